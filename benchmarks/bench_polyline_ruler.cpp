@@ -0,0 +1,498 @@
+// google-benchmark micro benchmarks for the hot C++ entry points,
+//
+//      make bench
+//
+// every case runs on synthetic polylines of 10 / 1k / 100k / 10M vertices,
+// cartesian (wgs84:0) and WGS84 (wgs84:1) where it applies, segment length
+// kernels once per instruction set (isa:0 generic, 1 avx2, 2 avx512), results
+// are written to build/bench_polyline_ruler.json (--benchmark_out), pick
+// cases with e.g.
+//
+//      ./build/bench/bench_polyline_ruler --benchmark_filter='ranges.*N:1000/'
+
+#include <benchmark/benchmark.h>
+
+#include <map>
+#include <random>
+
+#include "cheap_ruler.hpp"
+#include "crs_transform.hpp"
+#include "polyline_kernels.hpp"
+#include "polyline_ruler.hpp"
+
+using namespace cubao;
+
+namespace
+{
+const Eigen::Vector3d ANCHOR(120.0, 30.0, 10.0);
+
+// smooth random walk (~10m steps) in ENU, converted to LLA around ANCHOR
+// for wgs84, lines are generated once and shared by all cases
+const RowVectors &line(int N, bool is_wgs84)
+{
+    static std::map<std::pair<int, bool>, RowVectors> cache;
+    auto &ret = cache[{N, is_wgs84}];
+    if (ret.rows() == N) {
+        return ret;
+    }
+    std::mt19937 rng(N);
+    std::normal_distribution<double> turn(0.0, 0.1);
+    std::uniform_real_distribution<double> step(5.0, 15.0);
+    RowVectors enus(N, 3);
+    double heading = 0.0;
+    enus.row(0).setZero();
+    for (int i = 1; i < N; ++i) {
+        heading += turn(rng);
+        double d = step(rng);
+        enus.row(i) =
+            enus.row(i - 1) + Eigen::RowVector3d(d * std::cos(heading),
+                                                 d * std::sin(heading),
+                                                 0.01 * turn(rng));
+    }
+    ret = is_wgs84 ? enu2lla(enus, ANCHOR) : enus;
+    return ret;
+}
+
+// a point near (but not on) the middle of the line
+Eigen::Vector3d probe(const RowVectors &polyline, bool is_wgs84)
+{
+    Eigen::Vector3d p = polyline.row(polyline.rows() / 2);
+    p += is_wgs84 ? Eigen::Vector3d(1e-5, 1e-5, 0.0)
+                  : Eigen::Vector3d(1.0, 1.0, 0.0);
+    return p;
+}
+
+void Sizes(benchmark::internal::Benchmark *b)
+{
+    for (int N : {10, 1000, 100 * 1000, 10 * 1000 * 1000}) {
+        b->Args({N});
+    }
+    b->ArgNames({"N"})->Unit(benchmark::kMicrosecond);
+}
+
+void SizesAndCrs(benchmark::internal::Benchmark *b)
+{
+    for (int N : {10, 1000, 100 * 1000, 10 * 1000 * 1000}) {
+        for (int is_wgs84 : {0, 1}) {
+            b->Args({N, is_wgs84});
+        }
+    }
+    b->ArgNames({"N", "wgs84"})->Unit(benchmark::kMicrosecond);
+}
+
+// isa: 0 generic, 1 avx2, 2 avx512 (skipped if the CPU lacks it)
+void SizesAndIsa(benchmark::internal::Benchmark *b)
+{
+    for (int N : {1000, 100 * 1000, 10 * 1000 * 1000}) {
+        for (int isa : {0, 1, 2}) {
+            b->Args({N, isa});
+        }
+    }
+    b->ArgNames({"N", "isa"})->Unit(benchmark::kMicrosecond);
+}
+
+bool supported(benchmark::State &state, int isa)
+{
+    if (isa > (int)kernels::detect_isa()) {
+        state.SkipWithError("instruction set not supported");
+        return false;
+    }
+    return true;
+}
+} // namespace
+
+// PolylineRuler ///////////////////////////////////////////////////////////////
+
+static void BM_ranges(benchmark::State &state)
+{
+    const bool is_wgs84 = state.range(1);
+    const auto &polyline = line(state.range(0), is_wgs84);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(PolylineRuler::ranges(polyline, is_wgs84));
+    }
+    state.SetItemsProcessed(state.iterations() * polyline.rows());
+}
+BENCHMARK(BM_ranges)->Apply(SizesAndCrs);
+
+static void BM_dirs(benchmark::State &state)
+{
+    const bool is_wgs84 = state.range(1);
+    const auto &polyline = line(state.range(0), is_wgs84);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(PolylineRuler::dirs(polyline, is_wgs84));
+    }
+    state.SetItemsProcessed(state.iterations() * polyline.rows());
+}
+BENCHMARK(BM_dirs)->Apply(SizesAndCrs);
+
+// 1k queries against a ruler with cached ranges
+static void BM_along(benchmark::State &state)
+{
+    const bool is_wgs84 = state.range(1);
+    const auto &polyline = line(state.range(0), is_wgs84);
+    PolylineRuler ruler(polyline, is_wgs84);
+    const Eigen::VectorXd dists =
+        Eigen::VectorXd::LinSpaced(1000, 0.0, ruler.length());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ruler.along(dists));
+    }
+    state.SetItemsProcessed(state.iterations() * dists.size());
+}
+BENCHMARK(BM_along)->Apply(SizesAndCrs);
+
+static void BM_pointOnLine(benchmark::State &state)
+{
+    const bool is_wgs84 = state.range(1);
+    const auto &polyline = line(state.range(0), is_wgs84);
+    const Eigen::Vector3d p = probe(polyline, is_wgs84);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            PolylineRuler::pointOnLine(polyline, p, is_wgs84));
+    }
+    state.SetItemsProcessed(state.iterations() * polyline.rows());
+}
+BENCHMARK(BM_pointOnLine)->Apply(SizesAndCrs);
+
+static void BM_lineSlice(benchmark::State &state)
+{
+    const bool is_wgs84 = state.range(1);
+    const auto &polyline = line(state.range(0), is_wgs84);
+    const int N = polyline.rows();
+    const Eigen::Vector3d start = polyline.row(N / 4);
+    const Eigen::Vector3d stop = polyline.row(N * 3 / 4);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            PolylineRuler::lineSlice(start, stop, polyline, is_wgs84));
+    }
+    state.SetItemsProcessed(state.iterations() * N);
+}
+BENCHMARK(BM_lineSlice)->Apply(SizesAndCrs);
+
+static void BM_lineSliceAlong(benchmark::State &state)
+{
+    const bool is_wgs84 = state.range(1);
+    const auto &polyline = line(state.range(0), is_wgs84);
+    const double length = PolylineRuler(polyline, is_wgs84).length();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(PolylineRuler::lineSliceAlong(
+            0.25 * length, 0.75 * length, polyline, is_wgs84));
+    }
+    state.SetItemsProcessed(state.iterations() * polyline.rows());
+}
+BENCHMARK(BM_lineSliceAlong)->Apply(SizesAndCrs);
+
+static void BM_douglas_simplify(benchmark::State &state)
+{
+    const bool is_wgs84 = state.range(1);
+    const auto &polyline = line(state.range(0), is_wgs84);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            douglas_simplify_mask(polyline, 1.0, is_wgs84));
+    }
+    state.SetItemsProcessed(state.iterations() * polyline.rows());
+}
+BENCHMARK(BM_douglas_simplify)->Apply(SizesAndCrs);
+
+// consecutive segment pairs (i, i + 1) and (i, i + N/2)
+static void BM_intersect_segments(benchmark::State &state)
+{
+    const auto &polyline = line(state.range(0), false);
+    const int N = polyline.rows();
+    const int half = N / 2;
+    for (auto _ : state) {
+        int hits = 0;
+        for (int i = 0; i + 2 < N; ++i) {
+            const int j = (i + half) % (N - 1);
+            hits += intersect_segments(
+                        Eigen::Vector2d(polyline.row(i).head<2>()),
+                        Eigen::Vector2d(polyline.row(i + 1).head<2>()),
+                        Eigen::Vector2d(polyline.row(j).head<2>()),
+                        Eigen::Vector2d(polyline.row(j + 1).head<2>()))
+                        .has_value();
+        }
+        benchmark::DoNotOptimize(hits);
+    }
+    state.SetItemsProcessed(state.iterations() * (N - 2));
+}
+BENCHMARK(BM_intersect_segments)->Apply(Sizes);
+
+// segment length kernels (polyline_kernels.hpp) on each instruction set,
+// BM_ranges_reference is the plain Eigen rowwise norm + prefix sum
+static void BM_ranges_reference(benchmark::State &state)
+{
+    const auto &polyline = line(state.range(0), false);
+    const int N = polyline.rows();
+    Eigen::VectorXd ranges(N);
+    for (auto _ : state) {
+        ranges[0] = 0.0;
+        ranges.tail(N - 1) =
+            (polyline.bottomRows(N - 1) - polyline.topRows(N - 1))
+                .rowwise()
+                .norm();
+        for (int i = 1; i < N; ++i) {
+            ranges[i] += ranges[i - 1];
+        }
+        benchmark::DoNotOptimize(ranges.data());
+    }
+    state.SetItemsProcessed(state.iterations() * N);
+}
+BENCHMARK(BM_ranges_reference)->Apply(Sizes);
+
+static void BM_kernels_segment_lengths(benchmark::State &state)
+{
+    const auto &polyline = line(state.range(0), false);
+    const int isa = state.range(1);
+    if (!supported(state, isa)) {
+        return;
+    }
+    Eigen::VectorXd lengths(polyline.rows());
+    for (auto _ : state) {
+        kernels::segment_lengths(polyline.data(), polyline.rows(),
+                                 lengths.data(), (kernels::ISA)isa);
+        benchmark::DoNotOptimize(lengths.data());
+    }
+    state.SetItemsProcessed(state.iterations() * polyline.rows());
+}
+BENCHMARK(BM_kernels_segment_lengths)->Apply(SizesAndIsa);
+
+static void BM_kernels_ranges(benchmark::State &state)
+{
+    const auto &polyline = line(state.range(0), false);
+    const int isa = state.range(1);
+    if (!supported(state, isa)) {
+        return;
+    }
+    Eigen::VectorXd ranges(polyline.rows());
+    for (auto _ : state) {
+        kernels::ranges(polyline.data(), polyline.rows(), ranges.data(),
+                        (kernels::ISA)isa);
+        benchmark::DoNotOptimize(ranges.data());
+    }
+    state.SetItemsProcessed(state.iterations() * polyline.rows());
+}
+BENCHMARK(BM_kernels_ranges)->Apply(SizesAndIsa);
+
+static void BM_kernels_ranges_float32(benchmark::State &state)
+{
+    const RowVectorsNx3f polyline = line(state.range(0), false).cast<float>();
+    const int isa = state.range(1);
+    if (!supported(state, isa)) {
+        return;
+    }
+    Eigen::VectorXd ranges(polyline.rows());
+    for (auto _ : state) {
+        kernels::ranges(polyline.data(), polyline.rows(), ranges.data(),
+                        (kernels::ISA)isa);
+        benchmark::DoNotOptimize(ranges.data());
+    }
+    state.SetItemsProcessed(state.iterations() * polyline.rows());
+}
+BENCHMARK(BM_kernels_ranges_float32)->Apply(SizesAndIsa);
+
+static void BM_kernels_line_distance_longdiff(benchmark::State &state)
+{
+    const auto &llas = line(state.range(0), true);
+    const int isa = state.range(1);
+    if (!supported(state, isa)) {
+        return;
+    }
+    const Eigen::Vector3d k = CheapRuler(ANCHOR[1]).k();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(kernels::line_distance_longdiff(
+            llas.data(), llas.rows(), k.data(), (kernels::ISA)isa));
+    }
+    state.SetItemsProcessed(state.iterations() * llas.rows());
+}
+BENCHMARK(BM_kernels_line_distance_longdiff)->Apply(SizesAndIsa);
+
+// crs_transform ///////////////////////////////////////////////////////////////
+
+static void BM_lla2ecef(benchmark::State &state)
+{
+    const auto &llas = line(state.range(0), true);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(lla2ecef(llas));
+    }
+    state.SetItemsProcessed(state.iterations() * llas.rows());
+}
+BENCHMARK(BM_lla2ecef)->Apply(Sizes);
+
+static void BM_ecef2lla(benchmark::State &state)
+{
+    const RowVectors ecefs = lla2ecef(line(state.range(0), true));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ecef2lla(ecefs));
+    }
+    state.SetItemsProcessed(state.iterations() * ecefs.rows());
+}
+BENCHMARK(BM_ecef2lla)->Apply(Sizes);
+
+static void BM_lla2enu(benchmark::State &state)
+{
+    const auto &llas = line(state.range(0), true);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(lla2enu(llas, ANCHOR));
+    }
+    state.SetItemsProcessed(state.iterations() * llas.rows());
+}
+BENCHMARK(BM_lla2enu)->Apply(Sizes);
+
+static void BM_enu2lla(benchmark::State &state)
+{
+    const auto &enus = line(state.range(0), false);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(enu2lla(enus, ANCHOR));
+    }
+    state.SetItemsProcessed(state.iterations() * enus.rows());
+}
+BENCHMARK(BM_enu2lla)->Apply(Sizes);
+
+// in-place versions run as round trips so the buffer stays valid
+static void BM_lla_ecef_inplace(benchmark::State &state)
+{
+    RowVectors coords = line(state.range(0), true);
+    for (auto _ : state) {
+        lla2ecef_inplace(coords, 1);
+        ecef2lla_inplace(coords, 1);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * coords.rows() * 2);
+}
+BENCHMARK(BM_lla_ecef_inplace)->Apply(Sizes);
+
+static void BM_lla_enu_inplace(benchmark::State &state)
+{
+    RowVectors coords = line(state.range(0), true);
+    for (auto _ : state) {
+        lla2enu_inplace(coords, ANCHOR, true, 1);
+        enu2lla_inplace(coords, ANCHOR, true, 1);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * coords.rows() * 2);
+}
+BENCHMARK(BM_lla_enu_inplace)->Apply(Sizes);
+
+// CheapRuler (always WGS84) ///////////////////////////////////////////////////
+
+static void BM_CheapRuler_distance(benchmark::State &state)
+{
+    const auto &llas = line(state.range(0), true);
+    const CheapRuler ruler(ANCHOR[1]);
+    const int N = llas.rows();
+    for (auto _ : state) {
+        double sum = 0.0;
+        for (int i = 0; i + 1 < N; ++i) {
+            sum += ruler.distance(llas.row(i), llas.row(i + 1));
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * (N - 1));
+}
+BENCHMARK(BM_CheapRuler_distance)->Apply(Sizes);
+
+static void BM_CheapRuler_bearing(benchmark::State &state)
+{
+    const auto &llas = line(state.range(0), true);
+    const CheapRuler ruler(ANCHOR[1]);
+    const int N = llas.rows();
+    for (auto _ : state) {
+        double sum = 0.0;
+        for (int i = 0; i + 1 < N; ++i) {
+            sum += ruler.bearing(llas.row(i), llas.row(i + 1));
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * (N - 1));
+}
+BENCHMARK(BM_CheapRuler_bearing)->Apply(Sizes);
+
+static void BM_CheapRuler_destination(benchmark::State &state)
+{
+    const auto &llas = line(state.range(0), true);
+    const CheapRuler ruler(ANCHOR[1]);
+    const int N = llas.rows();
+    for (auto _ : state) {
+        Eigen::Vector3d sum(0.0, 0.0, 0.0);
+        for (int i = 0; i < N; ++i) {
+            sum += ruler.destination(llas.row(i), 10.0, 45.0);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * N);
+}
+BENCHMARK(BM_CheapRuler_destination)->Apply(Sizes);
+
+static void BM_CheapRuler_lineDistance(benchmark::State &state)
+{
+    const auto &llas = line(state.range(0), true);
+    const CheapRuler ruler(ANCHOR[1]);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ruler.lineDistance(llas));
+    }
+    state.SetItemsProcessed(state.iterations() * llas.rows());
+}
+BENCHMARK(BM_CheapRuler_lineDistance)->Apply(Sizes);
+
+static void BM_CheapRuler_area(benchmark::State &state)
+{
+    const auto &llas = line(state.range(0), true);
+    const CheapRuler ruler(ANCHOR[1]);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ruler.area(llas));
+    }
+    state.SetItemsProcessed(state.iterations() * llas.rows());
+}
+BENCHMARK(BM_CheapRuler_area)->Apply(Sizes);
+
+static void BM_CheapRuler_along(benchmark::State &state)
+{
+    const auto &llas = line(state.range(0), true);
+    const CheapRuler ruler(ANCHOR[1]);
+    const double dist = 0.5 * ruler.lineDistance(llas);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ruler.along(llas, dist));
+    }
+    state.SetItemsProcessed(state.iterations() * llas.rows());
+}
+BENCHMARK(BM_CheapRuler_along)->Apply(Sizes);
+
+static void BM_CheapRuler_pointOnLine(benchmark::State &state)
+{
+    const auto &llas = line(state.range(0), true);
+    const CheapRuler ruler(ANCHOR[1]);
+    const Eigen::Vector3d p = probe(llas, true);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ruler.pointOnLine(llas, p));
+    }
+    state.SetItemsProcessed(state.iterations() * llas.rows());
+}
+BENCHMARK(BM_CheapRuler_pointOnLine)->Apply(Sizes);
+
+static void BM_CheapRuler_lineSlice(benchmark::State &state)
+{
+    const auto &llas = line(state.range(0), true);
+    const CheapRuler ruler(ANCHOR[1]);
+    const int N = llas.rows();
+    const Eigen::Vector3d start = llas.row(N / 4);
+    const Eigen::Vector3d stop = llas.row(N * 3 / 4);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ruler.lineSlice(start, stop, llas));
+    }
+    state.SetItemsProcessed(state.iterations() * N);
+}
+BENCHMARK(BM_CheapRuler_lineSlice)->Apply(Sizes);
+
+static void BM_CheapRuler_lineSliceAlong(benchmark::State &state)
+{
+    const auto &llas = line(state.range(0), true);
+    const CheapRuler ruler(ANCHOR[1]);
+    const double length = ruler.lineDistance(llas);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            ruler.lineSliceAlong(0.25 * length, 0.75 * length, llas));
+    }
+    state.SetItemsProcessed(state.iterations() * llas.rows());
+}
+BENCHMARK(BM_CheapRuler_lineSliceAlong)->Apply(Sizes);
+
+BENCHMARK_MAIN();
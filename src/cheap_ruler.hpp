@@ -18,6 +18,7 @@
 #include <cassert>
 #include <cstdint>
 #include <limits>
+#include <stdexcept>
 #include <array>
 #include <tuple>
 #include <utility>
@@ -29,6 +30,9 @@
 #define M_PI 3.14159265358979323846
 #endif
 
+#include "parallel_for.hpp"
+#include "polyline_kernels.hpp"
+
 namespace cubao
 {
 using RowVectors = Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor>;
@@ -199,15 +203,17 @@ class CheapRuler
     //
     // Given a line (an array of points), returns the total line distance.
     //
-    double lineDistance(const Eigen::Ref<const line_string> &points)
+    double lineDistance(const Eigen::Ref<const line_string> &points) const
     {
-        double total = 0.;
-
-        for (int i = 1; i < points.rows(); ++i) {
-            total += distance(points.row(i - 1), points.row(i));
+        const int N = points.rows();
+        if (N < 2) {
+            return 0.;
         }
-
-        return total;
+        if (points.outerStride() != 3) {
+            return lineDistance(line_string(points));
+        }
+        const double k[3] = {kx, ky, kz};
+        return kernels::line_distance_longdiff(points.data(), N, k);
     }
 
     //
@@ -394,34 +400,48 @@ class CheapRuler
     // indicated by distance along the line.
     //
     line_string lineSliceAlong(double start, double stop,
-                               const Eigen::Ref<line_string> &line) const
+                               const Eigen::Ref<const line_string> &line) const
     {
+        // locate start & stop in one pass, then fill the slice directly
+        const int N = line.rows();
+        int i0 = N, j = N;
+        double t0 = 0., t1 = 0.;
         double sum = 0.;
-        std::vector<Eigen::Vector3d> slice;
 
-        for (int i = 1; i < line.rows(); ++i) {
-            auto p0 = line.row(i - 1);
-            auto p1 = line.row(i);
-            auto d = distance(p0, p1);
+        for (int i = 1; i < N; ++i) {
+            auto d = distance(line.row(i - 1), line.row(i));
 
             sum += d;
 
-            if (sum > start && slice.size() == 0) {
-                slice.push_back(interpolate(p0, p1, (start - (sum - d)) / d));
+            if (sum > start && i0 == N) {
+                i0 = i;
+                t0 = (start - (sum - d)) / d;
             }
 
             if (sum >= stop) {
-                slice.push_back(interpolate(p0, p1, (stop - (sum - d)) / d));
-                return line_string::Map(slice[0].data(),
-                                        (Eigen::Index)slice.size(), 3);
-            }
-
-            if (sum > start) {
-                slice.push_back(p1);
+                j = i;
+                t1 = (stop - (sum - d)) / d;
+                break;
             }
         }
 
-        return line_string::Map(slice[0].data(), (Eigen::Index)slice.size(), 3);
+        if (j < i0) {
+            line_string slice(1, 3);
+            slice.row(0) = interpolate(line.row(j - 1), line.row(j), t1);
+            return slice;
+        }
+        if (i0 >= N) {
+            return line_string(0, 3);
+        }
+        const int end = std::min(j, N);
+        line_string slice(1 + end - i0 + (j < N), 3);
+        slice.row(0) = interpolate(line.row(i0 - 1), line.row(i0), t0);
+        slice.middleRows(1, end - i0) = line.middleRows(i0, end - i0);
+        if (j < N) {
+            slice.row(slice.rows() - 1) =
+                interpolate(line.row(j - 1), line.row(j), t1);
+        }
+        return slice;
     }
 
     //
@@ -468,6 +488,189 @@ class CheapRuler
         return inside2d && bbox.first[2] <= p[2] && p[2] <= bbox.second[2];
     }
 
+    //
+    // Batch versions of the above, on rows of row-major Nx3 arrays, pairwise
+    // (a.row(i) with b.row(i)), a single row is broadcast (one-to-many),
+    // distanceMatrix is many-to-many. plain loops over rows (same formulas
+    // as the scalar methods, with a branch-free longDiff for longitudes in
+    // [-180, 180]), large inputs are split across n_threads (0 for all
+    // hardware threads)
+    //
+    line_string deltas(const Eigen::Ref<const line_string> &a,
+                       const Eigen::Ref<const line_string> &b,
+                       int n_threads = 0) const
+    {
+        const int N = __broadcast(a.rows(), b.rows());
+        const Rows A(a), B(b);
+        line_string ret(N, 3);
+        __for_chunks(
+            N,
+            [&](int begin, int end) {
+                for (int i = begin; i < end; ++i) {
+                    const double *p = A[i], *q = B[i];
+                    ret(i, 0) = __longDiff(q[0] - p[0]) * kx;
+                    ret(i, 1) = (q[1] - p[1]) * ky;
+                    ret(i, 2) = (q[2] - p[2]) * kz;
+                }
+            },
+            n_threads);
+        return ret;
+    }
+
+    Eigen::VectorXd squareDistances(const Eigen::Ref<const line_string> &a,
+                                    const Eigen::Ref<const line_string> &b,
+                                    int n_threads = 0) const
+    {
+        const int N = __broadcast(a.rows(), b.rows());
+        const Rows A(a), B(b);
+        Eigen::VectorXd ret(N);
+        __for_chunks(
+            N,
+            [&](int begin, int end) {
+                for (int i = begin; i < end; ++i) {
+                    ret[i] = __squareDistance(A[i], B[i]);
+                }
+            },
+            n_threads);
+        return ret;
+    }
+    Eigen::VectorXd distances(const Eigen::Ref<const line_string> &a,
+                              const Eigen::Ref<const line_string> &b,
+                              int n_threads = 0) const
+    {
+        return squareDistances(a, b, n_threads).cwiseSqrt();
+    }
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>
+    distanceMatrix(const Eigen::Ref<const line_string> &a,
+                   const Eigen::Ref<const line_string> &b,
+                   int n_threads = 0) const
+    {
+        const int M = b.rows();
+        const Rows A(a), B(b);
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>
+            ret(a.rows(), M);
+        parallel_for(
+            a.rows(),
+            [&](int begin, int end) {
+                for (int i = begin; i < end; ++i) {
+                    double *row = ret.row(i).data();
+                    for (int j = 0; j < M; ++j) {
+                        row[j] = std::sqrt(__squareDistance(A[i], B[j]));
+                    }
+                }
+            },
+            n_threads, std::max(1, BATCH_CHUNK / std::max(M, 1)));
+        return ret;
+    }
+
+    Eigen::VectorXd bearings(const Eigen::Ref<const line_string> &a,
+                             const Eigen::Ref<const line_string> &b,
+                             int n_threads = 0) const
+    {
+        const int N = __broadcast(a.rows(), b.rows());
+        const Rows A(a), B(b);
+        Eigen::VectorXd ret(N);
+        __for_chunks(
+            N,
+            [&](int begin, int end) {
+                for (int i = begin; i < end; ++i) {
+                    const double *p = A[i], *q = B[i];
+                    ret[i] = std::atan2(__longDiff(q[0] - p[0]) * kx,
+                                        (q[1] - p[1]) * ky) /
+                             RAD;
+                }
+            },
+            n_threads);
+        return ret;
+    }
+
+    line_string destinations(const Eigen::Ref<const line_string> &origins,
+                             const Eigen::Ref<const Eigen::VectorXd> &dists,
+                             const Eigen::Ref<const Eigen::VectorXd> &bearings,
+                             int n_threads = 0) const
+    {
+        const int N = __broadcast(origins.rows(), dists.size());
+        if (bearings.size() != dists.size()) {
+            throw std::invalid_argument(
+                "dists and bearings should have the same size");
+        }
+        const Rows O(origins);
+        // a single dist/bearing is broadcast, same as single rows
+        const Eigen::Index step = dists.size() > 1 ? 1 : 0;
+        line_string ret(N, 3);
+        __for_chunks(
+            N,
+            [&](int begin, int end) {
+                for (int i = begin; i < end; ++i) {
+                    const double *o = O[i];
+                    const double d = dists[i * step];
+                    const double a = bearings[i * step] * RAD;
+                    ret(i, 0) = o[0] + std::sin(a) * d / kx;
+                    ret(i, 1) = o[1] + std::cos(a) * d / ky;
+                    ret(i, 2) = o[2];
+                }
+            },
+            n_threads);
+        return ret;
+    }
+
+    // dxyzs are rows of [dx, dy, dz]
+    line_string offsets(const Eigen::Ref<const line_string> &origins,
+                        const Eigen::Ref<const line_string> &dxyzs,
+                        int n_threads = 0) const
+    {
+        const int N = __broadcast(origins.rows(), dxyzs.rows());
+        const Rows O(origins), D(dxyzs);
+        line_string ret(N, 3);
+        __for_chunks(
+            N,
+            [&](int begin, int end) {
+                for (int i = begin; i < end; ++i) {
+                    const double *o = O[i], *d = D[i];
+                    ret(i, 0) = o[0] + d[0] / kx;
+                    ret(i, 1) = o[1] + d[1] / ky;
+                    ret(i, 2) = o[2] + d[2] / kz;
+                }
+            },
+            n_threads);
+        return ret;
+    }
+
+    // returns [mins, maxs] of boxes
+    std::pair<line_string, line_string>
+    bufferPoints(const Eigen::Ref<const line_string> &points,
+                 double buffer) const
+    {
+        const Eigen::RowVector3d d(buffer / kx, buffer / ky, buffer / kz);
+        line_string mins = points.rowwise() - d;
+        line_string maxs = points.rowwise() + d;
+        return std::make_pair(std::move(mins), std::move(maxs));
+    }
+
+    // returns 1/0 per row
+    static Eigen::VectorXi
+    insideBBox(const Eigen::Ref<const line_string> &points, const box &bbox,
+               bool check_z = false, int n_threads = 0)
+    {
+        const Rows P(points);
+        const point &lo = bbox.first, &hi = bbox.second;
+        const bool any_z = !check_z;
+        Eigen::VectorXi mask(points.rows());
+        __for_chunks(
+            points.rows(),
+            [&](int begin, int end) {
+                for (int i = begin; i < end; ++i) {
+                    const double *p = P[i];
+                    mask[i] = (p[1] >= lo[1]) & (p[1] <= hi[1]) &
+                              (__longDiff(p[0] - lo[0]) >= 0) &
+                              (__longDiff(p[0] - hi[0]) <= 0) &
+                              (any_z | ((lo[2] <= p[2]) & (p[2] <= hi[2])));
+                }
+            },
+            n_threads);
+        return mask;
+    }
+
     static point interpolate(const point &a, const point &b, double t)
     {
         double dx = longDiff(b[0], a[0]);
@@ -479,13 +682,60 @@ class CheapRuler
 
     static double longDiff(double a, double b)
     {
-        return std::remainder(a - b, 360);
+        // same as std::remainder (n = 0) within [-180, 180], much cheaper
+        double d = a - b;
+        return (d >= -180.0 && d <= 180.0) ? d : std::remainder(d, 360);
     }
 
   private:
     double ky;
     double kx;
     double kz;
+
+    // batch loops are split across threads in chunks of at least this many
+    static constexpr int BATCH_CHUNK = 16384;
+    template <typename Fn>
+    static void __for_chunks(int N, Fn &&fn, int n_threads)
+    {
+        parallel_for(N, std::forward<Fn>(fn), n_threads, BATCH_CHUNK);
+    }
+    // rows of a batch input, a single row is broadcast (stride 0)
+    struct Rows
+    {
+        explicit Rows(const Eigen::Ref<const line_string> &m)
+            : data(m.data()), stride(m.rows() > 1 ? m.outerStride() : 0)
+        {
+        }
+        const double *operator[](Eigen::Index i) const
+        {
+            return data + i * stride;
+        }
+        const double *data;
+        Eigen::Index stride;
+    };
+    // longDiff(a, b) as __longDiff(a - b), folds once without branches,
+    // same as longDiff for |a - b| < 540 (any longitudes in [-180, 180]),
+    // up to the sign of zero (+0 for a - b = -360)
+    static double __longDiff(double d)
+    {
+        return d - 360.0 * ((d > 180.0) - (d < -180.0));
+    }
+    double __squareDistance(const double *a, const double *b) const
+    {
+        double dx = __longDiff(a[0] - b[0]) * kx;
+        double dy = (a[1] - b[1]) * ky;
+        double dz = (a[2] - b[2]) * kz;
+        return dx * dx + dy * dy + dz * dz;
+    }
+    // size of a pairwise batch, a single row is broadcast
+    static int __broadcast(int n, int m)
+    {
+        if (n != m && n != 1 && m != 1) {
+            throw std::invalid_argument("batch inputs should have the same "
+                                        "number of rows (or one row)");
+        }
+        return (n == 1 || m == 1) ? n * m : n;
+    }
 };
 
 } // namespace cheap_ruler
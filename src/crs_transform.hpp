@@ -15,6 +15,14 @@
 #include <Eigen/Geometry>
 #include <optional>
 
+#include "parallel_for.hpp"
+
+#if (defined(__GNUC__) || defined(__clang__)) &&                              \
+    (defined(__x86_64__) || defined(__i386__)) && !__INTELLISENSE__
+#define CUBAO_CRS_X86 1
+#include <immintrin.h>
+#endif
+
 #define _USE_MATH_DEFINES
 #include <cmath>
 #ifndef M_PI
@@ -107,6 +115,429 @@ inline void geodetic_to_ecef(const double lon_rad, const double lat_rad,
     y = NH * coslat * sinlong;
     z = (b * b * N / (a * a) + ht) * sinlat;
 }
+
+// bulk versions of the above, on SoA blocks (x[], y[], z[]) in place.
+// branch-free, with sin/cos/atan2 replaced by polynomial approximations
+// (cephes, ~1 ulp on the ranges used here), an AVX2/FMA path is picked at
+// runtime. results agree with the scalar functions to within
+//  - lon/lat: 1e-13 degrees
+//  - altitude, ecef/enu coordinates: 1e-8 meters
+// (for points within 1e7 meters of the earth's surface)
+namespace bulk
+{
+// sin & cos for |x| < 1e5
+inline void sincos(const double x, double &s, double &c)
+{
+    // x = q * pi/2 + r, |r| <= pi/4
+    constexpr double two_over_pi = 6.36619772367581382433e-01;
+    constexpr double pio2_1 = 1.57079632673412561417e+00;
+    constexpr double pio2_2 = 6.07710050630396597660e-11;
+    constexpr double pio2_2t = 2.02226624879595063154e-21;
+    // round to nearest without calling libm
+    constexpr double shifter = 6755399441055744.0; // 1.5 * 2^52
+    const double q = (x * two_over_pi + shifter) - shifter;
+    const double r = ((x - q * pio2_1) - q * pio2_2) - q * pio2_2t;
+    const double z = r * r;
+    const double sr =
+        r + r * z *
+                (((((1.58962301576546568060e-10 * z -
+                     2.50507477628578072866e-8) *
+                        z +
+                    2.75573136213857245213e-6) *
+                       z -
+                   1.98412698295895385996e-4) *
+                      z +
+                  8.33333333332211858878e-3) *
+                     z -
+                 1.66666666666666307295e-1);
+    const double cr =
+        1.0 - 0.5 * z +
+        z * z *
+            (((((-1.13585365213876817300e-11 * z +
+                 2.08757008419747316778e-9) *
+                    z -
+                2.75573141792967388112e-7) *
+                   z +
+               2.48015872888517045348e-5) *
+                  z -
+              1.38888888888730564116e-3) *
+                 z +
+             4.16666666666665929218e-2);
+    // quadrant: 0: (sr, cr), 1: (cr, -sr), 2: (-sr, -cr), 3: (-cr, sr)
+    const int n = (int)q;
+    const bool swap = n & 1;
+    const double s0 = swap ? cr : sr;
+    const double c0 = swap ? sr : cr;
+    s = (n & 2) ? -s0 : s0;
+    c = ((n + 1) & 2) ? -c0 : c0;
+}
+
+inline double atan2(const double y, const double x)
+{
+    constexpr double pio2 = 1.57079632679489661923;
+    constexpr double pio4 = 7.85398163397448309616e-1;
+    constexpr double morebits = 6.123233995736765886130e-17;
+    constexpr double t3p8 = 2.41421356237309504880; // tan(3pi/8)
+    const double ax = std::fabs(x);
+    const double ay = std::fabs(y);
+    // atan(t) for t in [0, inf], t = 0 when x == y == 0
+    const double t = ay == 0.0 ? 0.0 : ay / ax;
+    const bool big = t > t3p8;
+    const bool mid = !big && t > 0.66;
+    const double u = big ? -1.0 / t : (mid ? (t - 1.0) / (t + 1.0) : t);
+    const double base = big ? pio2 : (mid ? pio4 : 0.0);
+    const double more = big ? morebits : (mid ? 0.5 * morebits : 0.0);
+    const double z = u * u;
+    const double p = (((-8.750608600031904122785e-1 * z -
+                        1.615753718733365076637e1) *
+                           z -
+                       7.500855792314704667340e1) *
+                          z -
+                      1.228866684490136173410e2) *
+                         z -
+                     6.485021904942025371773e1;
+    const double q = ((((z + 2.485846490142306297962e1) * z +
+                        1.650270098316988542046e2) *
+                           z +
+                       4.328810604912902668951e2) *
+                          z +
+                      4.853903996359136964868e2) *
+                         z +
+                     1.945506571482613964425e2;
+    double a = base + ((u + u * (z * p / q)) + more);
+    // quadrants
+    a = std::copysign(1.0, x) < 0.0 ? (2.0 * pio2 - a) : a;
+    return std::copysign(a, y);
+}
+
+#ifdef CUBAO_CRS_X86
+// AVX2/FMA versions, 4 points per step, return number of points done
+#define CUBAO_CRS_AVX2 __attribute__((target("avx2,fma")))
+inline bool has_avx2_fma()
+{
+    static const bool ok = [] {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    }();
+    return ok;
+}
+namespace avx2
+{
+CUBAO_CRS_AVX2 inline __m256d set1(double v) { return _mm256_set1_pd(v); }
+// a * x + b
+CUBAO_CRS_AVX2 inline __m256d fma(__m256d a, __m256d x, double b)
+{
+    return _mm256_fmadd_pd(a, x, _mm256_set1_pd(b));
+}
+CUBAO_CRS_AVX2 inline __m256d copysign(__m256d mag, __m256d sgn)
+{
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    return _mm256_or_pd(_mm256_andnot_pd(sign, mag), _mm256_and_pd(sign, sgn));
+}
+
+CUBAO_CRS_AVX2 inline void sincos(__m256d x, __m256d &s, __m256d &c)
+{
+    const __m256d shifter = set1(6755399441055744.0);
+    const __m256d qs = _mm256_add_pd(
+        _mm256_mul_pd(x, set1(6.36619772367581382433e-01)), shifter);
+    const __m256d q = _mm256_sub_pd(qs, shifter);
+    // low mantissa bits of qs hold the integer q
+    const __m256i n = _mm256_castpd_si256(qs);
+    __m256d r = _mm256_fnmadd_pd(q, set1(1.57079632673412561417e+00), x);
+    r = _mm256_fnmadd_pd(q, set1(6.07710050630396597660e-11), r);
+    r = _mm256_fnmadd_pd(q, set1(2.02226624879595063154e-21), r);
+    const __m256d z = _mm256_mul_pd(r, r);
+    __m256d ps = fma(set1(1.58962301576546568060e-10), z,
+                     -2.50507477628578072866e-8);
+    ps = fma(ps, z, 2.75573136213857245213e-6);
+    ps = fma(ps, z, -1.98412698295895385996e-4);
+    ps = fma(ps, z, 8.33333333332211858878e-3);
+    ps = fma(ps, z, -1.66666666666666307295e-1);
+    const __m256d sr = _mm256_fmadd_pd(_mm256_mul_pd(r, z), ps, r);
+    __m256d pc = fma(set1(-1.13585365213876817300e-11), z,
+                     2.08757008419747316778e-9);
+    pc = fma(pc, z, -2.75573141792967388112e-7);
+    pc = fma(pc, z, 2.48015872888517045348e-5);
+    pc = fma(pc, z, -1.38888888888730564116e-3);
+    pc = fma(pc, z, 4.16666666666665929218e-2);
+    const __m256d cr = _mm256_fmadd_pd(
+        _mm256_mul_pd(z, z), pc, _mm256_fnmadd_pd(set1(0.5), z, set1(1.0)));
+    const __m256i one = _mm256_set1_epi64x(1);
+    const __m256i two = _mm256_set1_epi64x(2);
+    const __m256d swap = _mm256_castsi256_pd(
+        _mm256_cmpeq_epi64(_mm256_and_si256(n, one), one));
+    const __m256d sign_s = _mm256_castsi256_pd(
+        _mm256_slli_epi64(_mm256_and_si256(n, two), 62));
+    const __m256d sign_c = _mm256_castsi256_pd(_mm256_slli_epi64(
+        _mm256_and_si256(_mm256_add_epi64(n, one), two), 62));
+    s = _mm256_xor_pd(_mm256_blendv_pd(sr, cr, swap), sign_s);
+    c = _mm256_xor_pd(_mm256_blendv_pd(cr, sr, swap), sign_c);
+}
+
+CUBAO_CRS_AVX2 inline __m256d atan2(__m256d y, __m256d x)
+{
+    constexpr double pio2 = 1.57079632679489661923;
+    constexpr double morebits = 6.123233995736765886130e-17;
+    const __m256d sign = set1(-0.0);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d ax = _mm256_andnot_pd(sign, x);
+    const __m256d ay = _mm256_andnot_pd(sign, y);
+    __m256d t = _mm256_div_pd(ay, ax);
+    t = _mm256_blendv_pd(t, zero, _mm256_cmp_pd(ay, zero, _CMP_EQ_OQ));
+    const __m256d big = _mm256_cmp_pd(t, set1(2.41421356237309504880),
+                                      _CMP_GT_OQ);
+    const __m256d mid =
+        _mm256_andnot_pd(big, _mm256_cmp_pd(t, set1(0.66), _CMP_GT_OQ));
+    const __m256d u = _mm256_blendv_pd(
+        _mm256_blendv_pd(t,
+                         _mm256_div_pd(_mm256_sub_pd(t, set1(1.0)),
+                                       _mm256_add_pd(t, set1(1.0))),
+                         mid),
+        _mm256_div_pd(set1(-1.0), t), big);
+    const __m256d base = _mm256_blendv_pd(
+        _mm256_blendv_pd(zero, set1(pio2 / 2), mid), set1(pio2), big);
+    const __m256d more = _mm256_blendv_pd(
+        _mm256_blendv_pd(zero, set1(0.5 * morebits), mid), set1(morebits),
+        big);
+    const __m256d z = _mm256_mul_pd(u, u);
+    __m256d p = fma(set1(-8.750608600031904122785e-1), z,
+                    -1.615753718733365076637e1);
+    p = fma(p, z, -7.500855792314704667340e1);
+    p = fma(p, z, -1.228866684490136173410e2);
+    p = fma(p, z, -6.485021904942025371773e1);
+    __m256d q = _mm256_add_pd(z, set1(2.485846490142306297962e1));
+    q = fma(q, z, 1.650270098316988542046e2);
+    q = fma(q, z, 4.328810604912902668951e2);
+    q = fma(q, z, 4.853903996359136964868e2);
+    q = fma(q, z, 1.945506571482613964425e2);
+    __m256d a = _mm256_fmadd_pd(u, _mm256_div_pd(_mm256_mul_pd(z, p), q), u);
+    a = _mm256_add_pd(base, _mm256_add_pd(a, more));
+    // quadrants, blendv selects on the sign bit of x
+    a = _mm256_blendv_pd(a, _mm256_sub_pd(set1(2.0 * pio2), a), x);
+    return copysign(a, y);
+}
+
+CUBAO_CRS_AVX2 inline int ecef_to_geodetic(double *xs, double *ys,
+                                           double *zs, int n)
+{
+    constexpr auto a = 6378137.0;
+    constexpr auto e2 = 6.6943799901377997e-3;
+    constexpr auto a1 = a * e2;
+    constexpr auto a2 = a1 * a1;
+    constexpr auto a3 = a1 * e2 / 2;
+    constexpr auto a4 = 2.5 * a2;
+    constexpr auto a5 = a1 + a3;
+    const __m256d one = set1(1.0);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256d x = _mm256_loadu_pd(xs + i);
+        const __m256d y = _mm256_loadu_pd(ys + i);
+        const __m256d z = _mm256_loadu_pd(zs + i);
+        const __m256d w2 = _mm256_add_pd(_mm256_mul_pd(x, x),
+                                         _mm256_mul_pd(y, y));
+        const __m256d w = _mm256_sqrt_pd(w2);
+        const __m256d z2 = _mm256_mul_pd(z, z);
+        const __m256d r2 = _mm256_add_pd(w2, z2);
+        const __m256d r = _mm256_sqrt_pd(r2);
+        const __m256d s2 = _mm256_div_pd(z2, r2);
+        const __m256d c2 = _mm256_div_pd(w2, r2);
+        __m256d u = _mm256_div_pd(set1(a2), r);
+        __m256d v = _mm256_sub_pd(set1(a3), _mm256_div_pd(set1(a4), r));
+        // equatorial
+        __m256d se = _mm256_add_pd(_mm256_add_pd(set1(a1), u),
+                                   _mm256_mul_pd(s2, v));
+        se = _mm256_add_pd(one, _mm256_div_pd(_mm256_mul_pd(c2, se), r));
+        se = _mm256_mul_pd(_mm256_div_pd(z, r), se);
+        const __m256d sse = _mm256_mul_pd(se, se);
+        const __m256d ce = _mm256_sqrt_pd(_mm256_sub_pd(one, sse));
+        // polar
+        __m256d cp = _mm256_sub_pd(_mm256_sub_pd(set1(a5), u),
+                                   _mm256_mul_pd(c2, v));
+        cp = _mm256_sub_pd(one, _mm256_div_pd(_mm256_mul_pd(s2, cp), r));
+        cp = _mm256_mul_pd(_mm256_div_pd(w, r), cp);
+        const __m256d ssp = _mm256_sub_pd(one, _mm256_mul_pd(cp, cp));
+        const __m256d sp = copysign(_mm256_sqrt_pd(ssp), z);
+        const __m256d equatorial = _mm256_cmp_pd(c2, set1(0.5), _CMP_GT_OQ);
+        const __m256d s = _mm256_blendv_pd(sp, se, equatorial);
+        const __m256d c = _mm256_blendv_pd(cp, ce, equatorial);
+        const __m256d ss = _mm256_blendv_pd(ssp, sse, equatorial);
+
+        const __m256d d2 = _mm256_sub_pd(one, _mm256_mul_pd(set1(e2), ss));
+        const __m256d Rn = _mm256_div_pd(set1(a), _mm256_sqrt_pd(d2));
+        const __m256d Rm = _mm256_div_pd(_mm256_mul_pd(set1(1 - e2), Rn), d2);
+        const __m256d rf = _mm256_mul_pd(set1(1 - e2), Rn);
+        u = _mm256_sub_pd(w, _mm256_mul_pd(Rn, c));
+        v = _mm256_sub_pd(z, _mm256_mul_pd(rf, s));
+        const __m256d f =
+            _mm256_add_pd(_mm256_mul_pd(c, u), _mm256_mul_pd(s, v));
+        const __m256d m =
+            _mm256_sub_pd(_mm256_mul_pd(c, v), _mm256_mul_pd(s, u));
+        const __m256d p = _mm256_div_pd(m, _mm256_add_pd(Rm, f));
+
+        const __m256d deg = set1(180.0 / M_PI);
+        _mm256_storeu_pd(xs + i, _mm256_mul_pd(deg, atan2(y, x)));
+        _mm256_storeu_pd(
+            ys + i, _mm256_mul_pd(deg, _mm256_add_pd(atan2(s, c), p)));
+        _mm256_storeu_pd(
+            zs + i, _mm256_add_pd(f, _mm256_mul_pd(_mm256_mul_pd(m, p),
+                                                   set1(0.5))));
+    }
+    return i;
+}
+
+CUBAO_CRS_AVX2 inline int geodetic_to_ecef(double *xs, double *ys,
+                                           double *zs, int n)
+{
+    constexpr double a = 6378137.0;
+    constexpr double b = 6356752.314245;
+    constexpr double E = (a * a - b * b) / (a * a);
+    const __m256d rad = set1(M_PI / 180.0);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d coslat, sinlat, coslong, sinlong;
+        sincos(_mm256_mul_pd(rad, _mm256_loadu_pd(ys + i)), sinlat, coslat);
+        sincos(_mm256_mul_pd(rad, _mm256_loadu_pd(xs + i)), sinlong, coslong);
+        const __m256d ht = _mm256_loadu_pd(zs + i);
+        const __m256d N = _mm256_div_pd(
+            set1(a),
+            _mm256_sqrt_pd(_mm256_sub_pd(
+                set1(1.0),
+                _mm256_mul_pd(_mm256_mul_pd(set1(E), sinlat), sinlat))));
+        const __m256d NHc = _mm256_mul_pd(_mm256_add_pd(N, ht), coslat);
+        _mm256_storeu_pd(xs + i, _mm256_mul_pd(NHc, coslong));
+        _mm256_storeu_pd(ys + i, _mm256_mul_pd(NHc, sinlong));
+        _mm256_storeu_pd(
+            zs + i,
+            _mm256_mul_pd(
+                _mm256_add_pd(_mm256_mul_pd(set1(b * b / (a * a)), N), ht),
+                sinlat));
+    }
+    return i;
+}
+} // namespace avx2
+#undef CUBAO_CRS_AVX2
+#endif
+
+// in-place on SoA blocks: x, y, z (ecef) -> lon, lat (degrees), alt
+inline void ecef_to_geodetic(double *__restrict xs, double *__restrict ys,
+                             double *__restrict zs, int n)
+{
+    constexpr auto a = 6378137.0;
+    constexpr auto e2 = 6.6943799901377997e-3;
+    constexpr auto a1 = a * e2;
+    constexpr auto a2 = a1 * a1;
+    constexpr auto a3 = a1 * e2 / 2;
+    constexpr auto a4 = 2.5 * a2;
+    constexpr auto a5 = a1 + a3;
+    int i = 0;
+#ifdef CUBAO_CRS_X86
+    if (has_avx2_fma()) {
+        i = avx2::ecef_to_geodetic(xs, ys, zs, n);
+    }
+#endif
+    for (; i < n; ++i) {
+        const double x = xs[i], y = ys[i], z = zs[i];
+        const double w2 = x * x + y * y;
+        const double w = std::sqrt(w2);
+        const double z2 = z * z;
+        const double r2 = w2 + z2;
+        const double r = std::sqrt(r2);
+        const double s2 = z2 / r2;
+        const double c2 = w2 / r2;
+        double u = a2 / r;
+        double v = a3 - a4 / r;
+        // both branches of the scalar code, asin(s) & acos(c) are then
+        // atan2(s, c) with s^2 + c^2 = 1
+        const double se = (z / r) * (1 + c2 * (a1 + u + s2 * v) / r);
+        const double sse = se * se;
+        const double ce = std::sqrt(1 - sse);
+        const double cp = (w / r) * (1 - s2 * (a5 - u - c2 * v) / r);
+        const double ssp = 1 - cp * cp;
+        const double sp = std::copysign(std::sqrt(ssp), z);
+        const bool equatorial = c2 > 0.5;
+        const double s = equatorial ? se : sp;
+        const double c = equatorial ? ce : cp;
+        const double ss = equatorial ? sse : ssp;
+
+        const double d2 = 1 - e2 * ss;
+        const double Rn = a / std::sqrt(d2);
+        const double Rm = (1 - e2) * Rn / d2;
+        const double rf = (1 - e2) * Rn;
+        u = w - Rn * c;
+        v = z - rf * s;
+        const double f = c * u + s * v;
+        const double m = c * v - s * u;
+        const double p = m / (Rm + f);
+
+        xs[i] = 180.0 / M_PI * atan2(y, x);
+        ys[i] = 180.0 / M_PI * (atan2(s, c) + p);
+        zs[i] = f + m * p / 2;
+    }
+}
+
+// in-place on SoA blocks: lon, lat (degrees), alt -> x, y, z (ecef)
+inline void geodetic_to_ecef(double *__restrict xs, double *__restrict ys,
+                             double *__restrict zs, int n)
+{
+    constexpr double a = 6378137.0;
+    constexpr double b = 6356752.314245;
+    constexpr double E = (a * a - b * b) / (a * a);
+    int i = 0;
+#ifdef CUBAO_CRS_X86
+    if (has_avx2_fma()) {
+        i = avx2::geodetic_to_ecef(xs, ys, zs, n);
+    }
+#endif
+    for (; i < n; ++i) {
+        double coslat, sinlat, coslong, sinlong;
+        sincos(M_PI / 180.0 * ys[i], sinlat, coslat);
+        sincos(M_PI / 180.0 * xs[i], sinlong, coslong);
+        const double ht = zs[i];
+        const double N = a / (std::sqrt(1 - E * sinlat * sinlat));
+        const double NH = N + ht;
+        xs[i] = NH * coslat * coslong;
+        ys[i] = NH * coslat * sinlong;
+        zs[i] = (b * b * N / (a * a) + ht) * sinlat;
+    }
+}
+
+// in-place on SoA blocks: p = R * p + t (T is row-major 4x4)
+inline void apply_transform(const double *T, double *__restrict xs,
+                            double *__restrict ys, double *__restrict zs,
+                            int n)
+{
+    for (int i = 0; i < n; ++i) {
+        const double x = xs[i], y = ys[i], z = zs[i];
+        xs[i] = T[0] * x + T[1] * y + T[2] * z + T[3];
+        ys[i] = T[4] * x + T[5] * y + T[6] * z + T[7];
+        zs[i] = T[8] * x + T[9] * y + T[10] * z + T[11];
+    }
+}
+
+// in-place on SoA blocks: p = (p - anchor) * k
+inline void scale_offset(const double *anchor, const double *k,
+                         double *__restrict xs, double *__restrict ys,
+                         double *__restrict zs, int n)
+{
+    for (int i = 0; i < n; ++i) {
+        xs[i] = (xs[i] - anchor[0]) * k[0];
+        ys[i] = (ys[i] - anchor[1]) * k[1];
+        zs[i] = (zs[i] - anchor[2]) * k[2];
+    }
+}
+
+// in-place on SoA blocks: p = p / k + anchor
+inline void unscale_offset(const double *anchor, const double *k,
+                           double *__restrict xs, double *__restrict ys,
+                           double *__restrict zs, int n)
+{
+    for (int i = 0; i < n; ++i) {
+        xs[i] = xs[i] / k[0] + anchor[0];
+        ys[i] = ys[i] / k[1] + anchor[1];
+        zs[i] = zs[i] / k[2] + anchor[2];
+    }
+}
+} // namespace bulk
 } // namespace internal
 
 // note that:
@@ -275,7 +706,7 @@ inline RowVectors enu2ecef(const Eigen::Ref<const RowVectors> &enus,
         return lla2ecef(enu2lla(enus, anchor_lla, cheap_ruler));
     }
     // lossless and and even faster than cheap-ruler
-    return apply_transform(T_ecef_enu(anchor_lla).inverse(), enus);
+    return apply_transform(T_ecef_enu(anchor_lla), enus);
 }
 inline RowVectors ecef2enu(const Eigen::Ref<const RowVectors> &ecef,
                            std::optional<Eigen::Vector3d> anchor_lla = {},
@@ -294,6 +725,161 @@ inline RowVectors ecef2enu(const Eigen::Ref<const RowVectors> &ecef,
     return apply_transform(T_ecef_enu(*anchor_lla).inverse(), ecef);
 }
 
+namespace internal
+{
+using Matrix4dRowMajor = Eigen::Matrix<double, 4, 4, Eigen::RowMajor>;
+// copies blocks of rows into SoA buffers, runs `fn(xs, ys, zs, n)` on them
+// and writes back, rows are split across n_threads threads
+template <typename Fn>
+inline void transform_inplace(Eigen::Ref<RowVectors> coords, Fn &&fn,
+                              int n_threads)
+{
+    parallel_for(
+        coords.rows(),
+        [&](int begin, int end) {
+            constexpr int B = 256;
+            double xs[B], ys[B], zs[B];
+            for (int i = begin; i < end; i += B) {
+                const int n = std::min(B, end - i);
+                for (int j = 0; j < n; ++j) {
+                    xs[j] = coords(i + j, 0);
+                    ys[j] = coords(i + j, 1);
+                    zs[j] = coords(i + j, 2);
+                }
+                fn(xs, ys, zs, n);
+                for (int j = 0; j < n; ++j) {
+                    coords(i + j, 0) = xs[j];
+                    coords(i + j, 1) = ys[j];
+                    coords(i + j, 2) = zs[j];
+                }
+            }
+        },
+        n_threads, 1 << 14);
+}
+} // namespace internal
+
+// in-place bulk conversions, for large inputs (e.g. point clouds):
+// vectorized (see internal::bulk for the accuracy vs. the functions above)
+// and split across n_threads threads (0 for all hardware threads)
+inline void ecef2lla_inplace(Eigen::Ref<RowVectors> coords, int n_threads = 0)
+{
+    internal::transform_inplace(coords, internal::bulk::ecef_to_geodetic,
+                                n_threads);
+}
+inline void lla2ecef_inplace(Eigen::Ref<RowVectors> coords, int n_threads = 0)
+{
+    internal::transform_inplace(coords, internal::bulk::geodetic_to_ecef,
+                                n_threads);
+}
+inline void lla2enu_inplace(Eigen::Ref<RowVectors> coords,
+                            std::optional<Eigen::Vector3d> anchor_lla = {},
+                            bool cheap_ruler = true, int n_threads = 0)
+{
+    if (!coords.rows()) {
+        return;
+    }
+    if (!anchor_lla) {
+        anchor_lla = coords.row(0);
+    }
+    if (cheap_ruler) {
+        auto k = cheap_ruler_k((*anchor_lla)[1]);
+        internal::transform_inplace(
+            coords,
+            [&](double *xs, double *ys, double *zs, int n) {
+                internal::bulk::scale_offset(anchor_lla->data(), k.data(), //
+                                             xs, ys, zs, n);
+            },
+            n_threads);
+        return;
+    }
+    internal::Matrix4dRowMajor T = T_ecef_enu(*anchor_lla).inverse();
+    internal::transform_inplace(
+        coords,
+        [&](double *xs, double *ys, double *zs, int n) {
+            internal::bulk::geodetic_to_ecef(xs, ys, zs, n);
+            internal::bulk::apply_transform(T.data(), xs, ys, zs, n);
+        },
+        n_threads);
+}
+inline void enu2lla_inplace(Eigen::Ref<RowVectors> coords,
+                            const Eigen::Vector3d &anchor_lla,
+                            bool cheap_ruler = true, int n_threads = 0)
+{
+    if (cheap_ruler) {
+        auto k = cheap_ruler_k(anchor_lla[1]);
+        internal::transform_inplace(
+            coords,
+            [&](double *xs, double *ys, double *zs, int n) {
+                internal::bulk::unscale_offset(anchor_lla.data(), k.data(), //
+                                               xs, ys, zs, n);
+            },
+            n_threads);
+        return;
+    }
+    internal::Matrix4dRowMajor T = T_ecef_enu(anchor_lla);
+    internal::transform_inplace(
+        coords,
+        [&](double *xs, double *ys, double *zs, int n) {
+            internal::bulk::apply_transform(T.data(), xs, ys, zs, n);
+            internal::bulk::ecef_to_geodetic(xs, ys, zs, n);
+        },
+        n_threads);
+}
+inline void enu2ecef_inplace(Eigen::Ref<RowVectors> coords,
+                             const Eigen::Vector3d &anchor_lla,
+                             bool cheap_ruler = false, int n_threads = 0)
+{
+    if (cheap_ruler) {
+        auto k = cheap_ruler_k(anchor_lla[1]);
+        internal::transform_inplace(
+            coords,
+            [&](double *xs, double *ys, double *zs, int n) {
+                internal::bulk::unscale_offset(anchor_lla.data(), k.data(), //
+                                               xs, ys, zs, n);
+                internal::bulk::geodetic_to_ecef(xs, ys, zs, n);
+            },
+            n_threads);
+        return;
+    }
+    internal::Matrix4dRowMajor T = T_ecef_enu(anchor_lla);
+    internal::transform_inplace(
+        coords,
+        [&](double *xs, double *ys, double *zs, int n) {
+            internal::bulk::apply_transform(T.data(), xs, ys, zs, n);
+        },
+        n_threads);
+}
+inline void ecef2enu_inplace(Eigen::Ref<RowVectors> coords,
+                             std::optional<Eigen::Vector3d> anchor_lla = {},
+                             bool cheap_ruler = false, int n_threads = 0)
+{
+    if (!coords.rows()) {
+        return;
+    }
+    if (!anchor_lla) {
+        anchor_lla = ecef2lla(coords(0, 0), coords(0, 1), coords(0, 2));
+    }
+    if (cheap_ruler) {
+        auto k = cheap_ruler_k((*anchor_lla)[1]);
+        internal::transform_inplace(
+            coords,
+            [&](double *xs, double *ys, double *zs, int n) {
+                internal::bulk::ecef_to_geodetic(xs, ys, zs, n);
+                internal::bulk::scale_offset(anchor_lla->data(), k.data(), //
+                                             xs, ys, zs, n);
+            },
+            n_threads);
+        return;
+    }
+    internal::Matrix4dRowMajor T = T_ecef_enu(*anchor_lla).inverse();
+    internal::transform_inplace(
+        coords,
+        [&](double *xs, double *ys, double *zs, int n) {
+            internal::bulk::apply_transform(T.data(), xs, ys, zs, n);
+        },
+        n_threads);
+}
+
 } // namespace cubao
 
 #endif
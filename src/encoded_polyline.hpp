@@ -0,0 +1,322 @@
+#ifndef CUBAO_ENCODED_POLYLINE_HPP
+#define CUBAO_ENCODED_POLYLINE_HPP
+
+// should sync
+// - https://github.com/cubao/polyline-ruler/blob/master/src/encoded_polyline.hpp
+
+// https://github.com/microsoft/vscode-cpptools/issues/9692
+#if __INTELLISENSE__
+#undef __ARM_NEON
+#undef __ARM_NEON__
+#endif
+
+#include <Eigen/Core>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "parallel_for.hpp"
+#include "polyline_ruler.hpp"
+
+namespace cubao
+{
+// compact (lossy) polyline storage in the encoded polyline format
+// (https://developers.google.com/maps/documentation/utilities/polylinealgorithm):
+// fixed-point values (rounded to `precision` decimal digits), deltas to the
+// previous point, zigzag, then 5-bit chunks as printable chars (63 ~ 126).
+// points are encoded as [y, x] ([lat, lon] for wgs84, same as google),
+// with z_precision, as [y, x, z] (z with its own precision), decoded Nx3
+// (zero z for 2D). typical gps tracks take 2~6 bytes per point (vs 24).
+namespace internal
+{
+inline double encoding_factor(int precision)
+{
+    if (precision < 0 || precision > 15) {
+        throw std::invalid_argument("precision should be within [0, 15]");
+    }
+    return std::pow(10.0, precision);
+}
+
+inline void encode_value(int64_t delta, std::string &encoded)
+{
+    uint64_t v = (static_cast<uint64_t>(delta) << 1) ^
+                 static_cast<uint64_t>(delta >> 63);
+    while (v >= 0x20) {
+        encoded.push_back(static_cast<char>((0x20 | (v & 0x1f)) + 63));
+        v >>= 5;
+    }
+    encoded.push_back(static_cast<char>(v + 63));
+}
+
+// number of encoded values, -1 if malformed (bad chars, truncated value)
+inline int64_t count_values(const std::string &encoded)
+{
+    int64_t n = 0;
+    int chunks = 0;
+    for (unsigned char c : encoded) {
+        if (c < 63 || c > 126 || ++chunks > 13) {
+            return -1;
+        }
+        if (c < 63 + 0x20) {
+            ++n;
+            chunks = 0;
+        }
+    }
+    return chunks ? -1 : n;
+}
+
+// decodes a well-formed (see count_values) string of `dims` values per
+// point into `coords` (rows already sized)
+inline void decode_values(const std::string &encoded, double factor,
+                          double z_factor, int dims,
+                          Eigen::Ref<RowVectors> coords)
+{
+    const double inv[3] = {1.0 / factor, 1.0 / factor, 1.0 / z_factor};
+    const int cols[3] = {1, 0, 2};
+    // wraps around (instead of overflowing) on garbage input
+    uint64_t values[3] = {0, 0, 0};
+    const char *p = encoded.data();
+    for (int i = 0; i < coords.rows(); ++i) {
+        for (int d = 0; d < dims; ++d) {
+            uint64_t v = 0;
+            int shift = 0;
+            int c;
+            do {
+                c = *p++ - 63;
+                v |= static_cast<uint64_t>(c & 0x1f) << shift;
+                shift += 5;
+            } while (c >= 0x20);
+            values[d] += (v >> 1) ^ (0 - (v & 1));
+            coords(i, cols[d]) = static_cast<int64_t>(values[d]) * inv[d];
+        }
+        if (dims == 2) {
+            coords(i, 2) = 0.0;
+        }
+    }
+}
+
+inline std::string encode_polyline(const Eigen::Ref<const RowVectors> &coords,
+                                   int precision,
+                                   std::optional<int> z_precision)
+{
+    const double factors[3] = {
+        internal::encoding_factor(precision),
+        internal::encoding_factor(precision),
+        z_precision ? internal::encoding_factor(*z_precision) : 1.0};
+    const int cols[3] = {1, 0, 2};
+    const int dims = z_precision ? 3 : 2;
+    int64_t prev[3] = {0, 0, 0};
+    std::string encoded;
+    encoded.reserve(coords.rows() * dims * 2);
+    for (int i = 0; i < coords.rows(); ++i) {
+        for (int d = 0; d < dims; ++d) {
+            double v = std::round(coords(i, cols[d]) * factors[d]);
+            // also rejects nan & inf
+            if (!(std::abs(v) < 0x1p60)) {
+                throw std::invalid_argument(
+                    "coordinates out of range for encoding");
+            }
+            int64_t value = static_cast<int64_t>(v);
+            internal::encode_value(value - prev[d], encoded);
+            prev[d] = value;
+        }
+    }
+    return encoded;
+}
+} // namespace internal
+
+inline std::string encode_polyline(const RowVectors &coords, int precision = 5,
+                                   std::optional<int> z_precision = {})
+{
+    return internal::encode_polyline(coords, precision, z_precision);
+}
+inline std::string
+encode_polyline(const Eigen::Ref<const RowVectorsNx2> &coords,
+                int precision = 5)
+{
+    return internal::encode_polyline(to_Nx3(coords), precision, {});
+}
+
+inline RowVectors decode_polyline(const std::string &encoded,
+                                  int precision = 5,
+                                  std::optional<int> z_precision = {})
+{
+    const double factor = internal::encoding_factor(precision);
+    const double z_factor =
+        z_precision ? internal::encoding_factor(*z_precision) : 1.0;
+    const int dims = z_precision ? 3 : 2;
+    const int64_t n = internal::count_values(encoded);
+    if (n < 0 || n % dims) {
+        throw std::invalid_argument("malformed encoded polyline");
+    }
+    RowVectors coords(n / dims, 3);
+    internal::decode_values(encoded, factor, z_factor, dims, coords);
+    return coords;
+}
+
+// encode_polyline on many polylines packed in one buffer, polyline k is
+// coords[offsets[k]:offsets[k+1]], split across n_threads (0 for all
+// hardware threads)
+inline std::vector<std::string>
+encode_polylines(const Eigen::Ref<const RowVectors> &coords,
+                 const Eigen::Ref<const Eigen::VectorXi> &offsets,
+                 int precision = 5, std::optional<int> z_precision = {},
+                 int n_threads = 0)
+{
+    internal::check_offsets(offsets, coords.rows());
+    const int M = std::max(0, (int)offsets.size() - 1);
+    internal::encoding_factor(precision);
+    if (z_precision) {
+        internal::encoding_factor(*z_precision);
+    }
+    std::vector<std::string> encoded(M);
+    std::vector<std::string> errors(M);
+    parallel_for(
+        M,
+        [&](int begin, int end) {
+            for (int k = begin; k < end; ++k) {
+                try {
+                    encoded[k] = internal::encode_polyline(
+                        coords.middleRows(offsets[k],
+                                          offsets[k + 1] - offsets[k]),
+                        precision, z_precision);
+                } catch (std::invalid_argument &e) {
+                    errors[k] = e.what();
+                }
+            }
+        },
+        n_threads, 64);
+    for (auto &error : errors) {
+        if (!error.empty()) {
+            throw std::invalid_argument(error);
+        }
+    }
+    return encoded;
+}
+
+// decode_polyline on many strings, returns [coords, offsets] (polyline k is
+// coords[offsets[k]:offsets[k+1]]), split across n_threads (0 for all
+// hardware threads)
+inline std::tuple<RowVectors, Eigen::VectorXi>
+decode_polylines(const std::vector<std::string> &encoded, int precision = 5,
+                 std::optional<int> z_precision = {}, int n_threads = 0)
+{
+    const double factor = internal::encoding_factor(precision);
+    const double z_factor =
+        z_precision ? internal::encoding_factor(*z_precision) : 1.0;
+    const int dims = z_precision ? 3 : 2;
+    const int M = encoded.size();
+    std::vector<int64_t> counts(M);
+    parallel_for(
+        M,
+        [&](int begin, int end) {
+            for (int k = begin; k < end; ++k) {
+                counts[k] = internal::count_values(encoded[k]);
+            }
+        },
+        n_threads, 64);
+    Eigen::VectorXi offsets(M + 1);
+    int64_t N = 0;
+    offsets[0] = 0;
+    for (int k = 0; k < M; ++k) {
+        if (counts[k] < 0 || counts[k] % dims) {
+            throw std::invalid_argument("malformed encoded polyline at " +
+                                        std::to_string(k));
+        }
+        N += counts[k] / dims;
+        if (N > INT_MAX) {
+            throw std::invalid_argument("too many points to decode");
+        }
+        offsets[k + 1] = N;
+    }
+    RowVectors coords(N, 3);
+    parallel_for(
+        M,
+        [&](int begin, int end) {
+            for (int k = begin; k < end; ++k) {
+                internal::decode_values(
+                    encoded[k], factor, z_factor, dims,
+                    coords.middleRows(offsets[k], offsets[k + 1] - offsets[k]));
+            }
+        },
+        n_threads, 64);
+    return std::make_tuple(std::move(coords), std::move(offsets));
+}
+
+// polyline kept encoded (see encode_polyline), the PolylineRuler (on the
+// decoded, i.e. rounded, coordinates) is built on first use, so cold
+// polylines only cost their encoded bytes, release() turns a hot one cold
+// again. safe to be shared across threads (except release)
+struct EncodedPolyline
+{
+    EncodedPolyline(const Eigen::Ref<const RowVectors> &coords,
+                    bool is_wgs84 = false, int precision = 5,
+                    std::optional<int> z_precision = {})
+        : encoded_(internal::encode_polyline(coords, precision, z_precision)),
+          N_(coords.rows()), is_wgs84_(is_wgs84), precision_(precision),
+          z_precision_(z_precision)
+    {
+    }
+    EncodedPolyline(std::string encoded, bool is_wgs84 = false,
+                    int precision = 5, std::optional<int> z_precision = {})
+        : encoded_(std::move(encoded)), is_wgs84_(is_wgs84),
+          precision_(precision), z_precision_(z_precision)
+    {
+        internal::encoding_factor(precision_);
+        if (z_precision_) {
+            internal::encoding_factor(*z_precision_);
+        }
+        const int64_t n = internal::count_values(encoded_);
+        const int dims = z_precision_ ? 3 : 2;
+        if (n < 0 || n % dims || n / dims > INT_MAX) {
+            throw std::invalid_argument("malformed encoded polyline");
+        }
+        N_ = n / dims;
+    }
+
+    const std::string &encoded() const { return encoded_; }
+    int N() const { return N_; }
+    bool is_wgs84() const { return is_wgs84_; }
+    int precision() const { return precision_; }
+    std::optional<int> z_precision() const { return z_precision_; }
+
+    RowVectors decode() const
+    {
+        RowVectors coords(N_, 3);
+        internal::decode_values(encoded_,
+                                internal::encoding_factor(precision_),
+                                z_precision_ ? internal::encoding_factor(
+                                                   *z_precision_)
+                                             : 1.0,
+                                z_precision_ ? 3 : 2, coords);
+        return coords;
+    }
+    bool is_decoded() const { return bool(ruler_); }
+    const PolylineRuler &ruler() const { return *shared_ruler(); }
+    // same as above, shared with the cache, outlives release()
+    std::shared_ptr<const PolylineRuler> shared_ruler() const
+    {
+        return ruler_.get([this] {
+            return std::make_shared<const PolylineRuler>(decode(), is_wgs84_);
+        });
+    }
+    // drop the decoded ruler (decoded again on next use), references from
+    // ruler() are invalidated, not thread-safe
+    void release() { ruler_.reset(); }
+
+  private:
+    std::string encoded_;
+    int N_ = 0;
+    bool is_wgs84_;
+    int precision_;
+    std::optional<int> z_precision_;
+    LazyCache<std::shared_ptr<const PolylineRuler>> ruler_;
+};
+} // namespace cubao
+
+#endif
@@ -21,13 +21,23 @@
 #include "cheap_ruler.hpp"
 #include "crs_transform.hpp"
 #include "eigen_helpers.hpp"
+#include "encoded_polyline.hpp"
+#include "map_matcher.hpp"
+#include "polyline_collection.hpp"
+#include "polyline_index.hpp"
 #include "polyline_ruler.hpp"
+#include "tile_clipping.hpp"
 
 #define CUBAO_ARGV_DEFAULT_NONE(argv) py::arg_v(#argv, std::nullopt, "None")
 
 #include "pybind11_crs_transform.hpp"
 #include "pybind11_polyline_ruler.hpp"
+#include "pybind11_polyline_collection.hpp"
+#include "pybind11_polyline_index.hpp"
 #include "pybind11_cheap_ruler.hpp"
+#include "pybind11_encoded_polyline.hpp"
+#include "pybind11_tile_clipping.hpp"
+#include "pybind11_map_matcher.hpp"
 
 #define STRINGIFY(x) #x
 #define MACRO_STRINGIFY(x) STRINGIFY(x)
@@ -54,7 +64,12 @@ PYBIND11_MODULE(_core, m)
     cubao::bind_crs_transform(tf);
 
     cubao::bind_polyline_ruler(m);
+    cubao::bind_polyline_collection(m);
+    cubao::bind_polyline_index(m);
     cubao::bind_cheap_ruler(m);
+    cubao::bind_encoded_polyline(m);
+    cubao::bind_tile_clipping(m);
+    cubao::bind_map_matcher(m);
 
 #ifdef VERSION_INFO
     m.attr("__version__") = MACRO_STRINGIFY(VERSION_INFO);
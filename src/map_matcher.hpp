@@ -0,0 +1,442 @@
+#ifndef CUBAO_MAP_MATCHER_HPP
+#define CUBAO_MAP_MATCHER_HPP
+
+// should sync
+// - https://github.com/cubao/polyline-ruler/blob/master/src/map_matcher.hpp
+
+// https://github.com/microsoft/vscode-cpptools/issues/9692
+#if __INTELLISENSE__
+#undef __ARM_NEON
+#undef __ARM_NEON__
+#endif
+
+#include <Eigen/Core>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "crs_transform.hpp"
+#include "packed_rtree.hpp"
+#include "parallel_for.hpp"
+#include "polyline_index.hpp"
+
+namespace cubao
+{
+// HMM map matching (Newson & Krumm, 2009) of traces onto the polylines of a
+// PolylineIndex, decoded by Viterbi:
+// - candidates of a trace point: nearest point of each polyline within
+//   search_radius, at most max_candidates (nearest first)
+// - emission: gaussian (sigma) on the projection distance
+// - transition: exponential (beta) on |route - straight distance| between
+//   consecutive trace points, the route is along the same polyline (either
+//   way), or the shortest one through shared ends (within
+//   connect_tolerance) and along other polylines in between (Dijkstra),
+//   routes longer than max_route_factor * straight + 2 * search_radius
+//   are impossible
+// - at most beam_width states are kept per trace point
+// trace points without candidates are left unmatched (id -1), when no
+// candidate can be reached from the previous ones, the chain is broken
+// (decoded so far) and a new one starts.
+// ranges are measured as in PolylineRuler (wgs84: k of the first point)
+struct MapMatcher
+{
+    // (polyline ids, matched points, segment indexes, t, ranges), one row
+    // per trace point, unmatched: id -1, segment -1, the trace point
+    using Matches = std::tuple<Eigen::VectorXi, RowVectors, Eigen::VectorXi,
+                               Eigen::VectorXd, Eigen::VectorXd>;
+
+    // over polylines of index (shared, not copied)
+    MapMatcher(std::shared_ptr<const PolylineIndex> index, double sigma = 5.0,
+               double beta = 10.0, double search_radius = 50.0,
+               int max_candidates = 8, int beam_width = 32,
+               double connect_tolerance = 1.0, double max_route_factor = 4.0)
+        : index_(std::move(index)), sigma_(sigma), beta_(beta),
+          search_radius_(search_radius), max_candidates_(max_candidates),
+          beam_width_(beam_width), connect_tolerance_(connect_tolerance),
+          max_route_factor_(max_route_factor)
+    {
+        if (!index_) {
+            throw std::invalid_argument("index should not be null");
+        }
+        if (!(sigma_ > 0.0) || !(beta_ > 0.0)) {
+            throw std::invalid_argument("sigma and beta should be positive");
+        }
+        if (!(search_radius_ > 0.0) || max_candidates_ < 1 ||
+            beam_width_ < 1 || !(max_route_factor_ > 0.0)) {
+            throw std::invalid_argument(
+                "search_radius, max_candidates, beam_width and "
+                "max_route_factor should be positive");
+        }
+        __build_ranges();
+        __build_links();
+    }
+    // over polylines of rulers (copied, see PolylineIndex)
+    explicit MapMatcher(const std::vector<PolylineRuler> &rulers,
+                        double sigma = 5.0, double beta = 10.0,
+                        double search_radius = 50.0, int max_candidates = 8,
+                        int beam_width = 32, double connect_tolerance = 1.0,
+                        double max_route_factor = 4.0)
+        : MapMatcher(std::make_shared<const PolylineIndex>(rulers), sigma,
+                     beta, search_radius, max_candidates, beam_width,
+                     connect_tolerance, max_route_factor)
+    {
+    }
+
+    const PolylineIndex &index() const { return *index_; }
+    double sigma() const { return sigma_; }
+    double beta() const { return beta_; }
+    double search_radius() const { return search_radius_; }
+    int max_candidates() const { return max_candidates_; }
+    int beam_width() const { return beam_width_; }
+    double connect_tolerance() const { return connect_tolerance_; }
+    double max_route_factor() const { return max_route_factor_; }
+    // cumulative distances along polyline k
+    Eigen::Map<const Eigen::VectorXd> ranges(int k) const
+    {
+        const Eigen::VectorXi &offsets = index_->offsets();
+        if (k < 0 || k >= index_->size()) {
+            throw std::out_of_range("polyline index out of range");
+        }
+        return Eigen::Map<const Eigen::VectorXd>(
+            ranges_.data() + offsets[k], offsets[k + 1] - offsets[k]);
+    }
+    // ends of other polylines within connect_tolerance of the end of
+    // polyline k (at_end: last point, else first), as [polyline, at_end]
+    RowVectorsNx2i links(int k, bool at_end) const
+    {
+        if (k < 0 || k >= index_->size()) {
+            throw std::out_of_range("polyline index out of range");
+        }
+        auto &links = links_[2 * k + at_end];
+        RowVectorsNx2i ret(links.size(), 2);
+        for (int i = 0; i < (int)links.size(); ++i) {
+            ret(i, 0) = links[i] / 2;
+            ret(i, 1) = links[i] % 2;
+        }
+        return ret;
+    }
+
+    Matches match(const Eigen::Ref<const RowVectors> &points) const
+    {
+        const int N = points.rows();
+        Matches matches{Eigen::VectorXi::Constant(N, -1), points,
+                        Eigen::VectorXi::Constant(N, -1),
+                        Eigen::VectorXd::Zero(N), Eigen::VectorXd::Zero(N)};
+        __match(points, matches, 0);
+        return matches;
+    }
+    // match() on traces packed in one buffer (trace k is
+    // points[offsets[k]:offsets[k+1]]), rows of the matches are the rows of
+    // points, traces are split across n_threads (0 for all hardware threads)
+    Matches match_batch(const Eigen::Ref<const RowVectors> &points,
+                        const Eigen::Ref<const Eigen::VectorXi> &offsets,
+                        int n_threads = 0) const
+    {
+        internal::check_offsets(offsets, points.rows());
+        const int N = points.rows();
+        Matches matches{Eigen::VectorXi::Constant(N, -1), points,
+                        Eigen::VectorXi::Constant(N, -1),
+                        Eigen::VectorXd::Zero(N), Eigen::VectorXd::Zero(N)};
+        parallel_for(
+            std::max(0, (int)offsets.size() - 1),
+            [&](int begin, int end) {
+                for (int k = begin; k < end; ++k) {
+                    __match(points.middleRows(offsets[k],
+                                              offsets[k + 1] - offsets[k]),
+                            matches, offsets[k]);
+                }
+            },
+            n_threads, 1);
+        return matches;
+    }
+
+  private:
+    std::shared_ptr<const PolylineIndex> index_;
+    double sigma_;
+    double beta_;
+    double search_radius_;
+    int max_candidates_;
+    int beam_width_;
+    double connect_tolerance_;
+    double max_route_factor_;
+    // per row of index_->coords()
+    Eigen::VectorXd ranges_;
+    // per polyline end (2 * k + at_end), linked ends of other polylines
+    std::vector<std::vector<int>> links_;
+
+    struct State
+    {
+        int polyline;
+        int segment;
+        double t;
+        double range;
+        Eigen::Vector3d point;
+        double score;
+        int prev; // index in the previous step
+    };
+
+    void __build_ranges()
+    {
+        const RowVectors &coords = index_->coords();
+        const Eigen::VectorXi &offsets = index_->offsets();
+        ranges_.resize(coords.rows());
+        for (int k = 0; k < index_->size(); ++k) {
+            if (offsets[k] == offsets[k + 1]) {
+                continue;
+            }
+            const Eigen::Vector3d scale =
+                index_->is_wgs84() ? cheap_ruler_k(coords(offsets[k], 1))
+                                  : Eigen::Vector3d::Ones();
+            ranges_[offsets[k]] = 0.0;
+            for (int i = offsets[k] + 1; i < offsets[k + 1]; ++i) {
+                Eigen::Vector3d d = coords.row(i) - coords.row(i - 1);
+                ranges_[i] = ranges_[i - 1] + d.cwiseProduct(scale).norm();
+            }
+        }
+    }
+
+    // distance between two points, in the frame of a (cheap ruler at a's
+    // latitude if wgs84)
+    double __distance(const Eigen::Vector3d &a, const Eigen::Vector3d &b) const
+    {
+        if (!index_->is_wgs84()) {
+            return (b - a).norm();
+        }
+        Eigen::Vector3d d = b - a;
+        d[0] = std::remainder(d[0], 360.0);
+        return d.cwiseProduct(cheap_ruler_k(a[1])).norm();
+    }
+
+    void __build_links()
+    {
+        const RowVectors &coords = index_->coords();
+        const Eigen::VectorXi &offsets = index_->offsets();
+        links_.assign(2 * index_->size(), {});
+        // ends (2 * k + at_end) of non-empty polylines
+        std::vector<int> ends;
+        for (int k = 0; k < index_->size(); ++k) {
+            if (offsets[k] < offsets[k + 1]) {
+                ends.push_back(2 * k);
+                ends.push_back(2 * k + 1);
+            }
+        }
+        if (ends.empty()) {
+            return;
+        }
+        auto end_point = [&](int e) -> Eigen::Vector3d {
+            const int k = e / 2;
+            return coords.row(e % 2 ? offsets[k + 1] - 1 : offsets[k]);
+        };
+        PackedRTree::Boxes boxes(ends.size(), 6);
+        for (int i = 0; i < (int)ends.size(); ++i) {
+            Eigen::Vector3d p = end_point(ends[i]);
+            boxes.row(i).head(3) = p;
+            boxes.row(i).tail(3) = p;
+        }
+        PackedRTree rtree(boxes);
+        for (int e : ends) {
+            Eigen::Vector3d p = end_point(e);
+            Eigen::Vector3d tol = Eigen::Vector3d::Constant(connect_tolerance_);
+            if (index_->is_wgs84()) {
+                tol = tol.cwiseQuotient(cheap_ruler_k(p[1]));
+            }
+            for (int i : rtree.search(p - tol, p + tol)) {
+                const int f = ends[i];
+                if (f / 2 != e / 2 &&
+                    __distance(p, end_point(f)) <= connect_tolerance_) {
+                    links_[e].push_back(f);
+                }
+            }
+            std::sort(links_[e].begin(), links_[e].end());
+        }
+    }
+
+    double __length(int k) const
+    {
+        return ranges_[index_->offsets()[k + 1] - 1];
+    }
+
+    // shortest routes from a to polyline ends (2 * k + at_end), hopping
+    // between linked ends and running along polylines (Dijkstra), ends
+    // farther than max_route are left out
+    void __routes(const State &a, double max_route,
+                  std::unordered_map<int, double> &dists) const
+    {
+        dists.clear();
+        using Entry = std::pair<double, int>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> q;
+        auto push = [&](int e, double d) {
+            if (d > max_route) {
+                return;
+            }
+            auto [it, inserted] = dists.emplace(e, d);
+            if (!inserted) {
+                if (it->second <= d) {
+                    return;
+                }
+                it->second = d;
+            }
+            q.push({d, e});
+        };
+        push(2 * a.polyline, a.range);
+        push(2 * a.polyline + 1, __length(a.polyline) - a.range);
+        while (!q.empty()) {
+            auto [d, e] = q.top();
+            q.pop();
+            if (d > dists[e]) {
+                continue;
+            }
+            for (int f : links_[e]) {
+                push(f, d);
+            }
+            push(e ^ 1, d + __length(e / 2));
+        }
+    }
+
+    // shortest route from a to b (along the same polyline, or through the
+    // ends reached by __routes from a), infinity if there is none
+    double __route(const State &a, const std::unordered_map<int, double> &dists,
+                   const State &b) const
+    {
+        if (a.polyline == b.polyline) {
+            return std::abs(b.range - a.range);
+        }
+        double best = std::numeric_limits<double>::infinity();
+        for (int end = 0; end < 2; ++end) {
+            auto it = dists.find(2 * b.polyline + end);
+            if (it == dists.end()) {
+                continue;
+            }
+            const double from_end =
+                end ? __length(b.polyline) - b.range : b.range;
+            best = std::min(best, it->second + from_end);
+        }
+        return best;
+    }
+
+    // decodes the chain (states per step, trace rows of steps) into matches
+    void __decode(const std::vector<std::vector<State>> &chain,
+                  const std::vector<int> &rows, Matches &matches,
+                  int row0) const
+    {
+        if (chain.empty()) {
+            return;
+        }
+        auto &[ids, points, segs, ts, ranges] = matches;
+        const auto &last = chain.back();
+        int s = std::max_element(last.begin(), last.end(),
+                                 [](const State &a, const State &b) {
+                                     return a.score < b.score;
+                                 }) -
+                last.begin();
+        for (int step = chain.size() - 1; step >= 0; --step) {
+            const State &state = chain[step][s];
+            const int r = row0 + rows[step];
+            ids[r] = state.polyline;
+            points.row(r) = state.point;
+            segs[r] = state.segment;
+            ts[r] = state.t;
+            ranges[r] = state.range;
+            s = state.prev;
+        }
+    }
+
+    void __match(const Eigen::Ref<const RowVectors> &points, Matches &matches,
+                 int row0) const
+    {
+        const double log_emission = -std::log(sigma_ * std::sqrt(2 * M_PI));
+        const double log_transition = -std::log(beta_);
+        const Eigen::VectorXi &offsets = index_->offsets();
+        std::vector<std::vector<State>> chain;
+        std::vector<int> rows;
+        std::vector<State> states;
+        std::unordered_map<int, double> dists;
+        for (int r = 0; r < points.rows(); ++r) {
+            const Eigen::Vector3d p = points.row(r);
+            auto [cids, cpoints, csegs, cts, cdists] =
+                index_->nearest(p, max_candidates_, search_radius_);
+            if (!cids.size()) {
+                continue;
+            }
+            states.clear();
+            for (int c = 0; c < cids.size(); ++c) {
+                const int k = cids[c];
+                const int i = offsets[k] + csegs[c];
+                double range = ranges_[i];
+                if (offsets[k + 1] - offsets[k] > 1) {
+                    range += (ranges_[i + 1] - ranges_[i]) * cts[c];
+                }
+                const double z = cdists[c] / sigma_;
+                states.push_back({k, csegs[c], cts[c], range,
+                                  cpoints.row(c), log_emission - 0.5 * z * z,
+                                  -1});
+            }
+            if (!chain.empty()) {
+                const auto &prev = chain.back();
+                const double straight =
+                    __distance(points.row(rows.back()), p);
+                const double max_route =
+                    max_route_factor_ * straight + 2.0 * search_radius_;
+                std::vector<double> best(
+                    states.size(), -std::numeric_limits<double>::infinity());
+                for (int j = 0; j < (int)prev.size(); ++j) {
+                    __routes(prev[j], max_route, dists);
+                    for (int c = 0; c < (int)states.size(); ++c) {
+                        const double route = __route(prev[j], dists, states[c]);
+                        if (std::isinf(route)) {
+                            continue;
+                        }
+                        const double score =
+                            prev[j].score + log_transition -
+                            std::abs(route - straight) / beta_;
+                        if (score > best[c]) {
+                            best[c] = score;
+                            states[c].prev = j;
+                        }
+                    }
+                }
+                bool reachable = false;
+                for (int c = 0; c < (int)states.size(); ++c) {
+                    states[c].score += best[c];
+                    reachable |= states[c].prev >= 0;
+                }
+                if (!reachable) {
+                    // break the chain, restart from emissions
+                    __decode(chain, rows, matches, row0);
+                    chain.clear();
+                    rows.clear();
+                    for (int c = 0; c < (int)states.size(); ++c) {
+                        const double z = cdists[c] / sigma_;
+                        states[c].score = log_emission - 0.5 * z * z;
+                    }
+                } else {
+                    states.erase(std::remove_if(states.begin(), states.end(),
+                                                [](const State &s) {
+                                                    return s.prev < 0;
+                                                }),
+                                 states.end());
+                }
+            }
+            if ((int)states.size() > beam_width_) {
+                std::partial_sort(states.begin(),
+                                  states.begin() + beam_width_, states.end(),
+                                  [](const State &a, const State &b) {
+                                      return a.score > b.score;
+                                  });
+                states.resize(beam_width_);
+            }
+            chain.push_back(states);
+            rows.push_back(r);
+        }
+        __decode(chain, rows, matches, row0);
+    }
+};
+} // namespace cubao
+
+#endif
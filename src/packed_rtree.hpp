@@ -0,0 +1,336 @@
+#ifndef CUBAO_PACKED_RTREE_HPP
+#define CUBAO_PACKED_RTREE_HPP
+
+// should sync
+// - https://github.com/cubao/polyline-ruler/blob/master/src/packed_rtree.hpp
+// - https://github.com/cubao/headers/tree/main/include/cubao/packed_rtree.hpp
+
+// static (build once, query many) packed R-tree, based on
+// https://github.com/mourner/flatbush
+
+// https://github.com/microsoft/vscode-cpptools/issues/9692
+#if __INTELLISENSE__
+#undef __ARM_NEON
+#undef __ARM_NEON__
+#endif
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace cubao
+{
+struct PackedRTree
+{
+    // each row: [min_x, min_y, min_z, max_x, max_y, max_z]
+    using Boxes = Eigen::Matrix<double, Eigen::Dynamic, 6, Eigen::RowMajor>;
+
+    PackedRTree(const Eigen::Ref<const Boxes> &boxes, int node_size = 16)
+        : num_items_(boxes.rows()), node_size_(std::max(2, node_size))
+    {
+        if (!num_items_) {
+            return;
+        }
+        // levels are stored bottom-up, leaves (items) first, root last
+        int n = num_items_;
+        int num_nodes = n;
+        level_bounds_.push_back(num_nodes);
+        do {
+            n = (n + node_size_ - 1) / node_size_;
+            num_nodes += n;
+            level_bounds_.push_back(num_nodes);
+        } while (n != 1);
+        boxes_.resize(num_nodes, 6);
+        indices_.resize(num_nodes);
+
+        // sort items by hilbert value of their centers (in x-y plane)
+        Eigen::Vector3d min = boxes.leftCols(3).colwise().minCoeff();
+        Eigen::Vector3d max = boxes.rightCols(3).colwise().maxCoeff();
+        double width = max[0] - min[0];
+        double height = max[1] - min[1];
+        constexpr double hilbert_max = (1 << 16) - 1;
+        std::vector<uint32_t> values(num_items_);
+        for (int i = 0; i < num_items_; ++i) {
+            double cx = (boxes(i, 0) + boxes(i, 3)) / 2.0;
+            double cy = (boxes(i, 1) + boxes(i, 4)) / 2.0;
+            uint32_t x = width > 0
+                             ? std::floor(hilbert_max * (cx - min[0]) / width)
+                             : 0;
+            uint32_t y = height > 0
+                             ? std::floor(hilbert_max * (cy - min[1]) / height)
+                             : 0;
+            values[i] = hilbert(x, y);
+        }
+        std::vector<int> order(num_items_);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            return values[a] < values[b];
+        });
+        for (int i = 0; i < num_items_; ++i) {
+            boxes_.row(i) = boxes.row(order[i]);
+            indices_[i] = order[i];
+        }
+
+        // generate nodes at each tree level, bottom-up
+        int pos = 0;
+        for (int l = 0; l + 1 < (int)level_bounds_.size(); ++l) {
+            int end = level_bounds_[l];
+            int node = end;
+            while (pos < end) {
+                int first = pos;
+                Eigen::Matrix<double, 1, 6> box = boxes_.row(pos++);
+                for (int c = 1; c < node_size_ && pos < end; ++c, ++pos) {
+                    box.head(3) = box.head(3).cwiseMin(boxes_.row(pos).head(3));
+                    box.tail(3) = box.tail(3).cwiseMax(boxes_.row(pos).tail(3));
+                }
+                boxes_.row(node) = box;
+                indices_[node++] = first;
+            }
+        }
+    }
+
+    // restore a tree from boxes() and indices() of one built with the same
+    // number of items and node size (no sorting, e.g. loaded from disk)
+    PackedRTree(const Eigen::Ref<const Boxes> &nodes,
+                const Eigen::Ref<const Eigen::VectorXi> &indices,
+                int num_items, int node_size)
+        : num_items_(num_items), node_size_(std::max(2, node_size))
+    {
+        if (!num_items_) {
+            return;
+        }
+        int n = num_items_;
+        level_bounds_.push_back(n);
+        do {
+            n = (n + node_size_ - 1) / node_size_;
+            level_bounds_.push_back(level_bounds_.back() + n);
+        } while (n != 1);
+        const int num_nodes = level_bounds_.back();
+        if (nodes.rows() != num_nodes || indices.size() != num_nodes) {
+            throw std::invalid_argument(
+                "nodes and indices do not match num_items and node_size");
+        }
+        check_indices(indices, num_items_);
+        boxes_ = nodes;
+        indices_ = indices;
+    }
+
+    // number of nodes (items included) of a tree over num_items items
+    static int64_t num_nodes(int num_items, int node_size)
+    {
+        if (num_items <= 0) {
+            return 0;
+        }
+        node_size = std::max(2, node_size);
+        int64_t n = num_items, num_nodes = n;
+        do {
+            n = (n + node_size - 1) / node_size;
+            num_nodes += n;
+        } while (n != 1);
+        return num_nodes;
+    }
+
+    // throws unless leaves index items in [0, num_items) and internal nodes
+    // point below themselves (so traversal stays in range and terminates)
+    static void check_indices(const Eigen::Ref<const Eigen::VectorXi> &indices,
+                              int num_items)
+    {
+        for (int node = 0; node < indices.size(); ++node) {
+            int bound = node < num_items ? num_items : node;
+            if (indices[node] < 0 || indices[node] >= bound) {
+                throw std::invalid_argument("corrupted rtree indices");
+            }
+        }
+    }
+
+    int size() const { return num_items_; }
+    int node_size() const { return node_size_; }
+    // all nodes, leaves (in sorted order) first, root last
+    const Boxes &boxes() const { return boxes_; }
+    // per node, leaves: original item index, internal nodes: position of
+    // first child
+    const Eigen::VectorXi &indices() const { return indices_; }
+    Eigen::Matrix<double, 1, 6> bounds() const
+    {
+        if (!num_items_) {
+            throw std::out_of_range("empty rtree has no bounds");
+        }
+        return boxes_.row(boxes_.rows() - 1);
+    }
+
+    // visit items whose boxes overlap [min, max],
+    // `visitor(item_index)` returns false to stop early
+    template <typename Visitor>
+    void visit(const Eigen::Vector3d &min, const Eigen::Vector3d &max,
+               Visitor &&visitor) const
+    {
+        if (!num_items_) {
+            return;
+        }
+        std::vector<int> stack{(int)boxes_.rows() - 1};
+        while (!stack.empty()) {
+            int node = stack.back();
+            stack.pop_back();
+            int first = indices_[node];
+            int last = std::min(first + node_size_, upper_level_bound(first));
+            for (int pos = first; pos < last; ++pos) {
+                if (max[0] < boxes_(pos, 0) || max[1] < boxes_(pos, 1) ||
+                    max[2] < boxes_(pos, 2) || min[0] > boxes_(pos, 3) ||
+                    min[1] > boxes_(pos, 4) || min[2] > boxes_(pos, 5)) {
+                    continue;
+                }
+                if (pos >= num_items_) {
+                    stack.push_back(pos);
+                } else if (!visitor(indices_[pos])) {
+                    return;
+                }
+            }
+        }
+    }
+
+    std::vector<int> search(const Eigen::Vector3d &min,
+                            const Eigen::Vector3d &max) const
+    {
+        std::vector<int> hits;
+        visit(min, max, [&](int index) {
+            hits.push_back(index);
+            return true;
+        });
+        return hits;
+    }
+
+    // best-first traversal, items are visited by ascending (squared) distance
+    // from P to their boxes, `visitor(item_index, box_distance2)` returns
+    // false to stop early
+    template <typename Visitor>
+    void visit_nearest(const Eigen::Vector3d &P, Visitor &&visitor) const
+    {
+        visit_nearest_by(
+            [&](int node) { return box_distance2(node, P); },
+            std::forward<Visitor>(visitor));
+    }
+    // same as above, with `distance2(node)` for the distance to the box of
+    // a node (e.g. in a scaled or wrapped metric), it should lower-bound
+    // distances to all boxes below that node
+    template <typename Distance, typename Visitor>
+    void visit_nearest_by(Distance &&distance2, Visitor &&visitor) const
+    {
+        if (!num_items_) {
+            return;
+        }
+        using Entry = std::pair<double, int>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> q;
+        int node = boxes_.rows() - 1;
+        while (true) {
+            int first = indices_[node];
+            int last = std::min(first + node_size_, upper_level_bound(first));
+            for (int pos = first; pos < last; ++pos) {
+                q.push({distance2(pos), pos});
+            }
+            while (!q.empty() && q.top().second < num_items_) {
+                auto [dist2, pos] = q.top();
+                q.pop();
+                if (!visitor(indices_[pos], dist2)) {
+                    return;
+                }
+            }
+            if (q.empty()) {
+                return;
+            }
+            node = q.top().second;
+            q.pop();
+        }
+    }
+
+    double box_distance2(int node, const Eigen::Vector3d &P) const
+    {
+        double dist2 = 0.0;
+        for (int i = 0; i < 3; ++i) {
+            double d = std::max({boxes_(node, i) - P[i], //
+                                 0.0,                    //
+                                 P[i] - boxes_(node, i + 3)});
+            dist2 += d * d;
+        }
+        return dist2;
+    }
+
+    // https://github.com/rawrunprotected/hilbert_curves (public domain)
+    static uint32_t hilbert(uint32_t x, uint32_t y)
+    {
+        uint32_t a = x ^ y;
+        uint32_t b = 0xFFFF ^ a;
+        uint32_t c = 0xFFFF ^ (x | y);
+        uint32_t d = x & (y ^ 0xFFFF);
+
+        uint32_t A = a | (b >> 1);
+        uint32_t B = (a >> 1) ^ a;
+        uint32_t C = ((c >> 1) ^ (b & (d >> 1))) ^ c;
+        uint32_t D = ((a & (c >> 1)) ^ (d >> 1)) ^ d;
+
+        a = A;
+        b = B;
+        c = C;
+        d = D;
+        A = ((a & (a >> 2)) ^ (b & (b >> 2)));
+        B = ((a & (b >> 2)) ^ (b & ((a ^ b) >> 2)));
+        C ^= ((a & (c >> 2)) ^ (b & (d >> 2)));
+        D ^= ((b & (c >> 2)) ^ ((a ^ b) & (d >> 2)));
+
+        a = A;
+        b = B;
+        c = C;
+        d = D;
+        A = ((a & (a >> 4)) ^ (b & (b >> 4)));
+        B = ((a & (b >> 4)) ^ (b & ((a ^ b) >> 4)));
+        C ^= ((a & (c >> 4)) ^ (b & (d >> 4)));
+        D ^= ((b & (c >> 4)) ^ ((a ^ b) & (d >> 4)));
+
+        a = A;
+        b = B;
+        c = C;
+        d = D;
+        C ^= ((a & (c >> 8)) ^ (b & (d >> 8)));
+        D ^= ((b & (c >> 8)) ^ ((a ^ b) & (d >> 8)));
+
+        a = C ^ (C >> 1);
+        b = D ^ (D >> 1);
+
+        uint32_t i0 = x ^ y;
+        uint32_t i1 = b | (0xFFFF ^ (i0 | a));
+
+        i0 = (i0 | (i0 << 8)) & 0x00FF00FF;
+        i0 = (i0 | (i0 << 4)) & 0x0F0F0F0F;
+        i0 = (i0 | (i0 << 2)) & 0x33333333;
+        i0 = (i0 | (i0 << 1)) & 0x55555555;
+
+        i1 = (i1 | (i1 << 8)) & 0x00FF00FF;
+        i1 = (i1 | (i1 << 4)) & 0x0F0F0F0F;
+        i1 = (i1 | (i1 << 2)) & 0x33333333;
+        i1 = (i1 | (i1 << 1)) & 0x55555555;
+
+        return (i1 << 1) | i0;
+    }
+
+  private:
+    int num_items_ = 0;
+    int node_size_ = 16;
+    std::vector<int> level_bounds_;
+    Boxes boxes_;
+    // leaves: original item index, internal nodes: position of first child
+    Eigen::VectorXi indices_;
+
+    int upper_level_bound(int pos) const
+    {
+        return *std::upper_bound(level_bounds_.begin(), level_bounds_.end(),
+                                 pos);
+    }
+};
+} // namespace cubao
+
+#endif
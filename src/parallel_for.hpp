@@ -0,0 +1,68 @@
+#ifndef CUBAO_PARALLEL_FOR_HPP
+#define CUBAO_PARALLEL_FOR_HPP
+
+// should sync
+// - https://github.com/cubao/polyline-ruler/blob/master/src/parallel_for.hpp
+// - https://github.com/cubao/headers/tree/main/include/cubao/parallel_for.hpp
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace cubao
+{
+// number of worker threads to use, n_threads <= 0 means all hardware threads
+inline int num_threads(int n_threads = 0)
+{
+    if (n_threads > 0) {
+        return n_threads;
+    }
+    return std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+// split [0, N) into contiguous chunks of at least `min_chunk` items,
+// run `fn(begin, end)` on each chunk using up to `n_threads` threads
+// (the calling thread takes the first chunk), exceptions are re-thrown
+// in the calling thread
+template <typename Fn>
+inline void parallel_for(int N, Fn &&fn, int n_threads = 0,
+                         int min_chunk = 1024)
+{
+    if (N <= 0) {
+        return;
+    }
+    int T = std::min(num_threads(n_threads),
+                     (N + std::max(1, min_chunk) - 1) / std::max(1, min_chunk));
+    if (T <= 1) {
+        fn(0, N);
+        return;
+    }
+    std::vector<std::exception_ptr> errors(T);
+    auto run = [&](int t) {
+        int begin = (int)((long long)N * t / T);
+        int end = (int)((long long)N * (t + 1) / T);
+        try {
+            fn(begin, end);
+        } catch (...) {
+            errors[t] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> workers;
+    workers.reserve(T - 1);
+    for (int t = 1; t < T; ++t) {
+        workers.emplace_back(run, t);
+    }
+    run(0);
+    for (auto &w : workers) {
+        w.join();
+    }
+    for (auto &e : errors) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    }
+}
+} // namespace cubao
+
+#endif
@@ -0,0 +1,470 @@
+#ifndef CUBAO_POLYLINE_COLLECTION_HPP
+#define CUBAO_POLYLINE_COLLECTION_HPP
+
+// should sync
+// - https://github.com/cubao/polyline-ruler/blob/master/src/polyline_collection.hpp
+
+// many polylines in one binary file, opened via mmap (no parsing, no copy)
+//
+//      header (PolylineCollection::Header)
+//      offsets     int32[M+1]          polyline k is coords[offsets[k]:..]
+//      coords      float64[N, 3]
+//      ranges      float64[N]          (optional) per polyline, from 0
+//      dirs        float64[N-M, 3]     (optional) polyline k's dirs start at
+//                                      row offsets[k] - k
+//      rtree       float64[R, 6]       (optional) PackedRTree over bounding
+//                  int32[R]            boxes of polylines (boxes & indices)
+//
+// sections are 64-byte aligned, in host byte order (checked when opening)
+
+// https://github.com/microsoft/vscode-cpptools/issues/9692
+#if __INTELLISENSE__
+#undef __ARM_NEON
+#undef __ARM_NEON__
+#endif
+
+#include <Eigen/Core>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "packed_rtree.hpp"
+#include "parallel_for.hpp"
+#include "polyline_ruler.hpp"
+
+namespace cubao
+{
+namespace internal
+{
+// read-only mapping of a whole file, unmapped on destruction
+struct MappedFile
+{
+    explicit MappedFile(const std::string &path)
+    {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                                  nullptr, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("failed to open " + path);
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size) || !size.QuadPart) {
+            CloseHandle(file);
+            throw std::runtime_error("failed to map (empty?) " + path);
+        }
+        HANDLE mapping =
+            CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (!mapping) {
+            throw std::runtime_error("failed to map " + path);
+        }
+        data_ = static_cast<const char *>(
+            MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        CloseHandle(mapping);
+        if (!data_) {
+            throw std::runtime_error("failed to map " + path);
+        }
+        size_ = size.QuadPart;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("failed to open " + path);
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || !st.st_size) {
+            ::close(fd);
+            throw std::runtime_error("failed to map (empty?) " + path);
+        }
+        void *data = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            throw std::runtime_error("failed to map " + path);
+        }
+        data_ = static_cast<const char *>(data);
+        size_ = st.st_size;
+#endif
+    }
+    ~MappedFile()
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(data_);
+#else
+        ::munmap(const_cast<char *>(data_), size_);
+#endif
+    }
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *data() const { return data_; }
+    size_t size() const { return size_; }
+
+  private:
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+};
+} // namespace internal
+
+struct PolylineCollection
+{
+    static constexpr char MAGIC[8] = {'P', 'L', 'Y', 'R', 'U', 'L', 'E', 'R'};
+    static constexpr uint32_t FORMAT_VERSION = 1;
+    static constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+    enum Flags : uint32_t
+    {
+        IS_WGS84 = 1 << 0,
+        WITH_RANGES = 1 << 1,
+        WITH_DIRS = 1 << 2,
+        WITH_RTREE = 1 << 3,
+    };
+    enum Section
+    {
+        OFFSETS,
+        COORDS,
+        RANGES,
+        DIRS,
+        RTREE_BOXES,
+        RTREE_INDICES,
+        NUM_SECTIONS,
+    };
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint32_t flags;
+        int32_t num_polylines;
+        int32_t num_points;
+        int32_t rtree_node_size;
+        int32_t rtree_num_nodes;
+        int32_t reserved;
+        // byte offsets of sections (0 if absent)
+        uint64_t sections[NUM_SECTIONS];
+    };
+
+    // write polylines packed in coords (polyline k is
+    // coords[offsets[k]:offsets[k+1]], at least two points each) to `path`,
+    // ranges & dirs are computed on n_threads threads (0 for all hardware
+    // threads), rtree indexes bounding boxes of polylines (in input
+    // coordinates, i.e. lon/lat if wgs84)
+    static void write(const std::string &path, const RowVectors &coords,
+                      const Eigen::Ref<const Eigen::VectorXi> &offsets,
+                      bool is_wgs84 = false, bool with_ranges = true,
+                      bool with_dirs = true, bool with_rtree = true,
+                      int n_threads = 0)
+    {
+        internal::check_offsets(offsets, coords.rows());
+        const int M = std::max((int)offsets.size() - 1, 0);
+        // polylines are packed (re-based to start at row 0) when written
+        Eigen::VectorXi packed(M + 1);
+        packed[0] = 0;
+        for (int k = 0; k < M; ++k) {
+            int n = offsets[k + 1] - offsets[k];
+            if (n < 2) {
+                throw std::invalid_argument(
+                    "polylines should have at least two points");
+            }
+            packed[k + 1] = packed[k] + n;
+        }
+        const int N = packed[M];
+        auto polyline = [&](int k) {
+            return coords.middleRows(offsets[k], packed[k + 1] - packed[k]);
+        };
+
+        Header header;
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = FORMAT_VERSION;
+        header.byte_order = BYTE_ORDER_MARK;
+        header.flags = 0;
+        header.flags |= is_wgs84 ? IS_WGS84 : 0u;
+        header.flags |= with_ranges ? WITH_RANGES : 0u;
+        header.flags |= with_dirs ? WITH_DIRS : 0u;
+        header.flags |= with_rtree ? WITH_RTREE : 0u;
+        header.num_polylines = M;
+        header.num_points = N;
+        header.rtree_node_size = 16;
+        header.rtree_num_nodes = 0;
+        header.reserved = 0;
+
+        std::optional<PackedRTree> rtree;
+        if (with_rtree) {
+            PackedRTree::Boxes boxes(M, 6);
+            for (int k = 0; k < M; ++k) {
+                boxes.block<1, 3>(k, 0) = polyline(k).colwise().minCoeff();
+                boxes.block<1, 3>(k, 3) = polyline(k).colwise().maxCoeff();
+            }
+            rtree.emplace(boxes, header.rtree_node_size);
+            header.rtree_num_nodes = rtree->indices().size();
+        }
+
+        uint64_t pos = sizeof(Header);
+        auto section = [&](bool present, uint64_t bytes) -> uint64_t {
+            if (!present) {
+                return 0;
+            }
+            pos = (pos + 63) / 64 * 64;
+            uint64_t begin = pos;
+            pos += bytes;
+            return begin;
+        };
+        const uint64_t R = header.rtree_num_nodes;
+        header.sections[OFFSETS] = section(true, 4 * (M + 1));
+        header.sections[COORDS] = section(true, 8 * 3 * N);
+        header.sections[RANGES] = section(with_ranges, 8 * N);
+        header.sections[DIRS] = section(with_dirs, 8 * 3 * (N - M));
+        header.sections[RTREE_BOXES] = section(with_rtree, 8 * 6 * R);
+        header.sections[RTREE_INDICES] = section(with_rtree, 4 * R);
+
+        std::ofstream os(path, std::ios::binary | std::ios::trunc);
+        if (!os) {
+            throw std::runtime_error("failed to open " + path);
+        }
+        auto write_at = [&](uint64_t offset, const void *data,
+                            uint64_t bytes) {
+            static const char zeros[64] = {};
+            os.write(zeros, offset - (uint64_t)os.tellp());
+            os.write(static_cast<const char *>(data), bytes);
+        };
+        os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        write_at(header.sections[OFFSETS], packed.data(), 4 * (M + 1));
+        for (int k = 0; k < M; ++k) {
+            write_at(header.sections[COORDS] + 8 * 3 * packed[k],
+                     polyline(k).data(), 8 * polyline(k).size());
+        }
+        if (with_ranges || with_dirs) {
+            // computed in parallel, written in order
+            Eigen::VectorXd ranges(with_ranges ? N : 0);
+            RowVectors dirs(with_dirs ? N - M : 0, 3);
+            parallel_for(
+                M,
+                [&](int begin, int end) {
+                    for (int k = begin; k < end; ++k) {
+                        const int n = packed[k + 1] - packed[k];
+                        if (with_ranges) {
+                            ranges.segment(packed[k], n) =
+                                PolylineRuler::ranges(polyline(k), is_wgs84);
+                        }
+                        if (with_dirs) {
+                            dirs.middleRows(packed[k] - k, n - 1) =
+                                PolylineRuler::dirs(polyline(k), is_wgs84);
+                        }
+                    }
+                },
+                n_threads, 64);
+            if (with_ranges) {
+                write_at(header.sections[RANGES], ranges.data(), 8 * N);
+            }
+            if (with_dirs) {
+                write_at(header.sections[DIRS], dirs.data(),
+                         8 * dirs.size());
+            }
+        }
+        if (with_rtree) {
+            write_at(header.sections[RTREE_BOXES], rtree->boxes().data(),
+                     8 * 6 * R);
+            write_at(header.sections[RTREE_INDICES], rtree->indices().data(),
+                     4 * R);
+        }
+        if (!os.flush()) {
+            throw std::runtime_error("failed to write " + path);
+        }
+    }
+    static void write(const std::string &path,
+                      const Eigen::Ref<const RowVectorsNx2> &coords,
+                      const Eigen::Ref<const Eigen::VectorXi> &offsets,
+                      bool is_wgs84 = false, bool with_ranges = true,
+                      bool with_dirs = true, bool with_rtree = true,
+                      int n_threads = 0)
+    {
+        write(path, to_Nx3(coords), offsets, is_wgs84, with_ranges,
+              with_dirs, with_rtree, n_threads);
+    }
+
+    // open (mmap) a file written by write(), validates the header, offsets
+    // and rtree indices only (not coordinates), O(number of polylines)
+    explicit PolylineCollection(const std::string &path)
+        : file_(std::make_shared<const internal::MappedFile>(path))
+    {
+        const char *data = file_->data();
+        const uint64_t size = file_->size();
+        if (size < sizeof(Header)) {
+            throw std::invalid_argument("not a polyline collection: " + path);
+        }
+        std::memcpy(&header_, data, sizeof(Header));
+        if (std::memcmp(header_.magic, MAGIC, sizeof(MAGIC))) {
+            throw std::invalid_argument("not a polyline collection: " + path);
+        }
+        if (header_.version != FORMAT_VERSION ||
+            header_.byte_order != BYTE_ORDER_MARK) {
+            throw std::invalid_argument(
+                "unsupported version or byte order: " + path);
+        }
+        const int M = header_.num_polylines;
+        const int N = header_.num_points;
+        if (M < 0 || N < 2ll * M ||
+            (has_rtree() &&
+             (header_.rtree_node_size < 2 ||
+              header_.rtree_num_nodes !=
+                  PackedRTree::num_nodes(M, header_.rtree_node_size)))) {
+            throw std::invalid_argument("corrupted header: " + path);
+        }
+        const uint64_t R = has_rtree() ? header_.rtree_num_nodes : 0;
+        const uint64_t bytes[NUM_SECTIONS] = {
+            4ull * (M + 1), 8ull * 3 * N, 8ull * N, 8ull * 3 * (N - M),
+            8ull * 6 * R,   4ull * R,
+        };
+        const uint32_t required[NUM_SECTIONS] = {
+            0, 0, WITH_RANGES, WITH_DIRS, WITH_RTREE, WITH_RTREE,
+        };
+        for (int s = 0; s < NUM_SECTIONS; ++s) {
+            const uint64_t begin = header_.sections[s];
+            if (required[s] && !(header_.flags & required[s])) {
+                continue;
+            }
+            if (!begin || begin % 8 || begin > size ||
+                bytes[s] > size - begin) {
+                throw std::invalid_argument("truncated or corrupted: " +
+                                            path);
+            }
+        }
+        offsets_ = reinterpret_cast<const int *>(data +
+                                                 header_.sections[OFFSETS]);
+        for (int k = 0; k < M; ++k) {
+            if (offsets_[k + 1] - offsets_[k] < 2) {
+                throw std::invalid_argument("corrupted offsets: " + path);
+            }
+        }
+        if (offsets_[0] != 0 || offsets_[M] != N) {
+            throw std::invalid_argument("corrupted offsets: " + path);
+        }
+        if (has_rtree()) {
+            try {
+                PackedRTree::check_indices(
+                    Eigen::Map<const Eigen::VectorXi>(
+                        __rtree_indices(), header_.rtree_num_nodes),
+                    M);
+            } catch (const std::invalid_argument &e) {
+                throw std::invalid_argument(e.what() + (": " + path));
+            }
+        }
+    }
+
+    int size() const { return header_.num_polylines; }
+    int num_points() const { return header_.num_points; }
+    bool is_wgs84() const { return header_.flags & IS_WGS84; }
+    bool has_ranges() const { return header_.flags & WITH_RANGES; }
+    bool has_dirs() const { return header_.flags & WITH_DIRS; }
+    bool has_rtree() const { return header_.flags & WITH_RTREE; }
+
+    // views into the mapped file
+    Eigen::Map<const Eigen::VectorXi> offsets() const
+    {
+        return Eigen::Map<const Eigen::VectorXi>(offsets_, size() + 1);
+    }
+    Eigen::Map<const RowVectors> coords() const
+    {
+        return Eigen::Map<const RowVectors>(__section(COORDS), num_points(),
+                                            3);
+    }
+    Eigen::Map<const RowVectors> polyline(int k) const
+    {
+        __check_index(k);
+        return Eigen::Map<const RowVectors>(__section(COORDS) +
+                                                3 * offsets_[k],
+                                            __size(k), 3);
+    }
+
+    // ruler viewing polyline k's coords (no copy, keeps the file mapped),
+    // ranges/dirs stored in the file are copied into its caches (O(n), but
+    // no recomputation, cache the ruler if called repeatedly)
+    PolylineRuler ruler(int k) const
+    {
+        __check_index(k);
+        const int n = __size(k);
+        PolylineRuler ruler(__section(COORDS) + 3 * offsets_[k], n,
+                            is_wgs84(), file_);
+        if (has_ranges()) {
+            ruler.preload_ranges(Eigen::Map<const Eigen::VectorXd>(
+                __section(RANGES) + offsets_[k], n));
+        }
+        if (has_dirs()) {
+            ruler.preload_dirs(Eigen::Map<const RowVectors>(
+                __section(DIRS) + 3 * (offsets_[k] - k), n - 1, 3));
+        }
+        return ruler;
+    }
+
+    // packed R-tree over bounding boxes of polylines, restored from the
+    // file (or built on first use if not stored)
+    const PackedRTree &rtree() const
+    {
+        return rtree_.get([this] {
+            if (has_rtree()) {
+                const int R = header_.rtree_num_nodes;
+                return PackedRTree(
+                    Eigen::Map<const PackedRTree::Boxes>(
+                        __section(RTREE_BOXES), R, 6),
+                    Eigen::Map<const Eigen::VectorXi>(__rtree_indices(), R),
+                    size(), header_.rtree_node_size);
+            }
+            PackedRTree::Boxes boxes(size(), 6);
+            for (int k = 0; k < size(); ++k) {
+                auto line = polyline(k);
+                boxes.block<1, 3>(k, 0) = line.colwise().minCoeff();
+                boxes.block<1, 3>(k, 3) = line.colwise().maxCoeff();
+            }
+            return PackedRTree(boxes);
+        });
+    }
+    // indexes of polylines whose bounding boxes overlap [min, max]
+    std::vector<int> search(const Eigen::Vector3d &min,
+                            const Eigen::Vector3d &max) const
+    {
+        return rtree().search(min, max);
+    }
+
+  private:
+    std::shared_ptr<const internal::MappedFile> file_;
+    Header header_;
+    const int *offsets_ = nullptr;
+    LazyCache<PackedRTree> rtree_;
+
+    const double *__section(Section s) const
+    {
+        return reinterpret_cast<const double *>(file_->data() +
+                                                header_.sections[s]);
+    }
+    const int *__rtree_indices() const
+    {
+        return reinterpret_cast<const int *>(file_->data() +
+                                             header_.sections[RTREE_INDICES]);
+    }
+    int __size(int k) const { return offsets_[k + 1] - offsets_[k]; }
+    void __check_index(int k) const
+    {
+        if (k < 0 || k >= size()) {
+            throw std::out_of_range("polyline index out of range");
+        }
+    }
+};
+} // namespace cubao
+
+#endif
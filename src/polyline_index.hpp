@@ -0,0 +1,385 @@
+#ifndef CUBAO_POLYLINE_INDEX_HPP
+#define CUBAO_POLYLINE_INDEX_HPP
+
+// should sync
+// - https://github.com/cubao/polyline-ruler/blob/master/src/polyline_index.hpp
+
+// https://github.com/microsoft/vscode-cpptools/issues/9692
+#if __INTELLISENSE__
+#undef __ARM_NEON
+#undef __ARM_NEON__
+#endif
+
+#include <Eigen/Core>
+#include <climits>
+#include <cmath>
+#include <optional>
+#include <queue>
+#include <unordered_set>
+#include <vector>
+
+#include "crs_transform.hpp"
+#include "packed_rtree.hpp"
+#include "parallel_for.hpp"
+#include "polyline_ruler.hpp"
+
+namespace cubao
+{
+// nearest-line index over many polylines, for candidate retrieval (e.g. map
+// matching). segments are grouped into runs of up to `chunk_size`
+// consecutive segments of a polyline, one packed R-tree over their boxes.
+//
+// distances are measured in the frame of the query point p: cartesian, or
+// for wgs84 the cheap ruler at p's latitude with wrapped longitudes (same as
+// CheapRuler(p.lat).pointOnLine), so they stay right near the poles and
+// across the antimeridian.
+struct PolylineIndex
+{
+    // (polyline ids, nearest points, segment indexes, t, distances), one row
+    // per polyline, sorted by distance
+    using Hits = std::tuple<Eigen::VectorXi, RowVectors, Eigen::VectorXi,
+                            Eigen::VectorXd, Eigen::VectorXd>;
+    // same as Hits, rows of query i are [offsets[i], offsets[i+1])
+    using BatchHits =
+        std::tuple<Eigen::VectorXi, Eigen::VectorXi, RowVectors,
+                   Eigen::VectorXi, Eigen::VectorXd, Eigen::VectorXd>;
+
+    // polyline k is coords[offsets[k]:offsets[k+1]] (copied)
+    PolylineIndex(const RowVectors &coords,
+                  const Eigen::Ref<const Eigen::VectorXi> &offsets,
+                  bool is_wgs84 = false, int chunk_size = 16)
+        : coords_(__packed(coords, offsets)), offsets_(__rebased(offsets)),
+          is_wgs84_(is_wgs84), rtree_(__build(std::max(1, chunk_size)))
+    {
+    }
+    PolylineIndex(const Eigen::Ref<const RowVectorsNx2> &coords,
+                  const Eigen::Ref<const Eigen::VectorXi> &offsets,
+                  bool is_wgs84 = false, int chunk_size = 16)
+        : PolylineIndex(to_Nx3(coords), offsets, is_wgs84, chunk_size)
+    {
+    }
+    // over polylines of rulers (copied), all cartesian or all wgs84
+    explicit PolylineIndex(const std::vector<PolylineRuler> &rulers,
+                           int chunk_size = 16)
+        : PolylineIndex(__concat(rulers), __offsets(rulers),
+                        !rulers.empty() && rulers[0].is_wgs84(), chunk_size)
+    {
+        for (auto &ruler : rulers) {
+            if (ruler.is_wgs84() != is_wgs84_) {
+                throw std::invalid_argument(
+                    "rulers should be all cartesian or all wgs84");
+            }
+        }
+    }
+
+    int size() const { return offsets_.size() - 1; }
+    bool is_wgs84() const { return is_wgs84_; }
+    const RowVectors &coords() const { return coords_; }
+    const Eigen::VectorXi &offsets() const { return offsets_; }
+    Eigen::Map<const RowVectors> polyline(int k) const
+    {
+        if (k < 0 || k >= size()) {
+            throw std::out_of_range("polyline index out of range");
+        }
+        return Eigen::Map<const RowVectors>(coords_.data() + 3 * offsets_[k],
+                                            offsets_[k + 1] - offsets_[k], 3);
+    }
+    const PackedRTree &rtree() const { return rtree_; }
+
+    // k nearest polylines to p (each with its nearest point, longitude in
+    // [-180, 180] if wgs84), within max_distance if given
+    Hits nearest(const Eigen::Vector3d &p, int k = 1,
+                 std::optional<double> max_distance = {}) const
+    {
+        std::vector<Hit> hits;
+        __nearest(p, k, __max_dist2(max_distance), hits);
+        return __hits(hits);
+    }
+    // all polylines within radius of p, sorted by distance
+    Hits within(const Eigen::Vector3d &p, double radius) const
+    {
+        return nearest(p, INT_MAX, radius);
+    }
+
+    // nearest() for every row of points, on n_threads threads (0 for all
+    // hardware threads)
+    BatchHits nearest_batch(const Eigen::Ref<const RowVectors> &points,
+                            int k = 1,
+                            std::optional<double> max_distance = {},
+                            int n_threads = 0) const
+    {
+        const int M = points.rows();
+        const double max_dist2 = __max_dist2(max_distance);
+        std::vector<std::vector<Hit>> hits(M);
+        parallel_for(
+            M,
+            [&](int begin, int end) {
+                for (int i = begin; i < end; ++i) {
+                    __nearest(points.row(i), k, max_dist2, hits[i]);
+                }
+            },
+            n_threads, 64);
+        Eigen::VectorXi offsets(M + 1);
+        offsets[0] = 0;
+        for (int i = 0; i < M; ++i) {
+            offsets[i + 1] = offsets[i] + hits[i].size();
+        }
+        std::vector<Hit> flat;
+        flat.reserve(offsets[M]);
+        for (auto &h : hits) {
+            flat.insert(flat.end(), h.begin(), h.end());
+        }
+        auto [ids, pts, segs, ts, dists] = __hits(flat);
+        return std::make_tuple(offsets, ids, pts, segs, ts, dists);
+    }
+    BatchHits within_batch(const Eigen::Ref<const RowVectors> &points,
+                           double radius, int n_threads = 0) const
+    {
+        return nearest_batch(points, INT_MAX, radius, n_threads);
+    }
+
+  private:
+    RowVectors coords_;
+    Eigen::VectorXi offsets_;
+    bool is_wgs84_;
+    // chunk c covers segments [chunk_begin_[c], chunk_end_[c]) (rows of
+    // coords_) of polyline chunk_polyline_[c], single point polylines are
+    // one chunk with begin == end
+    std::vector<int> chunk_polyline_, chunk_begin_, chunk_end_;
+    PackedRTree rtree_;
+
+    struct Hit
+    {
+        int polyline;
+        int segment;
+        double t;
+        Eigen::Vector3d point;
+        double dist2;
+    };
+
+    static RowVectors __packed(const RowVectors &coords,
+                               const Eigen::Ref<const Eigen::VectorXi> &offsets)
+    {
+        internal::check_offsets(offsets, coords.rows());
+        const int M = std::max((int)offsets.size() - 1, 0);
+        if (!M || (offsets[0] == 0 && offsets[M] == coords.rows())) {
+            return M ? coords : RowVectors(0, 3);
+        }
+        RowVectors packed(offsets[M] - offsets[0], 3);
+        packed = coords.middleRows(offsets[0], packed.rows());
+        return packed;
+    }
+    static Eigen::VectorXi
+    __rebased(const Eigen::Ref<const Eigen::VectorXi> &offsets)
+    {
+        if (offsets.size() < 2) {
+            return Eigen::VectorXi::Zero(1);
+        }
+        return offsets.array() - offsets[0];
+    }
+    static RowVectors __concat(const std::vector<PolylineRuler> &rulers)
+    {
+        int N = 0;
+        for (auto &ruler : rulers) {
+            N += ruler.N();
+        }
+        RowVectors coords(N, 3);
+        N = 0;
+        for (auto &ruler : rulers) {
+            coords.middleRows(N, ruler.N()) = ruler.polyline();
+            N += ruler.N();
+        }
+        return coords;
+    }
+    static Eigen::VectorXi
+    __offsets(const std::vector<PolylineRuler> &rulers)
+    {
+        Eigen::VectorXi offsets(rulers.size() + 1);
+        offsets[0] = 0;
+        for (int k = 0; k < (int)rulers.size(); ++k) {
+            offsets[k + 1] = offsets[k] + rulers[k].N();
+        }
+        return offsets;
+    }
+    static double __max_dist2(std::optional<double> max_distance)
+    {
+        return max_distance ? (*max_distance) * (*max_distance)
+                            : std::numeric_limits<double>::infinity();
+    }
+
+    PackedRTree __build(int chunk_size)
+    {
+        for (int k = 0; k < size(); ++k) {
+            const int begin = offsets_[k], end = offsets_[k + 1];
+            if (end - begin == 1) {
+                chunk_polyline_.push_back(k);
+                chunk_begin_.push_back(begin);
+                chunk_end_.push_back(begin);
+            }
+            for (int i = begin; i < end - 1; i += chunk_size) {
+                chunk_polyline_.push_back(k);
+                chunk_begin_.push_back(i);
+                chunk_end_.push_back(std::min(i + chunk_size, end - 1));
+            }
+        }
+        const int C = chunk_polyline_.size();
+        PackedRTree::Boxes boxes(C, 6);
+        for (int c = 0; c < C; ++c) {
+            const int n = chunk_end_[c] - chunk_begin_[c] + 1;
+            auto rows = coords_.middleRows(chunk_begin_[c], n);
+            boxes.block<1, 3>(c, 0) = rows.colwise().minCoeff();
+            boxes.block<1, 3>(c, 3) = rows.colwise().maxCoeff();
+            if (!is_wgs84_) {
+                continue;
+            }
+            for (int i = 0; i + 1 < n; ++i) {
+                if (std::abs(rows(i + 1, 0) - rows(i, 0)) > 180.0) {
+                    // crosses the antimeridian, any longitude
+                    boxes(c, 0) = -180.0;
+                    boxes(c, 3) = 180.0;
+                    break;
+                }
+            }
+        }
+        return PackedRTree(boxes);
+    }
+
+    // lower bound of squared distances from p to the box of a node, in the
+    // frame of p (scaled by k, longitudes wrapped if wgs84)
+    double __box_distance2(int node, const Eigen::Vector3d &p,
+                           const Eigen::Vector3d &k) const
+    {
+        auto box = rtree_.boxes().row(node);
+        double dist2 = 0.0;
+        for (int i = 0; i < 3; ++i) {
+            double lo = box[i], hi = box[i + 3];
+            double d = std::max({lo - p[i], 0.0, p[i] - hi});
+            if (i == 0 && is_wgs84_) {
+                double w = hi - lo;
+                double u = std::fmod(p[0] - lo, 360.0);
+                u += u < 0.0 ? 360.0 : 0.0;
+                d = (w >= 360.0 || u <= w) ? 0.0
+                                           : std::min(u - w, 360.0 - u);
+            }
+            dist2 += (d * k[i]) * (d * k[i]);
+        }
+        // absorb rounding, boxes are only a bound
+        return dist2 * (1.0 - 1e-9);
+    }
+
+    // nearest point of chunk c to p
+    Hit __chunk_nearest(int c, const Eigen::Vector3d &p,
+                        const Eigen::Vector3d &k) const
+    {
+        const int polyline = chunk_polyline_[c];
+        Hit best{polyline, 0, 0.0, coords_.row(chunk_begin_[c]),
+                 std::numeric_limits<double>::infinity()};
+        auto delta = [&](const Eigen::Vector3d &to,
+                         const Eigen::Vector3d &from) {
+            Eigen::Vector3d d = to - from;
+            if (is_wgs84_) {
+                d[0] = std::remainder(d[0], 360.0);
+            }
+            return d;
+        };
+        if (chunk_begin_[c] == chunk_end_[c]) {
+            best.dist2 = delta(best.point, p).cwiseProduct(k).squaredNorm();
+        }
+        for (int i = chunk_begin_[c]; i < chunk_end_[c]; ++i) {
+            Eigen::Vector3d A = coords_.row(i);
+            Eigen::Vector3d dAB = delta(coords_.row(i + 1), A);
+            Eigen::Vector3d a = delta(A, p).cwiseProduct(k);
+            Eigen::Vector3d ab = dAB.cwiseProduct(k);
+            double len2 = ab.squaredNorm();
+            double t =
+                len2 > 0.0 ? std::clamp(-a.dot(ab) / len2, 0.0, 1.0) : 0.0;
+            double dist2 = (a + t * ab).squaredNorm();
+            if (dist2 < best.dist2) {
+                best.segment = i - offsets_[polyline];
+                best.t = t;
+                best.point = A + t * dAB;
+                best.dist2 = dist2;
+            }
+        }
+        if (is_wgs84_) {
+            // A + t * dAB may step over the antimeridian, back to [-180, 180]
+            best.point[0] = std::remainder(best.point[0], 360.0);
+        }
+        return best;
+    }
+
+    // best-first over chunks, evaluated chunks are held back until no
+    // unvisited chunk can be nearer, so polylines come out by ascending
+    // (exact) distance, each at its nearest chunk
+    void __nearest(const Eigen::Vector3d &p, int k, double max_dist2,
+                   std::vector<Hit> &hits) const
+    {
+        hits.clear();
+        if (k <= 0) {
+            return;
+        }
+        const Eigen::Vector3d scale =
+            is_wgs84_ ? cheap_ruler_k(p[1]) : Eigen::Vector3d::Ones();
+        std::vector<Hit> evaluated;
+        using Entry = std::pair<double, int>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>>
+            ready;
+        std::unordered_set<int> seen;
+        auto emit = [&](double bound2) {
+            while (!ready.empty() && ready.top().first <= bound2) {
+                const Hit &hit = evaluated[ready.top().second];
+                ready.pop();
+                if (seen.insert(hit.polyline).second) {
+                    hits.push_back(hit);
+                    if ((int)hits.size() == k) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        };
+        bool done = false;
+        rtree_.visit_nearest_by(
+            [&](int node) { return __box_distance2(node, p, scale); },
+            [&](int c, double box_dist2) {
+                if (box_dist2 > max_dist2) {
+                    return false;
+                }
+                if (emit(box_dist2)) {
+                    done = true;
+                    return false;
+                }
+                if (seen.count(chunk_polyline_[c])) {
+                    return true;
+                }
+                Hit hit = __chunk_nearest(c, p, scale);
+                if (hit.dist2 <= max_dist2) {
+                    evaluated.push_back(hit);
+                    ready.push({hit.dist2, (int)evaluated.size() - 1});
+                }
+                return true;
+            });
+        if (!done) {
+            emit(max_dist2);
+        }
+    }
+
+    static Hits __hits(const std::vector<Hit> &hits)
+    {
+        const int N = hits.size();
+        Eigen::VectorXi ids(N), segs(N);
+        RowVectors points(N, 3);
+        Eigen::VectorXd ts(N), dists(N);
+        for (int i = 0; i < N; ++i) {
+            ids[i] = hits[i].polyline;
+            points.row(i) = hits[i].point;
+            segs[i] = hits[i].segment;
+            ts[i] = hits[i].t;
+            dists[i] = std::sqrt(hits[i].dist2);
+        }
+        return std::make_tuple(ids, points, segs, ts, dists);
+    }
+};
+} // namespace cubao
+
+#endif
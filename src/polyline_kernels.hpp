@@ -0,0 +1,514 @@
+#ifndef CUBAO_POLYLINE_KERNELS_HPP
+#define CUBAO_POLYLINE_KERNELS_HPP
+
+// should sync
+// - https://github.com/cubao/polyline-ruler/blob/master/src/polyline_kernels.hpp
+// - https://github.com/cubao/headers/tree/main/include/cubao/polyline_kernels.hpp
+
+// bulk kernels (segment lengths, ranges) on row-major Nx3 buffers,
+// explicit AVX2/AVX-512 code paths are chosen at runtime by CPU detection.
+// every path does the same operations in the same order (no FMA), so
+// results are identical to the scalar code (unless the whole build enables
+// -ffp-contract=fast with FMA, which changes the scalar code as well)
+
+// https://github.com/microsoft/vscode-cpptools/issues/9692
+#if __INTELLISENSE__
+#undef __ARM_NEON
+#undef __ARM_NEON__
+#endif
+
+#include <algorithm>
+#include <cmath>
+
+#if (defined(__GNUC__) || defined(__clang__)) &&                              \
+    (defined(__x86_64__) || defined(__i386__)) && !__INTELLISENSE__
+#define CUBAO_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace cubao
+{
+namespace kernels
+{
+enum class ISA
+{
+    Generic = 0,
+    AVX2 = 1,
+    AVX512 = 2,
+};
+
+inline ISA detect_isa()
+{
+#ifdef CUBAO_KERNELS_X86
+    static const ISA isa = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            return ISA::AVX512;
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            return ISA::AVX2;
+        }
+        return ISA::Generic;
+    }();
+    return isa;
+#else
+    return ISA::Generic;
+#endif
+}
+
+namespace internal
+{
+// how deltas of consecutive points are computed
+enum class Delta
+{
+    // ((p[i+1] - anchor) * k) - ((p[i] - anchor) * k), same as differences
+    // of lla2enu coordinates (anchor=0, k=1 for cartesian coordinates)
+    Anchored,
+    // (p[i] - p[i+1]) * k, longitude difference wrapped into [-180, 180],
+    // same as CheapRuler::squareDistance
+    LongDiff,
+};
+
+// lengths of segments [begin, end)
+template <Delta mode, typename Scalar>
+inline void segment_lengths_generic(const Scalar *xyzs, int begin, int end,
+                                    const Scalar *anchor, const Scalar *k,
+                                    Scalar *out)
+{
+    for (int i = begin; i < end; ++i) {
+        const Scalar *p0 = xyzs + 3 * i;
+        const Scalar *p1 = p0 + 3;
+        Scalar d[3];
+        if (mode == Delta::Anchored) {
+            for (int c = 0; c < 3; ++c) {
+                d[c] = (p1[c] - anchor[c]) * k[c] - (p0[c] - anchor[c]) * k[c];
+            }
+        } else {
+            d[0] = std::remainder(p0[0] - p1[0], Scalar(360)) * k[0];
+            d[1] = (p0[1] - p1[1]) * k[1];
+            d[2] = (p0[2] - p1[2]) * k[2];
+        }
+        out[i] = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+    }
+}
+
+#ifdef CUBAO_KERNELS_X86
+// vector ops, `load3` reads `lanes` consecutive xyz points and
+// de-interleaves them into x, y, z registers
+#define CUBAO_KERNELS_TARGET __attribute__((target("avx2")))
+struct AVX2d
+{
+    using Scalar = double;
+    using V = __m256d;
+    static constexpr int lanes = 4;
+    CUBAO_KERNELS_TARGET static V set1(double v) { return _mm256_set1_pd(v); }
+    CUBAO_KERNELS_TARGET static void load3(const double *p, V &x, V &y, V &z)
+    {
+        // a: x0 y0 z0 x1, b: y1 z1 x2 y2, c: z2 x3 y3 z3
+        V a = _mm256_loadu_pd(p);
+        V b = _mm256_loadu_pd(p + 4);
+        V c = _mm256_loadu_pd(p + 8);
+        x = _mm256_blend_pd(_mm256_blend_pd(a, b, 0b0100), c, 0b0010);
+        y = _mm256_blend_pd(_mm256_blend_pd(a, b, 0b1001), c, 0b0100);
+        z = _mm256_blend_pd(_mm256_blend_pd(a, b, 0b0010), c, 0b1001);
+        x = _mm256_permute4x64_pd(x, _MM_SHUFFLE(1, 2, 3, 0));
+        y = _mm256_permute4x64_pd(y, _MM_SHUFFLE(2, 3, 0, 1));
+        z = _mm256_permute4x64_pd(z, _MM_SHUFFLE(3, 0, 1, 2));
+    }
+    CUBAO_KERNELS_TARGET static V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+    CUBAO_KERNELS_TARGET static V add(V a, V b) { return _mm256_add_pd(a, b); }
+    CUBAO_KERNELS_TARGET static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+    CUBAO_KERNELS_TARGET static V sqrt(V a) { return _mm256_sqrt_pd(a); }
+    CUBAO_KERNELS_TARGET static void store(double *p, V a)
+    {
+        _mm256_storeu_pd(p, a);
+    }
+    // all lanes in [-bound, bound] (false for NaN)
+    CUBAO_KERNELS_TARGET static bool within(V a, double bound)
+    {
+        V abs = _mm256_andnot_pd(_mm256_set1_pd(-0.0), a);
+        return _mm256_movemask_pd(_mm256_cmp_pd(abs, _mm256_set1_pd(bound),
+                                                _CMP_LE_OQ)) == 0xF;
+    }
+};
+struct AVX2f
+{
+    using Scalar = float;
+    using V = __m256;
+    static constexpr int lanes = 8;
+    CUBAO_KERNELS_TARGET static V set1(float v) { return _mm256_set1_ps(v); }
+    CUBAO_KERNELS_TARGET static void load3(const float *p, V &x, V &y, V &z)
+    {
+        // same permutation for a, b, c, then pick lanes from each
+        const __m256i x_idx = _mm256_setr_epi32(0, 3, 6, 1, 4, 7, 2, 5);
+        const __m256i y_idx = _mm256_setr_epi32(1, 4, 7, 2, 5, 0, 3, 6);
+        const __m256i z_idx = _mm256_setr_epi32(2, 5, 0, 3, 6, 1, 4, 7);
+        V a = _mm256_loadu_ps(p);
+        V b = _mm256_loadu_ps(p + 8);
+        V c = _mm256_loadu_ps(p + 16);
+        x = _mm256_blend_ps(
+            _mm256_blend_ps(_mm256_permutevar8x32_ps(a, x_idx),
+                            _mm256_permutevar8x32_ps(b, x_idx), 0x38),
+            _mm256_permutevar8x32_ps(c, x_idx), 0xC0);
+        y = _mm256_blend_ps(
+            _mm256_blend_ps(_mm256_permutevar8x32_ps(a, y_idx),
+                            _mm256_permutevar8x32_ps(b, y_idx), 0x18),
+            _mm256_permutevar8x32_ps(c, y_idx), 0xE0);
+        z = _mm256_blend_ps(
+            _mm256_blend_ps(_mm256_permutevar8x32_ps(a, z_idx),
+                            _mm256_permutevar8x32_ps(b, z_idx), 0x1C),
+            _mm256_permutevar8x32_ps(c, z_idx), 0xE0);
+    }
+    CUBAO_KERNELS_TARGET static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    CUBAO_KERNELS_TARGET static V add(V a, V b) { return _mm256_add_ps(a, b); }
+    CUBAO_KERNELS_TARGET static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    CUBAO_KERNELS_TARGET static V sqrt(V a) { return _mm256_sqrt_ps(a); }
+    CUBAO_KERNELS_TARGET static void store(float *p, V a)
+    {
+        _mm256_storeu_ps(p, a);
+    }
+    CUBAO_KERNELS_TARGET static bool within(V a, float bound)
+    {
+        V abs = _mm256_andnot_ps(_mm256_set1_ps(-0.f), a);
+        return _mm256_movemask_ps(_mm256_cmp_ps(abs, _mm256_set1_ps(bound),
+                                                _CMP_LE_OQ)) == 0xFF;
+    }
+};
+#undef CUBAO_KERNELS_TARGET
+
+// avx512f implies FMA, explicit rounding keeps compilers from contracting
+// mul + add/sub into fma (which would change results)
+#define CUBAO_KERNELS_TARGET __attribute__((target("avx512f")))
+#define CUBAO_KERNELS_ROUNDING (_MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)
+// zero-masked forms with all lanes set: the unmasked *_round intrinsics
+// merge into _mm512_undefined_*(), which gcc 12 flags -Wmaybe-uninitialized
+#define CUBAO_KERNELS_ALL_PD ((__mmask8)-1)
+#define CUBAO_KERNELS_ALL_PS ((__mmask16)-1)
+struct AVX512d
+{
+    using Scalar = double;
+    using V = __m512d;
+    static constexpr int lanes = 8;
+    CUBAO_KERNELS_TARGET static V set1(double v) { return _mm512_set1_pd(v); }
+    CUBAO_KERNELS_TARGET static void load3(const double *p, V &x, V &y, V &z)
+    {
+        // pick lanes from a, b first, then fill the rest from c
+        const __m512i x_ab = _mm512_setr_epi64(0, 3, 6, 9, 12, 15, 0, 0);
+        const __m512i x_c = _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 10, 13);
+        const __m512i y_ab = _mm512_setr_epi64(1, 4, 7, 10, 13, 0, 0, 0);
+        const __m512i y_c = _mm512_setr_epi64(0, 1, 2, 3, 4, 8, 11, 14);
+        const __m512i z_ab = _mm512_setr_epi64(2, 5, 8, 11, 14, 0, 0, 0);
+        const __m512i z_c = _mm512_setr_epi64(0, 1, 2, 3, 4, 9, 12, 15);
+        V a = _mm512_loadu_pd(p);
+        V b = _mm512_loadu_pd(p + 8);
+        V c = _mm512_loadu_pd(p + 16);
+        x = _mm512_permutex2var_pd(_mm512_permutex2var_pd(a, x_ab, b), x_c, c);
+        y = _mm512_permutex2var_pd(_mm512_permutex2var_pd(a, y_ab, b), y_c, c);
+        z = _mm512_permutex2var_pd(_mm512_permutex2var_pd(a, z_ab, b), z_c, c);
+    }
+    CUBAO_KERNELS_TARGET static V sub(V a, V b)
+    {
+        return _mm512_maskz_sub_round_pd(CUBAO_KERNELS_ALL_PD, a, b,
+                                         CUBAO_KERNELS_ROUNDING);
+    }
+    CUBAO_KERNELS_TARGET static V add(V a, V b)
+    {
+        return _mm512_maskz_add_round_pd(CUBAO_KERNELS_ALL_PD, a, b,
+                                         CUBAO_KERNELS_ROUNDING);
+    }
+    CUBAO_KERNELS_TARGET static V mul(V a, V b)
+    {
+        return _mm512_maskz_mul_round_pd(CUBAO_KERNELS_ALL_PD, a, b,
+                                         CUBAO_KERNELS_ROUNDING);
+    }
+    CUBAO_KERNELS_TARGET static V sqrt(V a)
+    {
+        return _mm512_maskz_sqrt_round_pd(CUBAO_KERNELS_ALL_PD, a,
+                                          CUBAO_KERNELS_ROUNDING);
+    }
+    CUBAO_KERNELS_TARGET static void store(double *p, V a)
+    {
+        _mm512_storeu_pd(p, a);
+    }
+    CUBAO_KERNELS_TARGET static bool within(V a, double bound)
+    {
+        return _mm512_cmp_pd_mask(_mm512_abs_pd(a), _mm512_set1_pd(bound),
+                                  _CMP_LE_OQ) == 0xFF;
+    }
+};
+struct AVX512f
+{
+    using Scalar = float;
+    using V = __m512;
+    static constexpr int lanes = 16;
+    CUBAO_KERNELS_TARGET static V set1(float v) { return _mm512_set1_ps(v); }
+    CUBAO_KERNELS_TARGET static void load3(const float *p, V &x, V &y, V &z)
+    {
+        const __m512i x_ab = _mm512_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21, //
+                                               24, 27, 30, 0, 0, 0, 0, 0);
+        const __m512i x_c = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, //
+                                              8, 9, 10, 17, 20, 23, 26, 29);
+        const __m512i y_ab = _mm512_setr_epi32(1, 4, 7, 10, 13, 16, 19, 22, //
+                                               25, 28, 31, 0, 0, 0, 0, 0);
+        const __m512i y_c = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, //
+                                              8, 9, 10, 18, 21, 24, 27, 30);
+        const __m512i z_ab = _mm512_setr_epi32(2, 5, 8, 11, 14, 17, 20, 23, //
+                                               26, 29, 0, 0, 0, 0, 0, 0);
+        const __m512i z_c = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, //
+                                              8, 9, 16, 19, 22, 25, 28, 31);
+        V a = _mm512_loadu_ps(p);
+        V b = _mm512_loadu_ps(p + 16);
+        V c = _mm512_loadu_ps(p + 32);
+        x = _mm512_permutex2var_ps(_mm512_permutex2var_ps(a, x_ab, b), x_c, c);
+        y = _mm512_permutex2var_ps(_mm512_permutex2var_ps(a, y_ab, b), y_c, c);
+        z = _mm512_permutex2var_ps(_mm512_permutex2var_ps(a, z_ab, b), z_c, c);
+    }
+    CUBAO_KERNELS_TARGET static V sub(V a, V b)
+    {
+        return _mm512_maskz_sub_round_ps(CUBAO_KERNELS_ALL_PS, a, b,
+                                         CUBAO_KERNELS_ROUNDING);
+    }
+    CUBAO_KERNELS_TARGET static V add(V a, V b)
+    {
+        return _mm512_maskz_add_round_ps(CUBAO_KERNELS_ALL_PS, a, b,
+                                         CUBAO_KERNELS_ROUNDING);
+    }
+    CUBAO_KERNELS_TARGET static V mul(V a, V b)
+    {
+        return _mm512_maskz_mul_round_ps(CUBAO_KERNELS_ALL_PS, a, b,
+                                         CUBAO_KERNELS_ROUNDING);
+    }
+    CUBAO_KERNELS_TARGET static V sqrt(V a)
+    {
+        return _mm512_maskz_sqrt_round_ps(CUBAO_KERNELS_ALL_PS, a,
+                                          CUBAO_KERNELS_ROUNDING);
+    }
+    CUBAO_KERNELS_TARGET static void store(float *p, V a)
+    {
+        _mm512_storeu_ps(p, a);
+    }
+    CUBAO_KERNELS_TARGET static bool within(V a, float bound)
+    {
+        return _mm512_cmp_ps_mask(_mm512_abs_ps(a), _mm512_set1_ps(bound),
+                                  _CMP_LE_OQ) == 0xFFFF;
+    }
+};
+#undef CUBAO_KERNELS_ALL_PS
+#undef CUBAO_KERNELS_ALL_PD
+#undef CUBAO_KERNELS_ROUNDING
+#undef CUBAO_KERNELS_TARGET
+
+// vectorized segment_lengths_generic on segments [0, n), returns number of
+// segments done: stops at the last partial step, or at the first step
+// where longitude deltas need wrapping (left to the scalar code)
+#define CUBAO_KERNELS_SEGMENT_LENGTHS(NAME, TARGET)                            \
+    template <typename Ops, Delta mode>                                        \
+    __attribute__((target(TARGET))) inline int NAME(                           \
+        const typename Ops::Scalar *xyzs, int n,                               \
+        const typename Ops::Scalar *anchor, const typename Ops::Scalar *k,     \
+        typename Ops::Scalar *out)                                             \
+    {                                                                          \
+        using V = typename Ops::V;                                             \
+        const V kx = Ops::set1(k[0]);                                          \
+        const V ky = Ops::set1(k[1]);                                          \
+        const V kz = Ops::set1(k[2]);                                          \
+        V ax = kx, ay = ky, az = kz;                                           \
+        if (mode == Delta::Anchored) {                                         \
+            ax = Ops::set1(anchor[0]);                                         \
+            ay = Ops::set1(anchor[1]);                                         \
+            az = Ops::set1(anchor[2]);                                         \
+        }                                                                      \
+        int i = 0;                                                             \
+        for (; i + Ops::lanes <= n; i += Ops::lanes) {                         \
+            V x0, y0, z0, x1, y1, z1, dx, dy, dz;                              \
+            Ops::load3(xyzs + 3 * i, x0, y0, z0);                              \
+            Ops::load3(xyzs + 3 * i + 3, x1, y1, z1);                          \
+            if (mode == Delta::Anchored) {                                     \
+                dx = Ops::sub(Ops::mul(Ops::sub(x1, ax), kx),                  \
+                              Ops::mul(Ops::sub(x0, ax), kx));                 \
+                dy = Ops::sub(Ops::mul(Ops::sub(y1, ay), ky),                  \
+                              Ops::mul(Ops::sub(y0, ay), ky));                 \
+                dz = Ops::sub(Ops::mul(Ops::sub(z1, az), kz),                  \
+                              Ops::mul(Ops::sub(z0, az), kz));                 \
+            } else {                                                           \
+                dx = Ops::sub(x0, x1);                                         \
+                if (!Ops::within(dx, 180)) {                                   \
+                    break;                                                     \
+                }                                                              \
+                dx = Ops::mul(dx, kx);                                         \
+                dy = Ops::mul(Ops::sub(y0, y1), ky);                           \
+                dz = Ops::mul(Ops::sub(z0, z1), kz);                           \
+            }                                                                  \
+            V dx2_dy2 = Ops::add(Ops::mul(dx, dx), Ops::mul(dy, dy));          \
+            Ops::store(out + i,                                                \
+                       Ops::sqrt(Ops::add(dx2_dy2, Ops::mul(dz, dz))));        \
+        }                                                                      \
+        return i;                                                              \
+    }
+CUBAO_KERNELS_SEGMENT_LENGTHS(segment_lengths_avx2, "avx2")
+CUBAO_KERNELS_SEGMENT_LENGTHS(segment_lengths_avx512, "avx512f")
+#undef CUBAO_KERNELS_SEGMENT_LENGTHS
+
+template <typename Scalar> struct SIMD;
+template <> struct SIMD<double>
+{
+    using AVX2 = AVX2d;
+    using AVX512 = AVX512d;
+};
+template <> struct SIMD<float>
+{
+    using AVX2 = AVX2f;
+    using AVX512 = AVX512f;
+};
+#endif
+
+template <Delta mode, typename Scalar>
+inline void segment_lengths(const Scalar *xyzs, int N, const Scalar *anchor,
+                            const Scalar *k, Scalar *out, ISA isa)
+{
+    const int n = N - 1;
+    int i = 0;
+#ifdef CUBAO_KERNELS_X86
+    while (isa != ISA::Generic && i < n) {
+        int done = 0;
+        if (isa == ISA::AVX512) {
+            using Ops = typename SIMD<Scalar>::AVX512;
+            done = segment_lengths_avx512<Ops, mode>(xyzs + 3 * i, n - i,
+                                                     anchor, k, out + i);
+        } else {
+            using Ops = typename SIMD<Scalar>::AVX2;
+            done = segment_lengths_avx2<Ops, mode>(xyzs + 3 * i, n - i,
+                                                   anchor, k, out + i);
+        }
+        // one scalar step (where simd bailed out, or the tail)
+        int end = std::min(n, i + done + 16);
+        segment_lengths_generic<mode>(xyzs, i + done, end, anchor, k, out);
+        i = end;
+    }
+#endif
+    segment_lengths_generic<mode>(xyzs, i, n, anchor, k, out);
+}
+
+// segment lengths in cache-sized blocks,
+// `visitor(first_segment_index, lengths, num_segments)`
+template <Delta mode, typename Scalar, typename Visitor>
+inline void visit_segment_lengths(const Scalar *xyzs, int N,
+                                  const Scalar *anchor, const Scalar *k,
+                                  ISA isa, Visitor &&visitor)
+{
+    constexpr int BLOCK_SIZE = 1024;
+    Scalar lengths[BLOCK_SIZE];
+    for (int i0 = 0; i0 < N - 1; i0 += BLOCK_SIZE) {
+        int n = std::min(BLOCK_SIZE, N - 1 - i0);
+        segment_lengths<mode>(xyzs + 3 * i0, n + 1, anchor, k, lengths, isa);
+        visitor(i0, (const Scalar *)lengths, n);
+    }
+}
+
+template <Delta mode, typename Scalar>
+inline void ranges(const Scalar *xyzs, int N, const Scalar *anchor,
+                   const Scalar *k, double *out, ISA isa)
+{
+    if (N <= 0) {
+        return;
+    }
+    out[0] = 0.0;
+    visit_segment_lengths<mode>(
+        xyzs, N, anchor, k, isa, [out](int i0, const Scalar *lengths, int n) {
+            double *ranges = out + i0;
+            for (int j = 0; j < n; ++j) {
+                ranges[j + 1] = ranges[j] + lengths[j];
+            }
+        });
+}
+
+template <Delta mode, typename Scalar>
+inline double line_distance(const Scalar *xyzs, int N, const Scalar *anchor,
+                            const Scalar *k, ISA isa)
+{
+    double total = 0.0;
+    visit_segment_lengths<mode>(xyzs, N, anchor, k, isa,
+                                [&](int, const Scalar *lengths, int n) {
+                                    for (int j = 0; j < n; ++j) {
+                                        total += lengths[j];
+                                    }
+                                });
+    return total;
+}
+} // namespace internal
+
+// lengths of N-1 segments of row-major Nx3 `xyzs` into `out`, measured
+// on (xyz - anchor) * k, i.e. in ENU coordinates like lla2enu does
+// (pass anchor=0, k=1 for cartesian coordinates)
+template <typename Scalar>
+inline void segment_lengths(const Scalar *xyzs, int N, const Scalar *anchor,
+                            const Scalar *k, Scalar *out,
+                            ISA isa = detect_isa())
+{
+    internal::segment_lengths<internal::Delta::Anchored>(xyzs, N, anchor, k,
+                                                         out, isa);
+}
+template <typename Scalar>
+inline void segment_lengths(const Scalar *xyzs, int N, Scalar *out,
+                            ISA isa = detect_isa())
+{
+    const Scalar anchor[3] = {0, 0, 0};
+    const Scalar k[3] = {1, 1, 1};
+    segment_lengths(xyzs, N, anchor, k, out, isa);
+}
+
+// same as above, but longitude differences are wrapped (CheapRuler::longDiff)
+// and no anchor is needed
+template <typename Scalar>
+inline void segment_lengths_longdiff(const Scalar *llas, int N,
+                                     const Scalar *k, Scalar *out,
+                                     ISA isa = detect_isa())
+{
+    internal::segment_lengths<internal::Delta::LongDiff, Scalar>(
+        llas, N, nullptr, k, out, isa);
+}
+
+// cumulative lengths (N values, starting from 0) into `out`, accumulated
+// sequentially in double, so `ranges[i + 1] == ranges[i] + length[i]`
+// holds exactly (and float32 inputs don't lose precision over long lines)
+template <typename Scalar>
+inline void ranges(const Scalar *xyzs, int N, const Scalar *anchor,
+                   const Scalar *k, double *out, ISA isa = detect_isa())
+{
+    internal::ranges<internal::Delta::Anchored>(xyzs, N, anchor, k, out, isa);
+}
+template <typename Scalar>
+inline void ranges(const Scalar *xyzs, int N, double *out,
+                   ISA isa = detect_isa())
+{
+    const Scalar anchor[3] = {0, 0, 0};
+    const Scalar k[3] = {1, 1, 1};
+    ranges(xyzs, N, anchor, k, out, isa);
+}
+
+// total length, same value as the last of ranges
+template <typename Scalar>
+inline double line_distance(const Scalar *xyzs, int N, const Scalar *anchor,
+                            const Scalar *k, ISA isa = detect_isa())
+{
+    return internal::line_distance<internal::Delta::Anchored>(xyzs, N, anchor,
+                                                              k, isa);
+}
+template <typename Scalar>
+inline double line_distance(const Scalar *xyzs, int N, ISA isa = detect_isa())
+{
+    const Scalar anchor[3] = {0, 0, 0};
+    const Scalar k[3] = {1, 1, 1};
+    return line_distance(xyzs, N, anchor, k, isa);
+}
+template <typename Scalar>
+inline double line_distance_longdiff(const Scalar *llas, int N,
+                                     const Scalar *k, ISA isa = detect_isa())
+{
+    return internal::line_distance<internal::Delta::LongDiff, Scalar>(
+        llas, N, nullptr, k, isa);
+}
+} // namespace kernels
+} // namespace cubao
+
+#endif
@@ -12,17 +12,27 @@
 #endif
 
 #include <Eigen/Core>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <queue>
 
 #include "crs_transform.hpp"
 #include "eigen_helpers.hpp"
+#include "packed_rtree.hpp"
+#include "parallel_for.hpp"
+#include "polyline_kernels.hpp"
 
 namespace cubao
 {
 using RowVectors = Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor>;
 using RowVectorsNx3 = RowVectors;
 using RowVectorsNx2 = Eigen::Matrix<double, Eigen::Dynamic, 2, Eigen::RowMajor>;
+using RowVectorsNx3f = Eigen::Matrix<float, Eigen::Dynamic, 3, Eigen::RowMajor>;
+using RowVectorsNx16 =
+    Eigen::Matrix<double, Eigen::Dynamic, 16, Eigen::RowMajor>;
+using RowVectorsNx2i = Eigen::Matrix<int, Eigen::Dynamic, 2, Eigen::RowMajor>;
 
 inline std::tuple<Eigen::Vector2d, double, double>
 snap_onto_2d(const Eigen::Vector2d &P, //
@@ -257,15 +267,301 @@ struct LineSegment
     }
 };
 
+// lazily initialized value, safe to be shared (read & initialized) across
+// threads, copying copies the value (if ready), not the lock
+template <typename T> struct LazyCache
+{
+    LazyCache() = default;
+    LazyCache(const LazyCache &other)
+    {
+        if (other) {
+            value_.emplace(*other);
+            ready_.store(true, std::memory_order_release);
+        }
+    }
+    LazyCache &operator=(const LazyCache &) = delete;
+
+    explicit operator bool() const
+    {
+        return ready_.load(std::memory_order_acquire);
+    }
+    // only valid when ready
+    const T &operator*() const { return *value_; }
+
+    template <typename Init> const T &get(Init &&init) const
+    {
+        if (!*this) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!ready_.load(std::memory_order_relaxed)) {
+                value_ = init();
+                ready_.store(true, std::memory_order_release);
+            }
+        }
+        return *value_;
+    }
+    // drop the value (computed again on next get), not thread-safe: no
+    // other thread may be reading it
+    void reset()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready_.store(false, std::memory_order_release);
+        value_.reset();
+    }
+
+  private:
+    mutable std::optional<T> value_;
+    mutable std::atomic<bool> ready_{false};
+    mutable std::mutex mutex_;
+};
+
+namespace internal
+{
+// shared by PolylineRuler & PolylineRulerT, `line` is a row-major Nx2 or Nx3
+// matrix (or a Ref/Map of one), `Vector` a fixed-size column of the same
+// dimension
+
+// (segment index, t) for a cumulative distance along ranges[0:N] (N >= 2),
+// t is not clamped (extrapolates before the first/after the last segment)
+inline std::pair<int, double> segment_index_t(const double *ranges, int N,
+                                              double range)
+{
+    int I = std::upper_bound(ranges, ranges + N, range) - ranges;
+    int i = std::min(std::max(0, I - 1), N - 2);
+    double t = (range - ranges[i]) / (ranges[i + 1] - ranges[i]);
+    return {i, t};
+}
+
+// squared distance from p to segment [line[i], line[i+1]],
+// projected point and t (unclamped) returned via pp, t
+template <typename Line, typename Vector>
+inline double point_on_segment(const Line &line, int i, const Vector &p,
+                               Vector &pp, double &t)
+{
+    t = 0.;
+    Vector ab = line.row(i + 1) - line.row(i);
+    pp = line.row(i);
+    if ((ab.array() != 0.).any()) {
+        Vector ap = p - line.row(i).transpose();
+        t = ab.dot(ap) / ab.squaredNorm();
+        // t' = unit(ab).dot(ap) = t / |ab|
+        // t' > |ap|        -> pp   = line.row(i+1)
+        // t' > 0.0         -> pp  += t' * unit(ab)
+        //                     pp  += t  * ab
+        if (t > 1.0) {
+            pp = line.row(i + 1);
+        } else if (t > 0) {
+            pp += t * ab;
+        }
+    }
+    return (pp - p).squaredNorm();
+}
+
+// packed R-tree over bounding boxes of segments (z = 0 for 2D)
+template <typename Line> inline PackedRTree segments_rtree(const Line &line)
+{
+    constexpr int Dim = Line::ColsAtCompileTime;
+    const int N = line.rows();
+    PackedRTree::Boxes boxes =
+        PackedRTree::Boxes::Zero(std::max(N - 1, 0), 6);
+    for (int i = 0; i < N - 1; ++i) {
+        boxes.block<1, Dim>(i, 0) = line.row(i).cwiseMin(line.row(i + 1));
+        boxes.block<1, Dim>(i, 3) = line.row(i).cwiseMax(line.row(i + 1));
+    }
+    return PackedRTree(boxes);
+}
+
+// slack for rounding errors when pruning by box distance
+inline double rtree_tolerance(const PackedRTree &rtree)
+{
+    double scale = rtree.bounds().cwiseAbs().maxCoeff();
+    return (1e-10 * scale) * (1e-10 * scale) + 1e-30;
+}
+
+// nearest point on line to p, as [point, segment index, t], by linear scan
+// or, given rtree (segments_rtree(line)), only over segments near p, both
+// keep the first (smallest index) of equal minimums
+template <typename Line, typename Vector>
+inline std::tuple<Vector, int, double>
+point_on_line(const Line &line, const Vector &p,
+              const PackedRTree *rtree = nullptr)
+{
+    double minDist = std::numeric_limits<double>::infinity();
+    Vector minP = Vector::Zero();
+    int minI = 0;
+    double minT = 0.;
+    auto visit = [&](int i) {
+        double t = 0.;
+        Vector pp;
+        double sqDist = point_on_segment(line, i, p, pp, t);
+        if (sqDist < minDist || (sqDist == minDist && i < minI)) {
+            minDist = sqDist;
+            minP = pp;
+            minI = i;
+            minT = t;
+        }
+    };
+    if (rtree && rtree->size()) {
+        constexpr int Dim = Vector::RowsAtCompileTime;
+        Eigen::Vector3d P = Eigen::Vector3d::Zero();
+        P.head<Dim>() = p;
+        const double tol = rtree_tolerance(*rtree);
+        rtree->visit_nearest(P, [&](int i, double box_dist2) {
+            if (box_dist2 > minDist * (1.0 + 1e-9) + tol) {
+                return false;
+            }
+            visit(i);
+            return true;
+        });
+    } else {
+        for (int i = 0; i < line.rows() - 1; ++i) {
+            visit(i);
+        }
+    }
+    return std::make_tuple(minP, minI, std::fmax(0., std::fmin(1., minT)));
+}
+
+struct SegmentHit
+{
+    int i, j; // rows of the segments' start points, i < j
+    Eigen::Vector3d point;
+    double t, s;
+};
+
+// crossings (in x-y plane) between segments of polylines
+// coords[offsets[k]:offsets[k+1]], sorted by (i, j), segments of the same
+// polyline are only checked when `include_self`.
+// zero-length segments (duplicate points) are skipped, neighboring segments
+// (also the last & first ones of a closed polyline) touching at their shared
+// point don't count, overlapping collinear ones do (see intersect_segments).
+// candidates come from a PackedRTree of segment boxes, queries are split
+// across n_threads threads, `first_only` stops at (any) first crossing
+inline std::vector<SegmentHit>
+segment_intersections(const Eigen::Ref<const RowVectors> &coords,
+                      const Eigen::Ref<const Eigen::VectorXi> &offsets,
+                      bool include_self, bool first_only = false,
+                      int n_threads = 0)
+{
+    const int N = coords.rows();
+    // segs: rows of non-degenerate segments, owner: their polyline index,
+    // next: row of the next segment along the polyline (or -1)
+    std::vector<int> segs, owner(N, -1), next(N, -1);
+    for (int k = 0; k + 1 < offsets.size(); ++k) {
+        int first = -1, last = -1;
+        for (int r = offsets[k]; r + 1 < offsets[k + 1]; ++r) {
+            if (coords.row(r).head<2>() == coords.row(r + 1).head<2>()) {
+                continue;
+            }
+            owner[r] = k;
+            if (last < 0) {
+                first = r;
+            } else {
+                next[last] = r;
+            }
+            last = r;
+            segs.push_back(r);
+        }
+        if (first != last && coords.row(offsets[k]).head<2>() ==
+                                 coords.row(offsets[k + 1] - 1).head<2>()) {
+            next[last] = first;
+        }
+    }
+    std::vector<SegmentHit> hits;
+    const int S = segs.size();
+    if (S < 2) {
+        return hits;
+    }
+    PackedRTree::Boxes boxes(S, 6);
+    for (int k = 0; k < S; ++k) {
+        auto a = coords.row(segs[k]);
+        auto b = coords.row(segs[k] + 1);
+        boxes.row(k) << std::min(a[0], b[0]), std::min(a[1], b[1]), 0.0,
+            std::max(a[0], b[0]), std::max(a[1], b[1]), 0.0;
+    }
+    const PackedRTree rtree(boxes);
+
+    constexpr double eps = 1e-9;
+    std::atomic<bool> found{false};
+    std::mutex mutex;
+    std::vector<std::pair<int, std::vector<SegmentHit>>> chunks;
+    parallel_for(
+        S,
+        [&](int begin, int end) {
+            std::vector<SegmentHit> local;
+            std::vector<int> js;
+            for (int k = begin; k < end && !(first_only && found); ++k) {
+                const int i = segs[k];
+                js.clear();
+                rtree.visit(boxes.row(k).head<3>(), boxes.row(k).tail<3>(),
+                            [&](int l) {
+                                if (segs[l] > i) {
+                                    js.push_back(segs[l]);
+                                }
+                                return true;
+                            });
+                std::sort(js.begin(), js.end());
+                for (int j : js) {
+                    if (!include_self && owner[i] == owner[j]) {
+                        continue;
+                    }
+                    auto hit = intersect_segments(
+                        Eigen::Vector3d(coords.row(i)),
+                        Eigen::Vector3d(coords.row(i + 1)),
+                        Eigen::Vector3d(coords.row(j)),
+                        Eigen::Vector3d(coords.row(j + 1)));
+                    if (!hit) {
+                        continue;
+                    }
+                    const double t = std::get<1>(*hit);
+                    const double s = std::get<2>(*hit);
+                    if ((next[i] == j && 1.0 - t <= eps && s <= eps) ||
+                        (next[j] == i && t <= eps && 1.0 - s <= eps)) {
+                        continue;
+                    }
+                    local.push_back({i, j, std::get<0>(*hit), t, s});
+                    if (first_only) {
+                        found = true;
+                        break;
+                    }
+                }
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            chunks.emplace_back(begin, std::move(local));
+        },
+        n_threads, 1 << 12);
+    std::sort(chunks.begin(), chunks.end(),
+              [](auto &a, auto &b) { return a.first < b.first; });
+    for (auto &chunk : chunks) {
+        hits.insert(hits.end(), chunk.second.begin(), chunk.second.end());
+    }
+    if (first_only && hits.size() > 1) {
+        hits.resize(1);
+    }
+    return hits;
+}
+} // namespace internal
+
+struct AppendablePolylineRuler;
+struct BandedPolylineRuler;
 struct PolylineRuler
 {
+    friend struct AppendablePolylineRuler;
+    friend struct BandedPolylineRuler;
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
     PolylineRuler(const Eigen::Ref<const RowVectors> &polyline,
                   bool is_wgs84 = false)
-        : polyline_(polyline),                        //
-          N_(polyline.rows()),                        //
+        : PolylineRuler(std::make_shared<const RowVectors>(polyline), is_wgs84)
+    {
+    }
+    // non-owning view over a row-major Nx3 buffer (no copy), `owner` (if any)
+    // is held to keep the buffer alive, the buffer should not be modified
+    // during the lifetime of the ruler (caches would be stale)
+    PolylineRuler(const double *data, int N, bool is_wgs84 = false,
+                  std::shared_ptr<const void> owner = {})
+        : owner_(std::move(owner)),                   //
+          polyline_(data, N, 3),                      //
+          N_(N),                                      //
           is_wgs84_(is_wgs84),                        //
-          k_(is_wgs84 ? cheap_ruler_k(polyline(0, 1)) //
+          k_(is_wgs84 ? cheap_ruler_k(polyline_(0, 1)) //
                       : Eigen::Vector3d::Ones())
     {
     }
@@ -278,17 +574,26 @@ struct PolylineRuler
     }
 
   private:
-    const RowVectors polyline_;
+    PolylineRuler(const std::shared_ptr<const RowVectors> &polyline,
+                  bool is_wgs84)
+        : PolylineRuler(polyline->data(), polyline->rows(), is_wgs84, polyline)
+    {
+    }
+
+    // owned (shared, immutable) data or keep-alive handle of external buffer
+    std::shared_ptr<const void> owner_;
+    const Eigen::Map<const RowVectors> polyline_;
     const int N_;
     const bool is_wgs84_;
     const Eigen::Vector3d k_;
-    // cache
-    mutable std::optional<Eigen::VectorXd> ranges_;
-    mutable std::optional<RowVectors> dirs_;
-    mutable std::optional<RowVectors> enus_; // only when is_wgs84==true
+    // cache, lazily computed (thread-safe), see also freeze()
+    LazyCache<Eigen::VectorXd> ranges_;
+    LazyCache<RowVectors> dirs_;
+    LazyCache<RowVectors> enus_; // only when is_wgs84==true
+    LazyCache<PackedRTree> rtree_;
 
   public:
-    const RowVectors &polyline() const { return polyline_; }
+    const Eigen::Map<const RowVectors> &polyline() const { return polyline_; }
     int N() const { return N_; }
     bool is_wgs84() const { return is_wgs84_; }
     Eigen::Vector3d k() const { return k_; }
@@ -300,33 +605,42 @@ struct PolylineRuler
         //      0  1  2  3  4  5
         //      o----o--------o
         //      return [0, 1.5, 4.8]
-        if (is_wgs84) {
-            return ranges(lla2enu(polyline), !is_wgs84);
+        const int N = polyline.rows();
+        if (N < 2) {
+            throw std::invalid_argument(
+                "polyline should have at least two points");
+        }
+        if (polyline.outerStride() != 3) {
+            return ranges(RowVectors(polyline), is_wgs84);
         }
+        auto [anchor, k] = __anchor_k(polyline, is_wgs84);
+        Eigen::VectorXd ret(N);
+        kernels::ranges(polyline.data(), N, anchor.data(), k.data(),
+                        ret.data());
+        return ret;
+    }
+    // float32 variant (cartesian only), for bulk jobs where centimeter
+    // precision is enough: twice the SIMD lanes for segment lengths,
+    // still accumulated in double
+    static Eigen::VectorXd
+    ranges(const Eigen::Ref<const RowVectorsNx3f> &polyline)
+    {
         const int N = polyline.rows();
         if (N < 2) {
             throw std::invalid_argument(
                 "polyline should have at least two points");
         }
-        Eigen::VectorXd ranges =
-            (polyline.bottomRows(N - 1) - polyline.topRows(N - 1))
-                .rowwise()
-                .norm();
-        for (int i = 1; i < N - 1; ++i) {
-            ranges[i] += ranges[i - 1];
+        if (polyline.outerStride() != 3) {
+            return ranges(RowVectorsNx3f(polyline));
         }
         Eigen::VectorXd ret(N);
-        ret[0] = 0.0;
-        ret.tail(N - 1) = ranges;
+        kernels::ranges(polyline.data(), N, ret.data());
         return ret;
     }
 
     const Eigen::VectorXd &ranges() const
     {
-        if (!ranges_) {
-            ranges_ = ranges(polyline_, is_wgs84_);
-        }
-        return *ranges_;
+        return ranges_.get([this] { return ranges(polyline_, is_wgs84_); });
     }
     double range(int seg_idx) const { return ranges()[seg_idx]; }
     double range(int seg_idx, double t) const
@@ -344,11 +658,62 @@ struct PolylineRuler
 
     std::pair<int, double> segment_index_t(double range) const
     {
-        const double *ranges = this->ranges().data();
-        int I = std::upper_bound(ranges, ranges + N_, range) - ranges;
-        int i = std::min(std::max(0, I - 1), N_ - 2);
-        double t = (range - ranges[i]) / (ranges[i + 1] - ranges[i]);
-        return {i, t};
+        return internal::segment_index_t(ranges().data(), N_, range);
+    }
+
+    // batched segment_index_t, advances a single cursor over ranges() when
+    // `ranges` is sorted, otherwise sorts first and scatters results back
+    std::pair<Eigen::VectorXi, Eigen::VectorXd>
+    segment_indexes_t(const Eigen::Ref<const Eigen::VectorXd> &ranges) const
+    {
+        const int M = ranges.size();
+        Eigen::VectorXi indexes(M);
+        Eigen::VectorXd ts(M);
+        const double *R = this->ranges().data();
+        // walk a few steps, then binary search the rest (sparse queries)
+        auto advance = [&](int I, double range) {
+            for (int s = 0; s < 8; ++s, ++I) {
+                if (I == N_ || R[I] > range) {
+                    return I;
+                }
+            }
+            return (int)(std::upper_bound(R + I, R + N_, range) - R);
+        };
+        auto assign = [&](int k, int I) {
+            int i = std::min(std::max(0, I - 1), N_ - 2);
+            indexes[k] = i;
+            ts[k] = (ranges[k] - R[i]) / (R[i + 1] - R[i]);
+        };
+        bool sorted = true;
+        for (int k = 1; k < M && sorted; ++k) {
+            sorted = ranges[k] >= ranges[k - 1];
+        }
+        if (M && sorted && !std::isnan(ranges[0])) {
+            int I = 0;
+            for (int k = 0; k < M; ++k) {
+                I = advance(I, ranges[k]);
+                assign(k, I);
+            }
+            return {std::move(indexes), std::move(ts)};
+        }
+        std::vector<int> order;
+        order.reserve(M);
+        for (int k = 0; k < M; ++k) {
+            if (std::isnan(ranges[k])) {
+                assign(k, N_); // same as upper_bound
+            } else {
+                order.push_back(k);
+            }
+        }
+        std::sort(order.begin(), order.end(), [&](int a, int b) {
+            return ranges[a] < ranges[b];
+        });
+        int I = 0;
+        for (int k : order) {
+            I = advance(I, ranges[k]);
+            assign(k, I);
+        }
+        return {std::move(indexes), std::move(ts)};
     }
 
     double length() const { return ranges()[N_ - 1]; }
@@ -386,14 +751,14 @@ struct PolylineRuler
             while (r < N - 1 && !norms2[r]) {
                 ++r;
             }
-            if (r != i + 1 || r == N) {
+            if (r != i + 1 || r == N - 1) {
                 while (l >= 0 && !norms2[l]) {
                     --l;
                 }
             }
             l = std::max(0, l);
             r = std::min(N - 1, r);
-            if (!norms2.segment(l, r - l + 1).sum()) {
+            if (!norms2.segment(l, std::min(r, N - 2) - l + 1).sum()) {
                 throw std::invalid_argument(
                     "polyline is collapsed under plane-xy");
             }
@@ -406,20 +771,80 @@ struct PolylineRuler
 
     const RowVectors &dirs() const
     {
-        if (!dirs_) {
-            dirs_ = dirs(polyline_, is_wgs84_);
+        return dirs_.get([this] { return dirs(polyline_, is_wgs84_); });
+    }
+
+    static PackedRTree rtree(const Eigen::Ref<const RowVectors> &polyline,
+                             bool is_wgs84 = false)
+    {
+        // packed R-tree over bounding boxes of segments (in ENU if wgs84)
+        if (is_wgs84) {
+            return rtree(lla2enu(polyline), !is_wgs84);
+        }
+        return internal::segments_rtree(polyline);
+    }
+
+    // segment index, built lazily, once built it speeds up
+    // pointOnLine/lineSlice/nearest_segments to ~O(logN)
+    const PackedRTree &rtree() const
+    {
+        return rtree_.get([this] { return rtree(__xyzs(), false); });
+    }
+    bool has_rtree() const { return (bool)rtree_; }
+
+    // eagerly compute all caches (optionally the segment index), a frozen
+    // ruler can be queried concurrently without ever taking a lock
+    const PolylineRuler &freeze(bool with_rtree = false) const
+    {
+        ranges();
+        dirs();
+        if (is_wgs84_) {
+            enus();
+        }
+        if (with_rtree) {
+            rtree();
+        }
+        return *this;
+    }
+    bool is_frozen() const
+    {
+        return ranges_ && dirs_ && (!is_wgs84_ || enus_);
+    }
+
+    // fill caches with precomputed ranges() / dirs() (e.g. stored along with
+    // the polyline, see PolylineCollection), no-op if already computed
+    const PolylineRuler &
+    preload_ranges(const Eigen::Ref<const Eigen::VectorXd> &ranges) const
+    {
+        if (ranges.size() != N_) {
+            throw std::invalid_argument("ranges should have N rows");
+        }
+        ranges_.get([&] { return Eigen::VectorXd(ranges); });
+        return *this;
+    }
+    const PolylineRuler &
+    preload_dirs(const Eigen::Ref<const RowVectors> &dirs) const
+    {
+        if (dirs.rows() != N_ - 1) {
+            throw std::invalid_argument("dirs should have N-1 rows");
         }
-        return *dirs_;
+        dirs_.get([&] { return RowVectors(dirs); });
+        return *this;
     }
 
   private:
     const RowVectors &enus() const
     {
         assert(is_wgs84_);
-        if (!enus_) {
-            enus_ = __lla2enu(polyline_);
+        return enus_.get([this] { return __lla2enu(RowVectors(polyline_)); });
+    }
+    // coordinates to measure on: enus() if wgs84, otherwise polyline()
+    Eigen::Ref<const RowVectors> __xyzs() const
+    {
+        if (is_wgs84_) {
+            return enus();
         }
-        return *enus_;
+        return polyline_;
     }
     Eigen::Vector3d __enu2lla(const Eigen::Vector3d &enu) const
     {
@@ -444,9 +869,8 @@ struct PolylineRuler
         }
         return llas;
     }
-    RowVectors __lla2enu(const RowVectors &llas) const
+    RowVectors __lla2enu(RowVectors enus) const
     {
-        RowVectors enus = llas;
         for (int i = 0; i < 3; ++i) {
             enus.col(i).array() -= polyline_(0, i);
             enus.col(i).array() *= k_[i];
@@ -454,19 +878,17 @@ struct PolylineRuler
         return enus;
     }
 
-  public:
-    Eigen::Vector3d dir(int pt_index) const
+    // shared by single and batched queries, (i, t) from segment_index_t
+    Eigen::Vector3d __dir(int i, double t, bool smooth_joint) const
     {
-        return dirs().row(std::min(pt_index, N_ - 2));
+        return __dir(dirs(), i, t, smooth_joint);
     }
-
-    Eigen::Vector3d dir(double range, bool smooth_joint = true) const
+    static Eigen::Vector3d __dir(const Eigen::Ref<const RowVectors> &dirs,
+                                 int i, double t, bool smooth_joint)
     {
         if (!smooth_joint) {
-            return dir(segment_index(range));
+            return dirs.row(i);
         }
-        auto [i, t] = segment_index_t(range);
-        auto &dirs = this->dirs();
         if (i == 0) {
             return dirs.row(0);
         } else if (t == 0) {
@@ -476,6 +898,65 @@ struct PolylineRuler
             return dirs.row(i);
         }
     }
+    std::pair<Eigen::Vector3d, Eigen::Vector3d>
+    __scanline(const Eigen::Vector3d &pos, const Eigen::Vector3d &dir,
+               double min, double max) const
+    {
+        Eigen::Vector3d left(-dir[1], dir[0], 0.0);
+        left /= left.norm();
+        if (is_wgs84_) {
+            left.array() /= k_.array();
+        }
+        return std::make_pair<Eigen::Vector3d, Eigen::Vector3d>(
+            pos + left * min, pos + left * max);
+    }
+    Eigen::Matrix4d __local_frame(const Eigen::Vector3d &pos,
+                                  const Eigen::Vector3d &x) const
+    {
+        return __local_frame(pos, x, is_wgs84_);
+    }
+    static Eigen::Matrix4d __local_frame(const Eigen::Vector3d &pos,
+                                         const Eigen::Vector3d &x,
+                                         bool is_wgs84)
+    {
+        // x -> forward
+        Eigen::Vector3d z(0, 0, 1);     // upward
+        Eigen::Vector3d y = z.cross(x); // leftward
+        y /= y.norm();
+        z = x.cross(y);
+        Eigen::Matrix4d T_world_local = Eigen::Matrix4d::Identity();
+        T_world_local.block<3, 1>(0, 0) = x;
+        T_world_local.block<3, 1>(0, 1) = y;
+        T_world_local.block<3, 1>(0, 2) = z;
+        if (!is_wgs84) {
+            T_world_local.block<3, 1>(0, 3) = pos;
+        } else {
+            T_world_local = T_ecef_enu(pos) * T_world_local;
+        }
+        return T_world_local;
+    }
+
+  public:
+    Eigen::Vector3d dir(int pt_index) const
+    {
+        return dirs().row(std::min(pt_index, N_ - 2));
+    }
+
+    Eigen::Vector3d dir(double range, bool smooth_joint = true) const
+    {
+        auto [i, t] = segment_index_t(range);
+        return __dir(i, t, smooth_joint);
+    }
+    RowVectors dir(const Eigen::Ref<const Eigen::VectorXd> &ranges,
+                   bool smooth_joint = true) const
+    {
+        auto [I, T] = segment_indexes_t(ranges);
+        RowVectors dirs(I.size(), 3);
+        for (int k = 0; k < I.size(); ++k) {
+            dirs.row(k) = __dir(I[k], T[k], smooth_joint);
+        }
+        return dirs;
+    }
 
     Eigen::Vector3d extended_along(double range) const
     {
@@ -484,6 +965,15 @@ struct PolylineRuler
     }
 
     Eigen::Vector3d at(double range) const { return extended_along(range); }
+    RowVectors at(const Eigen::Ref<const Eigen::VectorXd> &ranges) const
+    {
+        auto [I, T] = segment_indexes_t(ranges);
+        RowVectors xyzs(I.size(), 3);
+        for (int k = 0; k < I.size(); ++k) {
+            xyzs.row(k) = at(I[k], T[k]);
+        }
+        return xyzs;
+    }
     Eigen::Vector3d at(int seg_idx) const { return polyline_.row(seg_idx); }
     Eigen::Vector3d at(int seg_idx, double t) const
     {
@@ -508,16 +998,15 @@ struct PolylineRuler
     arrows(const Eigen::Ref<const Eigen::VectorXd> &ranges,
            bool smooth_joint = true) const
     {
-        const int N = ranges.size();
-        RowVectors xyzs(N, 3);
-        RowVectors dirs(N, 3);
-        for (int i = 0; i < N; ++i) {
-            auto arrow = this->arrow(ranges[i], smooth_joint);
-            xyzs.row(i) = arrow.first;
-            dirs.row(i) = arrow.second;
+        auto [I, T] = segment_indexes_t(ranges);
+        RowVectors xyzs(I.size(), 3);
+        RowVectors dirs(I.size(), 3);
+        for (int k = 0; k < I.size(); ++k) {
+            xyzs.row(k) = at(I[k], T[k]);
+            dirs.row(k) = __dir(I[k], T[k], smooth_joint);
         }
-        return std::make_tuple(std::move(ranges), //
-                               std::move(xyzs),   //
+        return std::make_tuple(Eigen::VectorXd(ranges), //
+                               std::move(xyzs),         //
                                std::move(dirs));
     }
 
@@ -531,36 +1020,44 @@ struct PolylineRuler
     scanline(double range, double min = -5.0, double max = 5.0,
              bool smooth_joint = true) const
     {
-        auto pos = this->extended_along(range);
-        auto dir = this->dir(range, smooth_joint);
-        Eigen::Vector3d left(-dir[1], dir[0], 0.0);
-        left /= left.norm();
-        if (is_wgs84_) {
-            left.array() /= k_.array();
+        auto [i, t] = segment_index_t(range);
+        return __scanline(at(i, t), __dir(i, t, smooth_joint), min, max);
+    }
+    std::pair<RowVectors, RowVectors>
+    scanline(const Eigen::Ref<const Eigen::VectorXd> &ranges, double min = -5.0,
+             double max = 5.0, bool smooth_joint = true) const
+    {
+        auto [I, T] = segment_indexes_t(ranges);
+        RowVectors lefts(I.size(), 3);
+        RowVectors rights(I.size(), 3);
+        for (int k = 0; k < I.size(); ++k) {
+            auto [l, r] = __scanline(at(I[k], T[k]),
+                                     __dir(I[k], T[k], smooth_joint), min, max);
+            lefts.row(k) = l;
+            rights.row(k) = r;
         }
-        return std::make_pair<Eigen::Vector3d, Eigen::Vector3d>(
-            pos + left * min, pos + left * max);
+        return std::make_pair(std::move(lefts), std::move(rights));
     }
 
     // similar to Frenet frame, x -> forward, y->leftward, z->upword
     Eigen::Matrix4d local_frame(double range, bool smooth_joint = true) const
     {
-        auto x = this->dir(range, smooth_joint); // forward
-        Eigen::Vector3d z(0, 0, 1);              // upward
-        Eigen::Vector3d y = z.cross(x);          // leftward
-        y /= y.norm();
-        z = x.cross(y);
-        Eigen::Matrix4d T_world_local = Eigen::Matrix4d::Identity();
-        T_world_local.block<3, 1>(0, 0) = x;
-        T_world_local.block<3, 1>(0, 1) = y;
-        T_world_local.block<3, 1>(0, 2) = z;
-        if (!is_wgs84_) {
-            T_world_local.block<3, 1>(0, 3) = this->extended_along(range);
-        } else {
-            T_world_local =
-                T_ecef_enu(this->extended_along(range)) * T_world_local;
+        auto [i, t] = segment_index_t(range);
+        return __local_frame(at(i, t), __dir(i, t, smooth_joint));
+    }
+    // each row is a (row-major) flattened 4x4 local frame
+    RowVectorsNx16
+    local_frame(const Eigen::Ref<const Eigen::VectorXd> &ranges,
+                bool smooth_joint = true) const
+    {
+        auto [I, T] = segment_indexes_t(ranges);
+        RowVectorsNx16 frames(I.size(), 16);
+        for (int k = 0; k < I.size(); ++k) {
+            Eigen::Map<Eigen::Matrix<double, 4, 4, Eigen::RowMajor>>(
+                frames.row(k).data()) =
+                __local_frame(at(I[k], T[k]), __dir(I[k], T[k], smooth_joint));
         }
-        return T_world_local;
+        return frames;
     }
 
     // almost identical APIs to CheapRuler
@@ -582,19 +1079,28 @@ struct PolylineRuler
     static double lineDistance(const Eigen::Ref<const RowVectors> &line,
                                bool is_wgs84 = false)
     {
-        if (is_wgs84) {
-            return lineDistance(lla2enu(line), !is_wgs84);
+        int N = line.rows();
+        if (N < 2) {
+            return 0.0;
+        }
+        if (line.outerStride() != 3) {
+            return lineDistance(RowVectors(line), is_wgs84);
         }
+        auto [anchor, k] = __anchor_k(line, is_wgs84);
+        return kernels::line_distance(line.data(), N, anchor.data(), k.data());
+    }
+    static double lineDistance(const Eigen::Ref<const RowVectorsNx3f> &line)
+    {
         int N = line.rows();
         if (N < 2) {
             return 0.0;
         }
-        return (line.bottomRows(N - 1) - line.topRows(N - 1))
-            .rowwise()
-            .norm()
-            .sum();
+        if (line.outerStride() != 3) {
+            return lineDistance(RowVectorsNx3f(line));
+        }
+        return kernels::line_distance(line.data(), N);
     }
-    double lineDistance() const { return ranges()[N_]; }
+    double lineDistance() const { return length(); }
 
     static Eigen::Vector3d along(const Eigen::Ref<const RowVectors> &line,
                                  double dist, bool is_wgs84 = false)
@@ -624,6 +1130,24 @@ struct PolylineRuler
         return is_wgs84_ ? __enu2lla(along(enus(), dist))
                          : along(polyline_, dist);
     }
+    // batched along (clamped to both ends), interpolated on ranges(),
+    // matches along(dist) up to rounding
+    RowVectors along(const Eigen::Ref<const Eigen::VectorXd> &dists) const
+    {
+        auto [I, T] = segment_indexes_t(dists);
+        const double length = this->length();
+        RowVectors xyzs(I.size(), 3);
+        for (int k = 0; k < I.size(); ++k) {
+            if (dists[k] <= 0.) {
+                xyzs.row(k) = polyline_.row(0);
+            } else if (dists[k] >= length) {
+                xyzs.row(k) = polyline_.row(N_ - 1);
+            } else {
+                xyzs.row(k) = at(I[k], T[k]);
+            }
+        }
+        return xyzs;
+    }
 
     static double pointToSegmentDistance(const Eigen::Vector3d &p,
                                          const Eigen::Vector3d &a,
@@ -662,46 +1186,227 @@ struct PolylineRuler
                 enu2lla(std::get<0>(ret).transpose(), anchor).row(0);
             return ret;
         }
-        double minDist = std::numeric_limits<double>::infinity();
-        Eigen::Vector3d minP(0.0, 0.0, 0.0);
-        double minI = 0., minT = 0.;
-        for (int i = 0; i < N - 1; ++i) {
-            double t = 0.;
-            Eigen::Vector3d ab = line.row(i + 1) - line.row(i);
-            Eigen::Vector3d pp = line.row(i);
-            if (ab[0] != 0. || ab[1] != 0. || ab[2] != 0.) {
-                Eigen::Vector3d ap = p - line.row(i).transpose();
-                t = ab.dot(ap) / ab.squaredNorm();
-                // t' = unit(ab).dot(ap) = t / |ab|
-                // t' > |ap|        -> pp   = line.row(i+1)
-                // t' > 0.0         -> pp  += t' * unit(ab)
-                //                     pp  += t  * ab
-                if (t > 1.0) {
-                    pp = line.row(i + 1);
-                } else if (t > 0) {
-                    pp += t * ab;
-                }
-            }
-            double sqDist = (pp - p).squaredNorm();
-            if (sqDist < minDist) {
-                minDist = sqDist;
-                minP = pp;
-                minI = i;
-                minT = t;
-            }
+        return internal::point_on_line(line, p);
+    }
+    // same as above, but only visits segments near p (rtree from
+    // PolylineRuler::rtree(line)), results are identical to the linear scan
+    static std::tuple<Eigen::Vector3d, int, double>
+    pointOnLine(const Eigen::Ref<const RowVectors> &line,
+                const Eigen::Vector3d &p, const PackedRTree &rtree)
+    {
+        if (!line.rows()) {
+            return std::make_tuple(p, -1, 0.);
         }
-        return std::make_tuple(minP, minI, std::fmax(0., std::fmin(1., minT)));
+        return internal::point_on_line(line, p, &rtree);
     }
     std::tuple<Eigen::Vector3d, int, double>
     pointOnLine(const Eigen::Vector3d &p) const
     {
         if (!is_wgs84_) {
-            return pointOnLine(polyline_, p);
+            return rtree_ ? pointOnLine(polyline_, p, *rtree_)
+                          : pointOnLine(polyline_, p);
         }
-        auto [enu, i, t] = pointOnLine(enus(), __lla2enu(p));
+        auto [enu, i, t] = rtree_ ? pointOnLine(enus(), __lla2enu(p), *rtree_)
+                                  : pointOnLine(enus(), __lla2enu(p));
         return std::make_tuple(__enu2lla(enu), i, t);
     }
 
+    // pointOnLine around a hint segment (e.g. the match of the previous fix
+    // of a trajectory): segments [hint - window, hint + window] are scanned,
+    // their best match is kept if it's not on the border of the window (so
+    // it's a local minimum) and within max_distance of p (if given),
+    // otherwise falls back to pointOnLine(p). negative hints search globally
+    std::tuple<Eigen::Vector3d, int, double>
+    pointOnLine(const Eigen::Vector3d &p, int hint, int window = 8,
+                std::optional<double> max_distance = {}) const
+    {
+        if (hint < 0 || N_ < 2) {
+            return pointOnLine(p);
+        }
+        const Eigen::Vector3d P = is_wgs84_ ? __lla2enu(p) : p;
+        auto hit = __pointOnWindow(__xyzs(), P, hint, window, max_distance);
+        if (!hit) {
+            return pointOnLine(p);
+        }
+        auto &[pp, i, t] = *hit;
+        return std::make_tuple(is_wgs84_ ? __enu2lla(pp) : pp, i, t);
+    }
+
+    // snap an ordered trajectory, each point is searched around the match of
+    // the previous one (see pointOnLine with hint), starting from hint,
+    // returns [points, segment indexes, t, distances]
+    std::tuple<RowVectors, Eigen::VectorXi, Eigen::VectorXd, Eigen::VectorXd>
+    snap_trajectory(const Eigen::Ref<const RowVectors> &points,
+                    int window = 8, std::optional<double> max_distance = {},
+                    int hint = -1) const
+    {
+        const int M = points.rows();
+        RowVectors xyzs = points;
+        Eigen::VectorXi indexes = Eigen::VectorXi::Constant(M, -1);
+        Eigen::VectorXd ts = Eigen::VectorXd::Zero(M);
+        Eigen::VectorXd dists = Eigen::VectorXd::Constant(
+            M, std::numeric_limits<double>::infinity());
+        if (!N_) {
+            return std::make_tuple(std::move(xyzs), std::move(indexes),
+                                   std::move(ts), std::move(dists));
+        }
+        const Eigen::Ref<const RowVectors> line = __xyzs();
+        for (int r = 0; r < M; ++r) {
+            Eigen::Vector3d P = points.row(r);
+            if (is_wgs84_) {
+                P = __lla2enu(P);
+            }
+            std::optional<std::tuple<Eigen::Vector3d, int, double>> hit;
+            if (hint >= 0 && N_ >= 2) {
+                hit = __pointOnWindow(line, P, hint, window, max_distance);
+            }
+            if (!hit) {
+                hit = rtree_ ? pointOnLine(line, P, *rtree_)
+                             : pointOnLine(line, P);
+            }
+            auto &[pp, i, t] = *hit;
+            dists[r] = (pp - P).norm();
+            xyzs.row(r) = is_wgs84_ ? __enu2lla(pp) : pp;
+            indexes[r] = i;
+            ts[r] = t;
+            hint = i;
+        }
+        return std::make_tuple(std::move(xyzs), std::move(indexes),
+                               std::move(ts), std::move(dists));
+    }
+
+    // batched pointOnLine, queries are split across n_threads (0 for all
+    // hardware threads), returns [points, segment indexes, t, distances]
+    std::tuple<RowVectors, Eigen::VectorXi, Eigen::VectorXd, Eigen::VectorXd>
+    pointsOnLine(const Eigen::Ref<const RowVectors> &points,
+                 int n_threads = 0) const
+    {
+        const int M = points.rows();
+        RowVectors xyzs(M, 3);
+        Eigen::VectorXi indexes(M);
+        Eigen::VectorXd ts(M);
+        Eigen::VectorXd dists(M);
+        if (!M || !N_) {
+            indexes.setConstant(-1);
+            ts.setZero();
+            dists.setConstant(std::numeric_limits<double>::infinity());
+            xyzs = points;
+            return std::make_tuple(std::move(xyzs), std::move(indexes),
+                                   std::move(ts), std::move(dists));
+        }
+        // prepare caches before going parallel, the segment index pays off
+        // quickly for large batches
+        const Eigen::Ref<const RowVectors> line = __xyzs();
+        const PackedRTree *rtree = nullptr;
+        if (rtree_ || (M >= 16 && N_ >= 64)) {
+            rtree = &this->rtree();
+        }
+        parallel_for(
+            M,
+            [&](int begin, int end) {
+                for (int r = begin; r < end; ++r) {
+                    Eigen::Vector3d P = points.row(r);
+                    if (is_wgs84_) {
+                        P = __lla2enu(P);
+                    }
+                    auto [pp, i, t] = rtree ? pointOnLine(line, P, *rtree)
+                                            : pointOnLine(line, P);
+                    dists[r] = (pp - P).norm();
+                    xyzs.row(r) = is_wgs84_ ? __enu2lla(pp) : pp;
+                    indexes[r] = i;
+                    ts[r] = t;
+                }
+            },
+            n_threads, 256);
+        return std::make_tuple(std::move(xyzs), std::move(indexes),
+                               std::move(ts), std::move(dists));
+    }
+
+    // k nearest segments to p (sorted by distance), optionally within
+    // max_distance, returns [points, segment indexes, t, distances]
+    std::tuple<RowVectors, Eigen::VectorXi, Eigen::VectorXd, Eigen::VectorXd>
+    nearest_segments(const Eigen::Vector3d &p, int k = 1,
+                     std::optional<double> max_distance = {}) const
+    {
+        const Eigen::Ref<const RowVectors> line = __xyzs();
+        const Eigen::Vector3d P = is_wgs84_ ? __lla2enu(p) : p;
+        const auto &rtree = this->rtree();
+        const double tol = internal::rtree_tolerance(rtree);
+        const double max_dist2 =
+            max_distance ? (*max_distance) * (*max_distance)
+                         : std::numeric_limits<double>::infinity();
+        // max-heap of [dist2, index], top is the worst of current k-best
+        std::priority_queue<std::pair<double, int>> heap;
+        if (k > 0) {
+            rtree.visit_nearest(P, [&](int i, double box_dist2) {
+                double bound = (int)heap.size() == k ? heap.top().first
+                                                     : max_dist2;
+                if (box_dist2 > bound * (1.0 + 1e-9) + tol) {
+                    return false;
+                }
+                double t = 0.;
+                Eigen::Vector3d pp;
+                double dist2 = internal::point_on_segment(line, i, P, pp, t);
+                if (dist2 > max_dist2) {
+                    return true;
+                }
+                heap.push({dist2, i});
+                if ((int)heap.size() > k) {
+                    heap.pop();
+                }
+                return true;
+            });
+        }
+        const int K = heap.size();
+        RowVectors points(K, 3);
+        Eigen::VectorXi indexes(K);
+        Eigen::VectorXd ts(K);
+        Eigen::VectorXd dists(K);
+        for (int r = K - 1; r >= 0; --r) {
+            int i = heap.top().second;
+            heap.pop();
+            double t = 0.;
+            Eigen::Vector3d pp;
+            dists[r] =
+                std::sqrt(internal::point_on_segment(line, i, P, pp, t));
+            points.row(r) = is_wgs84_ ? __enu2lla(pp) : pp;
+            indexes[r] = i;
+            ts[r] = std::fmax(0., std::fmin(1., t));
+        }
+        return std::make_tuple(std::move(points), std::move(indexes),
+                               std::move(ts), std::move(dists));
+    }
+
+    // crossings of the polyline with itself (measured on enus() if wgs84),
+    // returns (points, [seg_i, seg_j], [t_i, t_j]) sorted by (seg_i, seg_j),
+    // seg_i < seg_j. neighboring segments touching at their shared point
+    // (also first & last segments of a closed polyline) are not crossings
+    std::tuple<RowVectors, RowVectorsNx2i, RowVectorsNx2>
+    self_intersections(int n_threads = 0) const
+    {
+        auto hits = internal::segment_intersections(
+            __xyzs(), Eigen::Vector2i(0, N_), true, false, n_threads);
+        const int M = hits.size();
+        RowVectors points(M, 3);
+        RowVectorsNx2i segs(M, 2);
+        RowVectorsNx2 ts(M, 2);
+        for (int k = 0; k < M; ++k) {
+            const auto &hit = hits[k];
+            points.row(k) = is_wgs84_ ? __enu2lla(hit.point) : hit.point;
+            segs.row(k) << hit.i, hit.j;
+            ts.row(k) << hit.t, hit.s;
+        }
+        return std::make_tuple(std::move(points), std::move(segs),
+                               std::move(ts));
+    }
+    // same as !self_intersections().empty(), stops at the first crossing
+    bool has_self_intersections(int n_threads = 0) const
+    {
+        return !internal::segment_intersections(
+                    __xyzs(), Eigen::Vector2i(0, N_), true, true, n_threads)
+                    .empty();
+    }
+
     static RowVectors lineSlice(const Eigen::Vector3d &start,
                                 const Eigen::Vector3d &stop,
                                 const Eigen::Ref<const RowVectors> &line,
@@ -718,16 +1423,42 @@ struct PolylineRuler
                            anchor_lla);
         }
 
-        auto getPoint = [](auto &tuple) -> const Eigen::Vector3d & {
-            return std::get<0>(tuple);
-        };
-        auto getIndex = [](auto &tuple) -> int { return std::get<1>(tuple); };
-        auto getT = [](auto &tuple) -> double { return std::get<2>(tuple); };
-        auto same_point = [](const Eigen::Vector3d &p1,
-                             const Eigen::Vector3d &p2) { return p1 == p2; };
+        return __lineSlice(pointOnLine(line, start), pointOnLine(line, stop),
+                           line);
+    }
+    RowVectors lineSlice(const Eigen::Vector3d &start,
+                         const Eigen::Vector3d &stop) const
+    {
+        if (!is_wgs84_) {
+            if (!rtree_) {
+                return lineSlice(start, stop, polyline_);
+            }
+            return __lineSlice(pointOnLine(polyline_, start, *rtree_),
+                               pointOnLine(polyline_, stop, *rtree_),
+                               polyline_);
+        }
+        if (!rtree_) {
+            return __enu2lla(
+                lineSlice(__lla2enu(start), __lla2enu(stop), enus()));
+        }
+        return __enu2lla(
+            __lineSlice(pointOnLine(enus(), __lla2enu(start), *rtree_),
+                        pointOnLine(enus(), __lla2enu(stop), *rtree_), enus()));
+    }
 
-        auto p1 = pointOnLine(line, start);
-        auto p2 = pointOnLine(line, stop);
+  private:
+    static RowVectors
+    __lineSlice(std::tuple<Eigen::Vector3d, int, double> p1,
+                std::tuple<Eigen::Vector3d, int, double> p2,
+                const Eigen::Ref<const RowVectors> &line)
+    {
+        auto getPoint = [](auto &tuple) -> const Eigen::Vector3d & {
+            return std::get<0>(tuple);
+        };
+        auto getIndex = [](auto &tuple) -> int { return std::get<1>(tuple); };
+        auto getT = [](auto &tuple) -> double { return std::get<2>(tuple); };
+        auto same_point = [](const Eigen::Vector3d &p1,
+                             const Eigen::Vector3d &p2) { return p1 == p2; };
 
         if (getIndex(p1) > getIndex(p2) ||
             (getIndex(p1) == getIndex(p2) && getT(p1) > getT(p2))) {
@@ -755,15 +1486,107 @@ struct PolylineRuler
 
         return RowVectors::Map(slice[0].data(), (Eigen::Index)slice.size(), 3);
     }
-    RowVectors lineSlice(const Eigen::Vector3d &start,
-                         const Eigen::Vector3d &stop) const
+
+    // best match on segments [hint - window, hint + window] of line, none if
+    // it's on the border of the window or farther than max_distance
+    static std::optional<std::tuple<Eigen::Vector3d, int, double>>
+    __pointOnWindow(const Eigen::Ref<const RowVectors> &line,
+                    const Eigen::Vector3d &p, int hint, int window,
+                    std::optional<double> max_distance)
     {
-        if (!is_wgs84_) {
-            return lineSlice(start, stop, polyline_);
+        const int n = line.rows() - 1;
+        hint = std::min(hint, n - 1);
+        window = std::min(std::max(window, 0), n);
+        const int lo = std::max(hint - window, 0);
+        const int hi = std::min(hint + window, n - 1);
+        double minDist = std::numeric_limits<double>::infinity();
+        Eigen::Vector3d minP(0.0, 0.0, 0.0);
+        int minI = lo;
+        double minT = 0.;
+        for (int i = lo; i <= hi; ++i) {
+            double t = 0.;
+            Eigen::Vector3d pp;
+            double sqDist = internal::point_on_segment(line, i, p, pp, t);
+            if (sqDist < minDist) {
+                minDist = sqDist;
+                minP = pp;
+                minI = i;
+                minT = t;
+            }
+        }
+        minT = std::fmax(0., std::fmin(1., minT));
+        // nearer matches may lie beyond a border vertex
+        if ((minI == lo && lo > 0 && minT <= 0.) ||
+            (minI == hi && hi < n - 1 && minT >= 1.)) {
+            return {};
+        }
+        if (max_distance && minDist > (*max_distance) * (*max_distance)) {
+            return {};
+        }
+        return std::make_tuple(minP, minI, minT);
+    }
+
+    // wgs84 polylines are measured in the ENU frame anchored at their first
+    // point (same as lla2enu), returns the (anchor, k) of that frame
+    static std::pair<Eigen::Vector3d, Eigen::Vector3d>
+    __anchor_k(const Eigen::Ref<const RowVectors> &polyline, bool is_wgs84)
+    {
+        if (!is_wgs84) {
+            return {Eigen::Vector3d::Zero(), Eigen::Vector3d::Ones()};
+        }
+        Eigen::Vector3d anchor = polyline.row(0);
+        return {anchor, cheap_ruler_k(anchor[1])};
+    }
+
+    // lineSliceAlong given ranges (cumulative distances, any origin) of
+    // line: binary searches instead of summing up segment lengths. the slice
+    // is the point at start (on segment [i0-1, i0], i0 first with
+    // ranges > start), line[i0:j] and the point at stop (on [j-1, j], j
+    // first with ranges >= stop), the stop point alone if j < i0
+    static RowVectors __lineSliceAlong(double start, double stop,
+                                       const Eigen::Ref<const RowVectors> &line,
+                                       const double *ranges)
+    {
+        const int N = line.rows();
+        if (N < 2) {
+            return RowVectors(0, 3);
+        }
+        start += ranges[0];
+        stop += ranges[0];
+        int i0 = std::upper_bound(ranges + 1, ranges + N, start) - ranges;
+        int j = std::lower_bound(ranges + 1, ranges + N, stop) - ranges;
+        return __lineSliceAlong(
+            line, i0,
+            i0 < N ? (start - ranges[i0 - 1]) / (ranges[i0] - ranges[i0 - 1])
+                   : 0.0,
+            j,
+            j < N ? (stop - ranges[j - 1]) / (ranges[j] - ranges[j - 1])
+                  : 0.0);
+    }
+    static RowVectors __lineSliceAlong(const Eigen::Ref<const RowVectors> &line,
+                                       int i0, double t0, int j, double t1)
+    {
+        const int N = line.rows();
+        if (j < i0) {
+            RowVectors slice(1, 3);
+            slice.row(0) = interpolate(line.row(j - 1), line.row(j), t1);
+            return slice;
+        }
+        if (i0 >= N) {
+            return RowVectors(0, 3);
         }
-        return __enu2lla(lineSlice(__lla2enu(start), __lla2enu(stop), enus()));
+        const int end = std::min(j, N);
+        RowVectors slice(1 + end - i0 + (j < N), 3);
+        slice.row(0) = interpolate(line.row(i0 - 1), line.row(i0), t0);
+        slice.middleRows(1, end - i0) = line.middleRows(i0, end - i0);
+        if (j < N) {
+            slice.row(slice.rows() - 1) =
+                interpolate(line.row(j - 1), line.row(j), t1);
+        }
+        return slice;
     }
 
+  public:
     static RowVectors lineSliceAlong(double start, double stop,
                                      const Eigen::Ref<const RowVectors> &line,
                                      bool is_wgs84 = false)
@@ -773,39 +1596,58 @@ struct PolylineRuler
                 lineSliceAlong(start, stop, lla2enu(line), !is_wgs84),
                 line.row(0));
         }
+        // single pass up to stop, then one allocation for the slice
+        const int N = line.rows();
+        int i0 = N, j = N;
+        double t0 = 0.0, t1 = 0.0;
         double sum = 0.;
-        std::vector<Eigen::Vector3d> slice;
-
-        for (int i = 1; i < line.rows(); ++i) {
-            auto p0 = line.row(i - 1);
-            auto p1 = line.row(i);
-            auto d = distance(p0, p1);
-
+        for (int i = 1; i < N; ++i) {
+            double d = distance(line.row(i - 1), line.row(i));
             sum += d;
-
-            if (sum > start && slice.size() == 0) {
-                slice.push_back(interpolate(p0, p1, (start - (sum - d)) / d));
+            if (sum > start && i0 == N) {
+                i0 = i;
+                t0 = (start - (sum - d)) / d;
             }
-
             if (sum >= stop) {
-                slice.push_back(interpolate(p0, p1, (stop - (sum - d)) / d));
-                return RowVectors::Map(slice[0].data(),
-                                       (Eigen::Index)slice.size(), 3);
-            }
-
-            if (sum > start) {
-                slice.push_back(p1);
+                j = i;
+                t1 = (stop - (sum - d)) / d;
+                break;
             }
         }
-
-        return RowVectors::Map(slice[0].data(), (Eigen::Index)slice.size(), 3);
+        return __lineSliceAlong(line, i0, t0, j, t1);
     }
     RowVectors lineSliceAlong(double start, double stop) const
     {
-        if (!is_wgs84_) {
-            return lineSliceAlong(start, stop, polyline_);
+        if (N_ < 2) {
+            return RowVectors(0, 3);
+        }
+        // interpolation is linear, so the same in lla as in enu
+        return __lineSliceAlong(start, stop, polyline_, ranges().data());
+    }
+    // lineSliceAlong without building the slice, returns [head, begin, end,
+    // tail], the slice is head, polyline()[begin:end], tail.
+    // start & stop are clamped to [0, length()] (stop to >= start), same
+    // points as lineSliceAlong for 0 <= start < stop <= length()
+    std::tuple<Eigen::Vector3d, int, int, Eigen::Vector3d>
+    lineSliceAlongView(double start, double stop) const
+    {
+        const double *ranges = this->ranges().data();
+        start = std::min(std::max(start, 0.0), ranges[N_ - 1]);
+        stop = std::min(std::max(stop, start), ranges[N_ - 1]);
+        int i0 = std::upper_bound(ranges + 1, ranges + N_, start) - ranges;
+        Eigen::Vector3d head =
+            i0 < N_ ? interpolate(polyline_.row(i0 - 1), polyline_.row(i0),
+                                  (start - ranges[i0 - 1]) /
+                                      (ranges[i0] - ranges[i0 - 1]))
+                    : polyline_.row(N_ - 1).transpose();
+        if (stop <= start) {
+            return std::make_tuple(head, i0, i0, head);
         }
-        return __enu2lla(lineSliceAlong(start, stop, enus()));
+        int j = std::lower_bound(ranges + 1, ranges + N_, stop) - ranges;
+        Eigen::Vector3d tail = interpolate(
+            polyline_.row(j - 1), polyline_.row(j),
+            (stop - ranges[j - 1]) / (ranges[j] - ranges[j - 1]));
+        return std::make_tuple(head, i0, j, tail);
     }
 
     static Eigen::Vector3d interpolate(const Eigen::Vector3d &a,
@@ -815,129 +1657,2024 @@ struct PolylineRuler
     }
 };
 
-inline void douglas_simplify(const Eigen::Ref<const RowVectors> &coords,
-                             Eigen::VectorXi &to_keep, const int i, const int j,
-                             const double epsilon)
+// PolylineRuler for live streams (e.g. a growing GPS trace), points can be
+// appended at the tail and trimmed from the head (sliding windows), caches
+// are extended instead of recomputed:
+//  - ranges: amortized O(k) per append of k points, ranges (and all `range`
+//    arguments) are measured from the current head
+//  - dirs: lazily, from the last non-degenerate segment on
+//  - enus (wgs84): in the ENU frame of the current head (same as
+//    PolylineRuler), trim_head re-anchors to the new head, which recomputes
+//    enus, ranges and dirs of the window (O(N))
+// results match a PolylineRuler built on the same points. not thread-safe,
+// no queries during append/trim_head.
+// ruler() returns an immutable PolylineRuler snapshot for everything else
+struct AppendablePolylineRuler
 {
-    to_keep[i] = to_keep[j] = 1;
-    if (j - i <= 1) {
-        return;
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    explicit AppendablePolylineRuler(bool is_wgs84 = false)
+        : is_wgs84_(is_wgs84)
+    {
     }
-    LineSegment line(coords.row(i), coords.row(j));
-    double max_dist2 = 0.0;
-    int max_index = i;
-    for (int k = i + 1; k < j; ++k) {
-        double dist2 = line.distance2(coords.row(k));
-        if (dist2 > max_dist2) {
-            max_dist2 = dist2;
-            max_index = k;
-        }
+    AppendablePolylineRuler(const Eigen::Ref<const RowVectors> &polyline,
+                            bool is_wgs84 = false)
+        : is_wgs84_(is_wgs84)
+    {
+        append(polyline);
     }
-    if (max_dist2 <= epsilon * epsilon) {
-        return;
+
+    int N() const { return N_; }
+    bool is_wgs84() const { return is_wgs84_; }
+    Eigen::Vector3d k() const { return k_; }
+    // views are invalidated by append/trim_head
+    Eigen::Map<const RowVectors> polyline() const
+    {
+        return Eigen::Map<const RowVectors>(polyline_.data() + 3 * head_, N_,
+                                            3);
     }
-    douglas_simplify(coords, to_keep, i, max_index, epsilon);
-    douglas_simplify(coords, to_keep, max_index, j, epsilon);
-}
+    Eigen::Map<const RowVectors> dirs() const
+    {
+        __update_dirs();
+        return Eigen::Map<const RowVectors>(dirs_.data() + 3 * head_,
+                                            std::max(N_ - 1, 0), 3);
+    }
+    Eigen::VectorXd ranges() const
+    {
+        return ranges_.segment(head_, N_).array() - __range0();
+    }
+    double range(int seg_idx) const
+    {
+        return ranges_[head_ + seg_idx] - __range0();
+    }
+    double range(int seg_idx, double t) const
+    {
+        return range(seg_idx) * (1.0 - t) + range(seg_idx + 1) * t;
+    }
+    double length() const { return N_ ? range(N_ - 1) : 0.0; }
 
-inline void douglas_simplify_iter(const Eigen::Ref<const RowVectors> &coords,
-                                  Eigen::VectorXi &to_keep,
-                                  const double epsilon)
-{
-    std::queue<std::pair<int, int>> q;
-    q.push({0, to_keep.size() - 1});
-    while (!q.empty()) {
-        int i = q.front().first;
-        int j = q.front().second;
-        q.pop();
-        to_keep[i] = to_keep[j] = 1;
-        if (j - i <= 1) {
-            continue;
+    void append(const Eigen::Ref<const RowVectors> &points)
+    {
+        const int K = points.rows();
+        if (!K) {
+            return;
         }
-        LineSegment line(coords.row(i), coords.row(j));
-        double max_dist2 = 0.0;
-        int max_index = i;
-        for (int k = i + 1; k < j; ++k) {
-            double dist2 = line.distance2(coords.row(k));
-            if (dist2 > max_dist2) {
-                max_dist2 = dist2;
-                max_index = k;
+        if (!anchor_) {
+            anchor_ = points.row(0).transpose();
+            if (is_wgs84_) {
+                k_ = cheap_ruler_k((*anchor_)[1]);
             }
         }
-        if (max_dist2 <= epsilon * epsilon) {
-            continue;
+        __reserve(K);
+        const int begin = head_ + N_;
+        polyline_.middleRows(begin, K) = points;
+        if (is_wgs84_) {
+            for (int d = 0; d < 3; ++d) {
+                enus_.col(d).segment(begin, K).array() =
+                    (points.col(d).array() - (*anchor_)[d]) * k_[d];
+            }
         }
-        q.push({i, max_index});
-        q.push({max_index, j});
+        // segment lengths from the last point on, then prefix sum,
+        // same kernel & order as PolylineRuler::ranges
+        if (!N_) {
+            ranges_[begin] = 0.0;
+        }
+        const int first = N_ ? begin - 1 : begin;
+        const int n = begin + K - first;
+        if (n > 1) {
+            std::vector<double> lengths(n - 1);
+            const Eigen::Vector3d anchor =
+                is_wgs84_ ? *anchor_ : Eigen::Vector3d::Zero();
+            kernels::segment_lengths(polyline_.row(first).data(), n,
+                                     anchor.data(), k_.data(),
+                                     lengths.data());
+            for (int i = 0; i < n - 1; ++i) {
+                ranges_[first + i + 1] = ranges_[first + i] + lengths[i];
+            }
+        }
+        N_ += K;
+    }
+    void push_back(const Eigen::Vector3d &point)
+    {
+        append(RowVectors(point.transpose()));
     }
-}
 
-inline Eigen::VectorXi douglas_simplify_mask(const RowVectors &coords,
-                                             double epsilon,        //
-                                             bool is_wgs84 = false, //
-                                             bool recursive = true)
-{
-    if (is_wgs84) {
-        return douglas_simplify_mask(lla2enu(coords), epsilon, //
-                                     false, recursive);
+    // drop the first n points
+    void trim_head(int n)
+    {
+        if (n < 0 || n > N_) {
+            throw std::invalid_argument("can only trim [0, N] points");
+        }
+        head_ += n;
+        N_ -= n;
+        if (is_wgs84_ && n) {
+            __reanchor();
+            return;
+        }
+        if (dirs_final_ <= head_) {
+            dirs_final_ = head_;
+            return;
+        }
+        // leading degenerate segments look for neighbors on both sides,
+        // redo them as there is nothing on their left now
+        int f = head_;
+        while (f < dirs_final_ && __degenerate(f)) {
+            ++f;
+        }
+        if (f > head_) {
+            __write_dirs(head_, f + 2 - head_);
+        }
     }
-    Eigen::VectorXi mask(coords.rows());
-    mask.setZero();
-    if (recursive) {
-        douglas_simplify(coords, mask, 0, mask.size() - 1, epsilon);
-    } else {
-        douglas_simplify_iter(coords, mask, epsilon);
+
+    std::pair<int, double> segment_index_t(double range) const
+    {
+        __check_segments();
+        return internal::segment_index_t(ranges_.data() + head_, N_,
+                                         range + __range0());
+    }
+    int segment_index(double range) const
+    {
+        return segment_index_t(range).first;
     }
-    return mask;
-}
 
-inline Eigen::VectorXi douglas_simplify_indexes(const RowVectors &coords,
-                                                double epsilon,        //
-                                                bool is_wgs84 = false, //
-                                                bool recursive = true)
-{
-    return mask2indexes(
-        douglas_simplify_mask(coords, epsilon, is_wgs84, recursive));
-}
+    Eigen::Vector3d at(int seg_idx) const
+    {
+        return polyline_.row(head_ + seg_idx);
+    }
+    Eigen::Vector3d at(int seg_idx, double t) const
+    {
+        return PolylineRuler::interpolate(polyline_.row(head_ + seg_idx),
+                                          polyline_.row(head_ + seg_idx + 1),
+                                          t);
+    }
+    Eigen::Vector3d at(double range) const
+    {
+        auto [i, t] = segment_index_t(range);
+        return at(i, t);
+    }
 
-inline RowVectors douglas_simplify(const RowVectors &coords,
-                                   double epsilon,        //
-                                   bool is_wgs84 = false, //
-                                   bool recursive = true)
-{
-    return select_by_mask(
-        coords, //
-        douglas_simplify_mask(coords, epsilon, is_wgs84, recursive));
-}
+    Eigen::Vector3d dir(int pt_index) const
+    {
+        __check_segments();
+        return dirs().row(std::min(pt_index, N_ - 2));
+    }
+    Eigen::Vector3d dir(double range, bool smooth_joint = true) const
+    {
+        auto [i, t] = segment_index_t(range);
+        return PolylineRuler::__dir(dirs(), i, t, smooth_joint);
+    }
 
-// Nx2
-inline Eigen::VectorXi
-douglas_simplify_mask(const Eigen::Ref<const RowVectorsNx2> &coords,
-                      double epsilon,        //
-                      bool is_wgs84 = false, //
-                      bool recursive = true)
-{
-    return douglas_simplify_mask(to_Nx3(coords), epsilon, is_wgs84, recursive);
-}
-inline Eigen::VectorXi
-douglas_simplify_indexes(const Eigen::Ref<const RowVectorsNx2> &coords,
-                         double epsilon,        //
-                         bool is_wgs84 = false, //
-                         bool recursive = true)
-{
-    return douglas_simplify_indexes(to_Nx3(coords), epsilon, is_wgs84,
-                                    recursive);
-}
-inline RowVectorsNx2
-douglas_simplify(const Eigen::Ref<const RowVectorsNx2> &coords,
-                 double epsilon,        //
-                 bool is_wgs84 = false, //
-                 bool recursive = true)
-{
-    RowVectorsNx2 ret =
-        douglas_simplify(to_Nx3(coords), epsilon, is_wgs84, recursive)
-            .leftCols(2);
-    return ret;
+    // clamped to both ends, interpolated on ranges (O(logN))
+    Eigen::Vector3d along(double dist) const
+    {
+        __check_segments();
+        if (dist <= 0.) {
+            return at(0);
+        } else if (dist >= length()) {
+            return at(N_ - 1);
+        }
+        auto [i, t] = segment_index_t(dist);
+        return at(i, t);
+    }
+    RowVectors along(const Eigen::Ref<const Eigen::VectorXd> &dists) const
+    {
+        RowVectors xyzs(dists.size(), 3);
+        for (int k = 0; k < dists.size(); ++k) {
+            xyzs.row(k) = along(dists[k]);
+        }
+        return xyzs;
+    }
+
+    std::tuple<Eigen::Vector3d, int, double>
+    pointOnLine(const Eigen::Vector3d &p) const
+    {
+        if (!is_wgs84_) {
+            return PolylineRuler::pointOnLine(polyline(), p);
+        }
+        auto [enu, i, t] = PolylineRuler::pointOnLine(__enus(), __lla2enu(p));
+        return std::make_tuple(__enu2lla(enu), i, t);
+    }
+
+    RowVectors lineSliceAlong(double start, double stop) const
+    {
+        return PolylineRuler::__lineSliceAlong(start, stop, polyline(),
+                                               ranges_.data() + head_);
+    }
+
+    Eigen::Matrix4d local_frame(double range, bool smooth_joint = true) const
+    {
+        auto [i, t] = segment_index_t(range);
+        return PolylineRuler::__local_frame(
+            at(i, t), PolylineRuler::__dir(dirs(), i, t, smooth_joint),
+            is_wgs84_);
+    }
+
+    // immutable copy of the current points
+    PolylineRuler ruler() const { return PolylineRuler(polyline(), is_wgs84_); }
+
+  private:
+    const bool is_wgs84_;
+    Eigen::Vector3d k_ = Eigen::Vector3d::Ones();
+    std::optional<Eigen::Vector3d> anchor_; // ENU origin (wgs84): the head
+    // rows [head_, head_ + N_) of the buffers are in use, capacity grows
+    // geometrically, trimmed rows are reclaimed when there is no room left
+    int head_ = 0;
+    int N_ = 0;
+    RowVectors polyline_;
+    RowVectors enus_; // only when is_wgs84==true
+    Eigen::VectorXd ranges_;
+    // dirs of segments [head_, dirs_final_) won't change by appending
+    mutable RowVectors dirs_;
+    mutable int dirs_final_ = 0;
+
+    double __range0() const { return N_ ? ranges_[head_] : 0.0; }
+    Eigen::Map<const RowVectors> __enus() const
+    {
+        return Eigen::Map<const RowVectors>(enus_.data() + 3 * head_, N_, 3);
+    }
+    const RowVectors &__xyzs_buffer() const
+    {
+        return is_wgs84_ ? enus_ : polyline_;
+    }
+    Eigen::Vector3d __lla2enu(const Eigen::Vector3d &lla) const
+    {
+        return k_.array() * (lla - *anchor_).array();
+    }
+    Eigen::Vector3d __enu2lla(const Eigen::Vector3d &enu) const
+    {
+        return (enu.array() / k_.array()) + anchor_->array();
+    }
+    void __check_segments() const
+    {
+        if (N_ < 2) {
+            throw std::invalid_argument(
+                "polyline should have at least two points");
+        }
+    }
+
+    // (wgs84) moves the ENU frame to the head and recomputes the caches
+    void __reanchor()
+    {
+        dirs_final_ = head_;
+        if (!N_) {
+            anchor_.reset();
+            return;
+        }
+        anchor_ = polyline_.row(head_).transpose();
+        k_ = cheap_ruler_k((*anchor_)[1]);
+        for (int d = 0; d < 3; ++d) {
+            auto col = polyline_.col(d).segment(head_, N_).array();
+            enus_.col(d).segment(head_, N_).array() =
+                (col - (*anchor_)[d]) * k_[d];
+        }
+        kernels::ranges(polyline_.row(head_).data(), N_, anchor_->data(),
+                        k_.data(), ranges_.data() + head_);
+    }
+
+    void __reserve(int K)
+    {
+        const int capacity = polyline_.rows();
+        if (head_ + N_ + K <= capacity) {
+            return;
+        }
+        if (head_ && N_ + K <= capacity / 2) {
+            // move to the front, ranges are re-based to the head
+            const double range0 = __range0();
+            polyline_.topRows(N_) = polyline_.middleRows(head_, N_).eval();
+            if (is_wgs84_) {
+                enus_.topRows(N_) = enus_.middleRows(head_, N_).eval();
+            }
+            ranges_.head(N_) =
+                (ranges_.segment(head_, N_).array() - range0).eval();
+            const int M = std::max(std::min(dirs_final_, head_ + N_ - 1) -
+                                       head_,
+                                   0);
+            dirs_.topRows(M) = dirs_.middleRows(head_, M).eval();
+            dirs_final_ = M;
+            head_ = 0;
+            return;
+        }
+        const int rows = std::max({2 * capacity, head_ + N_ + K, 16});
+        polyline_.conservativeResize(rows, 3);
+        if (is_wgs84_) {
+            enus_.conservativeResize(rows, 3);
+        }
+        ranges_.conservativeResize(rows);
+        dirs_.conservativeResize(rows, 3);
+    }
+
+    bool __degenerate(int seg) const
+    {
+        auto &xyzs = __xyzs_buffer();
+        return xyzs(seg, 0) == xyzs(seg + 1, 0) &&
+               xyzs(seg, 1) == xyzs(seg + 1, 1);
+    }
+    // PolylineRuler::dirs on rows [begin, begin + n) into segments
+    // [begin, begin + n - 1)
+    void __write_dirs(int begin, int n) const
+    {
+        auto xyzs = __xyzs_buffer().middleRows(begin, n);
+        dirs_.middleRows(begin, n - 1) = PolylineRuler::dirs(xyzs);
+    }
+    void __update_dirs() const
+    {
+        const int end = head_ + N_ - 1; // segments [head_, end)
+        if (end <= dirs_final_) {
+            return;
+        }
+        // degenerate segments look for the nearest non-degenerate ones,
+        // restart from the last one (already final)
+        const int begin = dirs_final_ > head_ ? dirs_final_ - 1 : head_;
+        __write_dirs(begin, end + 1 - begin);
+        for (int i = end - 1; i >= begin; --i) {
+            if (!__degenerate(i)) {
+                dirs_final_ = i + 1;
+                break;
+            }
+        }
+    }
+};
+
+// PolylineRuler specialised at compile time on dimension (2 or 3) and
+// coordinate system: fixed-size vectors, no runtime is_wgs84 branches, Nx2
+// polylines are used as is (no to_Nx3). caches (ranges, enus for wgs84)
+// are computed on construction, the segment rtree on first use (locked),
+// so it's thread-safe. segment lookup & nearest point kernels are shared
+// with PolylineRuler (internal::segment_index_t, point_on_line), wgs84
+// distances are measured in the ENU frame of the first point, same as
+// PolylineRuler (2D matches it on zero z, up to rounding).
+// covers the hot calls, ruler() gives a PolylineRuler for everything else
+template <int Dim, bool IsWGS84> struct PolylineRulerT
+{
+    static_assert(Dim == 2 || Dim == 3, "only 2D or 3D polylines");
+    using Vector = Eigen::Matrix<double, Dim, 1>;
+    using Points = Eigen::Matrix<double, Eigen::Dynamic, Dim, Eigen::RowMajor>;
+
+    explicit PolylineRulerT(const Eigen::Ref<const Points> &polyline)
+        : polyline_(polyline), N_(polyline.rows())
+    {
+        if (N_ < 2) {
+            throw std::invalid_argument(
+                "polyline should have at least two points");
+        }
+        if constexpr (IsWGS84) {
+            anchor_ = polyline_.row(0).transpose();
+            k_ = cheap_ruler_k(anchor_[1]).template head<Dim>();
+            xyzs_.resize(N_, Dim);
+            for (int i = 0; i < N_; ++i) {
+                xyzs_.row(i) = __lla2enu(polyline_.row(i));
+            }
+        }
+        if constexpr (Dim == 3) {
+            ranges_ = PolylineRuler::ranges(polyline_, IsWGS84);
+        } else {
+            const Points &xyzs = __xyzs();
+            ranges_.resize(N_);
+            ranges_[0] = 0.0;
+            for (int i = 0; i < N_ - 1; ++i) {
+                ranges_[i + 1] =
+                    ranges_[i] + (xyzs.row(i + 1) - xyzs.row(i)).norm();
+            }
+        }
+    }
+
+    static constexpr int dim() { return Dim; }
+    static constexpr bool is_wgs84() { return IsWGS84; }
+    int N() const { return N_; }
+    const Points &polyline() const { return polyline_; }
+    Vector k() const
+    {
+        if constexpr (IsWGS84) {
+            return k_;
+        } else {
+            return Vector::Ones();
+        }
+    }
+    const Eigen::VectorXd &ranges() const { return ranges_; }
+    double range(int seg_idx) const { return ranges_[seg_idx]; }
+    double range(int seg_idx, double t) const
+    {
+        return ranges_[seg_idx] * (1.0 - t) + ranges_[seg_idx + 1] * t;
+    }
+    double length() const { return ranges_[N_ - 1]; }
+
+    std::pair<int, double> segment_index_t(double range) const
+    {
+        return internal::segment_index_t(ranges_.data(), N_, range);
+    }
+
+    Vector at(int seg_idx, double t) const
+    {
+        return polyline_.row(seg_idx) +
+               (polyline_.row(seg_idx + 1) - polyline_.row(seg_idx)) * t;
+    }
+    // point at distance along the polyline, clamped to both ends
+    Vector along(double dist) const
+    {
+        if (dist <= 0.) {
+            return polyline_.row(0);
+        }
+        if (dist >= length()) {
+            return polyline_.row(N_ - 1);
+        }
+        auto [i, t] = segment_index_t(dist);
+        return at(i, t);
+    }
+    Points along(const Eigen::Ref<const Eigen::VectorXd> &dists) const
+    {
+        Points xyzs(dists.size(), Dim);
+        for (int k = 0; k < dists.size(); ++k) {
+            xyzs.row(k) = along(dists[k]);
+        }
+        return xyzs;
+    }
+
+    // segment index (in ENU if wgs84), built lazily, once built it speeds
+    // up pointOnLine to ~O(logN)
+    const PackedRTree &rtree() const
+    {
+        return rtree_.get(
+            [this] { return internal::segments_rtree(__xyzs()); });
+    }
+    bool has_rtree() const { return (bool)rtree_; }
+
+    // returns [nearest point, segment index, t]
+    std::tuple<Vector, int, double> pointOnLine(const Vector &p) const
+    {
+        auto [pp, i, t] = internal::point_on_line(
+            __xyzs(), __to_xyz(p), rtree_ ? &*rtree_ : nullptr);
+        return std::make_tuple(__from_xyz(pp), i, t);
+    }
+    // returns [points, segment indexes, t, distances], queries are split
+    // across n_threads (0 for all hardware threads), the segment rtree is
+    // built first for large batches (same rule as PolylineRuler)
+    std::tuple<Points, Eigen::VectorXi, Eigen::VectorXd, Eigen::VectorXd>
+    pointsOnLine(const Eigen::Ref<const Points> &points,
+                 int n_threads = 0) const
+    {
+        const int M = points.rows();
+        Points xyzs(M, Dim);
+        Eigen::VectorXi indexes(M);
+        Eigen::VectorXd ts(M);
+        Eigen::VectorXd dists(M);
+        const PackedRTree *rtree = nullptr;
+        if (rtree_ || (M >= 16 && N_ >= 64)) {
+            rtree = &this->rtree();
+        }
+        parallel_for(
+            M,
+            [&](int begin, int end) {
+                for (int r = begin; r < end; ++r) {
+                    const Vector P = __to_xyz(points.row(r));
+                    auto [pp, i, t] =
+                        internal::point_on_line(__xyzs(), P, rtree);
+                    dists[r] = (pp - P).norm();
+                    xyzs.row(r) = __from_xyz(pp);
+                    indexes[r] = i;
+                    ts[r] = t;
+                }
+            },
+            n_threads, 256);
+        return std::make_tuple(std::move(xyzs), std::move(indexes),
+                               std::move(ts), std::move(dists));
+    }
+
+    // PolylineRuler (copied, widened to Nx3) for the rest of the api
+    PolylineRuler ruler() const
+    {
+        if constexpr (Dim == 3) {
+            return PolylineRuler(polyline_, IsWGS84);
+        } else {
+            return PolylineRuler(to_Nx3(polyline_), IsWGS84);
+        }
+    }
+
+  private:
+    Points polyline_;
+    int N_;
+    Eigen::VectorXd ranges_;
+    // wgs84 only
+    Points xyzs_;
+    Vector anchor_ = Vector::Zero();
+    Vector k_ = Vector::Ones();
+    LazyCache<PackedRTree> rtree_;
+
+    const Points &__xyzs() const
+    {
+        if constexpr (IsWGS84) {
+            return xyzs_;
+        } else {
+            return polyline_;
+        }
+    }
+    Vector __lla2enu(const Vector &lla) const
+    {
+        return (lla - anchor_).cwiseProduct(k_);
+    }
+    Vector __to_xyz(const Vector &p) const
+    {
+        if constexpr (IsWGS84) {
+            return __lla2enu(p);
+        } else {
+            return p;
+        }
+    }
+    Vector __from_xyz(const Vector &xyz) const
+    {
+        if constexpr (IsWGS84) {
+            return xyz.cwiseQuotient(k_) + anchor_;
+        } else {
+            return xyz;
+        }
+    }
+};
+using PolylineRuler2D = PolylineRulerT<2, false>;
+using PolylineRuler3D = PolylineRulerT<3, false>;
+using PolylineRuler2DWGS84 = PolylineRulerT<2, true>;
+using PolylineRuler3DWGS84 = PolylineRulerT<3, true>;
+
+// PolylineRuler for long (e.g. continental) wgs84 polylines. PolylineRuler
+// measures everything in one ENU frame (anchor & k of the first point), the
+// east scale drifts with cos(latitude) along north-south routes. here the
+// polyline is split into latitude bands (consecutive segments spanning at
+// most band_height degrees of latitude, a longer segment gets a band of its
+// own), each band has its own ENU frame (anchor & k at its mid latitude) and
+// cached ENU coordinates for pointOnLine. ranges are summed up with k at the
+// mid latitude of each segment. caches are computed on construction, so
+// it's immutable & thread-safe.
+struct BandedPolylineRuler
+{
+    BandedPolylineRuler(const Eigen::Ref<const RowVectors> &polyline,
+                        double band_height = 0.1)
+        : polyline_(polyline), N_(polyline.rows()), band_height_(band_height)
+    {
+        if (N_ < 2) {
+            throw std::invalid_argument(
+                "polyline should have at least two points");
+        }
+        if (!(band_height_ > 0.0)) {
+            throw std::invalid_argument("band_height should be positive");
+        }
+        ranges_.resize(N_);
+        ranges_[0] = 0.0;
+        for (int i = 0; i < N_ - 1; ++i) {
+            Eigen::Vector3d k =
+                cheap_ruler_k((polyline_(i, 1) + polyline_(i + 1, 1)) / 2.0);
+            Eigen::Vector3d d = polyline_.row(i + 1) - polyline_.row(i);
+            ranges_[i + 1] = ranges_[i] + d.cwiseProduct(k).norm();
+        }
+
+        std::vector<int> offsets{0};
+        while (offsets.back() < N_ - 1) {
+            const int s = offsets.back();
+            double lo = polyline_(s, 1), hi = lo;
+            int e = s + 1;
+            for (; e < N_; ++e) {
+                double lat = polyline_(e, 1);
+                if (e > s + 1 && std::max(hi, lat) - std::min(lo, lat) >
+                                     band_height_) {
+                    break;
+                }
+                lo = std::min(lo, lat);
+                hi = std::max(hi, lat);
+            }
+            offsets.push_back(e - 1);
+        }
+        const int B = offsets.size() - 1;
+        offsets_ = Eigen::VectorXi::Map(offsets.data(), offsets.size());
+        anchors_.resize(B, 3);
+        ks_.resize(B, 3);
+        boxes_.resize(B, 6);
+        // band b has points [offsets[b], offsets[b+1]] (last point shared
+        // with the next band), at rows offsets[b] + b of enus_
+        enus_.resize(N_ + B - 1, 3);
+        for (int b = 0; b < B; ++b) {
+            const int s = offsets_[b], e = offsets_[b + 1];
+            auto llas = polyline_.middleRows(s, e - s + 1);
+            double lat =
+                (llas.col(1).minCoeff() + llas.col(1).maxCoeff()) / 2.0;
+            anchors_.row(b) << polyline_(s, 0), lat, polyline_(s, 2);
+            ks_.row(b) = cheap_ruler_k(lat);
+            auto enus = enus_.middleRows(s + b, e - s + 1);
+            for (int i = 0; i <= e - s; ++i) {
+                enus.row(i) = __lla2enu(b, llas.row(i));
+            }
+            boxes_.row(b).head(3) = enus.colwise().minCoeff();
+            boxes_.row(b).tail(3) = enus.colwise().maxCoeff();
+        }
+    }
+
+    int N() const { return N_; }
+    const RowVectors &polyline() const { return polyline_; }
+    double band_height() const { return band_height_; }
+    int num_bands() const { return offsets_.size() - 1; }
+    // band b covers segments [offsets[b], offsets[b+1])
+    const Eigen::VectorXi &band_offsets() const { return offsets_; }
+    // per band, anchor (lla) & k of its ENU frame
+    const RowVectors &anchors() const { return anchors_; }
+    const RowVectors &ks() const { return ks_; }
+    int band_index(int seg_idx) const
+    {
+        if (seg_idx < 0 || seg_idx >= N_ - 1) {
+            throw std::out_of_range("segment index out of range");
+        }
+        const int *offsets = offsets_.data();
+        return std::upper_bound(offsets + 1, offsets + offsets_.size(),
+                                seg_idx) -
+               offsets - 1;
+    }
+    // ENU coordinates of points [offsets[b], offsets[b+1]] in band b
+    RowVectors enus(int band) const
+    {
+        if (band < 0 || band >= num_bands()) {
+            throw std::out_of_range("band index out of range");
+        }
+        const int s = offsets_[band], e = offsets_[band + 1];
+        return enus_.middleRows(s + band, e - s + 1);
+    }
+
+    const Eigen::VectorXd &ranges() const { return ranges_; }
+    double range(int seg_idx) const { return ranges_[seg_idx]; }
+    double range(int seg_idx, double t) const
+    {
+        return ranges_[seg_idx] * (1.0 - t) + ranges_[seg_idx + 1] * t;
+    }
+    double length() const { return ranges_[N_ - 1]; }
+
+    std::pair<int, double> segment_index_t(double range) const
+    {
+        return internal::segment_index_t(ranges_.data(), N_, range);
+    }
+
+    Eigen::Vector3d at(int seg_idx, double t) const
+    {
+        return PolylineRuler::interpolate(polyline_.row(seg_idx),
+                                          polyline_.row(seg_idx + 1), t);
+    }
+    // point at distance along the polyline, clamped to both ends
+    Eigen::Vector3d along(double dist) const
+    {
+        if (dist <= 0.) {
+            return polyline_.row(0);
+        }
+        if (dist >= length()) {
+            return polyline_.row(N_ - 1);
+        }
+        auto [i, t] = segment_index_t(dist);
+        return at(i, t);
+    }
+    RowVectors along(const Eigen::Ref<const Eigen::VectorXd> &dists) const
+    {
+        RowVectors llas(dists.size(), 3);
+        for (int k = 0; k < dists.size(); ++k) {
+            llas.row(k) = along(dists[k]);
+        }
+        return llas;
+    }
+
+    // returns [nearest point, segment index, t], each band is searched in
+    // its own frame, bands are pruned by their boxes
+    std::tuple<Eigen::Vector3d, int, double>
+    pointOnLine(const Eigen::Vector3d &p) const
+    {
+        auto [i, t, dist2] = __pointOnLine(p);
+        return std::make_tuple(at(i, t), i, t);
+    }
+    // returns [points, segment indexes, t, distances], queries are split
+    // across n_threads (0 for all hardware threads)
+    std::tuple<RowVectors, Eigen::VectorXi, Eigen::VectorXd, Eigen::VectorXd>
+    pointsOnLine(const Eigen::Ref<const RowVectors> &points,
+                 int n_threads = 0) const
+    {
+        const int M = points.rows();
+        RowVectors llas(M, 3);
+        Eigen::VectorXi indexes(M);
+        Eigen::VectorXd ts(M);
+        Eigen::VectorXd dists(M);
+        parallel_for(
+            M,
+            [&](int begin, int end) {
+                for (int r = begin; r < end; ++r) {
+                    auto [i, t, dist2] = __pointOnLine(points.row(r));
+                    llas.row(r) = at(i, t);
+                    indexes[r] = i;
+                    ts[r] = t;
+                    dists[r] = std::sqrt(dist2);
+                }
+            },
+            n_threads, 256);
+        return std::make_tuple(std::move(llas), std::move(indexes),
+                               std::move(ts), std::move(dists));
+    }
+
+    RowVectors lineSlice(const Eigen::Vector3d &start,
+                         const Eigen::Vector3d &stop) const
+    {
+        return PolylineRuler::__lineSlice(pointOnLine(start),
+                                          pointOnLine(stop), polyline_);
+    }
+    RowVectors lineSliceAlong(double start, double stop) const
+    {
+        return PolylineRuler::__lineSliceAlong(start, stop, polyline_,
+                                               ranges_.data());
+    }
+
+  private:
+    RowVectors polyline_;
+    int N_;
+    double band_height_;
+    Eigen::VectorXd ranges_;
+    Eigen::VectorXi offsets_;
+    RowVectors anchors_;
+    RowVectors ks_;
+    RowVectors enus_;
+    // per band, box of its enus (in its own frame)
+    Eigen::Matrix<double, Eigen::Dynamic, 6, Eigen::RowMajor> boxes_;
+
+    Eigen::Vector3d __lla2enu(int band, const Eigen::Vector3d &lla) const
+    {
+        return (lla - anchors_.row(band).transpose())
+            .cwiseProduct(ks_.row(band).transpose());
+    }
+    // returns [segment index, t, squared distance (in the band frame)],
+    // ties are broken by segment index, same as a scan over all segments
+    std::tuple<int, double, double>
+    __pointOnLine(const Eigen::Vector3d &p) const
+    {
+        const int B = num_bands();
+        std::vector<std::pair<double, int>> order(B);
+        for (int b = 0; b < B; ++b) {
+            Eigen::Vector3d P = __lla2enu(b, p);
+            double dist2 = 0.0;
+            for (int c = 0; c < 3; ++c) {
+                double d = std::max({boxes_(b, c) - P[c], 0.0,
+                                     P[c] - boxes_(b, c + 3)});
+                dist2 += d * d;
+            }
+            order[b] = {dist2, b};
+        }
+        std::sort(order.begin(), order.end());
+        double minDist = std::numeric_limits<double>::infinity();
+        int minI = 0;
+        double minT = 0.;
+        for (auto &[box_dist2, b] : order) {
+            if (box_dist2 > minDist) {
+                break;
+            }
+            const Eigen::Vector3d P = __lla2enu(b, p);
+            const int s = offsets_[b];
+            auto enus = enus_.middleRows(s + b, offsets_[b + 1] - s + 1);
+            Eigen::Vector3d pp;
+            for (int i = 0; i < enus.rows() - 1; ++i) {
+                double t = 0.;
+                double dist2 = internal::point_on_segment(enus, i, P, pp, t);
+                if (dist2 < minDist || (dist2 == minDist && s + i < minI)) {
+                    minDist = dist2;
+                    minI = s + i;
+                    minT = std::fmax(0., std::fmin(1., t));
+                }
+            }
+        }
+        return std::make_tuple(minI, minT, minDist);
+    }
+};
+
+inline void douglas_simplify(const Eigen::Ref<const RowVectors> &coords,
+                             Eigen::VectorXi &to_keep, const int i, const int j,
+                             const double epsilon)
+{
+    to_keep[i] = to_keep[j] = 1;
+    if (j - i <= 1) {
+        return;
+    }
+    LineSegment line(coords.row(i), coords.row(j));
+    double max_dist2 = 0.0;
+    int max_index = i;
+    for (int k = i + 1; k < j; ++k) {
+        double dist2 = line.distance2(coords.row(k));
+        if (dist2 > max_dist2) {
+            max_dist2 = dist2;
+            max_index = k;
+        }
+    }
+    if (max_dist2 <= epsilon * epsilon) {
+        return;
+    }
+    douglas_simplify(coords, to_keep, i, max_index, epsilon);
+    douglas_simplify(coords, to_keep, max_index, j, epsilon);
+}
+
+inline void douglas_simplify_iter(const Eigen::Ref<const RowVectors> &coords,
+                                  Eigen::VectorXi &to_keep,
+                                  const double epsilon)
+{
+    std::queue<std::pair<int, int>> q;
+    q.push({0, to_keep.size() - 1});
+    while (!q.empty()) {
+        int i = q.front().first;
+        int j = q.front().second;
+        q.pop();
+        to_keep[i] = to_keep[j] = 1;
+        if (j - i <= 1) {
+            continue;
+        }
+        LineSegment line(coords.row(i), coords.row(j));
+        double max_dist2 = 0.0;
+        int max_index = i;
+        for (int k = i + 1; k < j; ++k) {
+            double dist2 = line.distance2(coords.row(k));
+            if (dist2 > max_dist2) {
+                max_dist2 = dist2;
+                max_index = k;
+            }
+        }
+        if (max_dist2 <= epsilon * epsilon) {
+            continue;
+        }
+        q.push({i, max_index});
+        q.push({max_index, j});
+    }
+}
+
+inline Eigen::VectorXi douglas_simplify_mask(const RowVectors &coords,
+                                             double epsilon,        //
+                                             bool is_wgs84 = false, //
+                                             bool recursive = true)
+{
+    if (is_wgs84) {
+        return douglas_simplify_mask(lla2enu(coords), epsilon, //
+                                     false, recursive);
+    }
+    Eigen::VectorXi mask(coords.rows());
+    mask.setZero();
+    if (recursive) {
+        douglas_simplify(coords, mask, 0, mask.size() - 1, epsilon);
+    } else {
+        douglas_simplify_iter(coords, mask, epsilon);
+    }
+    return mask;
+}
+
+inline Eigen::VectorXi douglas_simplify_indexes(const RowVectors &coords,
+                                                double epsilon,        //
+                                                bool is_wgs84 = false, //
+                                                bool recursive = true)
+{
+    return mask2indexes(
+        douglas_simplify_mask(coords, epsilon, is_wgs84, recursive));
+}
+
+inline RowVectors douglas_simplify(const RowVectors &coords,
+                                   double epsilon,        //
+                                   bool is_wgs84 = false, //
+                                   bool recursive = true)
+{
+    return select_by_mask(
+        coords, //
+        douglas_simplify_mask(coords, epsilon, is_wgs84, recursive));
+}
+
+// Nx2
+inline Eigen::VectorXi
+douglas_simplify_mask(const Eigen::Ref<const RowVectorsNx2> &coords,
+                      double epsilon,        //
+                      bool is_wgs84 = false, //
+                      bool recursive = true)
+{
+    return douglas_simplify_mask(to_Nx3(coords), epsilon, is_wgs84, recursive);
+}
+inline Eigen::VectorXi
+douglas_simplify_indexes(const Eigen::Ref<const RowVectorsNx2> &coords,
+                         double epsilon,        //
+                         bool is_wgs84 = false, //
+                         bool recursive = true)
+{
+    return douglas_simplify_indexes(to_Nx3(coords), epsilon, is_wgs84,
+                                    recursive);
+}
+inline RowVectorsNx2
+douglas_simplify(const Eigen::Ref<const RowVectorsNx2> &coords,
+                 double epsilon,        //
+                 bool is_wgs84 = false, //
+                 bool recursive = true)
+{
+    RowVectorsNx2 ret =
+        douglas_simplify(to_Nx3(coords), epsilon, is_wgs84, recursive)
+            .leftCols(2);
+    return ret;
+}
+
+namespace internal
+{
+// farthest row in (i, j) from segment [i, j] as (squared distance, index),
+// the first one wins on ties (same as the scan in douglas_simplify), long
+// spans are scanned by n_threads threads
+inline std::pair<double, int>
+douglas_farthest(const Eigen::Ref<const RowVectors> &coords, const int i,
+                 const int j, int n_threads = 1)
+{
+    LineSegment line(coords.row(i), coords.row(j));
+    auto scan = [&](int begin, int end) {
+        double max_dist2 = 0.0;
+        int max_index = i;
+        for (int k = begin; k < end; ++k) {
+            double dist2 = line.distance2(coords.row(k));
+            if (dist2 > max_dist2) {
+                max_dist2 = dist2;
+                max_index = k;
+            }
+        }
+        return std::make_pair(max_dist2, max_index);
+    };
+    constexpr int min_chunk = 1 << 15;
+    if (n_threads == 1 || j - i - 1 < 2 * min_chunk) {
+        return scan(i + 1, j);
+    }
+    std::pair<double, int> farthest{0.0, i};
+    std::mutex mutex;
+    parallel_for(
+        j - i - 1,
+        [&](int begin, int end) {
+            auto ret = scan(i + 1 + begin, i + 1 + end);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (ret.first > farthest.first ||
+                (ret.first > 0.0 && ret.first == farthest.first &&
+                 ret.second < farthest.second)) {
+                farthest = ret;
+            }
+        },
+        n_threads, min_chunk);
+    return farthest;
+}
+
+// douglas_simplify on the whole polyline, with an explicit (reusable) stack
+inline void douglas_simplify(const Eigen::Ref<const RowVectors> &coords,
+                             int *to_keep, const double epsilon,
+                             std::vector<std::pair<int, int>> &stack,
+                             int n_threads = 1)
+{
+    stack.clear();
+    stack.push_back({0, (int)coords.rows() - 1});
+    while (!stack.empty()) {
+        auto [i, j] = stack.back();
+        stack.pop_back();
+        to_keep[i] = to_keep[j] = 1;
+        if (j - i <= 1) {
+            continue;
+        }
+        auto [max_dist2, max_index] =
+            douglas_farthest(coords, i, j, n_threads);
+        if (max_dist2 <= epsilon * epsilon) {
+            continue;
+        }
+        stack.push_back({max_index, j});
+        stack.push_back({i, max_index});
+    }
+}
+
+// polyline k is coords[offsets[k]:offsets[k+1]]
+inline void check_offsets(const Eigen::Ref<const Eigen::VectorXi> &offsets,
+                          int N)
+{
+    for (int k = 0; k + 1 < offsets.size(); ++k) {
+        if (offsets[k] < 0 || offsets[k] > offsets[k + 1] ||
+            offsets[k + 1] > N) {
+            throw std::invalid_argument("offsets should be non-decreasing "
+                                        "and within [0, coords.rows()]");
+        }
+    }
+}
+} // namespace internal
+
+// douglas_simplify_mask on many polylines packed in one buffer, polyline k
+// is coords[offsets[k]:offsets[k+1]], returns the concatenated masks (rows
+// not covered by offsets are 0).
+// polylines are handed out to n_threads threads (0 for all hardware
+// threads) with per-thread scratch, very long ones are done one at a time
+// with their farthest point scans split across threads
+inline Eigen::VectorXi
+douglas_simplify_masks(const RowVectors &coords,
+                       const Eigen::Ref<const Eigen::VectorXi> &offsets,
+                       double epsilon,        //
+                       bool is_wgs84 = false, //
+                       int n_threads = 0)
+{
+    const int N = coords.rows();
+    const int M = offsets.size() - 1;
+    internal::check_offsets(offsets, N);
+    Eigen::VectorXi mask = Eigen::VectorXi::Zero(N);
+    if (M <= 0) {
+        return mask;
+    }
+    struct Scratch
+    {
+        RowVectors enus;
+        std::vector<std::pair<int, int>> stack;
+    };
+    auto simplify = [&](int index, Scratch &scratch, int n_threads) {
+        const int begin = offsets[index];
+        const int n = offsets[index + 1] - begin;
+        if (!n) {
+            return;
+        }
+        auto polyline = coords.middleRows(begin, n);
+        int *to_keep = mask.data() + begin;
+        if (!is_wgs84) {
+            internal::douglas_simplify(polyline, to_keep, epsilon,
+                                       scratch.stack, n_threads);
+            return;
+        }
+        // same as lla2enu(polyline), without allocating for every polyline
+        if (scratch.enus.rows() < n) {
+            scratch.enus.resize(n, 3);
+        }
+        auto enus = scratch.enus.topRows(n);
+        Eigen::Vector3d anchor = polyline.row(0);
+        Eigen::Vector3d k = cheap_ruler_k(anchor[1]);
+        for (int d = 0; d < 3; ++d) {
+            enus.col(d).array() =
+                (polyline.col(d).array() - anchor[d]) * k[d];
+        }
+        internal::douglas_simplify(enus, to_keep, epsilon, scratch.stack,
+                                   n_threads);
+    };
+
+    constexpr int long_polyline = 1 << 16;
+    constexpr int batch_size = 64;
+    const bool split_long = num_threads(n_threads) > 1;
+    std::atomic<int> next{0};
+    const int T = std::min(num_threads(n_threads), //
+                           (M + batch_size - 1) / batch_size);
+    parallel_for(
+        T,
+        [&](int, int) {
+            Scratch scratch;
+            for (int k0 = next.fetch_add(batch_size); k0 < M;
+                 k0 = next.fetch_add(batch_size)) {
+                for (int k = k0, K = std::min(k0 + batch_size, M); k < K;
+                     ++k) {
+                    if (!split_long ||
+                        offsets[k + 1] - offsets[k] < long_polyline) {
+                        simplify(k, scratch, 1);
+                    }
+                }
+            }
+        },
+        T, 1);
+    if (split_long) {
+        Scratch scratch;
+        for (int k = 0; k < M; ++k) {
+            if (offsets[k + 1] - offsets[k] >= long_polyline) {
+                simplify(k, scratch, n_threads);
+            }
+        }
+    }
+    return mask;
+}
+inline Eigen::VectorXi
+douglas_simplify_masks(const Eigen::Ref<const RowVectorsNx2> &coords,
+                       const Eigen::Ref<const Eigen::VectorXi> &offsets,
+                       double epsilon,        //
+                       bool is_wgs84 = false, //
+                       int n_threads = 0)
+{
+    return douglas_simplify_masks(to_Nx3(coords), offsets, epsilon, is_wgs84,
+                                  n_threads);
+}
+
+// streaming (opening window) simplifier for unbounded point streams: points
+// are dropped while all of them are within epsilon of the segment from the
+// last kept point to the newest one, otherwise the point before the newest
+// is kept and starts a new window. windows are capped at max_window points
+// (the point before the newest is kept once full), so memory and cost per
+// point are bounded. kept points are returned by push as soon as they are
+// final, the last point by flush (which also starts a new polyline).
+// epsilon and is_wgs84 mean the same as in douglas_simplify (wgs84 windows
+// are measured in the ENU frame of their first point), it keeps more points
+// than douglas_simplify, but every dropped point is within epsilon of the
+// simplified polyline
+struct StreamingSimplifier
+{
+    StreamingSimplifier(double epsilon, bool is_wgs84 = false,
+                        int max_window = 256)
+        : epsilon_(epsilon), is_wgs84_(is_wgs84), max_window_(max_window)
+    {
+        if (max_window_ < 1) {
+            throw std::invalid_argument("max_window should be positive");
+        }
+        window_.reserve(max_window_);
+    }
+
+    double epsilon() const { return epsilon_; }
+    bool is_wgs84() const { return is_wgs84_; }
+    int max_window() const { return max_window_; }
+    // points pushed since the last flush
+    int num_pushed() const { return num_pushed_; }
+    // points pushed after the last kept one (not final yet)
+    int num_buffered() const { return window_.size(); }
+
+    // returns the kept point that became final (if any, 0 or 1 row)
+    RowVectors push(const Eigen::Vector3d &point)
+    {
+        kept_.clear();
+        __push(point);
+        return __kept();
+    }
+    RowVectors push_points(const Eigen::Ref<const RowVectors> &points)
+    {
+        kept_.clear();
+        for (int i = 0; i < points.rows(); ++i) {
+            __push(points.row(i));
+        }
+        return __kept();
+    }
+    // returns the last point (if not returned yet), the next push starts a
+    // new polyline
+    RowVectors flush()
+    {
+        kept_.clear();
+        if (!window_.empty()) {
+            kept_.push_back(last_);
+        }
+        window_.clear();
+        num_pushed_ = 0;
+        return __kept();
+    }
+
+  private:
+    double epsilon_;
+    bool is_wgs84_;
+    int max_window_;
+    int num_pushed_ = 0;
+    // last kept point, as is, origin of the window
+    Eigen::Vector3d anchor_;
+    Eigen::Vector3d k_ = Eigen::Vector3d::Ones();
+    // points after the anchor, relative to it (ENU if wgs84)
+    std::vector<Eigen::Vector3d> window_;
+    // last pushed point, as is
+    Eigen::Vector3d last_;
+    std::vector<Eigen::Vector3d> kept_;
+
+    void __reset(const Eigen::Vector3d &anchor)
+    {
+        anchor_ = anchor;
+        if (is_wgs84_) {
+            k_ = cheap_ruler_k(anchor[1]);
+        }
+        kept_.push_back(anchor);
+        window_.clear();
+    }
+    void __push(const Eigen::Vector3d &point)
+    {
+        if (!num_pushed_++) {
+            __reset(point);
+            last_ = point;
+            return;
+        }
+        Eigen::Vector3d xyz = (point - anchor_).cwiseProduct(k_);
+        if (!window_.empty()) {
+            bool keep = (int)window_.size() >= max_window_;
+            if (!keep) {
+                LineSegment seg(Eigen::Vector3d::Zero(), xyz);
+                const double epsilon2 = epsilon_ * epsilon_;
+                for (auto &p : window_) {
+                    if (seg.distance2(p) > epsilon2) {
+                        keep = true;
+                        break;
+                    }
+                }
+            }
+            if (keep) {
+                __reset(last_);
+                xyz = (point - anchor_).cwiseProduct(k_);
+            }
+        }
+        window_.push_back(xyz);
+        last_ = point;
+    }
+    RowVectors __kept() const
+    {
+        RowVectors kept(kept_.size(), 3);
+        for (int i = 0; i < (int)kept_.size(); ++i) {
+            kept.row(i) = kept_[i];
+        }
+        return kept;
+    }
+};
+
+namespace internal
+{
+// 4-ary min-heap of point indexes ordered by (keys[i], i), positions are
+// tracked so that keys can be updated in place (keys are copied into the
+// heap, call update(i) after keys[i] changed)
+struct IndexedMinHeap
+{
+    IndexedMinHeap(const std::vector<double> &keys)
+        : keys_(keys), pos_(keys.size(), -1)
+    {
+        heap_.reserve(keys.size());
+    }
+    bool empty() const { return heap_.empty(); }
+    int top() const { return heap_[0].second; }
+    // push without ordering, call heapify afterwards
+    void append(int i)
+    {
+        pos_[i] = heap_.size();
+        heap_.push_back({keys_[i], i});
+    }
+    void heapify()
+    {
+        for (int k = ((int)heap_.size() - 2) / 4; k >= 0; --k) {
+            sift_down(k);
+        }
+    }
+    void pop()
+    {
+        pos_[heap_[0].second] = -1;
+        auto last = heap_.back();
+        heap_.pop_back();
+        if (!heap_.empty()) {
+            heap_[0] = last;
+            pos_[last.second] = 0;
+            sift_down(0);
+        }
+    }
+    // insert i, or restore order after keys[i] changed
+    void update(int i)
+    {
+        if (pos_[i] < 0) {
+            append(i);
+        }
+        heap_[pos_[i]].first = keys_[i];
+        sift_up(pos_[i]);
+        sift_down(pos_[i]);
+    }
+
+  private:
+    using Entry = std::pair<double, int>;
+    const std::vector<double> &keys_;
+    std::vector<Entry> heap_;
+    std::vector<int> pos_;
+
+    void place(int k, const Entry &e)
+    {
+        heap_[k] = e;
+        pos_[e.second] = k;
+    }
+    void sift_up(int k)
+    {
+        const Entry e = heap_[k];
+        while (k > 0) {
+            int parent = (k - 1) / 4;
+            if (!(e < heap_[parent])) {
+                break;
+            }
+            place(k, heap_[parent]);
+            k = parent;
+        }
+        place(k, e);
+    }
+    void sift_down(int k)
+    {
+        const int n = heap_.size();
+        const Entry e = heap_[k];
+        while (true) {
+            const int first = 4 * k + 1;
+            if (first >= n) {
+                break;
+            }
+            int child = first;
+            for (int c = first + 1, end = std::min(first + 4, n); c < end;
+                 ++c) {
+                if (heap_[c] < heap_[child]) {
+                    child = c;
+                }
+            }
+            if (!(heap_[child] < e)) {
+                break;
+            }
+            place(k, heap_[child]);
+            k = child;
+        }
+        place(k, e);
+    }
+};
+} // namespace internal
+
+// Visvalingam-Whyatt: repeatedly drops the inner point spanning the
+// smallest triangle with its current neighbors, until all of them span more
+// than min_area (ties go to the lower index), O(N log N) with a heap.
+// with preserve_topology, a point is kept when the shortcut would cross
+// another segment of the simplified line (checked in the x-y plane)
+inline Eigen::VectorXi visvalingam_simplify_mask(const RowVectors &coords,
+                                                 double min_area,       //
+                                                 bool is_wgs84 = false, //
+                                                 bool preserve_topology = false)
+{
+    if (is_wgs84) {
+        return visvalingam_simplify_mask(lla2enu(coords), min_area, //
+                                         false, preserve_topology);
+    }
+    const int N = coords.rows();
+    Eigen::VectorXi mask = Eigen::VectorXi::Ones(N);
+    if (N < 3) {
+        return mask;
+    }
+    std::vector<int> prev(N), next(N);
+    std::vector<double> areas(N, 0.0);
+    auto area = [&](int i) {
+        Eigen::Vector3d A = coords.row(prev[i]);
+        Eigen::Vector3d B = coords.row(i);
+        Eigen::Vector3d C = coords.row(next[i]);
+        return 0.5 * (B - A).cross(C - A).norm();
+    };
+    internal::IndexedMinHeap heap(areas);
+    for (int i = 0; i < N; ++i) {
+        prev[i] = i - 1;
+        next[i] = i + 1;
+    }
+    for (int i = 1; i < N - 1; ++i) {
+        areas[i] = area(i);
+        heap.append(i);
+    }
+    heap.heapify();
+
+    std::unique_ptr<PackedRTree> rtree;
+    if (preserve_topology) {
+        PackedRTree::Boxes boxes(N, 6);
+        boxes.setZero();
+        boxes.col(0) = boxes.col(3) = coords.col(0);
+        boxes.col(1) = boxes.col(4) = coords.col(1);
+        rtree = std::make_unique<PackedRTree>(boxes);
+    }
+    // whether shortcut prev[i] -> next[i] crosses the rest of the line:
+    // (for a simple line) any segment crossing it has an end point inside
+    // triangle prev[i], i, next[i], so only segments of points within its
+    // bounding box are checked
+    auto crosses = [&](int i) {
+        const int p = prev[i], n = next[i];
+        Eigen::Vector2d P = coords.row(p).head<2>();
+        Eigen::Vector2d Q = coords.row(n).head<2>();
+        Eigen::Vector2d I = coords.row(i).head<2>();
+        const double tolerance2 = 1e-18 * (Q - P).squaredNorm();
+        auto cross = [&](int u, int v) {
+            if (u == i || v == i) {
+                return false;
+            }
+            auto hit = intersect_segments(P, Q, coords.row(u).head<2>(),
+                                          coords.row(v).head<2>());
+            if (!hit) {
+                return false;
+            }
+            // touching at a shared end point is fine
+            auto &X = std::get<0>(*hit);
+            if (u == p || v == p) {
+                return (X - P).squaredNorm() > tolerance2;
+            }
+            if (u == n || v == n) {
+                return (X - Q).squaredNorm() > tolerance2;
+            }
+            return true;
+        };
+        Eigen::Vector3d min(std::min({P[0], Q[0], I[0]}),
+                            std::min({P[1], Q[1], I[1]}), 0.0);
+        Eigen::Vector3d max(std::max({P[0], Q[0], I[0]}),
+                            std::max({P[1], Q[1], I[1]}), 0.0);
+        bool crossed = false;
+        rtree->visit(min, max, [&](int v) {
+            if (!mask[v] || v == i) {
+                return true;
+            }
+            crossed = (prev[v] >= 0 && cross(prev[v], v)) ||
+                      (next[v] < N && cross(v, next[v]));
+            return !crossed;
+        });
+        return crossed;
+    };
+
+    while (!heap.empty()) {
+        const int i = heap.top();
+        if (!(areas[i] <= min_area)) {
+            break;
+        }
+        heap.pop();
+        if (preserve_topology && crosses(i)) {
+            continue; // back in the heap when one of its neighbors goes
+        }
+        mask[i] = 0;
+        const int p = prev[i], n = next[i];
+        next[p] = n;
+        prev[n] = p;
+        for (int j : {p, n}) {
+            if (0 < j && j < N - 1) {
+                areas[j] = area(j);
+                heap.update(j);
+            }
+        }
+    }
+    return mask;
+}
+
+inline Eigen::VectorXi
+visvalingam_simplify_indexes(const RowVectors &coords, double min_area, //
+                             bool is_wgs84 = false,                     //
+                             bool preserve_topology = false)
+{
+    return mask2indexes(visvalingam_simplify_mask(coords, min_area, is_wgs84,
+                                                  preserve_topology));
+}
+
+inline RowVectors visvalingam_simplify(const RowVectors &coords,
+                                       double min_area,       //
+                                       bool is_wgs84 = false, //
+                                       bool preserve_topology = false)
+{
+    return select_by_mask(coords, //
+                          visvalingam_simplify_mask(coords, min_area, is_wgs84,
+                                                    preserve_topology));
+}
+
+// Nx2
+inline Eigen::VectorXi
+visvalingam_simplify_mask(const Eigen::Ref<const RowVectorsNx2> &coords,
+                          double min_area,       //
+                          bool is_wgs84 = false, //
+                          bool preserve_topology = false)
+{
+    return visvalingam_simplify_mask(to_Nx3(coords), min_area, is_wgs84,
+                                     preserve_topology);
+}
+inline Eigen::VectorXi
+visvalingam_simplify_indexes(const Eigen::Ref<const RowVectorsNx2> &coords,
+                             double min_area,       //
+                             bool is_wgs84 = false, //
+                             bool preserve_topology = false)
+{
+    return visvalingam_simplify_indexes(to_Nx3(coords), min_area, is_wgs84,
+                                        preserve_topology);
+}
+inline RowVectorsNx2
+visvalingam_simplify(const Eigen::Ref<const RowVectorsNx2> &coords,
+                     double min_area,       //
+                     bool is_wgs84 = false, //
+                     bool preserve_topology = false)
+{
+    RowVectorsNx2 ret = visvalingam_simplify(to_Nx3(coords), min_area,
+                                             is_wgs84, preserve_topology)
+                            .leftCols(2);
+    return ret;
+}
+
+// all crossings between polylines packed in one buffer (polyline k is
+// coords[offsets[k]:offsets[k+1]]), with `include_self`, also crossings
+// within each polyline. returns
+//      points: intersection points (z interpolated & averaged), Mx3
+//      ids: polyline indexes of [A, B], Mx2
+//      segs: segment indexes of [A, B], within each polyline, Mx2
+//      ts: [t, s] as returned by intersect_segments, Mx2
+// sorted by (A, A's segment, B, B's segment), A <= B.
+// runs on lon/lat as is, crossings and t/s are invariant under cheap ruler
+// scaling
+inline std::tuple<RowVectors, RowVectorsNx2i, RowVectorsNx2i, RowVectorsNx2>
+intersect_polylines(const RowVectors &coords,
+                    const Eigen::Ref<const Eigen::VectorXi> &offsets,
+                    bool include_self = false, int n_threads = 0)
+{
+    internal::check_offsets(offsets, coords.rows());
+    auto hits = internal::segment_intersections(coords, offsets, include_self,
+                                                false, n_threads);
+    const int M = hits.size();
+    RowVectors points(M, 3);
+    RowVectorsNx2i ids(M, 2), segs(M, 2);
+    RowVectorsNx2 ts(M, 2);
+    const int *begin = offsets.data();
+    const int *end = begin + offsets.size();
+    for (int k = 0; k < M; ++k) {
+        const auto &hit = hits[k];
+        int a = std::upper_bound(begin, end, hit.i) - begin - 1;
+        int b = std::upper_bound(begin, end, hit.j) - begin - 1;
+        points.row(k) = hit.point;
+        ids.row(k) << a, b;
+        segs.row(k) << hit.i - offsets[a], hit.j - offsets[b];
+        ts.row(k) << hit.t, hit.s;
+    }
+    return std::make_tuple(points, ids, segs, ts);
+}
+
+inline std::tuple<RowVectorsNx2, RowVectorsNx2i, RowVectorsNx2i,
+                  RowVectorsNx2>
+intersect_polylines(const Eigen::Ref<const RowVectorsNx2> &coords,
+                    const Eigen::Ref<const Eigen::VectorXi> &offsets,
+                    bool include_self = false, int n_threads = 0)
+{
+    auto [points, ids, segs, ts] =
+        intersect_polylines(to_Nx3(coords), offsets, include_self, n_threads);
+    RowVectorsNx2 xys = points.leftCols(2);
+    return std::make_tuple(xys, ids, segs, ts);
+}
+
+namespace internal
+{
+// squared distance from p to segment [line[i], line[i+1]]
+inline double segment_distance2(const Eigen::Ref<const RowVectors> &line,
+                                int i, const Eigen::Vector3d &p)
+{
+    Eigen::Vector3d ab = line.row(i + 1) - line.row(i);
+    Eigen::Vector3d ap = p - line.row(i).transpose();
+    double len2 = ab.squaredNorm();
+    double t = len2 > 0.0 ? std::clamp(ab.dot(ap) / len2, 0.0, 1.0) : 0.0;
+    return (ap - t * ab).squaredNorm();
+}
+
+// max over vertices of A of their squared distances to polyline B (segments
+// indexed by `rtree`, see PolylineRuler::rtree), starting from `cmax2`.
+// a vertex stops searching as soon as it can not raise the max (Taha &
+// Hanbury), the whole scan stops as soon as the max exceeds `stop2`
+inline double directed_hausdorff2(
+    const Eigen::Ref<const RowVectors> &A,
+    const Eigen::Ref<const RowVectors> &B, const PackedRTree &rtree,
+    double cmax2 = 0.0,
+    double stop2 = std::numeric_limits<double>::infinity())
+{
+    if (B.rows() == 1) {
+        for (int k = 0; k < A.rows() && cmax2 <= stop2; ++k) {
+            cmax2 = std::max(cmax2, (A.row(k) - B.row(0)).squaredNorm());
+        }
+        return cmax2;
+    }
+    const double tol = internal::rtree_tolerance(rtree);
+    for (int k = 0; k < A.rows(); ++k) {
+        Eigen::Vector3d a = A.row(k);
+        double cmin2 = std::numeric_limits<double>::infinity();
+        rtree.visit_nearest(a, [&](int i, double box_dist2) {
+            if (box_dist2 > cmin2 * (1.0 + 1e-9) + tol) {
+                return false;
+            }
+            cmin2 = std::min(cmin2, segment_distance2(B, i, a));
+            return cmin2 > cmax2;
+        });
+        if (cmin2 > cmax2) {
+            cmax2 = cmin2;
+            if (cmax2 > stop2) {
+                break;
+            }
+        }
+    }
+    return cmax2;
+}
+
+// bounding boxes of A and B are within epsilon of each other on every axis,
+// necessary for hausdorff (thus frechet) distance <= epsilon
+inline bool bboxes_within(const Eigen::Ref<const RowVectors> &A,
+                          const Eigen::Ref<const RowVectors> &B,
+                          double epsilon)
+{
+    Eigen::Array3d dmin = A.colwise().minCoeff() - B.colwise().minCoeff();
+    Eigen::Array3d dmax = A.colwise().maxCoeff() - B.colwise().maxCoeff();
+    return (dmin.abs() <= epsilon).all() && (dmax.abs() <= epsilon).all();
+}
+
+// squared discrete frechet distance (Eiter & Mannila), one row of the
+// coupling table in `row`. cells above `stop2` are not refined, rows are
+// only scanned around the cells within it, returns infinity as soon as a
+// whole row exceeds it
+inline double
+discrete_frechet2(const Eigen::Ref<const RowVectors> &P,
+                  const Eigen::Ref<const RowVectors> &Q,
+                  std::vector<double> &row,
+                  double stop2 = std::numeric_limits<double>::infinity())
+{
+    constexpr double inf = std::numeric_limits<double>::infinity();
+    const int n = P.rows(), m = Q.rows();
+    row.assign(m, inf);
+    // cells of the last row within stop2 are in [lo, hi]
+    int lo = -1, hi = -1;
+    for (int j = 0; j < m; ++j) {
+        double d2 = (P.row(0) - Q.row(j)).squaredNorm();
+        row[j] = j ? std::max(d2, row[j - 1]) : d2;
+        if (row[j] > stop2) {
+            break;
+        }
+        lo = 0;
+        hi = j;
+    }
+    for (int i = 1; i < n && lo >= 0; ++i) {
+        double left = inf;
+        double diag = lo ? row[lo - 1] : inf;
+        int next_lo = -1, next_hi = -1;
+        for (int j = lo; j < m; ++j) {
+            if (j > hi + 1 && left > stop2) {
+                break;
+            }
+            double up = row[j];
+            double best = std::min({up, diag, left});
+            if (best <= stop2) {
+                best = std::max(best, (P.row(i) - Q.row(j)).squaredNorm());
+            }
+            diag = up;
+            row[j] = left = best;
+            if (best <= stop2) {
+                next_lo = next_lo < 0 ? j : next_lo;
+                next_hi = j;
+            }
+        }
+        lo = next_lo;
+        hi = next_hi;
+    }
+    return hi == m - 1 ? row[m - 1] : inf;
+}
+
+// {t in [0, 1] : |a + t * (b - a) - p|^2 <= epsilon2}, empty if lo > hi
+struct FreeInterval
+{
+    double lo = 1.0, hi = 0.0;
+    bool empty() const { return lo > hi; }
+};
+inline FreeInterval free_interval(const Eigen::Vector3d &p,
+                                  const Eigen::Vector3d &a,
+                                  const Eigen::Vector3d &b, double epsilon2)
+{
+    Eigen::Vector3d ab = b - a, ap = p - a;
+    double A = ab.squaredNorm();
+    double C = ap.squaredNorm() - epsilon2;
+    if (A == 0.0) {
+        return C <= 0.0 ? FreeInterval{0.0, 1.0} : FreeInterval{};
+    }
+    // A t^2 - 2 B t + C <= 0
+    double B = ab.dot(ap);
+    double disc = B * B - A * C;
+    if (disc < 0.0) {
+        return {};
+    }
+    double sq = std::sqrt(disc);
+    return {std::max(0.0, (B - sq) / A), std::min(1.0, (B + sq) / A)};
+}
+
+// continuous frechet distance <= sqrt(epsilon2), decided on the free space
+// diagram cell by cell (Alt & Godau), `col` holds the reachable intervals
+// on the right edges of the last column of cells. stops as soon as nothing
+// is reachable
+inline bool frechet_within(const Eigen::Ref<const RowVectors> &P,
+                           const Eigen::Ref<const RowVectors> &Q,
+                           double epsilon2, std::vector<FreeInterval> &col)
+{
+    const int n = P.rows(), m = Q.rows();
+    if ((P.row(0) - Q.row(0)).squaredNorm() > epsilon2 ||
+        (P.row(n - 1) - Q.row(m - 1)).squaredNorm() > epsilon2) {
+        return false;
+    }
+    if (n == 1 || m == 1) {
+        // distance to a point is convex along segments
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < m; ++j) {
+                if ((P.row(i) - Q.row(j)).squaredNorm() > epsilon2) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+    col.assign(m - 1, FreeInterval{});
+    for (int j = 0; j < m - 1; ++j) {
+        auto F = free_interval(P.row(0), Q.row(j), Q.row(j + 1), epsilon2);
+        if (F.lo > 0.0) {
+            break;
+        }
+        col[j] = F;
+        if (F.hi < 1.0) {
+            break;
+        }
+    }
+    FreeInterval top;
+    bool bottom = true; // bottom edge of the diagram reachable so far
+    for (int i = 0; i < n - 1; ++i) {
+        FreeInterval B;
+        if (bottom) {
+            auto F = free_interval(Q.row(0), P.row(i), P.row(i + 1), epsilon2);
+            bottom = F.lo == 0.0 && F.hi == 1.0;
+            if (F.lo == 0.0) {
+                B = F;
+            }
+        }
+        bool reachable = false;
+        for (int j = 0; j < m - 1; ++j) {
+            const FreeInterval L = col[j];
+            if (L.empty() && B.empty()) {
+                continue;
+            }
+            auto R = free_interval(P.row(i + 1), Q.row(j), Q.row(j + 1),
+                                   epsilon2);
+            auto T = free_interval(Q.row(j + 1), P.row(i), P.row(i + 1),
+                                   epsilon2);
+            if (B.empty()) {
+                R.lo = std::max(R.lo, L.lo);
+            }
+            if (L.empty()) {
+                T.lo = std::max(T.lo, B.lo);
+            }
+            col[j] = R;
+            B = T;
+            reachable |= !R.empty();
+        }
+        top = B;
+        if (!reachable && !bottom) {
+            return false;
+        }
+    }
+    return (!col[m - 2].empty() && col[m - 2].hi == 1.0) ||
+           (!top.empty() && top.hi == 1.0);
+}
+
+// continuous frechet distance by bisection on frechet_within between the
+// endpoint distances and the discrete frechet distance (an upper bound),
+// to a relative tolerance of 1e-9. infinity if above `stop`
+inline double continuous_frechet(
+    const Eigen::Ref<const RowVectors> &P,
+    const Eigen::Ref<const RowVectors> &Q, std::vector<double> &row,
+    std::vector<FreeInterval> &col,
+    double stop = std::numeric_limits<double>::infinity())
+{
+    double hi = std::sqrt(discrete_frechet2(P, Q, row, stop * stop));
+    double lo = std::sqrt(
+        std::max((P.row(0) - Q.row(0)).squaredNorm(),
+                 (P.row(P.rows() - 1) - Q.row(Q.rows() - 1)).squaredNorm()));
+    if (hi > stop) {
+        if (!frechet_within(P, Q, stop * stop, col)) {
+            return std::numeric_limits<double>::infinity();
+        }
+        hi = stop;
+    }
+    while (hi - lo > 1e-9 * std::max(hi, 1.0)) {
+        double mid = (lo + hi) / 2.0;
+        (frechet_within(P, Q, mid * mid, col) ? hi : lo) = mid;
+    }
+    return hi;
+}
+
+inline void check_polylines(const Eigen::Ref<const RowVectors> &A,
+                            const Eigen::Ref<const RowVectors> &B)
+{
+    if (!A.rows() || !B.rows()) {
+        throw std::invalid_argument("polylines should not be empty");
+    }
+}
+} // namespace internal
+
+// hausdorff distance between polylines A and B, max over vertices of either
+// of their distances to the other polyline (same as shapely/GEOS, densify
+// long segments to approach the continuous one). wgs84 polylines are
+// measured in the ENU frame anchored at A's first point (cheap ruler)
+inline double hausdorff_distance(const RowVectors &A, const RowVectors &B,
+                                 bool is_wgs84 = false)
+{
+    internal::check_polylines(A, B);
+    if (is_wgs84) {
+        Eigen::Vector3d anchor = A.row(0);
+        return hausdorff_distance(lla2enu(A), lla2enu(B, anchor), false);
+    }
+    double cmax2 = internal::directed_hausdorff2(
+        A, B, PolylineRuler::rtree(B, false));
+    cmax2 = internal::directed_hausdorff2(
+        B, A, PolylineRuler::rtree(A, false), cmax2);
+    return std::sqrt(cmax2);
+}
+inline double hausdorff_distance(const Eigen::Ref<const RowVectorsNx2> &A,
+                                 const Eigen::Ref<const RowVectorsNx2> &B,
+                                 bool is_wgs84 = false)
+{
+    return hausdorff_distance(to_Nx3(A), to_Nx3(B), is_wgs84);
+}
+
+// hausdorff_distance(A, B) <= epsilon, pruned by bounding boxes, every
+// vertex only visits segments (of the other polyline) near it and the first
+// one farther than epsilon decides
+inline bool hausdorff_within(const RowVectors &A, const RowVectors &B,
+                             double epsilon, bool is_wgs84 = false)
+{
+    internal::check_polylines(A, B);
+    if (is_wgs84) {
+        Eigen::Vector3d anchor = A.row(0);
+        return hausdorff_within(lla2enu(A), lla2enu(B, anchor), epsilon,
+                                false);
+    }
+    if (!internal::bboxes_within(A, B, epsilon)) {
+        return false;
+    }
+    const double eps2 = epsilon * epsilon;
+    return internal::directed_hausdorff2(A, B, PolylineRuler::rtree(B),
+                                         eps2, eps2) <= eps2 &&
+           internal::directed_hausdorff2(B, A, PolylineRuler::rtree(A),
+                                         eps2, eps2) <= eps2;
+}
+inline bool hausdorff_within(const Eigen::Ref<const RowVectorsNx2> &A,
+                             const Eigen::Ref<const RowVectorsNx2> &B,
+                             double epsilon, bool is_wgs84 = false)
+{
+    return hausdorff_within(to_Nx3(A), to_Nx3(B), epsilon, is_wgs84);
+}
+
+// frechet distance between polylines A and B, discrete (over vertices only,
+// exact) or continuous (over all points, see internal::continuous_frechet).
+// wgs84 polylines are measured in the ENU frame anchored at A's first point
+inline double frechet_distance(const RowVectors &A, const RowVectors &B,
+                               bool is_wgs84 = false, bool discrete = true)
+{
+    internal::check_polylines(A, B);
+    if (is_wgs84) {
+        Eigen::Vector3d anchor = A.row(0);
+        return frechet_distance(lla2enu(A), lla2enu(B, anchor), false,
+                                discrete);
+    }
+    std::vector<double> row;
+    if (discrete) {
+        return std::sqrt(internal::discrete_frechet2(A, B, row));
+    }
+    std::vector<internal::FreeInterval> col;
+    return internal::continuous_frechet(A, B, row, col);
+}
+inline double frechet_distance(const Eigen::Ref<const RowVectorsNx2> &A,
+                               const Eigen::Ref<const RowVectorsNx2> &B,
+                               bool is_wgs84 = false, bool discrete = true)
+{
+    return frechet_distance(to_Nx3(A), to_Nx3(B), is_wgs84, discrete);
+}
+
+// frechet_distance(A, B) <= epsilon, pruned by endpoints and bounding boxes,
+// then decided without computing the distance (only cells within epsilon
+// are visited for the discrete one)
+inline bool frechet_within(const RowVectors &A, const RowVectors &B,
+                           double epsilon, bool is_wgs84 = false,
+                           bool discrete = true)
+{
+    internal::check_polylines(A, B);
+    if (is_wgs84) {
+        Eigen::Vector3d anchor = A.row(0);
+        return frechet_within(lla2enu(A), lla2enu(B, anchor), epsilon,
+                              false, discrete);
+    }
+    if (!internal::bboxes_within(A, B, epsilon)) {
+        return false;
+    }
+    const double eps2 = epsilon * epsilon;
+    if (discrete) {
+        std::vector<double> row;
+        return internal::discrete_frechet2(A, B, row, eps2) <= eps2;
+    }
+    std::vector<internal::FreeInterval> col;
+    return internal::frechet_within(A, B, eps2, col);
+}
+inline bool frechet_within(const Eigen::Ref<const RowVectorsNx2> &A,
+                           const Eigen::Ref<const RowVectorsNx2> &B,
+                           double epsilon, bool is_wgs84 = false,
+                           bool discrete = true)
+{
+    return frechet_within(to_Nx3(A), to_Nx3(B), epsilon, is_wgs84, discrete);
+}
+
+namespace internal
+{
+// scores query against every polyline packed in coords (polyline k is
+// coords[offsets[k]:offsets[k+1]]), `score(query, candidate, scratch)` runs
+// on n_threads threads (0 for all hardware threads), wgs84 coordinates are
+// measured in the ENU frame anchored at the query's first point. empty
+// candidates score infinity
+template <typename Scratch, typename Score>
+Eigen::VectorXd
+score_polylines(const RowVectors &query, const RowVectors &coords,
+                const Eigen::Ref<const Eigen::VectorXi> &offsets,
+                bool is_wgs84, int n_threads, Score &&score)
+{
+    check_offsets(offsets, coords.rows());
+    if (!query.rows()) {
+        throw std::invalid_argument("query should not be empty");
+    }
+    const int M = std::max((int)offsets.size() - 1, 0);
+    Eigen::VectorXd scores =
+        Eigen::VectorXd::Constant(M, std::numeric_limits<double>::infinity());
+    RowVectors enus;
+    if (is_wgs84) {
+        enus = lla2enu(coords, Eigen::Vector3d(query.row(0)));
+    }
+    const Eigen::Ref<const RowVectors> xyzs = is_wgs84 ? enus : coords;
+    const RowVectors Q = is_wgs84 ? lla2enu(query) : query;
+    constexpr int batch_size = 16;
+    std::atomic<int> next{0};
+    const int T = std::min(num_threads(n_threads), //
+                           (M + batch_size - 1) / batch_size);
+    parallel_for(
+        T,
+        [&](int, int) {
+            Scratch scratch;
+            for (int k0 = next.fetch_add(batch_size); k0 < M;
+                 k0 = next.fetch_add(batch_size)) {
+                for (int k = k0, K = std::min(k0 + batch_size, M); k < K;
+                     ++k) {
+                    const int n = offsets[k + 1] - offsets[k];
+                    if (n) {
+                        scores[k] = score(Q, xyzs.middleRows(offsets[k], n),
+                                          scratch);
+                    }
+                }
+            }
+        },
+        T, 1);
+    return scores;
+}
+} // namespace internal
+
+// hausdorff_distance from query to every polyline packed in coords (polyline
+// k is coords[offsets[k]:offsets[k+1]]), multithreaded. with max_distance,
+// candidates farther than it are pruned early (hausdorff_within) and score
+// infinity, as do empty ones
+inline Eigen::VectorXd
+hausdorff_distances(const RowVectors &query, const RowVectors &coords,
+                    const Eigen::Ref<const Eigen::VectorXi> &offsets,
+                    bool is_wgs84 = false,
+                    std::optional<double> max_distance = {},
+                    int n_threads = 0)
+{
+    const PackedRTree rtree =
+        PolylineRuler::rtree(is_wgs84 ? lla2enu(query) : query, false);
+    const double stop2 = max_distance
+                             ? (*max_distance) * (*max_distance)
+                             : std::numeric_limits<double>::infinity();
+    struct Scratch
+    {
+    };
+    return internal::score_polylines<Scratch>(
+        query, coords, offsets, is_wgs84, n_threads,
+        [&](const auto &Q, const auto &B, Scratch &) {
+            constexpr double inf = std::numeric_limits<double>::infinity();
+            if (max_distance &&
+                !internal::bboxes_within(Q, B, *max_distance)) {
+                return inf;
+            }
+            // against the shared index first, it is the cheaper one
+            double cmax2 = internal::directed_hausdorff2(B, Q, rtree, 0.0,
+                                                         stop2);
+            if (cmax2 > stop2) {
+                return inf;
+            }
+            cmax2 = internal::directed_hausdorff2(
+                Q, B, PolylineRuler::rtree(B), cmax2, stop2);
+            return cmax2 > stop2 ? inf : std::sqrt(cmax2);
+        });
+}
+inline Eigen::VectorXd
+hausdorff_distances(const Eigen::Ref<const RowVectorsNx2> &query,
+                    const Eigen::Ref<const RowVectorsNx2> &coords,
+                    const Eigen::Ref<const Eigen::VectorXi> &offsets,
+                    bool is_wgs84 = false,
+                    std::optional<double> max_distance = {},
+                    int n_threads = 0)
+{
+    return hausdorff_distances(to_Nx3(query), to_Nx3(coords), offsets,
+                               is_wgs84, max_distance, n_threads);
+}
+
+// frechet_distance from query to every polyline packed in coords (polyline
+// k is coords[offsets[k]:offsets[k+1]]), multithreaded. with max_distance,
+// candidates farther than it are pruned early (frechet_within) and score
+// infinity, as do empty ones
+inline Eigen::VectorXd
+frechet_distances(const RowVectors &query, const RowVectors &coords,
+                  const Eigen::Ref<const Eigen::VectorXi> &offsets,
+                  bool is_wgs84 = false, bool discrete = true,
+                  std::optional<double> max_distance = {}, int n_threads = 0)
+{
+    const double stop = max_distance
+                            ? *max_distance
+                            : std::numeric_limits<double>::infinity();
+    struct Scratch
+    {
+        std::vector<double> row;
+        std::vector<internal::FreeInterval> col;
+    };
+    return internal::score_polylines<Scratch>(
+        query, coords, offsets, is_wgs84, n_threads,
+        [&](const auto &Q, const auto &B, Scratch &scratch) {
+            constexpr double inf = std::numeric_limits<double>::infinity();
+            if (max_distance &&
+                !internal::bboxes_within(Q, B, *max_distance)) {
+                return inf;
+            }
+            if (!discrete) {
+                return internal::continuous_frechet(Q, B, scratch.row,
+                                                    scratch.col, stop);
+            }
+            double d2 =
+                internal::discrete_frechet2(Q, B, scratch.row, stop * stop);
+            return d2 > stop * stop ? inf : std::sqrt(d2);
+        });
+}
+inline Eigen::VectorXd
+frechet_distances(const Eigen::Ref<const RowVectorsNx2> &query,
+                  const Eigen::Ref<const RowVectorsNx2> &coords,
+                  const Eigen::Ref<const Eigen::VectorXi> &offsets,
+                  bool is_wgs84 = false, bool discrete = true,
+                  std::optional<double> max_distance = {}, int n_threads = 0)
+{
+    return frechet_distances(to_Nx3(query), to_Nx3(coords), offsets,
+                             is_wgs84, discrete, max_distance, n_threads);
 }
 
 } // namespace cubao
@@ -18,17 +18,301 @@ import typing
 from . import tf
 
 __all__ = [
+    "AppendablePolylineRuler",
+    "BandedPolylineRuler",
     "CheapRuler",
+    "EncodedPolyline",
     "LineSegment",
+    "MapMatcher",
+    "PackedRTree",
+    "PolylineCollection",
+    "PolylineIndex",
     "PolylineRuler",
+    "PolylineRuler2D",
+    "PolylineRuler2DWGS84",
+    "PolylineRuler3D",
+    "PolylineRuler3DWGS84",
+    "StreamingSimplifier",
+    "clip_polylines_to_tiles",
+    "decode_polyline",
+    "decode_polylines",
     "douglas_simplify",
     "douglas_simplify_indexes",
     "douglas_simplify_mask",
+    "douglas_simplify_masks",
+    "encode_polyline",
+    "encode_polylines",
+    "frechet_distance",
+    "frechet_distances",
+    "frechet_within",
+    "hausdorff_distance",
+    "hausdorff_distances",
+    "hausdorff_within",
+    "intersect_polylines",
     "intersect_segments",
     "snap_onto_2d",
     "tf",
+    "visvalingam_simplify",
+    "visvalingam_simplify_indexes",
+    "visvalingam_simplify_mask",
 ]
 
+class AppendablePolylineRuler:
+    def N(self) -> int:
+        """
+        Get the number of points in the polyline.
+        """
+    @typing.overload
+    def __init__(self, *, is_wgs84: bool = False) -> None:
+        """
+        Create an empty AppendablePolylineRuler.
+        """
+    @typing.overload
+    def __init__(
+        self,
+        coords: numpy.ndarray[numpy.float64[m, 3], numpy.ndarray.flags.c_contiguous],
+        *,
+        is_wgs84: bool = False,
+    ) -> None:
+        """
+        Create an AppendablePolylineRuler from initial coordinates.
+        """
+    @typing.overload
+    def along(self, dist: float) -> numpy.ndarray[numpy.float64[3, 1]]:
+        """
+        Find a point at a specified distance along the polyline (clamped).
+        """
+    @typing.overload
+    def along(
+        self, dists: numpy.ndarray[numpy.float64[m, 1]]
+    ) -> numpy.ndarray[numpy.float64[m, 3]]:
+        """
+        Find points at multiple distances along the polyline (clamped).
+        """
+    @typing.overload
+    def append(self, point: numpy.ndarray[numpy.float64[3, 1]]) -> None:
+        """
+        Append a single point, updating caches incrementally.
+        """
+    @typing.overload
+    def append(
+        self,
+        points: numpy.ndarray[numpy.float64[m, 3], numpy.ndarray.flags.c_contiguous],
+    ) -> None:
+        """
+        Append points, updating caches incrementally.
+        """
+    @typing.overload
+    def at(self, *, range: float) -> numpy.ndarray[numpy.float64[3, 1]]:
+        """
+        Get the point at a specific cumulative distance.
+        """
+    @typing.overload
+    def at(self, *, segment_index: int) -> numpy.ndarray[numpy.float64[3, 1]]:
+        """
+        Get the point at a specific segment index.
+        """
+    @typing.overload
+    def at(self, *, segment_index: int, t: float) -> numpy.ndarray[numpy.float64[3, 1]]:
+        """
+        Get the point at a specific segment index and interpolation factor.
+        """
+    @typing.overload
+    def dir(self, *, point_index: int) -> numpy.ndarray[numpy.float64[3, 1]]:
+        """
+        Get the direction vector at a specific point index.
+        """
+    @typing.overload
+    def dir(
+        self, *, range: float, smooth_joint: bool = True
+    ) -> numpy.ndarray[numpy.float64[3, 1]]:
+        """
+        Get the direction vector at a specific cumulative distance.
+        """
+    def dirs(self) -> numpy.ndarray[numpy.float64[m, 3]]:
+        """
+        Get direction vectors for each segment of the polyline.
+        """
+    def is_wgs84(self) -> bool:
+        """
+        Check if the coordinate system is WGS84.
+        """
+    def k(self) -> numpy.ndarray[numpy.float64[3, 1]]:
+        """
+        Get the scale factor for distance calculations.
+        """
+    def length(self) -> float:
+        """
+        Get the total length of the polyline.
+        """
+    def lineSliceAlong(
+        self, start: float, stop: float
+    ) -> numpy.ndarray[numpy.float64[m, 3]]:
+        """
+        Extract a portion of the polyline between two distances along it.
+        """
+    def local_frame(
+        self, range: float, *, smooth_joint: bool = True
+    ) -> numpy.ndarray[numpy.float64[4, 4]]:
+        """
+        Get the local coordinate frame at a specific cumulative distance.
+        """
+    def pointOnLine(
+        self, P: numpy.ndarray[numpy.float64[3, 1]]
+    ) -> tuple[numpy.ndarray[numpy.float64[3, 1]], int, float]:
+        """
+        Find the closest point on the polyline to a given point.
+        """
+    def polyline(self) -> numpy.ndarray[numpy.float64[m, 3]]:
+        """
+        Get the polyline coordinates.
+        """
+    @typing.overload
+    def range(self, segment_index: int) -> float:
+        """
+        Get the cumulative distance at a specific segment index.
+        """
+    @typing.overload
+    def range(self, *, segment_index: int, t: float) -> float:
+        """
+        Get the cumulative distance at a specific segment index and interpolation factor.
+        """
+    def ranges(self) -> numpy.ndarray[numpy.float64[m, 1]]:
+        """
+        Get cumulative distances along the polyline.
+        """
+    def ruler(self) -> PolylineRuler:
+        """
+        Get an immutable PolylineRuler copy of the current points.
+        """
+    def segment_index(self, range: float) -> int:
+        """
+        Get the segment index for a given cumulative distance.
+        """
+    def segment_index_t(self, range: float) -> tuple[int, float]:
+        """
+        Get the segment index and interpolation factor for a given cumulative distance.
+        """
+    def trim_head(self, n: int) -> None:
+        """
+        Drop the first n points (ranges stay relative to the new head).
+        """
+
+class BandedPolylineRuler:
+    def N(self) -> int:
+        """
+        Get the number of points in the polyline.
+        """
+    def __init__(
+        self,
+        coords: numpy.ndarray[numpy.float64[m, 3], numpy.ndarray.flags.c_contiguous],
+        *,
+        band_height: float = 0.1,
+    ) -> None:
+        """
+        Initialize the ruler with wgs84 polyline coordinates, split into latitude bands of at most band_height degrees.
+        """
+    @typing.overload
+    def along(self, dist: float) -> numpy.ndarray[numpy.float64[3, 1]]:
+        """
+        Get the point at a distance along the polyline (clamped).
+        """
+    @typing.overload
+    def along(self, dists: numpy.ndarray[numpy.float64[m, 1]]) -> numpy.ndarray[numpy.float64[m, 3]]:
+        """
+        Get points at distances along the polyline (clamped).
+        """
+    def anchors(self) -> numpy.ndarray[numpy.float64[m, 3]]:
+        """
+        Get the anchor (lla) of the ENU frame of each band.
+        """
+    def at(self, *, segment_index: int, t: float) -> numpy.ndarray[numpy.float64[3, 1]]:
+        """
+        Get the point at a segment index and interpolation factor.
+        """
+    def band_height(self) -> float:
+        """
+        Get the max latitude span (degrees) of a band.
+        """
+    def band_index(self, segment_index: int) -> int:
+        """
+        Get the band of a segment.
+        """
+    def band_offsets(self) -> numpy.ndarray[numpy.int32[m, 1]]:
+        """
+        Get band offsets, band b covers segments [offsets[b], offsets[b+1]).
+        """
+    def enus(self, band: int) -> numpy.ndarray[numpy.float64[m, 3]]:
+        """
+        Get ENU coordinates of the points of a band, in its own frame.
+        """
+    def ks(self) -> numpy.ndarray[numpy.float64[m, 3]]:
+        """
+        Get the scale factors of the ENU frame of each band.
+        """
+    def length(self) -> float:
+        """
+        Get the total length of the polyline.
+        """
+    def lineSlice(
+        self,
+        start: numpy.ndarray[numpy.float64[3, 1]],
+        stop: numpy.ndarray[numpy.float64[3, 1]],
+    ) -> numpy.ndarray[numpy.float64[m, 3]]:
+        """
+        Get a slice of the polyline between two points (projected onto it).
+        """
+    def lineSliceAlong(
+        self, start: float, stop: float
+    ) -> numpy.ndarray[numpy.float64[m, 3]]:
+        """
+        Get a slice of the polyline between two distances along it.
+        """
+    def num_bands(self) -> int:
+        """
+        Get the number of latitude bands.
+        """
+    def pointOnLine(self, P: numpy.ndarray[numpy.float64[3, 1]]) -> tuple[numpy.ndarray[numpy.float64[3, 1]], int, float]:
+        """
+        Find the closest point on the polyline to a given point.
+        """
+    def pointsOnLine(
+        self,
+        points: numpy.ndarray[numpy.float64[m, 3], numpy.ndarray.flags.c_contiguous],
+        *,
+        n_threads: int = 0,
+    ) -> tuple[
+        numpy.ndarray[numpy.float64[m, 3]],
+        numpy.ndarray[numpy.int32[m, 1]],
+        numpy.ndarray[numpy.float64[m, 1]],
+        numpy.ndarray[numpy.float64[m, 1]],
+    ]:
+        """
+        Find the closest points on the polyline to a batch of points (points, segment indexes, t, distances), multithreaded.
+        """
+    def polyline(self) -> numpy.ndarray[numpy.float64[m, 3]]:
+        """
+        Get the polyline coordinates.
+        """
+    @typing.overload
+    def range(self, segment_index: int) -> float:
+        """
+        Get the cumulative distance at a specific segment index.
+        """
+    @typing.overload
+    def range(self, *, segment_index: int, t: float) -> float:
+        """
+        Get the cumulative distance at a specific segment index and interpolation factor.
+        """
+    def ranges(self) -> numpy.ndarray[numpy.float64[m, 1]]:
+        """
+        Get cumulative distances along the polyline.
+        """
+    def segment_index_t(self, range: float) -> tuple[int, float]:
+        """
+        Get the segment index and interpolation factor for a given cumulative distance.
+        """
+
 class CheapRuler:
     """
 
@@ -110,18 +394,46 @@ class CheapRuler:
         Create a CheapRuler from tile coordinates (x, y).
         """
     @staticmethod
+    @typing.overload
     def _insideBBox(
         p: numpy.ndarray[numpy.float64[3, 1]],
         bbox: tuple[
             numpy.ndarray[numpy.float64[3, 1]], numpy.ndarray[numpy.float64[3, 1]]
         ],
         *,
-        cheak_z: bool = False,
+        check_z: bool = False,
     ) -> bool:
         """
         Check if a point is inside a bounding box.
         """
     @staticmethod
+    @typing.overload
+    def _insideBBox(
+        points: numpy.ndarray[numpy.float64[m, 3]],
+        bbox: tuple[
+            numpy.ndarray[numpy.float64[3, 1]], numpy.ndarray[numpy.float64[3, 1]]
+        ],
+        *,
+        check_z: bool = False,
+        n_threads: int = 0,
+    ) -> numpy.ndarray[numpy.int32[m, 1]]:
+        """
+        Check which points are inside a bounding box (1/0 per point).
+        """
+    @staticmethod
+    @typing.overload
+    def _insideBBox(
+        p: numpy.ndarray[numpy.float64[3, 1]],
+        bbox: tuple[
+            numpy.ndarray[numpy.float64[3, 1]], numpy.ndarray[numpy.float64[3, 1]]
+        ],
+        *,
+        cheak_z: bool,
+    ) -> bool:
+        """
+        Same as _insideBBox(p, bbox, check_z=...) (deprecated spelling).
+        """
+    @staticmethod
     def _interpolate(
         a: numpy.ndarray[numpy.float64[3, 1]],
         b: numpy.ndarray[numpy.float64[3, 1]],
@@ -168,6 +480,16 @@ class CheapRuler:
         """
         Calculate the bearing between two points.
         """
+    def bearings(
+        self,
+        a: numpy.ndarray[numpy.float64[m, 3]],
+        b: numpy.ndarray[numpy.float64[m, 3]],
+        *,
+        n_threads: int = 0,
+    ) -> numpy.ndarray[numpy.float64[m, 1]]:
+        """
+        Batch bearing, pairwise on rows (a single row is broadcast).
+        """
     def bufferBBox(
         self,
         bbox: tuple[
@@ -184,6 +506,12 @@ class CheapRuler:
         """
         Create a bounding box around a point.
         """
+    def bufferPoints(
+        self, points: numpy.ndarray[numpy.float64[m, 3]], buffer: float
+    ) -> tuple[numpy.ndarray[numpy.float64[m, 3]], numpy.ndarray[numpy.float64[m, 3]]]:
+        """
+        Create bounding boxes around points, returns (mins, maxs).
+        """
     def delta(
         self,
         lla0: numpy.ndarray[numpy.float64[3, 1]],
@@ -192,12 +520,33 @@ class CheapRuler:
         """
         Calculate the distance between two points in the x, y plane.
         """
+    def deltas(
+        self,
+        a: numpy.ndarray[numpy.float64[m, 3]],
+        b: numpy.ndarray[numpy.float64[m, 3]],
+        *,
+        n_threads: int = 0,
+    ) -> numpy.ndarray[numpy.float64[m, 3]]:
+        """
+        Batch delta, pairwise on rows (a single row is broadcast).
+        """
     def destination(
         self, origin: numpy.ndarray[numpy.float64[3, 1]], dist: float, bearing: float
     ) -> numpy.ndarray[numpy.float64[3, 1]]:
         """
         Calculate the destination point given origin, distance, and bearing.
         """
+    def destinations(
+        self,
+        origins: numpy.ndarray[numpy.float64[m, 3]],
+        dists: numpy.ndarray[numpy.float64[m, 1]],
+        bearings: numpy.ndarray[numpy.float64[m, 1]],
+        *,
+        n_threads: int = 0,
+    ) -> numpy.ndarray[numpy.float64[m, 3]]:
+        """
+        Batch destination, pairwise on rows (a single origin is broadcast).
+        """
     def distance(
         self,
         a: numpy.ndarray[numpy.float64[3, 1]],
@@ -206,15 +555,35 @@ class CheapRuler:
         """
         Calculate the distance between two points.
         """
-    def k(self) -> numpy.ndarray[numpy.float64[3, 1]]:
+    def distanceMatrix(
+        self,
+        a: numpy.ndarray[numpy.float64[m, 3]],
+        b: numpy.ndarray[numpy.float64[m, 3]],
+        *,
+        n_threads: int = 0,
+    ) -> numpy.ndarray[numpy.float64[m, n]]:
         """
-        Get the ruler's unit conversion factor.
+        Distances between every row of a and every row of b.
         """
-    def lineDistance(
+    def distances(
         self,
-        points: numpy.ndarray[numpy.float64[m, 3], numpy.ndarray.flags.c_contiguous],
-    ) -> float:
-        """
+        a: numpy.ndarray[numpy.float64[m, 3]],
+        b: numpy.ndarray[numpy.float64[m, 3]],
+        *,
+        n_threads: int = 0,
+    ) -> numpy.ndarray[numpy.float64[m, 1]]:
+        """
+        Batch distance, pairwise on rows (a single row is broadcast).
+        """
+    def k(self) -> numpy.ndarray[numpy.float64[3, 1]]:
+        """
+        Get the ruler's unit conversion factor.
+        """
+    def lineDistance(
+        self,
+        points: numpy.ndarray[numpy.float64[m, 3], numpy.ndarray.flags.c_contiguous],
+    ) -> float:
+        """
         Calculate the total distance of a line (an array of points).
         """
     def lineSlice(
@@ -249,6 +618,16 @@ class CheapRuler:
         """
         Calculate a new point given origin and offsets.
         """
+    def offsets(
+        self,
+        origins: numpy.ndarray[numpy.float64[m, 3]],
+        dxyzs: numpy.ndarray[numpy.float64[m, 3]],
+        *,
+        n_threads: int = 0,
+    ) -> numpy.ndarray[numpy.float64[m, 3]]:
+        """
+        Batch offset by rows of [dx, dy, dz], pairwise on rows (a single row is broadcast).
+        """
     def pointOnLine(
         self,
         line: numpy.ndarray[numpy.float64[m, 3], numpy.ndarray.flags.c_contiguous],
@@ -274,6 +653,78 @@ class CheapRuler:
         """
         Calculate the squared distance between two points.
         """
+    def squareDistances(
+        self,
+        a: numpy.ndarray[numpy.float64[m, 3]],
+        b: numpy.ndarray[numpy.float64[m, 3]],
+        *,
+        n_threads: int = 0,
+    ) -> numpy.ndarray[numpy.float64[m, 1]]:
+        """
+        Batch squareDistance, pairwise on rows (a single row is broadcast).
+        """
+
+class EncodedPolyline:
+    def N(self) -> int:
+        """
+        Get the number of points in the polyline.
+        """
+    @typing.overload
+    def __init__(
+        self,
+        coords: numpy.ndarray[numpy.float64[m, 3], numpy.ndarray.flags.c_contiguous],
+        *,
+        is_wgs84: bool = False,
+        precision: int = 5,
+        z_precision: int | None = None,
+    ) -> None:
+        """
+        Encode a polyline, its ruler is decoded on first use.
+        """
+    @typing.overload
+    def __init__(
+        self,
+        encoded: str,
+        *,
+        is_wgs84: bool = False,
+        precision: int = 5,
+        z_precision: int | None = None,
+    ) -> None:
+        """
+        Wrap an encoded polyline, its ruler is decoded on first use.
+        """
+    def decode(self) -> numpy.ndarray[numpy.float64[m, 3]]:
+        """
+        Decode the polyline (Nx3).
+        """
+    def encoded(self) -> str:
+        """
+        Get the encoded polyline.
+        """
+    def is_decoded(self) -> bool:
+        """
+        Check if the ruler has been decoded.
+        """
+    def is_wgs84(self) -> bool:
+        """
+        Check if the coordinate system is WGS84.
+        """
+    def precision(self) -> int:
+        """
+        Get the precision (decimal digits) of x & y.
+        """
+    def release(self) -> None:
+        """
+        Drop the decoded ruler (decoded again on next use), rulers already returned stay valid.
+        """
+    def ruler(self) -> PolylineRuler:
+        """
+        Get the ruler (decoded on first use).
+        """
+    def z_precision(self) -> int | None:
+        """
+        Get the precision (decimal digits) of z, None for 2D.
+        """
 
 class LineSegment:
     def __init__(
@@ -324,6 +775,355 @@ class LineSegment:
         Get the squared length of the line segment.
         """
 
+class MapMatcher:
+    @typing.overload
+    def __init__(
+        self,
+        index: PolylineIndex,
+        *,
+        sigma: float = 5.0,
+        beta: float = 10.0,
+        search_radius: float = 50.0,
+        max_candidates: int = 8,
+        beam_width: int = 32,
+        connect_tolerance: float = 1.0,
+        max_route_factor: float = 4.0,
+    ) -> None:
+        """
+        HMM map matcher over polylines of an index (shared, not copied).
+        """
+    @typing.overload
+    def __init__(
+        self,
+        rulers: list[PolylineRuler],
+        *,
+        sigma: float = 5.0,
+        beta: float = 10.0,
+        search_radius: float = 50.0,
+        max_candidates: int = 8,
+        beam_width: int = 32,
+        connect_tolerance: float = 1.0,
+        max_route_factor: float = 4.0,
+    ) -> None:
+        """
+        HMM map matcher over polylines of rulers (copied).
+        """
+    def beam_width(self) -> int:
+        """
+        Get the max number of states kept per point.
+        """
+    def beta(self) -> float:
+        """
+        Get the scale of route/straight distance differences (transition).
+        """
+    def connect_tolerance(self) -> float:
+        """
+        Get the max distance between connected polyline ends.
+        """
+    def index(self) -> PolylineIndex:
+        """
+        Get the polyline index.
+        """
+    def links(self, index: int, at_end: bool) -> numpy.ndarray[numpy.int32[m, 2]]:
+        """
+        Get ends of other polylines connected to the first (or last) point of a polyline, as [polyline, at_end] rows.
+        """
+    def max_route_factor(self) -> float:
+        """
+        Get the max route length, relative to the straight distance (plus 2 * search_radius), between consecutive points.
+        """
+    def match(self, points: numpy.ndarray[numpy.float64[m, 3]]) -> tuple[
+        numpy.ndarray[numpy.int32[m, 1]],
+        numpy.ndarray[numpy.float64[m, 3]],
+        numpy.ndarray[numpy.int32[m, 1]],
+        numpy.ndarray[numpy.float64[m, 1]],
+        numpy.ndarray[numpy.float64[m, 1]],
+    ]:
+        """
+        Match a trace, as (polyline ids, matched points, segment indexes, t, ranges), one row per point (unmatched: id -1).
+        """
+    def match_batch(
+        self,
+        points: numpy.ndarray[numpy.float64[m, 3]],
+        offsets: numpy.ndarray[numpy.int32[m, 1]],
+        *,
+        n_threads: int = 0,
+    ) -> tuple[
+        numpy.ndarray[numpy.int32[m, 1]],
+        numpy.ndarray[numpy.float64[m, 3]],
+        numpy.ndarray[numpy.int32[m, 1]],
+        numpy.ndarray[numpy.float64[m, 1]],
+        numpy.ndarray[numpy.float64[m, 1]],
+    ]:
+        """
+        match() on traces packed in one buffer (trace k is points[offsets[k]:offsets[k+1]]), one row per point.
+        """
+    def max_candidates(self) -> int:
+        """
+        Get the max number of candidates per point.
+        """
+    def ranges(self, index: int) -> numpy.ndarray[numpy.float64[m, 1]]:
+        """
+        Get cumulative distances along a polyline.
+        """
+    def search_radius(self) -> float:
+        """
+        Get the radius of candidate search.
+        """
+    def sigma(self) -> float:
+        """
+        Get the std deviation of gps noise (emission).
+        """
+
+class PackedRTree:
+    def __init__(
+        self,
+        boxes: numpy.ndarray[numpy.float64[m, 6], numpy.ndarray.flags.c_contiguous],
+        *,
+        node_size: int = 16,
+    ) -> None:
+        """
+        Build a static packed R-tree over Nx6 boxes [min_x, min_y, min_z, max_x, max_y, max_z].
+        """
+    def bounds(self) -> numpy.ndarray[numpy.float64[1, 6]]:
+        """
+        Get the bounding box of all items.
+        """
+    def boxes(self) -> numpy.ndarray[numpy.float64[m, 6]]:
+        """
+        Get boxes of all nodes (leaves first, root last).
+        """
+    def node_size(self) -> int:
+        """
+        Get the node size.
+        """
+    def search(
+        self,
+        min: numpy.ndarray[numpy.float64[3, 1]],
+        max: numpy.ndarray[numpy.float64[3, 1]],
+    ) -> list[int]:
+        """
+        Get indexes of items whose boxes overlap [min, max].
+        """
+    def size(self) -> int:
+        """
+        Get the number of items.
+        """
+
+class PolylineCollection:
+    def __init__(self, path: str) -> None:
+        """
+        Open (mmap) a polyline collection file.
+        """
+    def __len__(self) -> int:
+        """
+        Get the number of polylines.
+        """
+    def coords(self) -> numpy.ndarray[numpy.float64[m, 3]]:
+        """
+        Get coordinates of all polylines (read-only view into the file).
+        """
+    def has_dirs(self) -> bool:
+        """
+        Check if dirs are stored in the file.
+        """
+    def has_ranges(self) -> bool:
+        """
+        Check if ranges are stored in the file.
+        """
+    def has_rtree(self) -> bool:
+        """
+        Check if the rtree is stored in the file.
+        """
+    def is_wgs84(self) -> bool:
+        """
+        Check if the coordinate system is WGS84.
+        """
+    def num_points(self) -> int:
+        """
+        Get the number of points of all polylines.
+        """
+    def offsets(self) -> numpy.ndarray[numpy.int32[m, 1]]:
+        """
+        Get offsets of polylines (read-only view into the file).
+        """
+    def polyline(self, index: int) -> numpy.ndarray[numpy.float64[m, 3]]:
+        """
+        Get coordinates of a polyline (read-only view into the file).
+        """
+    def rtree(self) -> PackedRTree:
+        """
+        Get the packed R-tree over bounding boxes of polylines.
+        """
+    def ruler(self, index: int) -> PolylineRuler:
+        """
+        Get a PolylineRuler viewing a polyline's coords (no copy), ranges/dirs are copied from the file into its caches.
+        """
+    def search(
+        self,
+        min: numpy.ndarray[numpy.float64[3, 1]],
+        max: numpy.ndarray[numpy.float64[3, 1]],
+    ) -> list[int]:
+        """
+        Get indexes of polylines whose bounding boxes overlap [min, max].
+        """
+    def size(self) -> int:
+        """
+        Get the number of polylines.
+        """
+    @staticmethod
+    @typing.overload
+    def write(
+        path: str,
+        coords: numpy.ndarray[numpy.float64[m, 3]],
+        offsets: numpy.ndarray[numpy.int32[m, 1]],
+        *,
+        is_wgs84: bool = False,
+        with_ranges: bool = True,
+        with_dirs: bool = True,
+        with_rtree: bool = True,
+        n_threads: int = 0,
+    ) -> None:
+        """
+        Write polylines packed in one buffer (polyline k is coords[offsets[k]:offsets[k+1]]) to a polyline collection file, optionally with precomputed ranges, dirs and rtree.
+        """
+    @staticmethod
+    @typing.overload
+    def write(
+        path: str,
+        coords: numpy.ndarray[numpy.float64[m, 2], numpy.ndarray.flags.c_contiguous],
+        offsets: numpy.ndarray[numpy.int32[m, 1]],
+        *,
+        is_wgs84: bool = False,
+        with_ranges: bool = True,
+        with_dirs: bool = True,
+        with_rtree: bool = True,
+        n_threads: int = 0,
+    ) -> None:
+        """
+        Write 2D polylines packed in one buffer (polyline k is coords[offsets[k]:offsets[k+1]]) to a polyline collection file, optionally with precomputed ranges, dirs and rtree.
+        """
+
+class PolylineIndex:
+    @typing.overload
+    def __init__(
+        self,
+        coords: numpy.ndarray[numpy.float64[m, 3]],
+        offsets: numpy.ndarray[numpy.int32[m, 1]],
+        *,
+        is_wgs84: bool = False,
+        chunk_size: int = 16,
+    ) -> None:
+        """
+        Index polylines packed in one buffer (polyline k is coords[offsets[k]:offsets[k+1]], copied).
+        """
+    @typing.overload
+    def __init__(
+        self,
+        coords: numpy.ndarray[numpy.float64[m, 2], numpy.ndarray.flags.c_contiguous],
+        offsets: numpy.ndarray[numpy.int32[m, 1]],
+        *,
+        is_wgs84: bool = False,
+        chunk_size: int = 16,
+    ) -> None:
+        """
+        Index 2D polylines packed in one buffer (polyline k is coords[offsets[k]:offsets[k+1]], copied).
+        """
+    @typing.overload
+    def __init__(
+        self, rulers: list[PolylineRuler], *, chunk_size: int = 16
+    ) -> None:
+        """
+        Index polylines of rulers (copied), all cartesian or all wgs84.
+        """
+    def __len__(self) -> int:
+        """
+        Get the number of polylines.
+        """
+    def coords(self) -> numpy.ndarray[numpy.float64[m, 3]]:
+        """
+        Get coordinates of all polylines.
+        """
+    def is_wgs84(self) -> bool:
+        """
+        Check if the coordinate system is WGS84.
+        """
+    def nearest(
+        self,
+        point: numpy.ndarray[numpy.float64[3, 1]],
+        *,
+        k: int = 1,
+        max_distance: float | None = None,
+    ) -> tuple[
+        numpy.ndarray[numpy.int32[m, 1]],
+        numpy.ndarray[numpy.float64[m, 3]],
+        numpy.ndarray[numpy.int32[m, 1]],
+        numpy.ndarray[numpy.float64[m, 1]],
+        numpy.ndarray[numpy.float64[m, 1]],
+    ]:
+        """
+        Get the k nearest polylines to a point (within max_distance if given), as (polyline ids, nearest points, segment indexes, t, distances), sorted by distance.
+        """
+    def nearest_batch(
+        self,
+        points: numpy.ndarray[numpy.float64[m, 3]],
+        *,
+        k: int = 1,
+        max_distance: float | None = None,
+        n_threads: int = 0,
+    ) -> tuple[
+        numpy.ndarray[numpy.int32[m, 1]],
+        numpy.ndarray[numpy.int32[m, 1]],
+        numpy.ndarray[numpy.float64[m, 3]],
+        numpy.ndarray[numpy.int32[m, 1]],
+        numpy.ndarray[numpy.float64[m, 1]],
+        numpy.ndarray[numpy.float64[m, 1]],
+    ]:
+        """
+        nearest() for every point, as (offsets, polyline ids, nearest points, segment indexes, t, distances), hits of point i are rows [offsets[i], offsets[i+1]).
+        """
+    def offsets(self) -> numpy.ndarray[numpy.int32[m, 1]]:
+        """
+        Get offsets of polylines.
+        """
+    def polyline(self, index: int) -> numpy.ndarray[numpy.float64[m, 3]]:
+        """
+        Get coordinates of a polyline.
+        """
+    def size(self) -> int:
+        """
+        Get the number of polylines.
+        """
+    def within(
+        self, point: numpy.ndarray[numpy.float64[3, 1]], radius: float
+    ) -> tuple[
+        numpy.ndarray[numpy.int32[m, 1]],
+        numpy.ndarray[numpy.float64[m, 3]],
+        numpy.ndarray[numpy.int32[m, 1]],
+        numpy.ndarray[numpy.float64[m, 1]],
+        numpy.ndarray[numpy.float64[m, 1]],
+    ]:
+        """
+        Get all polylines within radius of a point, as (polyline ids, nearest points, segment indexes, t, distances), sorted by distance.
+        """
+    def within_batch(
+        self,
+        points: numpy.ndarray[numpy.float64[m, 3]],
+        radius: float,
+        *,
+        n_threads: int = 0,
+    ) -> tuple[
+        numpy.ndarray[numpy.int32[m, 1]],
+        numpy.ndarray[numpy.int32[m, 1]],
+        numpy.ndarray[numpy.float64[m, 3]],
+        numpy.ndarray[numpy.int32[m, 1]],
+        numpy.ndarray[numpy.float64[m, 1]],
+        numpy.ndarray[numpy.float64[m, 1]],
+    ]:
+        """
+        within() for every point, as (offsets, polyline ids, nearest points, segment indexes, t, distances), hits of point i are rows [offsets[i], offsets[i+1]).
+        """
+
 class PolylineRuler:
     @staticmethod
     def _along(
@@ -365,6 +1165,7 @@ class PolylineRuler:
         Interpolate between two points.
         """
     @staticmethod
+    @typing.overload
     def _lineDistance(
         line: numpy.ndarray[numpy.float64[m, 3], numpy.ndarray.flags.c_contiguous],
         *,
@@ -374,6 +1175,14 @@ class PolylineRuler:
         Calculate the total length of a polyline.
         """
     @staticmethod
+    @typing.overload
+    def _lineDistance(
+        line: numpy.ndarray[numpy.float32[m, 3], numpy.ndarray.flags.c_contiguous],
+    ) -> float:
+        """
+        Calculate the total length of a float32 (cartesian) polyline.
+        """
+    @staticmethod
     def _lineSlice(
         start: numpy.ndarray[numpy.float64[3, 1]],
         stop: numpy.ndarray[numpy.float64[3, 1]],
@@ -417,6 +1226,7 @@ class PolylineRuler:
         Calculate the distance from a point to a line segment.
         """
     @staticmethod
+    @typing.overload
     def _ranges(
         polyline: numpy.ndarray[numpy.float64[m, 3], numpy.ndarray.flags.c_contiguous],
         *,
@@ -426,7 +1236,24 @@ class PolylineRuler:
         Calculate cumulative distances along a polyline.
         """
     @staticmethod
-    def _squareDistance(
+    @typing.overload
+    def _ranges(
+        polyline: numpy.ndarray[numpy.float32[m, 3], numpy.ndarray.flags.c_contiguous],
+    ) -> numpy.ndarray[numpy.float64[m, 1]]:
+        """
+        Calculate cumulative distances along a float32 (cartesian) polyline.
+        """
+    @staticmethod
+    def _rtree(
+        polyline: numpy.ndarray[numpy.float64[m, 3], numpy.ndarray.flags.c_contiguous],
+        *,
+        is_wgs84: bool = False,
+    ) -> PackedRTree:
+        """
+        Build a packed R-tree over segments of a polyline.
+        """
+    @staticmethod
+    def _squareDistance(
         a: numpy.ndarray[numpy.float64[3, 1]],
         b: numpy.ndarray[numpy.float64[3, 1]],
         *,
@@ -435,6 +1262,13 @@ class PolylineRuler:
         """
         Calculate the squared distance between two points.
         """
+    @staticmethod
+    def view(
+        coords: numpy.ndarray, *, is_wgs84: bool = False
+    ) -> PolylineRuler:
+        """
+        Create a PolylineRuler viewing (not copying) a C-contiguous float64 Nx3 numpy array, which is kept alive by the ruler and should not be modified afterwards (Nx2 arrays are copied).
+        """
     def N(self) -> int:
         """
         Get the number of points in the polyline.
@@ -448,11 +1282,19 @@ class PolylineRuler:
         """
         Initialize a PolylineRuler with coordinates and coordinate system.
         """
+    @typing.overload
     def along(self, dist: float) -> numpy.ndarray[numpy.float64[3, 1]]:
         """
         Find a point at a specified distance along the polyline.
         """
     @typing.overload
+    def along(
+        self, dists: numpy.ndarray[numpy.float64[m, 1]]
+    ) -> numpy.ndarray[numpy.float64[m, 3]]:
+        """
+        Find points at multiple distances along the polyline.
+        """
+    @typing.overload
     def arrow(
         self, *, index: int, t: float
     ) -> tuple[numpy.ndarray[numpy.float64[3, 1]], numpy.ndarray[numpy.float64[3, 1]]]:
@@ -494,6 +1336,13 @@ class PolylineRuler:
         Get the point on the polyline at a specific cumulative distance.
         """
     @typing.overload
+    def at(
+        self, *, ranges: numpy.ndarray[numpy.float64[m, 1]]
+    ) -> numpy.ndarray[numpy.float64[m, 3]]:
+        """
+        Get points on the polyline at multiple cumulative distances.
+        """
+    @typing.overload
     def at(self, *, segment_index: int) -> numpy.ndarray[numpy.float64[3, 1]]:
         """
         Get the point on the polyline at a specific segment index.
@@ -515,6 +1364,13 @@ class PolylineRuler:
         """
         Get the direction vector at a specific cumulative distance.
         """
+    @typing.overload
+    def dir(
+        self, *, ranges: numpy.ndarray[numpy.float64[m, 1]], smooth_joint: bool = True
+    ) -> numpy.ndarray[numpy.float64[m, 3]]:
+        """
+        Get direction vectors at multiple cumulative distances.
+        """
     def dirs(self) -> numpy.ndarray[numpy.float64[m, 3]]:
         """
         Get direction vectors for each segment of the polyline.
@@ -523,6 +1379,22 @@ class PolylineRuler:
         """
         Get the extended cumulative distance along the polyline.
         """
+    def freeze(self, *, with_rtree: bool = False) -> PolylineRuler:
+        """
+        Eagerly compute all caches so the ruler can be shared across threads without locking.
+        """
+    def has_rtree(self) -> bool:
+        """
+        Check if the segment index has been built.
+        """
+    def has_self_intersections(self, *, n_threads: int = 0) -> bool:
+        """
+        Check if the polyline crosses itself (stops at the first crossing).
+        """
+    def is_frozen(self) -> bool:
+        """
+        Check if all caches have been computed.
+        """
     def is_wgs84(self) -> bool:
         """
         Check if the coordinate system is WGS84.
@@ -553,18 +1425,74 @@ class PolylineRuler:
         """
         Extract a portion of the polyline between two distances along it.
         """
+    def lineSliceAlongView(
+        self, start: float, stop: float
+    ) -> tuple[numpy.ndarray[numpy.float64[3, 1]], int, int, numpy.ndarray[numpy.float64[3, 1]]]:
+        """
+        Locate a portion of the polyline between two distances along it without copying (head, begin, end, tail), the slice is head, polyline()[begin:end], tail.
+        """
+    @typing.overload
     def local_frame(
         self, range: float, *, smooth_joint: bool = True
     ) -> numpy.ndarray[numpy.float64[4, 4]]:
         """
         Get the local coordinate frame at a specific cumulative distance.
         """
+    @typing.overload
+    def local_frame(
+        self, ranges: numpy.ndarray[numpy.float64[m, 1]], *, smooth_joint: bool = True
+    ) -> numpy.ndarray[numpy.float64]:
+        """
+        Get local coordinate frames (as a Nx4x4 array) at multiple cumulative distances.
+        """
+    def nearest_segments(
+        self,
+        P: numpy.ndarray[numpy.float64[3, 1]],
+        *,
+        k: int = 1,
+        max_distance: float | None = None,
+    ) -> tuple[
+        numpy.ndarray[numpy.float64[m, 3]],
+        numpy.ndarray[numpy.int32[m, 1]],
+        numpy.ndarray[numpy.float64[m, 1]],
+        numpy.ndarray[numpy.float64[m, 1]],
+    ]:
+        """
+        Find k nearest segments (points, segment indexes, t, distances), sorted by distance.
+        """
+    @typing.overload
     def pointOnLine(
         self, P: numpy.ndarray[numpy.float64[3, 1]]
     ) -> tuple[numpy.ndarray[numpy.float64[3, 1]], int, float]:
         """
         Find the closest point on the polyline to a given point.
         """
+    @typing.overload
+    def pointOnLine(
+        self,
+        P: numpy.ndarray[numpy.float64[3, 1]],
+        hint: int,
+        *,
+        window: int = 8,
+        max_distance: float | None = None,
+    ) -> tuple[numpy.ndarray[numpy.float64[3, 1]], int, float]:
+        """
+        Find the closest point on the polyline around a hint segment index (e.g. the previous match), falls back to a global search if the match is on the window border or beyond max_distance.
+        """
+    def pointsOnLine(
+        self,
+        points: numpy.ndarray[numpy.float64[m, 3], numpy.ndarray.flags.c_contiguous],
+        *,
+        n_threads: int = 0,
+    ) -> tuple[
+        numpy.ndarray[numpy.float64[m, 3]],
+        numpy.ndarray[numpy.int32[m, 1]],
+        numpy.ndarray[numpy.float64[m, 1]],
+        numpy.ndarray[numpy.float64[m, 1]],
+    ]:
+        """
+        Find the closest points on the polyline to a batch of points (points, segment indexes, t, distances), multithreaded.
+        """
     def polyline(self) -> numpy.ndarray[numpy.float64[m, 3]]:
         """
         Get the polyline coordinates.
@@ -583,12 +1511,29 @@ class PolylineRuler:
         """
         Get cumulative distances along the polyline.
         """
+    def rtree(self) -> PackedRTree:
+        """
+        Get (build if needed) the segment index of the polyline, speeds up pointOnLine/lineSlice/nearest_segments.
+        """
+    @typing.overload
     def scanline(
         self, range: float, *, min: float, max: float, smooth_joint: bool = True
     ) -> tuple[numpy.ndarray[numpy.float64[3, 1]], numpy.ndarray[numpy.float64[3, 1]]]:
         """
         Generate a scanline perpendicular to the polyline at a specific cumulative distance.
         """
+    @typing.overload
+    def scanline(
+        self,
+        ranges: numpy.ndarray[numpy.float64[m, 1]],
+        *,
+        min: float,
+        max: float,
+        smooth_joint: bool = True,
+    ) -> tuple[numpy.ndarray[numpy.float64[m, 3]], numpy.ndarray[numpy.float64[m, 3]]]:
+        """
+        Generate scanlines perpendicular to the polyline at multiple cumulative distances.
+        """
     def segment_index(self, range: float) -> int:
         """
         Get the segment index for a given cumulative distance.
@@ -597,33 +1542,541 @@ class PolylineRuler:
         """
         Get the segment index and interpolation factor for a given cumulative distance.
         """
+    def segment_indexes_t(
+        self, ranges: numpy.ndarray[numpy.float64[m, 1]]
+    ) -> tuple[numpy.ndarray[numpy.int32[m, 1]], numpy.ndarray[numpy.float64[m, 1]]]:
+        """
+        Get segment indexes and interpolation factors for multiple cumulative distances.
+        """
+    def self_intersections(
+        self, *, n_threads: int = 0
+    ) -> tuple[
+        numpy.ndarray[numpy.float64[m, 3]],
+        numpy.ndarray[numpy.int32[m, 2]],
+        numpy.ndarray[numpy.float64[m, 2]],
+    ]:
+        """
+        Find all crossings of the polyline with itself (points, [seg_i, seg_j], [t_i, t_j]).
+        """
+    def snap_trajectory(
+        self,
+        points: numpy.ndarray[numpy.float64[m, 3]],
+        *,
+        window: int = 8,
+        max_distance: float | None = None,
+        hint: int = -1,
+    ) -> tuple[
+        numpy.ndarray[numpy.float64[m, 3]],
+        numpy.ndarray[numpy.int32[m, 1]],
+        numpy.ndarray[numpy.float64[m, 1]],
+        numpy.ndarray[numpy.float64[m, 1]],
+    ]:
+        """
+        Snap an ordered trajectory onto the polyline, each point is searched around the match of the previous one (points, segment indexes, t, distances).
+        """
 
-@typing.overload
-def douglas_simplify(
-    coords: numpy.ndarray[numpy.float64[m, 3]],
-    epsilon: float,
-    *,
-    is_wgs84: bool = False,
-    recursive: bool = True,
-) -> numpy.ndarray[numpy.float64[m, 3]]:
-    """
-    Simplify a polyline using the Douglas-Peucker algorithm.
-    """
+class PolylineRuler2D:
+    def N(self) -> int:
+        """
+        Get the number of points in the polyline.
+        """
+    def __init__(self, coords: numpy.ndarray[numpy.float64[m, 2], numpy.ndarray.flags.c_contiguous]) -> None:
+        """
+        Initialize the ruler with polyline coordinates.
+        """
+    @typing.overload
+    def along(self, dist: float) -> numpy.ndarray[numpy.float64[2, 1]]:
+        """
+        Get the point at a distance along the polyline (clamped).
+        """
+    @typing.overload
+    def along(self, dists: numpy.ndarray[numpy.float64[m, 1]]) -> numpy.ndarray[numpy.float64[m, 2]]:
+        """
+        Get points at distances along the polyline (clamped).
+        """
+    def at(self, *, segment_index: int, t: float) -> numpy.ndarray[numpy.float64[2, 1]]:
+        """
+        Get the point at a segment index and interpolation factor.
+        """
+    @staticmethod
+    def dim() -> int:
+        """
+        Get the dimension of points.
+        """
+    def has_rtree(self) -> bool:
+        """
+        Check if the segment index has been built.
+        """
+    @staticmethod
+    def is_wgs84() -> bool:
+        """
+        Check if the coordinate system is WGS84.
+        """
+    def k(self) -> numpy.ndarray[numpy.float64[2, 1]]:
+        """
+        Get the scale factors (ones for cartesian).
+        """
+    def length(self) -> float:
+        """
+        Get the total length of the polyline.
+        """
+    def pointOnLine(self, P: numpy.ndarray[numpy.float64[2, 1]]) -> tuple[numpy.ndarray[numpy.float64[2, 1]], int, float]:
+        """
+        Find the closest point on the polyline to a given point.
+        """
+    def pointsOnLine(
+        self,
+        points: numpy.ndarray[numpy.float64[m, 2], numpy.ndarray.flags.c_contiguous],
+        *,
+        n_threads: int = 0,
+    ) -> tuple[
+        numpy.ndarray[numpy.float64[m, 2]],
+        numpy.ndarray[numpy.int32[m, 1]],
+        numpy.ndarray[numpy.float64[m, 1]],
+        numpy.ndarray[numpy.float64[m, 1]],
+    ]:
+        """
+        Find the closest points on the polyline to a batch of points (points, segment indexes, t, distances), multithreaded.
+        """
+    def polyline(self) -> numpy.ndarray[numpy.float64[m, 2]]:
+        """
+        Get the polyline coordinates.
+        """
+    @typing.overload
+    def range(self, segment_index: int) -> float:
+        """
+        Get the cumulative distance at a specific segment index.
+        """
+    @typing.overload
+    def range(self, *, segment_index: int, t: float) -> float:
+        """
+        Get the cumulative distance at a specific segment index and interpolation factor.
+        """
+    def ranges(self) -> numpy.ndarray[numpy.float64[m, 1]]:
+        """
+        Get cumulative distances along the polyline.
+        """
+    def rtree(self) -> PackedRTree:
+        """
+        Get (build if needed) the segment index of the polyline, speeds up pointOnLine.
+        """
+    def ruler(self) -> PolylineRuler:
+        """
+        Get a PolylineRuler copy (Nx3) for the rest of the api.
+        """
+    def segment_index_t(self, range: float) -> tuple[int, float]:
+        """
+        Get the segment index and interpolation factor for a given cumulative distance.
+        """
 
-@typing.overload
-def douglas_simplify(
-    coords: numpy.ndarray[numpy.float64[m, 2], numpy.ndarray.flags.c_contiguous],
-    epsilon: float,
-    *,
-    is_wgs84: bool = False,
-    recursive: bool = True,
-) -> numpy.ndarray[numpy.float64[m, 2]]:
-    """
-    Simplify a 2D polyline using the Douglas-Peucker algorithm.
-    """
+class PolylineRuler2DWGS84:
+    def N(self) -> int:
+        """
+        Get the number of points in the polyline.
+        """
+    def __init__(self, coords: numpy.ndarray[numpy.float64[m, 2], numpy.ndarray.flags.c_contiguous]) -> None:
+        """
+        Initialize the ruler with polyline coordinates.
+        """
+    @typing.overload
+    def along(self, dist: float) -> numpy.ndarray[numpy.float64[2, 1]]:
+        """
+        Get the point at a distance along the polyline (clamped).
+        """
+    @typing.overload
+    def along(self, dists: numpy.ndarray[numpy.float64[m, 1]]) -> numpy.ndarray[numpy.float64[m, 2]]:
+        """
+        Get points at distances along the polyline (clamped).
+        """
+    def at(self, *, segment_index: int, t: float) -> numpy.ndarray[numpy.float64[2, 1]]:
+        """
+        Get the point at a segment index and interpolation factor.
+        """
+    @staticmethod
+    def dim() -> int:
+        """
+        Get the dimension of points.
+        """
+    def has_rtree(self) -> bool:
+        """
+        Check if the segment index has been built.
+        """
+    @staticmethod
+    def is_wgs84() -> bool:
+        """
+        Check if the coordinate system is WGS84.
+        """
+    def k(self) -> numpy.ndarray[numpy.float64[2, 1]]:
+        """
+        Get the scale factors (ones for cartesian).
+        """
+    def length(self) -> float:
+        """
+        Get the total length of the polyline.
+        """
+    def pointOnLine(self, P: numpy.ndarray[numpy.float64[2, 1]]) -> tuple[numpy.ndarray[numpy.float64[2, 1]], int, float]:
+        """
+        Find the closest point on the polyline to a given point.
+        """
+    def pointsOnLine(
+        self,
+        points: numpy.ndarray[numpy.float64[m, 2], numpy.ndarray.flags.c_contiguous],
+        *,
+        n_threads: int = 0,
+    ) -> tuple[
+        numpy.ndarray[numpy.float64[m, 2]],
+        numpy.ndarray[numpy.int32[m, 1]],
+        numpy.ndarray[numpy.float64[m, 1]],
+        numpy.ndarray[numpy.float64[m, 1]],
+    ]:
+        """
+        Find the closest points on the polyline to a batch of points (points, segment indexes, t, distances), multithreaded.
+        """
+    def polyline(self) -> numpy.ndarray[numpy.float64[m, 2]]:
+        """
+        Get the polyline coordinates.
+        """
+    @typing.overload
+    def range(self, segment_index: int) -> float:
+        """
+        Get the cumulative distance at a specific segment index.
+        """
+    @typing.overload
+    def range(self, *, segment_index: int, t: float) -> float:
+        """
+        Get the cumulative distance at a specific segment index and interpolation factor.
+        """
+    def ranges(self) -> numpy.ndarray[numpy.float64[m, 1]]:
+        """
+        Get cumulative distances along the polyline.
+        """
+    def rtree(self) -> PackedRTree:
+        """
+        Get (build if needed) the segment index of the polyline, speeds up pointOnLine.
+        """
+    def ruler(self) -> PolylineRuler:
+        """
+        Get a PolylineRuler copy (Nx3) for the rest of the api.
+        """
+    def segment_index_t(self, range: float) -> tuple[int, float]:
+        """
+        Get the segment index and interpolation factor for a given cumulative distance.
+        """
 
-@typing.overload
-def douglas_simplify_indexes(
+class PolylineRuler3D:
+    def N(self) -> int:
+        """
+        Get the number of points in the polyline.
+        """
+    def __init__(self, coords: numpy.ndarray[numpy.float64[m, 3], numpy.ndarray.flags.c_contiguous]) -> None:
+        """
+        Initialize the ruler with polyline coordinates.
+        """
+    @typing.overload
+    def along(self, dist: float) -> numpy.ndarray[numpy.float64[3, 1]]:
+        """
+        Get the point at a distance along the polyline (clamped).
+        """
+    @typing.overload
+    def along(self, dists: numpy.ndarray[numpy.float64[m, 1]]) -> numpy.ndarray[numpy.float64[m, 3]]:
+        """
+        Get points at distances along the polyline (clamped).
+        """
+    def at(self, *, segment_index: int, t: float) -> numpy.ndarray[numpy.float64[3, 1]]:
+        """
+        Get the point at a segment index and interpolation factor.
+        """
+    @staticmethod
+    def dim() -> int:
+        """
+        Get the dimension of points.
+        """
+    def has_rtree(self) -> bool:
+        """
+        Check if the segment index has been built.
+        """
+    @staticmethod
+    def is_wgs84() -> bool:
+        """
+        Check if the coordinate system is WGS84.
+        """
+    def k(self) -> numpy.ndarray[numpy.float64[3, 1]]:
+        """
+        Get the scale factors (ones for cartesian).
+        """
+    def length(self) -> float:
+        """
+        Get the total length of the polyline.
+        """
+    def pointOnLine(self, P: numpy.ndarray[numpy.float64[3, 1]]) -> tuple[numpy.ndarray[numpy.float64[3, 1]], int, float]:
+        """
+        Find the closest point on the polyline to a given point.
+        """
+    def pointsOnLine(
+        self,
+        points: numpy.ndarray[numpy.float64[m, 3], numpy.ndarray.flags.c_contiguous],
+        *,
+        n_threads: int = 0,
+    ) -> tuple[
+        numpy.ndarray[numpy.float64[m, 3]],
+        numpy.ndarray[numpy.int32[m, 1]],
+        numpy.ndarray[numpy.float64[m, 1]],
+        numpy.ndarray[numpy.float64[m, 1]],
+    ]:
+        """
+        Find the closest points on the polyline to a batch of points (points, segment indexes, t, distances), multithreaded.
+        """
+    def polyline(self) -> numpy.ndarray[numpy.float64[m, 3]]:
+        """
+        Get the polyline coordinates.
+        """
+    @typing.overload
+    def range(self, segment_index: int) -> float:
+        """
+        Get the cumulative distance at a specific segment index.
+        """
+    @typing.overload
+    def range(self, *, segment_index: int, t: float) -> float:
+        """
+        Get the cumulative distance at a specific segment index and interpolation factor.
+        """
+    def ranges(self) -> numpy.ndarray[numpy.float64[m, 1]]:
+        """
+        Get cumulative distances along the polyline.
+        """
+    def rtree(self) -> PackedRTree:
+        """
+        Get (build if needed) the segment index of the polyline, speeds up pointOnLine.
+        """
+    def ruler(self) -> PolylineRuler:
+        """
+        Get a PolylineRuler copy (Nx3) for the rest of the api.
+        """
+    def segment_index_t(self, range: float) -> tuple[int, float]:
+        """
+        Get the segment index and interpolation factor for a given cumulative distance.
+        """
+
+class PolylineRuler3DWGS84:
+    def N(self) -> int:
+        """
+        Get the number of points in the polyline.
+        """
+    def __init__(self, coords: numpy.ndarray[numpy.float64[m, 3], numpy.ndarray.flags.c_contiguous]) -> None:
+        """
+        Initialize the ruler with polyline coordinates.
+        """
+    @typing.overload
+    def along(self, dist: float) -> numpy.ndarray[numpy.float64[3, 1]]:
+        """
+        Get the point at a distance along the polyline (clamped).
+        """
+    @typing.overload
+    def along(self, dists: numpy.ndarray[numpy.float64[m, 1]]) -> numpy.ndarray[numpy.float64[m, 3]]:
+        """
+        Get points at distances along the polyline (clamped).
+        """
+    def at(self, *, segment_index: int, t: float) -> numpy.ndarray[numpy.float64[3, 1]]:
+        """
+        Get the point at a segment index and interpolation factor.
+        """
+    @staticmethod
+    def dim() -> int:
+        """
+        Get the dimension of points.
+        """
+    def has_rtree(self) -> bool:
+        """
+        Check if the segment index has been built.
+        """
+    @staticmethod
+    def is_wgs84() -> bool:
+        """
+        Check if the coordinate system is WGS84.
+        """
+    def k(self) -> numpy.ndarray[numpy.float64[3, 1]]:
+        """
+        Get the scale factors (ones for cartesian).
+        """
+    def length(self) -> float:
+        """
+        Get the total length of the polyline.
+        """
+    def pointOnLine(self, P: numpy.ndarray[numpy.float64[3, 1]]) -> tuple[numpy.ndarray[numpy.float64[3, 1]], int, float]:
+        """
+        Find the closest point on the polyline to a given point.
+        """
+    def pointsOnLine(
+        self,
+        points: numpy.ndarray[numpy.float64[m, 3], numpy.ndarray.flags.c_contiguous],
+        *,
+        n_threads: int = 0,
+    ) -> tuple[
+        numpy.ndarray[numpy.float64[m, 3]],
+        numpy.ndarray[numpy.int32[m, 1]],
+        numpy.ndarray[numpy.float64[m, 1]],
+        numpy.ndarray[numpy.float64[m, 1]],
+    ]:
+        """
+        Find the closest points on the polyline to a batch of points (points, segment indexes, t, distances), multithreaded.
+        """
+    def polyline(self) -> numpy.ndarray[numpy.float64[m, 3]]:
+        """
+        Get the polyline coordinates.
+        """
+    @typing.overload
+    def range(self, segment_index: int) -> float:
+        """
+        Get the cumulative distance at a specific segment index.
+        """
+    @typing.overload
+    def range(self, *, segment_index: int, t: float) -> float:
+        """
+        Get the cumulative distance at a specific segment index and interpolation factor.
+        """
+    def ranges(self) -> numpy.ndarray[numpy.float64[m, 1]]:
+        """
+        Get cumulative distances along the polyline.
+        """
+    def rtree(self) -> PackedRTree:
+        """
+        Get (build if needed) the segment index of the polyline, speeds up pointOnLine.
+        """
+    def ruler(self) -> PolylineRuler:
+        """
+        Get a PolylineRuler copy (Nx3) for the rest of the api.
+        """
+    def segment_index_t(self, range: float) -> tuple[int, float]:
+        """
+        Get the segment index and interpolation factor for a given cumulative distance.
+        """
+
+class StreamingSimplifier:
+    def __init__(self, epsilon: float, *, is_wgs84: bool = False, max_window: int = 256) -> None:
+        """
+        Initialize a streaming (opening window) simplifier, points within epsilon of the simplified polyline are dropped.
+        """
+    def epsilon(self) -> float:
+        """
+        Get the epsilon.
+        """
+    def flush(self) -> numpy.ndarray[numpy.float64[m, 3]]:
+        """
+        Get the last point (if not returned yet), the next push starts a new polyline.
+        """
+    def is_wgs84(self) -> bool:
+        """
+        Check if the coordinate system is WGS84.
+        """
+    def max_window(self) -> int:
+        """
+        Get the max number of points in a window.
+        """
+    def num_buffered(self) -> int:
+        """
+        Get the number of points after the last kept one.
+        """
+    def num_pushed(self) -> int:
+        """
+        Get the number of points pushed since the last flush.
+        """
+    def push(self, point: numpy.ndarray[numpy.float64[3, 1]]) -> numpy.ndarray[numpy.float64[m, 3]]:
+        """
+        Push a point, returns the kept point that became final (0 or 1 row).
+        """
+    def push_points(
+        self, points: numpy.ndarray[numpy.float64[m, 3], numpy.ndarray.flags.c_contiguous]
+    ) -> numpy.ndarray[numpy.float64[m, 3]]:
+        """
+        Push points, returns kept points that became final.
+        """
+
+@typing.overload
+def clip_polylines_to_tiles(
+    coords: numpy.ndarray[numpy.float64[m, 3]],
+    offsets: numpy.ndarray[numpy.int32[m, 1]],
+    zoom: int,
+    *,
+    buffer: float = 0.0,
+    epsilon: float | None = None,
+    n_threads: int = 0,
+) -> tuple[
+    numpy.ndarray[numpy.float64[m, 3]],
+    numpy.ndarray[numpy.int32[m, 1]],
+    numpy.ndarray[numpy.int32[m, 2]],
+    numpy.ndarray[numpy.int32[m, 1]],
+    numpy.ndarray[numpy.int32[m, 1]],
+    numpy.ndarray[numpy.float64[m, 1]],
+]:
+    """
+    Cut wgs84 polylines packed in one buffer (polyline k is coords[offsets[k]:offsets[k+1]]) into tiles of a zoom level, returns [coords, offsets, tiles, ids, segs, ts] of the parts.
+    """
+
+@typing.overload
+def clip_polylines_to_tiles(
+    coords: numpy.ndarray[numpy.float64[m, 2], numpy.ndarray.flags.c_contiguous],
+    offsets: numpy.ndarray[numpy.int32[m, 1]],
+    zoom: int,
+    *,
+    buffer: float = 0.0,
+    epsilon: float | None = None,
+    n_threads: int = 0,
+) -> tuple[
+    numpy.ndarray[numpy.float64[m, 3]],
+    numpy.ndarray[numpy.int32[m, 1]],
+    numpy.ndarray[numpy.int32[m, 2]],
+    numpy.ndarray[numpy.int32[m, 1]],
+    numpy.ndarray[numpy.int32[m, 1]],
+    numpy.ndarray[numpy.float64[m, 1]],
+]:
+    """
+    Cut 2D wgs84 polylines packed in one buffer into tiles of a zoom level, returns [coords (Nx3), offsets, tiles, ids, segs, ts] of the parts.
+    """
+
+def decode_polyline(
+    encoded: str, precision: int = 5, *, z_precision: int | None = None
+) -> numpy.ndarray[numpy.float64[m, 3]]:
+    """
+    Decode a polyline from the encoded polyline format (Nx3).
+    """
+
+def decode_polylines(
+    encoded: list[str],
+    precision: int = 5,
+    *,
+    z_precision: int | None = None,
+    n_threads: int = 0,
+) -> tuple[numpy.ndarray[numpy.float64[m, 3]], numpy.ndarray[numpy.int32[m, 1]]]:
+    """
+    Decode polylines into one buffer, returns [coords, offsets] (polyline k is coords[offsets[k]:offsets[k+1]]).
+    """
+
+@typing.overload
+def douglas_simplify(
+    coords: numpy.ndarray[numpy.float64[m, 3]],
+    epsilon: float,
+    *,
+    is_wgs84: bool = False,
+    recursive: bool = True,
+) -> numpy.ndarray[numpy.float64[m, 3]]:
+    """
+    Simplify a polyline using the Douglas-Peucker algorithm.
+    """
+
+@typing.overload
+def douglas_simplify(
+    coords: numpy.ndarray[numpy.float64[m, 2], numpy.ndarray.flags.c_contiguous],
+    epsilon: float,
+    *,
+    is_wgs84: bool = False,
+    recursive: bool = True,
+) -> numpy.ndarray[numpy.float64[m, 2]]:
+    """
+    Simplify a 2D polyline using the Douglas-Peucker algorithm.
+    """
+
+@typing.overload
+def douglas_simplify_indexes(
     coords: numpy.ndarray[numpy.float64[m, 3]],
     epsilon: float,
     *,
@@ -670,6 +2123,252 @@ def douglas_simplify_mask(
     Get a mask of points to keep when simplifying a 2D polyline using the Douglas-Peucker algorithm.
     """
 
+@typing.overload
+def douglas_simplify_masks(
+    coords: numpy.ndarray[numpy.float64[m, 3]],
+    offsets: numpy.ndarray[numpy.int32[m, 1]],
+    epsilon: float,
+    *,
+    is_wgs84: bool = False,
+    n_threads: int = 0,
+) -> numpy.ndarray[numpy.int32[m, 1]]:
+    """
+    Get concatenated Douglas-Peucker masks of many polylines packed in one buffer, polyline k is coords[offsets[k]:offsets[k+1]].
+    """
+
+@typing.overload
+def douglas_simplify_masks(
+    coords: numpy.ndarray[numpy.float64[m, 2], numpy.ndarray.flags.c_contiguous],
+    offsets: numpy.ndarray[numpy.int32[m, 1]],
+    epsilon: float,
+    *,
+    is_wgs84: bool = False,
+    n_threads: int = 0,
+) -> numpy.ndarray[numpy.int32[m, 1]]:
+    """
+    Get concatenated Douglas-Peucker masks of many 2D polylines packed in one buffer, polyline k is coords[offsets[k]:offsets[k+1]].
+    """
+
+@typing.overload
+def encode_polyline(
+    coords: numpy.ndarray[numpy.float64[m, 3]],
+    precision: int = 5,
+    *,
+    z_precision: int | None = None,
+) -> str:
+    """
+    Encode a polyline in the encoded polyline format ([y, x] or [y, x, z] with z_precision).
+    """
+
+@typing.overload
+def encode_polyline(
+    coords: numpy.ndarray[numpy.float64[m, 2], numpy.ndarray.flags.c_contiguous],
+    precision: int = 5,
+) -> str:
+    """
+    Encode a 2D polyline in the encoded polyline format.
+    """
+
+def encode_polylines(
+    coords: numpy.ndarray[numpy.float64[m, 3], numpy.ndarray.flags.c_contiguous],
+    offsets: numpy.ndarray[numpy.int32[m, 1]],
+    precision: int = 5,
+    *,
+    z_precision: int | None = None,
+    n_threads: int = 0,
+) -> list[str]:
+    """
+    Encode polylines packed in one buffer, polyline k is coords[offsets[k]:offsets[k+1]].
+    """
+
+@typing.overload
+def frechet_distance(
+    A: numpy.ndarray[numpy.float64[m, 3]],
+    B: numpy.ndarray[numpy.float64[m, 3]],
+    *,
+    is_wgs84: bool = False,
+    discrete: bool = True,
+) -> float:
+    """
+    Discrete (or continuous) Frechet distance between two polylines.
+    """
+
+@typing.overload
+def frechet_distance(
+    A: numpy.ndarray[numpy.float64[m, 2], numpy.ndarray.flags.c_contiguous],
+    B: numpy.ndarray[numpy.float64[m, 2], numpy.ndarray.flags.c_contiguous],
+    *,
+    is_wgs84: bool = False,
+    discrete: bool = True,
+) -> float:
+    """
+    Discrete (or continuous) Frechet distance between two 2D polylines.
+    """
+
+@typing.overload
+def frechet_distances(
+    query: numpy.ndarray[numpy.float64[m, 3]],
+    coords: numpy.ndarray[numpy.float64[m, 3]],
+    offsets: numpy.ndarray[numpy.int32[m, 1]],
+    *,
+    is_wgs84: bool = False,
+    discrete: bool = True,
+    max_distance: float | None = None,
+    n_threads: int = 0,
+) -> numpy.ndarray[numpy.float64[m, 1]]:
+    """
+    Frechet distances from query to polylines packed in one buffer, polyline k is coords[offsets[k]:offsets[k+1]]. Candidates farther than max_distance (and empty ones) get inf.
+    """
+
+@typing.overload
+def frechet_distances(
+    query: numpy.ndarray[numpy.float64[m, 2], numpy.ndarray.flags.c_contiguous],
+    coords: numpy.ndarray[numpy.float64[m, 2], numpy.ndarray.flags.c_contiguous],
+    offsets: numpy.ndarray[numpy.int32[m, 1]],
+    *,
+    is_wgs84: bool = False,
+    discrete: bool = True,
+    max_distance: float | None = None,
+    n_threads: int = 0,
+) -> numpy.ndarray[numpy.float64[m, 1]]:
+    """
+    Frechet distances from 2D query to 2D polylines packed in one buffer, polyline k is coords[offsets[k]:offsets[k+1]]. Candidates farther than max_distance (and empty ones) get inf.
+    """
+
+@typing.overload
+def frechet_within(
+    A: numpy.ndarray[numpy.float64[m, 3]],
+    B: numpy.ndarray[numpy.float64[m, 3]],
+    epsilon: float,
+    *,
+    is_wgs84: bool = False,
+    discrete: bool = True,
+) -> bool:
+    """
+    Check if the discrete (or continuous) Frechet distance between two polylines is within epsilon (with early exit).
+    """
+
+@typing.overload
+def frechet_within(
+    A: numpy.ndarray[numpy.float64[m, 2], numpy.ndarray.flags.c_contiguous],
+    B: numpy.ndarray[numpy.float64[m, 2], numpy.ndarray.flags.c_contiguous],
+    epsilon: float,
+    *,
+    is_wgs84: bool = False,
+    discrete: bool = True,
+) -> bool:
+    """
+    Check if the discrete (or continuous) Frechet distance between two 2D polylines is within epsilon (with early exit).
+    """
+
+@typing.overload
+def hausdorff_distance(
+    A: numpy.ndarray[numpy.float64[m, 3]],
+    B: numpy.ndarray[numpy.float64[m, 3]],
+    *,
+    is_wgs84: bool = False,
+) -> float:
+    """
+    Hausdorff distance between two polylines (vertices of either to segments of the other).
+    """
+
+@typing.overload
+def hausdorff_distance(
+    A: numpy.ndarray[numpy.float64[m, 2], numpy.ndarray.flags.c_contiguous],
+    B: numpy.ndarray[numpy.float64[m, 2], numpy.ndarray.flags.c_contiguous],
+    *,
+    is_wgs84: bool = False,
+) -> float:
+    """
+    Hausdorff distance between two 2D polylines (vertices of either to segments of the other).
+    """
+
+@typing.overload
+def hausdorff_distances(
+    query: numpy.ndarray[numpy.float64[m, 3]],
+    coords: numpy.ndarray[numpy.float64[m, 3]],
+    offsets: numpy.ndarray[numpy.int32[m, 1]],
+    *,
+    is_wgs84: bool = False,
+    max_distance: float | None = None,
+    n_threads: int = 0,
+) -> numpy.ndarray[numpy.float64[m, 1]]:
+    """
+    Hausdorff distances from query to polylines packed in one buffer, polyline k is coords[offsets[k]:offsets[k+1]]. Candidates farther than max_distance (and empty ones) get inf.
+    """
+
+@typing.overload
+def hausdorff_distances(
+    query: numpy.ndarray[numpy.float64[m, 2], numpy.ndarray.flags.c_contiguous],
+    coords: numpy.ndarray[numpy.float64[m, 2], numpy.ndarray.flags.c_contiguous],
+    offsets: numpy.ndarray[numpy.int32[m, 1]],
+    *,
+    is_wgs84: bool = False,
+    max_distance: float | None = None,
+    n_threads: int = 0,
+) -> numpy.ndarray[numpy.float64[m, 1]]:
+    """
+    Hausdorff distances from 2D query to 2D polylines packed in one buffer, polyline k is coords[offsets[k]:offsets[k+1]]. Candidates farther than max_distance (and empty ones) get inf.
+    """
+
+@typing.overload
+def hausdorff_within(
+    A: numpy.ndarray[numpy.float64[m, 3]],
+    B: numpy.ndarray[numpy.float64[m, 3]],
+    epsilon: float,
+    *,
+    is_wgs84: bool = False,
+) -> bool:
+    """
+    Check if the Hausdorff distance between two polylines is within epsilon (with early exit).
+    """
+
+@typing.overload
+def hausdorff_within(
+    A: numpy.ndarray[numpy.float64[m, 2], numpy.ndarray.flags.c_contiguous],
+    B: numpy.ndarray[numpy.float64[m, 2], numpy.ndarray.flags.c_contiguous],
+    epsilon: float,
+    *,
+    is_wgs84: bool = False,
+) -> bool:
+    """
+    Check if the Hausdorff distance between two 2D polylines is within epsilon (with early exit).
+    """
+
+@typing.overload
+def intersect_polylines(
+    coords: numpy.ndarray[numpy.float64[m, 3]],
+    offsets: numpy.ndarray[numpy.int32[m, 1]],
+    *,
+    include_self: bool = False,
+    n_threads: int = 0,
+) -> tuple[
+    numpy.ndarray[numpy.float64[m, 3]],
+    numpy.ndarray[numpy.int32[m, 2]],
+    numpy.ndarray[numpy.int32[m, 2]],
+    numpy.ndarray[numpy.float64[m, 2]],
+]:
+    """
+    Find all crossings between polylines packed in one buffer, polyline k is coords[offsets[k]:offsets[k+1]]. Returns (points, polyline ids, segment indexes, [t, s]).
+    """
+
+@typing.overload
+def intersect_polylines(
+    coords: numpy.ndarray[numpy.float64[m, 2], numpy.ndarray.flags.c_contiguous],
+    offsets: numpy.ndarray[numpy.int32[m, 1]],
+    *,
+    include_self: bool = False,
+    n_threads: int = 0,
+) -> tuple[
+    numpy.ndarray[numpy.float64[m, 2]],
+    numpy.ndarray[numpy.int32[m, 2]],
+    numpy.ndarray[numpy.int32[m, 2]],
+    numpy.ndarray[numpy.float64[m, 2]],
+]:
+    """
+    Find all crossings between 2D polylines packed in one buffer, polyline k is coords[offsets[k]:offsets[k+1]]. Returns (points, polyline ids, segment indexes, [t, s]).
+    """
+
 @typing.overload
 def intersect_segments(
     a1: numpy.ndarray[numpy.float64[2, 1]],
@@ -702,3 +2401,75 @@ def snap_onto_2d(
     """
 
 __version__: str = "0.0.6"
+
+@typing.overload
+def visvalingam_simplify(
+    coords: numpy.ndarray[numpy.float64[m, 3]],
+    min_area: float,
+    *,
+    is_wgs84: bool = False,
+    preserve_topology: bool = False,
+) -> numpy.ndarray[numpy.float64[m, 3]]:
+    """
+    Simplify a polyline using the Visvalingam-Whyatt algorithm.
+    """
+
+@typing.overload
+def visvalingam_simplify(
+    coords: numpy.ndarray[numpy.float64[m, 2], numpy.ndarray.flags.c_contiguous],
+    min_area: float,
+    *,
+    is_wgs84: bool = False,
+    preserve_topology: bool = False,
+) -> numpy.ndarray[numpy.float64[m, 2]]:
+    """
+    Simplify a 2D polyline using the Visvalingam-Whyatt algorithm.
+    """
+
+@typing.overload
+def visvalingam_simplify_indexes(
+    coords: numpy.ndarray[numpy.float64[m, 3]],
+    min_area: float,
+    *,
+    is_wgs84: bool = False,
+    preserve_topology: bool = False,
+) -> numpy.ndarray[numpy.int32[m, 1]]:
+    """
+    Get indexes of points to keep when simplifying a polyline using the Visvalingam-Whyatt algorithm.
+    """
+
+@typing.overload
+def visvalingam_simplify_indexes(
+    coords: numpy.ndarray[numpy.float64[m, 2], numpy.ndarray.flags.c_contiguous],
+    min_area: float,
+    *,
+    is_wgs84: bool = False,
+    preserve_topology: bool = False,
+) -> numpy.ndarray[numpy.int32[m, 1]]:
+    """
+    Get indexes of points to keep when simplifying a 2D polyline using the Visvalingam-Whyatt algorithm.
+    """
+
+@typing.overload
+def visvalingam_simplify_mask(
+    coords: numpy.ndarray[numpy.float64[m, 3]],
+    min_area: float,
+    *,
+    is_wgs84: bool = False,
+    preserve_topology: bool = False,
+) -> numpy.ndarray[numpy.int32[m, 1]]:
+    """
+    Get a mask of points to keep when simplifying a polyline using the Visvalingam-Whyatt algorithm.
+    """
+
+@typing.overload
+def visvalingam_simplify_mask(
+    coords: numpy.ndarray[numpy.float64[m, 2], numpy.ndarray.flags.c_contiguous],
+    min_area: float,
+    *,
+    is_wgs84: bool = False,
+    preserve_topology: bool = False,
+) -> numpy.ndarray[numpy.int32[m, 1]]:
+    """
+    Get a mask of points to keep when simplifying a 2D polyline using the Visvalingam-Whyatt algorithm.
+    """
@@ -9,11 +9,17 @@ __all__ = [
     "apply_transform_inplace",
     "cheap_ruler_k",
     "ecef2enu",
+    "ecef2enu_inplace",
     "ecef2lla",
+    "ecef2lla_inplace",
     "enu2ecef",
+    "enu2ecef_inplace",
     "enu2lla",
+    "enu2lla_inplace",
     "lla2ecef",
+    "lla2ecef_inplace",
     "lla2enu",
+    "lla2enu_inplace",
 ]
 
 def R_ecef_enu(lon: float, lat: float) -> numpy.ndarray[numpy.float64[3, 3]]:
@@ -74,6 +80,21 @@ def ecef2enu(
     Convert ECEF to ENU (East, North, Up) coordinates.
     """
 
+def ecef2enu_inplace(
+    coords: numpy.ndarray[
+        numpy.float64[m, 3],
+        numpy.ndarray.flags.writeable,
+        numpy.ndarray.flags.c_contiguous,
+    ],
+    *,
+    anchor_lla: numpy.ndarray[numpy.float64[3, 1]] | None = None,
+    cheap_ruler: bool = False,
+    n_threads: int = 0,
+) -> None:
+    """
+    Convert ECEF coordinates to ENU in-place (vectorized, multithreaded).
+    """
+
 @typing.overload
 def ecef2lla(x: float, y: float, z: float) -> numpy.ndarray[numpy.float64[3, 1]]:
     """
@@ -88,6 +109,19 @@ def ecef2lla(
     Convert multiple ECEF coordinates to LLA (Longitude, Latitude, Altitude).
     """
 
+def ecef2lla_inplace(
+    coords: numpy.ndarray[
+        numpy.float64[m, 3],
+        numpy.ndarray.flags.writeable,
+        numpy.ndarray.flags.c_contiguous,
+    ],
+    *,
+    n_threads: int = 0,
+) -> None:
+    """
+    Convert ECEF coordinates to LLA in-place (vectorized, multithreaded).
+    """
+
 def enu2ecef(
     enus: numpy.ndarray[numpy.float64[m, 3], numpy.ndarray.flags.c_contiguous],
     *,
@@ -98,6 +132,21 @@ def enu2ecef(
     Convert ENU (East, North, Up) to ECEF coordinates.
     """
 
+def enu2ecef_inplace(
+    coords: numpy.ndarray[
+        numpy.float64[m, 3],
+        numpy.ndarray.flags.writeable,
+        numpy.ndarray.flags.c_contiguous,
+    ],
+    *,
+    anchor_lla: numpy.ndarray[numpy.float64[3, 1]],
+    cheap_ruler: bool = False,
+    n_threads: int = 0,
+) -> None:
+    """
+    Convert ENU coordinates to ECEF in-place (vectorized, multithreaded).
+    """
+
 def enu2lla(
     enus: numpy.ndarray[numpy.float64[m, 3], numpy.ndarray.flags.c_contiguous],
     *,
@@ -108,6 +157,21 @@ def enu2lla(
     Convert ENU (East, North, Up) to LLA (Longitude, Latitude, Altitude) coordinates.
     """
 
+def enu2lla_inplace(
+    coords: numpy.ndarray[
+        numpy.float64[m, 3],
+        numpy.ndarray.flags.writeable,
+        numpy.ndarray.flags.c_contiguous,
+    ],
+    *,
+    anchor_lla: numpy.ndarray[numpy.float64[3, 1]],
+    cheap_ruler: bool = True,
+    n_threads: int = 0,
+) -> None:
+    """
+    Convert ENU coordinates to LLA in-place (vectorized, multithreaded).
+    """
+
 @typing.overload
 def lla2ecef(lon: float, lat: float, alt: float) -> numpy.ndarray[numpy.float64[3, 1]]:
     """
@@ -122,6 +186,19 @@ def lla2ecef(
     Convert multiple LLA (Longitude, Latitude, Altitude) to ECEF coordinates.
     """
 
+def lla2ecef_inplace(
+    coords: numpy.ndarray[
+        numpy.float64[m, 3],
+        numpy.ndarray.flags.writeable,
+        numpy.ndarray.flags.c_contiguous,
+    ],
+    *,
+    n_threads: int = 0,
+) -> None:
+    """
+    Convert LLA coordinates to ECEF in-place (vectorized, multithreaded).
+    """
+
 def lla2enu(
     llas: numpy.ndarray[numpy.float64[m, 3], numpy.ndarray.flags.c_contiguous],
     *,
@@ -131,3 +208,19 @@ def lla2enu(
     """
     Convert LLA (Longitude, Latitude, Altitude) to ENU (East, North, Up) coordinates.
     """
+
+
+def lla2enu_inplace(
+    coords: numpy.ndarray[
+        numpy.float64[m, 3],
+        numpy.ndarray.flags.writeable,
+        numpy.ndarray.flags.c_contiguous,
+    ],
+    *,
+    anchor_lla: numpy.ndarray[numpy.float64[3, 1]] | None = None,
+    cheap_ruler: bool = True,
+    n_threads: int = 0,
+) -> None:
+    """
+    Convert LLA coordinates to ENU in-place (vectorized, multithreaded).
+    """
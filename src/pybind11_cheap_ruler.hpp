@@ -83,6 +83,37 @@ CUBAO_INLINE void bind_cheap_ruler(py::module &m)
              "bearing.")
         .def("offset", &CheapRuler::offset, "origin"_a, "dx"_a, "dy"_a,
              "dz"_a = 0.0, "Calculate a new point given origin and offsets.")
+        //
+        .def("deltas", &CheapRuler::deltas, "a"_a, "b"_a, py::kw_only(),
+             "n_threads"_a = 0, py::call_guard<py::gil_scoped_release>(),
+             "Batch delta, pairwise on rows (a single row is broadcast).")
+        .def("squareDistances", &CheapRuler::squareDistances, "a"_a, "b"_a,
+             py::kw_only(), "n_threads"_a = 0,
+             py::call_guard<py::gil_scoped_release>(),
+             "Batch squareDistance, pairwise on rows (a single row is "
+             "broadcast).")
+        .def("distances", &CheapRuler::distances, "a"_a, "b"_a,
+             py::kw_only(), "n_threads"_a = 0,
+             py::call_guard<py::gil_scoped_release>(),
+             "Batch distance, pairwise on rows (a single row is broadcast).")
+        .def("distanceMatrix", &CheapRuler::distanceMatrix, "a"_a, "b"_a,
+             py::kw_only(), "n_threads"_a = 0,
+             py::call_guard<py::gil_scoped_release>(),
+             "Distances between every row of a and every row of b.")
+        .def("bearings", &CheapRuler::bearings, "a"_a, "b"_a, py::kw_only(),
+             "n_threads"_a = 0, py::call_guard<py::gil_scoped_release>(),
+             "Batch bearing, pairwise on rows (a single row is broadcast).")
+        .def("destinations", &CheapRuler::destinations, "origins"_a,
+             "dists"_a, "bearings"_a, py::kw_only(), "n_threads"_a = 0,
+             py::call_guard<py::gil_scoped_release>(),
+             "Batch destination, pairwise on rows (a single origin is "
+             "broadcast).")
+        .def("offsets", &CheapRuler::offsets, "origins"_a, "dxyzs"_a,
+             py::kw_only(), "n_threads"_a = 0,
+             py::call_guard<py::gil_scoped_release>(),
+             "Batch offset by rows of [dx, dy, dz], pairwise on rows (a "
+             "single row is broadcast).")
+        //
         .def("lineDistance", &CheapRuler::lineDistance, "points"_a,
              "Calculate the total distance of a line (an array of points).")
         .def("area", &CheapRuler::area, "ring"_a,
@@ -102,11 +133,33 @@ CUBAO_INLINE void bind_cheap_ruler(py::module &m)
              "along the line.")
         .def("bufferPoint", &CheapRuler::bufferPoint, "p"_a, "buffer"_a,
              "Create a bounding box around a point.")
+        .def("bufferPoints", &CheapRuler::bufferPoints, "points"_a,
+             "buffer"_a,
+             "Create bounding boxes around points, returns (mins, maxs).")
         .def("bufferBBox", &CheapRuler::bufferBBox, "bbox"_a, "buffer"_a,
              "Create a bounding box around another bounding box.")
-        .def_static("_insideBBox", &CheapRuler::insideBBox, "p"_a, "bbox"_a,
-                    py::kw_only(), "cheak_z"_a = false,
+        .def_static("_insideBBox",
+                    py::overload_cast<const CheapRuler::point &,
+                                      const CheapRuler::box &, bool>(
+                        &CheapRuler::insideBBox),
+                    "p"_a, "bbox"_a, py::kw_only(), "check_z"_a = false,
                     "Check if a point is inside a bounding box.")
+        .def_static(
+            "_insideBBox",
+            py::overload_cast<const Eigen::Ref<const RowVectors> &,
+                              const CheapRuler::box &, bool, int>(
+                &CheapRuler::insideBBox),
+            "points"_a, "bbox"_a, py::kw_only(), "check_z"_a = false,
+            "n_threads"_a = 0, py::call_guard<py::gil_scoped_release>(),
+            "Check which points are inside a bounding box (1/0 per point).")
+        // misspelled keyword of old releases, kept as an alias
+        .def_static("_insideBBox",
+                    py::overload_cast<const CheapRuler::point &,
+                                      const CheapRuler::box &, bool>(
+                        &CheapRuler::insideBBox),
+                    "p"_a, "bbox"_a, py::kw_only(), "cheak_z"_a,
+                    "Same as _insideBBox(p, bbox, check_z=...) (deprecated "
+                    "spelling).")
         .def_static("_interpolate", &CheapRuler::interpolate, "a"_a, "b"_a,
                     "t"_a, "Interpolate linearly between two points.")
         .def_static("_longDiff", &CheapRuler::longDiff, "a"_a, "b"_a,
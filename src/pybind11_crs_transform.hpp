@@ -75,6 +75,40 @@ CUBAO_INLINE void bind_crs_transform(py::module &m)
         .def("apply_transform_inplace", &apply_transform_inplace, "T"_a,
              "coords"_a, py::kw_only(), "batch_size"_a = 1000,
              "Apply transformation matrix to coordinates in-place.")
+        // in-place bulk versions
+        .def("ecef2lla_inplace", &ecef2lla_inplace, "coords"_a,
+             py::kw_only(), "n_threads"_a = 0,
+             "Convert ECEF coordinates to LLA in-place (vectorized, "
+             "multithreaded).",
+             py::call_guard<py::gil_scoped_release>())
+        .def("lla2ecef_inplace", &lla2ecef_inplace, "coords"_a,
+             py::kw_only(), "n_threads"_a = 0,
+             "Convert LLA coordinates to ECEF in-place (vectorized, "
+             "multithreaded).",
+             py::call_guard<py::gil_scoped_release>())
+        .def("lla2enu_inplace", &lla2enu_inplace, "coords"_a, py::kw_only(),
+             CUBAO_ARGV_DEFAULT_NONE(anchor_lla), "cheap_ruler"_a = true,
+             "n_threads"_a = 0,
+             "Convert LLA coordinates to ENU in-place (vectorized, "
+             "multithreaded).",
+             py::call_guard<py::gil_scoped_release>())
+        .def("enu2lla_inplace", &enu2lla_inplace, "coords"_a, py::kw_only(),
+             "anchor_lla"_a, "cheap_ruler"_a = true, "n_threads"_a = 0,
+             "Convert ENU coordinates to LLA in-place (vectorized, "
+             "multithreaded).",
+             py::call_guard<py::gil_scoped_release>())
+        .def("enu2ecef_inplace", &enu2ecef_inplace, "coords"_a,
+             py::kw_only(), "anchor_lla"_a, "cheap_ruler"_a = false,
+             "n_threads"_a = 0,
+             "Convert ENU coordinates to ECEF in-place (vectorized, "
+             "multithreaded).",
+             py::call_guard<py::gil_scoped_release>())
+        .def("ecef2enu_inplace", &ecef2enu_inplace, "coords"_a,
+             py::kw_only(), CUBAO_ARGV_DEFAULT_NONE(anchor_lla),
+             "cheap_ruler"_a = false, "n_threads"_a = 0,
+             "Convert ECEF coordinates to ENU in-place (vectorized, "
+             "multithreaded).",
+             py::call_guard<py::gil_scoped_release>())
         //
         .def("cheap_ruler_k", &cheap_ruler_k, "latitude"_a,
              "Get the cheap ruler's unit conversion factor for a given "
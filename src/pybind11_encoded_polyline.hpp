@@ -0,0 +1,104 @@
+// should sync
+// -
+// https://github.com/cubao/polyline-ruler/blob/master/src/pybind11_encoded_polyline.hpp
+
+#pragma once
+
+#include <pybind11/eigen.h>
+#include <pybind11/iostream.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include <pybind11/stl_bind.h>
+
+#include "cubao_inline.hpp"
+#include "encoded_polyline.hpp"
+
+namespace cubao
+{
+namespace py = pybind11;
+using namespace pybind11::literals;
+using rvp = py::return_value_policy;
+
+CUBAO_INLINE void bind_encoded_polyline(py::module &m)
+{
+    m.def("encode_polyline",
+          py::overload_cast<const RowVectors &, int, std::optional<int>>(
+              &encode_polyline),
+          "coords"_a, "precision"_a = 5, py::kw_only(),
+          CUBAO_ARGV_DEFAULT_NONE(z_precision),
+          "Encode a polyline in the encoded polyline format ([y, x] or [y, "
+          "x, z] with z_precision).")
+        .def("encode_polyline",
+             py::overload_cast<const Eigen::Ref<const RowVectorsNx2> &, int>(
+                 &encode_polyline),
+             "coords"_a, "precision"_a = 5,
+             "Encode a 2D polyline in the encoded polyline format.")
+        .def("decode_polyline", &decode_polyline, "encoded"_a,
+             "precision"_a = 5, py::kw_only(),
+             CUBAO_ARGV_DEFAULT_NONE(z_precision),
+             "Decode a polyline from the encoded polyline format (Nx3).")
+        .def("encode_polylines", &encode_polylines, "coords"_a, "offsets"_a,
+             "precision"_a = 5, py::kw_only(),
+             CUBAO_ARGV_DEFAULT_NONE(z_precision), "n_threads"_a = 0,
+             py::call_guard<py::gil_scoped_release>(),
+             "Encode polylines packed in one buffer, polyline k is "
+             "coords[offsets[k]:offsets[k+1]].")
+        .def("decode_polylines", &decode_polylines, "encoded"_a,
+             "precision"_a = 5, py::kw_only(),
+             CUBAO_ARGV_DEFAULT_NONE(z_precision), "n_threads"_a = 0,
+             py::call_guard<py::gil_scoped_release>(),
+             "Decode polylines into one buffer, returns [coords, offsets] "
+             "(polyline k is coords[offsets[k]:offsets[k+1]]).")
+        //
+        ;
+
+    py::class_<EncodedPolyline>(m, "EncodedPolyline", py::module_local()) //
+        .def(py::init<const Eigen::Ref<const RowVectors> &, bool, int,
+                      std::optional<int>>(),
+             "coords"_a, py::kw_only(), "is_wgs84"_a = false,
+             "precision"_a = 5, CUBAO_ARGV_DEFAULT_NONE(z_precision),
+             "Encode a polyline, its ruler is decoded on first use.")
+        .def(py::init<std::string, bool, int, std::optional<int>>(),
+             "encoded"_a, py::kw_only(), "is_wgs84"_a = false,
+             "precision"_a = 5, CUBAO_ARGV_DEFAULT_NONE(z_precision),
+             "Wrap an encoded polyline, its ruler is decoded on first use.")
+        //
+        .def("encoded", &EncodedPolyline::encoded,
+             "Get the encoded polyline.")
+        .def("N", &EncodedPolyline::N,
+             "Get the number of points in the polyline.")
+        .def("is_wgs84", &EncodedPolyline::is_wgs84,
+             "Check if the coordinate system is WGS84.")
+        .def("precision", &EncodedPolyline::precision,
+             "Get the precision (decimal digits) of x & y.")
+        .def("z_precision", &EncodedPolyline::z_precision,
+             "Get the precision (decimal digits) of z, None for 2D.")
+        .def("decode", &EncodedPolyline::decode,
+             "Decode the polyline (Nx3).")
+        .def("is_decoded", &EncodedPolyline::is_decoded,
+             "Check if the ruler has been decoded.")
+        .def(
+            "ruler",
+            [](const EncodedPolyline &self) {
+                // the python ruler holds its own reference to the decoded
+                // ruler, so it stays valid after release()
+                auto ruler = self.shared_ruler();
+                py::object obj = py::cast(ruler.get(), rvp::reference);
+                py::detail::keep_alive_impl(
+                    obj, py::capsule(
+                             new std::shared_ptr<const PolylineRuler>(ruler),
+                             [](void *ptr) {
+                                 delete static_cast<
+                                     std::shared_ptr<const PolylineRuler> *>(
+                                     ptr);
+                             }));
+                return obj;
+            },
+            "Get the ruler (decoded on first use).")
+        .def("release", &EncodedPolyline::release,
+             "Drop the decoded ruler (decoded again on next use), rulers "
+             "already returned stay valid.")
+        //
+        ;
+}
+} // namespace cubao
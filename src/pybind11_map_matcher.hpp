@@ -0,0 +1,88 @@
+// should sync
+// -
+// https://github.com/cubao/polyline-ruler/blob/master/src/pybind11_map_matcher.hpp
+
+#pragma once
+
+#include <pybind11/eigen.h>
+#include <pybind11/iostream.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include <pybind11/stl_bind.h>
+
+#include "cubao_inline.hpp"
+#include "map_matcher.hpp"
+
+namespace cubao
+{
+namespace py = pybind11;
+using namespace pybind11::literals;
+using rvp = py::return_value_policy;
+
+CUBAO_INLINE void bind_map_matcher(py::module &m)
+{
+    py::class_<MapMatcher>(m, "MapMatcher", py::module_local()) //
+        .def(py::init([](const PolylineIndex &index, double sigma,
+                         double beta, double search_radius,
+                         int max_candidates, int beam_width,
+                         double connect_tolerance, double max_route_factor) {
+                 // not owned, the python index is kept alive instead
+                 return std::make_unique<MapMatcher>(
+                     std::shared_ptr<const PolylineIndex>(
+                         &index, [](const PolylineIndex *) {}),
+                     sigma, beta, search_radius, max_candidates, beam_width,
+                     connect_tolerance, max_route_factor);
+             }),
+             "index"_a, py::kw_only(), "sigma"_a = 5.0, "beta"_a = 10.0,
+             "search_radius"_a = 50.0, "max_candidates"_a = 8,
+             "beam_width"_a = 32, "connect_tolerance"_a = 1.0,
+             "max_route_factor"_a = 4.0, py::keep_alive<1, 2>(),
+             py::call_guard<py::gil_scoped_release>(),
+             "HMM map matcher over polylines of an index (shared, not "
+             "copied).")
+        .def(py::init<const std::vector<PolylineRuler> &, double, double,
+                      double, int, int, double, double>(),
+             "rulers"_a, py::kw_only(), "sigma"_a = 5.0, "beta"_a = 10.0,
+             "search_radius"_a = 50.0, "max_candidates"_a = 8,
+             "beam_width"_a = 32, "connect_tolerance"_a = 1.0,
+             "max_route_factor"_a = 4.0,
+             "HMM map matcher over polylines of rulers (copied).")
+        //
+        .def("index", &MapMatcher::index, rvp::reference_internal,
+             "Get the polyline index.")
+        .def("sigma", &MapMatcher::sigma,
+             "Get the std deviation of gps noise (emission).")
+        .def("beta", &MapMatcher::beta,
+             "Get the scale of route/straight distance differences "
+             "(transition).")
+        .def("search_radius", &MapMatcher::search_radius,
+             "Get the radius of candidate search.")
+        .def("max_candidates", &MapMatcher::max_candidates,
+             "Get the max number of candidates per point.")
+        .def("beam_width", &MapMatcher::beam_width,
+             "Get the max number of states kept per point.")
+        .def("connect_tolerance", &MapMatcher::connect_tolerance,
+             "Get the max distance between connected polyline ends.")
+        .def("max_route_factor", &MapMatcher::max_route_factor,
+             "Get the max route length, relative to the straight distance "
+             "(plus 2 * search_radius), between consecutive points.")
+        .def("ranges", &MapMatcher::ranges, "index"_a,
+             rvp::reference_internal,
+             "Get cumulative distances along a polyline.")
+        .def("links", &MapMatcher::links, "index"_a, "at_end"_a,
+             "Get ends of other polylines connected to the first (or last) "
+             "point of a polyline, as [polyline, at_end] rows.")
+        //
+        .def("match", &MapMatcher::match, "points"_a,
+             py::call_guard<py::gil_scoped_release>(),
+             "Match a trace, as (polyline ids, matched points, segment "
+             "indexes, t, ranges), one row per point (unmatched: id -1).")
+        .def("match_batch", &MapMatcher::match_batch, "points"_a, "offsets"_a,
+             py::kw_only(), "n_threads"_a = 0,
+             py::call_guard<py::gil_scoped_release>(),
+             "match() on traces packed in one buffer (trace k is "
+             "points[offsets[k]:offsets[k+1]]), one row per point.")
+        //
+        ;
+}
+} // namespace cubao
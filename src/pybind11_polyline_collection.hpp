@@ -0,0 +1,91 @@
+// should sync
+// -
+// https://github.com/cubao/polyline-ruler/blob/master/src/pybind11_polyline_collection.hpp
+
+#pragma once
+
+#include <pybind11/eigen.h>
+#include <pybind11/iostream.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include <pybind11/stl_bind.h>
+
+#include "cubao_inline.hpp"
+#include "polyline_collection.hpp"
+
+namespace cubao
+{
+namespace py = pybind11;
+using namespace pybind11::literals;
+using rvp = py::return_value_policy;
+
+CUBAO_INLINE void bind_polyline_collection(py::module &m)
+{
+    py::class_<PolylineCollection>(m, "PolylineCollection",
+                                   py::module_local()) //
+        .def(py::init<const std::string &>(), "path"_a,
+             "Open (mmap) a polyline collection file.")
+        .def_static(
+            "write",
+            py::overload_cast<const std::string &, const RowVectors &,
+                              const Eigen::Ref<const Eigen::VectorXi> &, bool,
+                              bool, bool, bool, int>(
+                &PolylineCollection::write),
+            "path"_a, "coords"_a, "offsets"_a, py::kw_only(),
+            "is_wgs84"_a = false, "with_ranges"_a = true,
+            "with_dirs"_a = true, "with_rtree"_a = true, "n_threads"_a = 0,
+            py::call_guard<py::gil_scoped_release>(),
+            "Write polylines packed in one buffer (polyline k is "
+            "coords[offsets[k]:offsets[k+1]]) to a polyline collection "
+            "file, optionally with precomputed ranges, dirs and rtree.")
+        .def_static(
+            "write",
+            py::overload_cast<const std::string &,
+                              const Eigen::Ref<const RowVectorsNx2> &,
+                              const Eigen::Ref<const Eigen::VectorXi> &, bool,
+                              bool, bool, bool, int>(
+                &PolylineCollection::write),
+            "path"_a, "coords"_a, "offsets"_a, py::kw_only(),
+            "is_wgs84"_a = false, "with_ranges"_a = true,
+            "with_dirs"_a = true, "with_rtree"_a = true, "n_threads"_a = 0,
+            py::call_guard<py::gil_scoped_release>(),
+            "Write 2D polylines packed in one buffer (polyline k is "
+            "coords[offsets[k]:offsets[k+1]]) to a polyline collection "
+            "file, optionally with precomputed ranges, dirs and rtree.")
+        //
+        .def("size", &PolylineCollection::size,
+             "Get the number of polylines.")
+        .def("__len__", &PolylineCollection::size,
+             "Get the number of polylines.")
+        .def("num_points", &PolylineCollection::num_points,
+             "Get the number of points of all polylines.")
+        .def("is_wgs84", &PolylineCollection::is_wgs84,
+             "Check if the coordinate system is WGS84.")
+        .def("has_ranges", &PolylineCollection::has_ranges,
+             "Check if ranges are stored in the file.")
+        .def("has_dirs", &PolylineCollection::has_dirs,
+             "Check if dirs are stored in the file.")
+        .def("has_rtree", &PolylineCollection::has_rtree,
+             "Check if the rtree is stored in the file.")
+        //
+        .def("offsets", &PolylineCollection::offsets, rvp::reference_internal,
+             "Get offsets of polylines (read-only view into the file).")
+        .def("coords", &PolylineCollection::coords, rvp::reference_internal,
+             "Get coordinates of all polylines (read-only view into the "
+             "file).")
+        .def("polyline", &PolylineCollection::polyline, "index"_a,
+             rvp::reference_internal,
+             "Get coordinates of a polyline (read-only view into the file).")
+        .def("ruler", &PolylineCollection::ruler, "index"_a,
+             "Get a PolylineRuler viewing a polyline's coords (no copy), "
+             "ranges/dirs are copied from the file into its caches.")
+        .def("rtree", &PolylineCollection::rtree, rvp::reference_internal,
+             "Get the packed R-tree over bounding boxes of polylines.")
+        .def("search", &PolylineCollection::search, "min"_a, "max"_a,
+             py::call_guard<py::gil_scoped_release>(),
+             "Get indexes of polylines whose bounding boxes overlap "
+             "[min, max].")
+        //
+        ;
+}
+} // namespace cubao
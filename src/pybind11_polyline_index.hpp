@@ -0,0 +1,79 @@
+// should sync
+// -
+// https://github.com/cubao/polyline-ruler/blob/master/src/pybind11_polyline_index.hpp
+
+#pragma once
+
+#include <pybind11/eigen.h>
+#include <pybind11/iostream.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include <pybind11/stl_bind.h>
+
+#include "cubao_inline.hpp"
+#include "polyline_index.hpp"
+
+namespace cubao
+{
+namespace py = pybind11;
+using namespace pybind11::literals;
+using rvp = py::return_value_policy;
+
+CUBAO_INLINE void bind_polyline_index(py::module &m)
+{
+    py::class_<PolylineIndex>(m, "PolylineIndex", py::module_local()) //
+        .def(py::init<const RowVectors &,
+                      const Eigen::Ref<const Eigen::VectorXi> &, bool, int>(),
+             "coords"_a, "offsets"_a, py::kw_only(), "is_wgs84"_a = false,
+             "chunk_size"_a = 16, py::call_guard<py::gil_scoped_release>(),
+             "Index polylines packed in one buffer (polyline k is "
+             "coords[offsets[k]:offsets[k+1]], copied).")
+        .def(py::init<const Eigen::Ref<const RowVectorsNx2> &,
+                      const Eigen::Ref<const Eigen::VectorXi> &, bool, int>(),
+             "coords"_a, "offsets"_a, py::kw_only(), "is_wgs84"_a = false,
+             "chunk_size"_a = 16, py::call_guard<py::gil_scoped_release>(),
+             "Index 2D polylines packed in one buffer (polyline k is "
+             "coords[offsets[k]:offsets[k+1]], copied).")
+        .def(py::init<const std::vector<PolylineRuler> &, int>(), "rulers"_a,
+             py::kw_only(), "chunk_size"_a = 16,
+             "Index polylines of rulers (copied), all cartesian or all "
+             "wgs84.")
+        //
+        .def("size", &PolylineIndex::size, "Get the number of polylines.")
+        .def("__len__", &PolylineIndex::size, "Get the number of polylines.")
+        .def("is_wgs84", &PolylineIndex::is_wgs84,
+             "Check if the coordinate system is WGS84.")
+        .def("offsets", &PolylineIndex::offsets, rvp::reference_internal,
+             "Get offsets of polylines.")
+        .def("coords", &PolylineIndex::coords, rvp::reference_internal,
+             "Get coordinates of all polylines.")
+        .def("polyline", &PolylineIndex::polyline, "index"_a,
+             rvp::reference_internal, "Get coordinates of a polyline.")
+        //
+        .def("nearest", &PolylineIndex::nearest, "point"_a, py::kw_only(),
+             "k"_a = 1, CUBAO_ARGV_DEFAULT_NONE(max_distance),
+             py::call_guard<py::gil_scoped_release>(),
+             "Get the k nearest polylines to a point (within max_distance "
+             "if given), as (polyline ids, nearest points, segment indexes, "
+             "t, distances), sorted by distance.")
+        .def("within", &PolylineIndex::within, "point"_a, "radius"_a,
+             py::call_guard<py::gil_scoped_release>(),
+             "Get all polylines within radius of a point, as (polyline ids, "
+             "nearest points, segment indexes, t, distances), sorted by "
+             "distance.")
+        .def("nearest_batch", &PolylineIndex::nearest_batch, "points"_a,
+             py::kw_only(), "k"_a = 1, CUBAO_ARGV_DEFAULT_NONE(max_distance),
+             "n_threads"_a = 0, py::call_guard<py::gil_scoped_release>(),
+             "nearest() for every point, as (offsets, polyline ids, nearest "
+             "points, segment indexes, t, distances), hits of point i are "
+             "rows [offsets[i], offsets[i+1]).")
+        .def("within_batch", &PolylineIndex::within_batch, "points"_a,
+             "radius"_a, py::kw_only(), "n_threads"_a = 0,
+             py::call_guard<py::gil_scoped_release>(),
+             "within() for every point, as (offsets, polyline ids, nearest "
+             "points, segment indexes, t, distances), hits of point i are "
+             "rows [offsets[i], offsets[i+1]).")
+        //
+        ;
+}
+} // namespace cubao
@@ -21,6 +21,65 @@ namespace py = pybind11;
 using namespace pybind11::literals;
 using rvp = py::return_value_policy;
 
+// one class per PolylineRulerT specialisation
+template <int Dim, bool IsWGS84>
+inline void bind_polyline_ruler_t(py::module &m, const char *name)
+{
+    using Ruler = PolylineRulerT<Dim, IsWGS84>;
+    py::class_<Ruler>(m, name, py::module_local()) //
+        .def(py::init<const Eigen::Ref<const typename Ruler::Points> &>(),
+             "coords"_a, "Initialize the ruler with polyline coordinates.")
+        //
+        .def_static("dim", &Ruler::dim, "Get the dimension of points.")
+        .def_static("is_wgs84", &Ruler::is_wgs84,
+                    "Check if the coordinate system is WGS84.")
+        .def("N", &Ruler::N, "Get the number of points in the polyline.")
+        .def("polyline", &Ruler::polyline, rvp::reference_internal,
+             "Get the polyline coordinates.")
+        .def("k", &Ruler::k, "Get the scale factors (ones for cartesian).")
+        .def("ranges", &Ruler::ranges, rvp::reference_internal,
+             "Get cumulative distances along the polyline.")
+        .def("range", py::overload_cast<int>(&Ruler::range, py::const_),
+             "segment_index"_a,
+             "Get the cumulative distance at a specific segment index.")
+        .def("range",
+             py::overload_cast<int, double>(&Ruler::range, py::const_),
+             py::kw_only(), "segment_index"_a, "t"_a,
+             "Get the cumulative distance at a specific segment index and "
+             "interpolation factor.")
+        .def("length", &Ruler::length, "Get the total length of the polyline.")
+        .def("segment_index_t", &Ruler::segment_index_t, "range"_a,
+             "Get the segment index and interpolation factor for a given "
+             "cumulative distance.")
+        .def("at", &Ruler::at, py::kw_only(), "segment_index"_a, "t"_a,
+             "Get the point at a segment index and interpolation factor.")
+        .def("along", py::overload_cast<double>(&Ruler::along, py::const_),
+             "dist"_a,
+             "Get the point at a distance along the polyline (clamped).")
+        .def("along",
+             py::overload_cast<const Eigen::Ref<const Eigen::VectorXd> &>(
+                 &Ruler::along, py::const_),
+             "dists"_a,
+             "Get points at distances along the polyline (clamped).")
+        .def("rtree", &Ruler::rtree, rvp::reference_internal,
+             py::call_guard<py::gil_scoped_release>(),
+             "Get (build if needed) the segment index of the polyline, "
+             "speeds up pointOnLine.")
+        .def("has_rtree", &Ruler::has_rtree,
+             "Check if the segment index has been built.")
+        .def("pointOnLine", &Ruler::pointOnLine, "P"_a,
+             py::call_guard<py::gil_scoped_release>(),
+             "Find the closest point on the polyline to a given point.")
+        .def("pointsOnLine", &Ruler::pointsOnLine, "points"_a, py::kw_only(),
+             "n_threads"_a = 0, py::call_guard<py::gil_scoped_release>(),
+             "Find the closest points on the polyline to a batch of points "
+             "(points, segment indexes, t, distances), multithreaded.")
+        .def("ruler", &Ruler::ruler,
+             "Get a PolylineRuler copy (Nx3) for the rest of the api.")
+        //
+        ;
+}
+
 CUBAO_INLINE void bind_polyline_ruler(py::module &m)
 {
     m
@@ -80,11 +139,59 @@ CUBAO_INLINE void bind_polyline_ruler(py::module &m)
         //
         ;
 
+    py::class_<PackedRTree>(m, "PackedRTree", py::module_local()) //
+        .def(py::init<const Eigen::Ref<const PackedRTree::Boxes> &, int>(),
+             "boxes"_a, py::kw_only(), "node_size"_a = 16,
+             "Build a static packed R-tree over Nx6 boxes "
+             "[min_x, min_y, min_z, max_x, max_y, max_z].")
+        .def("size", &PackedRTree::size, "Get the number of items.")
+        .def("node_size", &PackedRTree::node_size, "Get the node size.")
+        .def("boxes", &PackedRTree::boxes, rvp::reference_internal,
+             "Get boxes of all nodes (leaves first, root last).")
+        .def("bounds", &PackedRTree::bounds,
+             "Get the bounding box of all items.")
+        .def("search", &PackedRTree::search, "min"_a, "max"_a,
+             "Get indexes of items whose boxes overlap [min, max].")
+        //
+        ;
+
     py::class_<PolylineRuler>(m, "PolylineRuler", py::module_local()) //
         .def(py::init<const Eigen::Ref<const RowVectors> &, bool>(),  //
              "coords"_a, py::kw_only(), "is_wgs84"_a = false,
              "Initialize a PolylineRuler with coordinates and coordinate "
              "system.")
+        .def_static(
+            "view",
+            [](const py::array &coords, bool is_wgs84) {
+                if (coords.ndim() != 2 ||
+                    (coords.shape(1) != 3 && coords.shape(1) != 2)) {
+                    throw std::invalid_argument(
+                        "coords should be Nx3 (or Nx2) numpy array");
+                }
+                if (!py::isinstance<
+                        py::array_t<double, py::array::c_style>>(coords)) {
+                    throw std::invalid_argument(
+                        "coords should be C-contiguous float64 numpy array");
+                }
+                const double *data = static_cast<const double *>(coords.data());
+                const int N = coords.shape(0);
+                if (coords.shape(1) == 2) {
+                    // no way to view Nx2 as Nx3, fallback to (owning) copy
+                    return PolylineRuler(
+                        to_Nx3(Eigen::Map<const RowVectorsNx2>(data, N, 2)),
+                        is_wgs84);
+                }
+                auto owner = std::shared_ptr<const void>(
+                    new py::object(coords), [](py::object *obj) {
+                        py::gil_scoped_acquire acquire;
+                        delete obj;
+                    });
+                return PolylineRuler(data, N, is_wgs84, std::move(owner));
+            },
+            "coords"_a, py::kw_only(), "is_wgs84"_a = false,
+            "Create a PolylineRuler viewing (not copying) a C-contiguous "
+            "float64 Nx3 numpy array, which is kept alive by the ruler and "
+            "should not be modified afterwards (Nx2 arrays are copied).")
         //
         .def("polyline", &PolylineRuler::polyline, rvp::reference_internal,
              "Get the polyline coordinates.")
@@ -101,6 +208,13 @@ CUBAO_INLINE void bind_polyline_ruler(py::module &m)
                 &PolylineRuler::ranges),
             "polyline"_a, py::kw_only(), "is_wgs84"_a = false,
             "Calculate cumulative distances along a polyline.")
+        .def_static(
+            "_ranges",
+            py::overload_cast<const Eigen::Ref<const RowVectorsNx3f> &>(
+                &PolylineRuler::ranges),
+            "polyline"_a.noconvert(), py::call_guard<py::gil_scoped_release>(),
+            "Calculate cumulative distances along a float32 (cartesian) "
+            "polyline.")
         .def("ranges", py::overload_cast<>(&PolylineRuler::ranges, py::const_),
              rvp::reference_internal,
              "Get cumulative distances along the polyline.")
@@ -118,6 +232,10 @@ CUBAO_INLINE void bind_polyline_ruler(py::module &m)
         .def("segment_index_t", &PolylineRuler::segment_index_t, "range"_a,
              "Get the segment index and interpolation factor for a given "
              "cumulative distance.")
+        .def("segment_indexes_t", &PolylineRuler::segment_indexes_t,
+             "ranges"_a, py::call_guard<py::gil_scoped_release>(),
+             "Get segment indexes and interpolation factors for multiple "
+             "cumulative distances.")
         //
         .def("length", &PolylineRuler::length,
              "Get the total length of the polyline.")
@@ -132,18 +250,52 @@ CUBAO_INLINE void bind_polyline_ruler(py::module &m)
              rvp::reference_internal,
              "Get direction vectors for each segment of the polyline.")
         //
+        .def_static(
+            "_rtree",
+            py::overload_cast<const Eigen::Ref<const RowVectors> &, bool>(
+                &PolylineRuler::rtree),
+            "polyline"_a, py::kw_only(), "is_wgs84"_a = false,
+            "Build a packed R-tree over segments of a polyline.")
+        .def("rtree", py::overload_cast<>(&PolylineRuler::rtree, py::const_),
+             rvp::reference_internal,
+             "Get (build if needed) the segment index of the polyline, "
+             "speeds up pointOnLine/lineSlice/nearest_segments.")
+        .def("has_rtree", &PolylineRuler::has_rtree,
+             "Check if the segment index has been built.")
+        .def("freeze", &PolylineRuler::freeze, py::kw_only(),
+             "with_rtree"_a = false, rvp::reference_internal,
+             py::call_guard<py::gil_scoped_release>(),
+             "Eagerly compute all caches so the ruler can be shared across "
+             "threads without locking.")
+        .def("is_frozen", &PolylineRuler::is_frozen,
+             "Check if all caches have been computed.")
+        //
         .def("dir", py::overload_cast<int>(&PolylineRuler::dir, py::const_),
              py::kw_only(), "point_index"_a,
+             py::call_guard<py::gil_scoped_release>(),
              "Get the direction vector at a specific point index.")
         .def("dir",
              py::overload_cast<double, bool>(&PolylineRuler::dir, py::const_),
              py::kw_only(), "range"_a, "smooth_joint"_a = true,
+             py::call_guard<py::gil_scoped_release>(),
              "Get the direction vector at a specific cumulative distance.")
+        .def("dir",
+             py::overload_cast<const Eigen::Ref<const Eigen::VectorXd> &, bool>(
+                 &PolylineRuler::dir, py::const_),
+             py::kw_only(), "ranges"_a, "smooth_joint"_a = true,
+             py::call_guard<py::gil_scoped_release>(),
+             "Get direction vectors at multiple cumulative distances.")
         .def("extended_along", &PolylineRuler::extended_along, "range"_a,
              "Get the extended cumulative distance along the polyline.")
         .def("at", py::overload_cast<double>(&PolylineRuler::at, py::const_),
              py::kw_only(), "range"_a,
              "Get the point on the polyline at a specific cumulative distance.")
+        .def("at",
+             py::overload_cast<const Eigen::Ref<const Eigen::VectorXd> &>(
+                 &PolylineRuler::at, py::const_),
+             py::kw_only(), "ranges"_a,
+             py::call_guard<py::gil_scoped_release>(),
+             "Get points on the polyline at multiple cumulative distances.")
         .def("at", py::overload_cast<int>(&PolylineRuler::at, py::const_),
              py::kw_only(), "segment_index"_a,
              "Get the point on the polyline at a specific segment index.")
@@ -168,6 +320,7 @@ CUBAO_INLINE void bind_polyline_ruler(py::module &m)
                  &PolylineRuler::arrows, py::const_),
              "ranges"_a, //
              py::kw_only(), "smooth_joint"_a = true,
+             py::call_guard<py::gil_scoped_release>(),
              "Get arrows (points and directions) at multiple cumulative "
              "distances.")
         .def("arrows",
@@ -177,16 +330,51 @@ CUBAO_INLINE void bind_polyline_ruler(py::module &m)
              py::kw_only(), "with_last"_a = true, "smooth_joint"_a = true,
              "Get arrows (points and directions) at regular intervals along "
              "the polyline.")
-        .def("scanline", &PolylineRuler::scanline,
+        .def("scanline",
+             py::overload_cast<double, double, double, bool>(
+                 &PolylineRuler::scanline, py::const_),
              "range"_a, //
              py::kw_only(), "min"_a, "max"_a, "smooth_joint"_a = true,
              "Generate a scanline perpendicular to the polyline at a specific "
              "cumulative distance.")
+        .def("scanline",
+             py::overload_cast<const Eigen::Ref<const Eigen::VectorXd> &,
+                               double, double, bool>(&PolylineRuler::scanline,
+                                                     py::const_),
+             "ranges"_a, //
+             py::kw_only(), "min"_a, "max"_a, "smooth_joint"_a = true,
+             py::call_guard<py::gil_scoped_release>(),
+             "Generate scanlines perpendicular to the polyline at multiple "
+             "cumulative distances.")
         //
         .def(
-            "local_frame", &PolylineRuler::local_frame, "range"_a,
-            py::kw_only(), "smooth_joint"_a = true,
+            "local_frame",
+            py::overload_cast<double, bool>(&PolylineRuler::local_frame,
+                                            py::const_),
+            "range"_a, py::kw_only(), "smooth_joint"_a = true,
             "Get the local coordinate frame at a specific cumulative distance.")
+        .def(
+            "local_frame",
+            [](const PolylineRuler &self,
+               const Eigen::Ref<const Eigen::VectorXd> &ranges,
+               bool smooth_joint) {
+                RowVectorsNx16 *frames = nullptr;
+                {
+                    py::gil_scoped_release release;
+                    frames = new RowVectorsNx16(
+                        self.local_frame(ranges, smooth_joint));
+                }
+                py::capsule owner(frames, [](void *p) {
+                    delete reinterpret_cast<RowVectorsNx16 *>(p);
+                });
+                return py::array_t<double>(
+                    {(py::ssize_t)frames->rows(), (py::ssize_t)4,
+                     (py::ssize_t)4},
+                    frames->data(), owner);
+            },
+            "ranges"_a, py::kw_only(), "smooth_joint"_a = true,
+            "Get local coordinate frames (as a Nx4x4 array) at multiple "
+            "cumulative distances.")
         //
         .def_static(
             "_squareDistance",
@@ -206,6 +394,12 @@ CUBAO_INLINE void bind_polyline_ruler(py::module &m)
                 &PolylineRuler::lineDistance),
             "line"_a, py::kw_only(), "is_wgs84"_a = false,
             "Calculate the total length of a polyline.")
+        .def_static(
+            "_lineDistance",
+            py::overload_cast<const Eigen::Ref<const RowVectorsNx3f> &>(
+                &PolylineRuler::lineDistance),
+            "line"_a.noconvert(), py::call_guard<py::gil_scoped_release>(),
+            "Calculate the total length of a float32 (cartesian) polyline.")
         .def("lineDistance",
              py::overload_cast<>(&PolylineRuler::lineDistance, py::const_),
              "Get the total length of the polyline.")
@@ -216,8 +410,13 @@ CUBAO_INLINE void bind_polyline_ruler(py::module &m)
                     "Find a point at a specified distance along a polyline.")
         .def("along",
              py::overload_cast<double>(&PolylineRuler::along, py::const_),
-             "dist"_a,
+             "dist"_a, py::call_guard<py::gil_scoped_release>(),
              "Find a point at a specified distance along the polyline.")
+        .def("along",
+             py::overload_cast<const Eigen::Ref<const Eigen::VectorXd> &>(
+                 &PolylineRuler::along, py::const_),
+             "dists"_a, py::call_guard<py::gil_scoped_release>(),
+             "Find points at multiple distances along the polyline.")
         //
         .def_static(
             "_pointToSegmentDistance",
@@ -235,7 +434,44 @@ CUBAO_INLINE void bind_polyline_ruler(py::module &m)
         .def("pointOnLine",
              py::overload_cast<const Eigen::Vector3d &>(
                  &PolylineRuler::pointOnLine, py::const_),
-             "P"_a, "Find the closest point on the polyline to a given point.")
+             "P"_a, py::call_guard<py::gil_scoped_release>(),
+             "Find the closest point on the polyline to a given point.")
+        .def("pointOnLine",
+             py::overload_cast<const Eigen::Vector3d &, int, int,
+                               std::optional<double>>(
+                 &PolylineRuler::pointOnLine, py::const_),
+             "P"_a, "hint"_a, py::kw_only(), "window"_a = 8,
+             CUBAO_ARGV_DEFAULT_NONE(max_distance),
+             py::call_guard<py::gil_scoped_release>(),
+             "Find the closest point on the polyline around a hint segment "
+             "index (e.g. the previous match), falls back to a global search "
+             "if the match is on the window border or beyond max_distance.")
+        .def("pointsOnLine", &PolylineRuler::pointsOnLine, "points"_a,
+             py::kw_only(), "n_threads"_a = 0,
+             py::call_guard<py::gil_scoped_release>(),
+             "Find the closest points on the polyline to a batch of points "
+             "(points, segment indexes, t, distances), multithreaded.")
+        .def("nearest_segments", &PolylineRuler::nearest_segments, "P"_a,
+             py::kw_only(), "k"_a = 1, CUBAO_ARGV_DEFAULT_NONE(max_distance),
+             "Find k nearest segments (points, segment indexes, t, "
+             "distances), sorted by distance.")
+        .def("self_intersections", &PolylineRuler::self_intersections,
+             py::kw_only(), "n_threads"_a = 0,
+             py::call_guard<py::gil_scoped_release>(),
+             "Find all crossings of the polyline with itself (points, "
+             "[seg_i, seg_j], [t_i, t_j]).")
+        .def("snap_trajectory", &PolylineRuler::snap_trajectory, "points"_a,
+             py::kw_only(), "window"_a = 8,
+             CUBAO_ARGV_DEFAULT_NONE(max_distance), "hint"_a = -1,
+             py::call_guard<py::gil_scoped_release>(),
+             "Snap an ordered trajectory onto the polyline, each point is "
+             "searched around the match of the previous one (points, segment "
+             "indexes, t, distances).")
+        .def("has_self_intersections",
+             &PolylineRuler::has_self_intersections, py::kw_only(),
+             "n_threads"_a = 0, py::call_guard<py::gil_scoped_release>(),
+             "Check if the polyline crosses itself (stops at the first "
+             "crossing).")
         .def_static(
             "_lineSlice",
             py::overload_cast<const Eigen::Vector3d &, const Eigen::Vector3d &,
@@ -248,7 +484,7 @@ CUBAO_INLINE void bind_polyline_ruler(py::module &m)
             "lineSlice",
             py::overload_cast<const Eigen::Vector3d &, const Eigen::Vector3d &>(
                 &PolylineRuler::lineSlice, py::const_),
-            "start"_a, "stop"_a,
+            "start"_a, "stop"_a, py::call_guard<py::gil_scoped_release>(),
             "Extract a portion of the polyline between two points.")
         //
         .def_static(
@@ -263,14 +499,203 @@ CUBAO_INLINE void bind_polyline_ruler(py::module &m)
             "lineSliceAlong",
             py::overload_cast<double, double>(&PolylineRuler::lineSliceAlong,
                                               py::const_),
-            "start"_a, "stop"_a,
+            "start"_a, "stop"_a, py::call_guard<py::gil_scoped_release>(),
             "Extract a portion of the polyline between two distances along it.")
+        .def("lineSliceAlongView", &PolylineRuler::lineSliceAlongView,
+             "start"_a, "stop"_a,
+             "Locate a portion of the polyline between two distances along "
+             "it without copying (head, begin, end, tail), the slice is head, "
+             "polyline()[begin:end], tail.")
         .def_static("_interpolate", &PolylineRuler::interpolate, //
                     "A"_a, "B"_a, py::kw_only(), "t"_a,
                     "Interpolate between two points.")
         //
         ;
 
+    py::class_<AppendablePolylineRuler>(m, "AppendablePolylineRuler",
+                                        py::module_local()) //
+        .def(py::init<bool>(), py::kw_only(), "is_wgs84"_a = false,
+             "Create an empty AppendablePolylineRuler.")
+        .def(py::init<const Eigen::Ref<const RowVectors> &, bool>(),
+             "coords"_a, py::kw_only(), "is_wgs84"_a = false,
+             "Create an AppendablePolylineRuler from initial coordinates.")
+        //
+        .def("append", &AppendablePolylineRuler::push_back, "point"_a,
+             "Append a single point, updating caches incrementally.")
+        .def("append", &AppendablePolylineRuler::append, "points"_a,
+             "Append points, updating caches incrementally.")
+        .def("trim_head", &AppendablePolylineRuler::trim_head, "n"_a,
+             "Drop the first n points (ranges stay relative to the new "
+             "head).")
+        //
+        .def("N", &AppendablePolylineRuler::N,
+             "Get the number of points in the polyline.")
+        .def("is_wgs84", &AppendablePolylineRuler::is_wgs84,
+             "Check if the coordinate system is WGS84.")
+        .def("k", &AppendablePolylineRuler::k,
+             "Get the scale factor for distance calculations.")
+        .def("polyline", &AppendablePolylineRuler::polyline, rvp::copy,
+             "Get the polyline coordinates.")
+        .def("dirs", &AppendablePolylineRuler::dirs, rvp::copy,
+             "Get direction vectors for each segment of the polyline.")
+        .def("ranges", &AppendablePolylineRuler::ranges,
+             "Get cumulative distances along the polyline.")
+        .def("range",
+             py::overload_cast<int>(&AppendablePolylineRuler::range,
+                                    py::const_),
+             "segment_index"_a,
+             "Get the cumulative distance at a specific segment index.")
+        .def("range",
+             py::overload_cast<int, double>(&AppendablePolylineRuler::range,
+                                            py::const_),
+             py::kw_only(), "segment_index"_a, "t"_a,
+             "Get the cumulative distance at a specific segment index and "
+             "interpolation factor.")
+        .def("length", &AppendablePolylineRuler::length,
+             "Get the total length of the polyline.")
+        //
+        .def("segment_index", &AppendablePolylineRuler::segment_index,
+             "range"_a,
+             "Get the segment index for a given cumulative distance.")
+        .def("segment_index_t", &AppendablePolylineRuler::segment_index_t,
+             "range"_a,
+             "Get the segment index and interpolation factor for a given "
+             "cumulative distance.")
+        .def("at",
+             py::overload_cast<double>(&AppendablePolylineRuler::at,
+                                       py::const_),
+             py::kw_only(), "range"_a,
+             "Get the point at a specific cumulative distance.")
+        .def("at",
+             py::overload_cast<int>(&AppendablePolylineRuler::at, py::const_),
+             py::kw_only(), "segment_index"_a,
+             "Get the point at a specific segment index.")
+        .def("at",
+             py::overload_cast<int, double>(&AppendablePolylineRuler::at,
+                                            py::const_),
+             py::kw_only(), "segment_index"_a, "t"_a,
+             "Get the point at a specific segment index and interpolation "
+             "factor.")
+        .def("dir",
+             py::overload_cast<int>(&AppendablePolylineRuler::dir, py::const_),
+             py::kw_only(), "point_index"_a,
+             "Get the direction vector at a specific point index.")
+        .def("dir",
+             py::overload_cast<double, bool>(&AppendablePolylineRuler::dir,
+                                             py::const_),
+             py::kw_only(), "range"_a, "smooth_joint"_a = true,
+             "Get the direction vector at a specific cumulative distance.")
+        .def("local_frame", &AppendablePolylineRuler::local_frame, "range"_a,
+             py::kw_only(), "smooth_joint"_a = true,
+             "Get the local coordinate frame at a specific cumulative "
+             "distance.")
+        //
+        .def("along",
+             py::overload_cast<double>(&AppendablePolylineRuler::along,
+                                       py::const_),
+             "dist"_a,
+             "Find a point at a specified distance along the polyline "
+             "(clamped).")
+        .def("along",
+             py::overload_cast<const Eigen::Ref<const Eigen::VectorXd> &>(
+                 &AppendablePolylineRuler::along, py::const_),
+             "dists"_a, py::call_guard<py::gil_scoped_release>(),
+             "Find points at multiple distances along the polyline "
+             "(clamped).")
+        .def("pointOnLine", &AppendablePolylineRuler::pointOnLine, "P"_a,
+             py::call_guard<py::gil_scoped_release>(),
+             "Find the closest point on the polyline to a given point.")
+        .def("lineSliceAlong", &AppendablePolylineRuler::lineSliceAlong,
+             "start"_a, "stop"_a, py::call_guard<py::gil_scoped_release>(),
+             "Extract a portion of the polyline between two distances along "
+             "it.")
+        .def("ruler", &AppendablePolylineRuler::ruler,
+             "Get an immutable PolylineRuler copy of the current points.")
+        //
+        ;
+
+    bind_polyline_ruler_t<2, false>(m, "PolylineRuler2D");
+    bind_polyline_ruler_t<3, false>(m, "PolylineRuler3D");
+    bind_polyline_ruler_t<2, true>(m, "PolylineRuler2DWGS84");
+    bind_polyline_ruler_t<3, true>(m, "PolylineRuler3DWGS84");
+
+    py::class_<BandedPolylineRuler>(m, "BandedPolylineRuler",
+                                    py::module_local()) //
+        .def(py::init<const Eigen::Ref<const RowVectors> &, double>(),
+             "coords"_a, py::kw_only(), "band_height"_a = 0.1,
+             "Initialize the ruler with wgs84 polyline coordinates, split "
+             "into latitude bands of at most band_height degrees.")
+        //
+        .def("N", &BandedPolylineRuler::N,
+             "Get the number of points in the polyline.")
+        .def("polyline", &BandedPolylineRuler::polyline,
+             rvp::reference_internal, "Get the polyline coordinates.")
+        .def("band_height", &BandedPolylineRuler::band_height,
+             "Get the max latitude span (degrees) of a band.")
+        .def("num_bands", &BandedPolylineRuler::num_bands,
+             "Get the number of latitude bands.")
+        .def("band_offsets", &BandedPolylineRuler::band_offsets,
+             rvp::reference_internal,
+             "Get band offsets, band b covers segments [offsets[b], "
+             "offsets[b+1]).")
+        .def("anchors", &BandedPolylineRuler::anchors,
+             rvp::reference_internal,
+             "Get the anchor (lla) of the ENU frame of each band.")
+        .def("ks", &BandedPolylineRuler::ks, rvp::reference_internal,
+             "Get the scale factors of the ENU frame of each band.")
+        .def("band_index", &BandedPolylineRuler::band_index, "segment_index"_a,
+             "Get the band of a segment.")
+        .def("enus", &BandedPolylineRuler::enus, "band"_a,
+             "Get ENU coordinates of the points of a band, in its own frame.")
+        //
+        .def("ranges", &BandedPolylineRuler::ranges, rvp::reference_internal,
+             "Get cumulative distances along the polyline.")
+        .def("range",
+             py::overload_cast<int>(&BandedPolylineRuler::range, py::const_),
+             "segment_index"_a,
+             "Get the cumulative distance at a specific segment index.")
+        .def("range",
+             py::overload_cast<int, double>(&BandedPolylineRuler::range,
+                                            py::const_),
+             py::kw_only(), "segment_index"_a, "t"_a,
+             "Get the cumulative distance at a specific segment index and "
+             "interpolation factor.")
+        .def("length", &BandedPolylineRuler::length,
+             "Get the total length of the polyline.")
+        .def("segment_index_t", &BandedPolylineRuler::segment_index_t,
+             "range"_a,
+             "Get the segment index and interpolation factor for a given "
+             "cumulative distance.")
+        .def("at", &BandedPolylineRuler::at, py::kw_only(), "segment_index"_a,
+             "t"_a,
+             "Get the point at a segment index and interpolation factor.")
+        .def("along",
+             py::overload_cast<double>(&BandedPolylineRuler::along,
+                                       py::const_),
+             "dist"_a,
+             "Get the point at a distance along the polyline (clamped).")
+        .def("along",
+             py::overload_cast<const Eigen::Ref<const Eigen::VectorXd> &>(
+                 &BandedPolylineRuler::along, py::const_),
+             "dists"_a,
+             "Get points at distances along the polyline (clamped).")
+        .def("pointOnLine", &BandedPolylineRuler::pointOnLine, "P"_a,
+             "Find the closest point on the polyline to a given point.")
+        .def("pointsOnLine", &BandedPolylineRuler::pointsOnLine, "points"_a,
+             py::kw_only(), "n_threads"_a = 0,
+             py::call_guard<py::gil_scoped_release>(),
+             "Find the closest points on the polyline to a batch of points "
+             "(points, segment indexes, t, distances), multithreaded.")
+        .def("lineSlice", &BandedPolylineRuler::lineSlice, "start"_a,
+             "stop"_a,
+             "Get a slice of the polyline between two points (projected onto "
+             "it).")
+        .def("lineSliceAlong", &BandedPolylineRuler::lineSliceAlong,
+             "start"_a, "stop"_a,
+             "Get a slice of the polyline between two distances along it.")
+        //
+        ;
+
     m.def("douglas_simplify",
           py::overload_cast<const RowVectors &, double, bool,
                             bool>(&douglas_simplify), //
@@ -322,5 +747,219 @@ CUBAO_INLINE void bind_polyline_ruler(py::module &m)
         "recursive"_a = true,
         "Get indexes of points to keep when simplifying a 2D polyline using "
         "the Douglas-Peucker algorithm.");
+    m.def("douglas_simplify_masks",
+          py::overload_cast<const RowVectors &,
+                            const Eigen::Ref<const Eigen::VectorXi> &, double,
+                            bool, int>(&douglas_simplify_masks), //
+          "coords"_a, "offsets"_a, "epsilon"_a, py::kw_only(),   //
+          "is_wgs84"_a = false,                                  //
+          "n_threads"_a = 0, py::call_guard<py::gil_scoped_release>(),
+          "Get concatenated Douglas-Peucker masks of many polylines packed in "
+          "one buffer, polyline k is coords[offsets[k]:offsets[k+1]].");
+    m.def("douglas_simplify_masks",
+          py::overload_cast<const Eigen::Ref<const RowVectorsNx2> &,
+                            const Eigen::Ref<const Eigen::VectorXi> &, double,
+                            bool, int>(&douglas_simplify_masks), //
+          "coords"_a, "offsets"_a, "epsilon"_a, py::kw_only(),   //
+          "is_wgs84"_a = false,                                  //
+          "n_threads"_a = 0, py::call_guard<py::gil_scoped_release>(),
+          "Get concatenated Douglas-Peucker masks of many 2D polylines packed "
+          "in one buffer, polyline k is coords[offsets[k]:offsets[k+1]].");
+
+    py::class_<StreamingSimplifier>(m, "StreamingSimplifier",
+                                    py::module_local()) //
+        .def(py::init<double, bool, int>(), "epsilon"_a, py::kw_only(),
+             "is_wgs84"_a = false, "max_window"_a = 256,
+             "Initialize a streaming (opening window) simplifier, points "
+             "within epsilon of the simplified polyline are dropped.")
+        //
+        .def("epsilon", &StreamingSimplifier::epsilon, "Get the epsilon.")
+        .def("is_wgs84", &StreamingSimplifier::is_wgs84,
+             "Check if the coordinate system is WGS84.")
+        .def("max_window", &StreamingSimplifier::max_window,
+             "Get the max number of points in a window.")
+        .def("num_pushed", &StreamingSimplifier::num_pushed,
+             "Get the number of points pushed since the last flush.")
+        .def("num_buffered", &StreamingSimplifier::num_buffered,
+             "Get the number of points after the last kept one.")
+        .def("push", &StreamingSimplifier::push, "point"_a,
+             "Push a point, returns the kept point that became final (0 or "
+             "1 row).")
+        .def("push_points", &StreamingSimplifier::push_points, "points"_a,
+             "Push points, returns kept points that became final.")
+        .def("flush", &StreamingSimplifier::flush,
+             "Get the last point (if not returned yet), the next push starts "
+             "a new polyline.")
+        //
+        ;
+    m.def("visvalingam_simplify",
+          py::overload_cast<const RowVectors &, double, bool, bool>(
+              &visvalingam_simplify),
+          "coords"_a, "min_area"_a, py::kw_only(), //
+          "is_wgs84"_a = false,                    //
+          "preserve_topology"_a = false,
+          "Simplify a polyline using the Visvalingam-Whyatt algorithm.");
+    m.def(
+        "visvalingam_simplify",
+        py::overload_cast<const Eigen::Ref<const RowVectorsNx2> &, double, bool,
+                          bool>(&visvalingam_simplify),
+        "coords"_a, "min_area"_a, py::kw_only(), //
+        "is_wgs84"_a = false,                    //
+        "preserve_topology"_a = false,
+        "Simplify a 2D polyline using the Visvalingam-Whyatt algorithm.");
+    m.def("visvalingam_simplify_mask",
+          py::overload_cast<const RowVectors &, double, bool, bool>(
+              &visvalingam_simplify_mask),
+          "coords"_a, "min_area"_a, py::kw_only(), //
+          "is_wgs84"_a = false,                    //
+          "preserve_topology"_a = false,
+          "Get a mask of points to keep when simplifying a polyline using the "
+          "Visvalingam-Whyatt algorithm.");
+    m.def(
+        "visvalingam_simplify_mask",
+        py::overload_cast<const Eigen::Ref<const RowVectorsNx2> &, double, bool,
+                          bool>(&visvalingam_simplify_mask),
+        "coords"_a, "min_area"_a, py::kw_only(), //
+        "is_wgs84"_a = false,                    //
+        "preserve_topology"_a = false,
+        "Get a mask of points to keep when simplifying a 2D polyline using "
+        "the Visvalingam-Whyatt algorithm.");
+    m.def("visvalingam_simplify_indexes",
+          py::overload_cast<const RowVectors &, double, bool, bool>(
+              &visvalingam_simplify_indexes),
+          "coords"_a, "min_area"_a, py::kw_only(), //
+          "is_wgs84"_a = false,                    //
+          "preserve_topology"_a = false,
+          "Get indexes of points to keep when simplifying a polyline using "
+          "the Visvalingam-Whyatt algorithm.");
+    m.def(
+        "visvalingam_simplify_indexes",
+        py::overload_cast<const Eigen::Ref<const RowVectorsNx2> &, double, bool,
+                          bool>(&visvalingam_simplify_indexes),
+        "coords"_a, "min_area"_a, py::kw_only(), //
+        "is_wgs84"_a = false,                    //
+        "preserve_topology"_a = false,
+        "Get indexes of points to keep when simplifying a 2D polyline using "
+        "the Visvalingam-Whyatt algorithm.");
+    m.def("intersect_polylines",
+          py::overload_cast<const RowVectors &,
+                            const Eigen::Ref<const Eigen::VectorXi> &, bool,
+                            int>(&intersect_polylines), //
+          "coords"_a, "offsets"_a, py::kw_only(),        //
+          "include_self"_a = false,                      //
+          "n_threads"_a = 0, py::call_guard<py::gil_scoped_release>(),
+          "Find all crossings between polylines packed in one buffer, "
+          "polyline k is coords[offsets[k]:offsets[k+1]]. Returns (points, "
+          "polyline ids, segment indexes, [t, s]).");
+    m.def("intersect_polylines",
+          py::overload_cast<const Eigen::Ref<const RowVectorsNx2> &,
+                            const Eigen::Ref<const Eigen::VectorXi> &, bool,
+                            int>(&intersect_polylines), //
+          "coords"_a, "offsets"_a, py::kw_only(),        //
+          "include_self"_a = false,                      //
+          "n_threads"_a = 0, py::call_guard<py::gil_scoped_release>(),
+          "Find all crossings between 2D polylines packed in one buffer, "
+          "polyline k is coords[offsets[k]:offsets[k+1]]. Returns (points, "
+          "polyline ids, segment indexes, [t, s]).");
+
+    using VectorXiRef = Eigen::Ref<const Eigen::VectorXi>;
+    using Nx2Ref = Eigen::Ref<const RowVectorsNx2>;
+    m.def("hausdorff_distance",
+          py::overload_cast<const RowVectors &, const RowVectors &, bool>(
+              &hausdorff_distance),
+          "A"_a, "B"_a, py::kw_only(), "is_wgs84"_a = false,
+          py::call_guard<py::gil_scoped_release>(),
+          "Hausdorff distance between two polylines (vertices of either to "
+          "segments of the other).");
+    m.def("hausdorff_distance",
+          py::overload_cast<const Nx2Ref &, const Nx2Ref &, bool>(
+              &hausdorff_distance),
+          "A"_a, "B"_a, py::kw_only(), "is_wgs84"_a = false,
+          py::call_guard<py::gil_scoped_release>(),
+          "Hausdorff distance between two 2D polylines (vertices of either "
+          "to segments of the other).");
+    m.def("hausdorff_within",
+          py::overload_cast<const RowVectors &, const RowVectors &, double,
+                            bool>(&hausdorff_within),
+          "A"_a, "B"_a, "epsilon"_a, py::kw_only(), "is_wgs84"_a = false,
+          py::call_guard<py::gil_scoped_release>(),
+          "Check if the Hausdorff distance between two polylines is within "
+          "epsilon (with early exit).");
+    m.def("hausdorff_within",
+          py::overload_cast<const Nx2Ref &, const Nx2Ref &, double, bool>(
+              &hausdorff_within),
+          "A"_a, "B"_a, "epsilon"_a, py::kw_only(), "is_wgs84"_a = false,
+          py::call_guard<py::gil_scoped_release>(),
+          "Check if the Hausdorff distance between two 2D polylines is "
+          "within epsilon (with early exit).");
+    m.def("hausdorff_distances",
+          py::overload_cast<const RowVectors &, const RowVectors &,
+                            const VectorXiRef &, bool, std::optional<double>,
+                            int>(&hausdorff_distances),
+          "query"_a, "coords"_a, "offsets"_a, py::kw_only(),
+          "is_wgs84"_a = false, CUBAO_ARGV_DEFAULT_NONE(max_distance),
+          "n_threads"_a = 0, py::call_guard<py::gil_scoped_release>(),
+          "Hausdorff distances from query to polylines packed in one buffer, "
+          "polyline k is coords[offsets[k]:offsets[k+1]]. Candidates farther "
+          "than max_distance (and empty ones) get inf.");
+    m.def("hausdorff_distances",
+          py::overload_cast<const Nx2Ref &, const Nx2Ref &,
+                            const VectorXiRef &, bool, std::optional<double>,
+                            int>(&hausdorff_distances),
+          "query"_a, "coords"_a, "offsets"_a, py::kw_only(),
+          "is_wgs84"_a = false, CUBAO_ARGV_DEFAULT_NONE(max_distance),
+          "n_threads"_a = 0, py::call_guard<py::gil_scoped_release>(),
+          "Hausdorff distances from 2D query to 2D polylines packed in one "
+          "buffer, polyline k is coords[offsets[k]:offsets[k+1]]. Candidates "
+          "farther than max_distance (and empty ones) get inf.");
+    m.def("frechet_distance",
+          py::overload_cast<const RowVectors &, const RowVectors &, bool,
+                            bool>(&frechet_distance),
+          "A"_a, "B"_a, py::kw_only(), "is_wgs84"_a = false,
+          "discrete"_a = true, py::call_guard<py::gil_scoped_release>(),
+          "Discrete (or continuous) Frechet distance between two polylines.");
+    m.def("frechet_distance",
+          py::overload_cast<const Nx2Ref &, const Nx2Ref &, bool, bool>(
+              &frechet_distance),
+          "A"_a, "B"_a, py::kw_only(), "is_wgs84"_a = false,
+          "discrete"_a = true, py::call_guard<py::gil_scoped_release>(),
+          "Discrete (or continuous) Frechet distance between two 2D "
+          "polylines.");
+    m.def("frechet_within",
+          py::overload_cast<const RowVectors &, const RowVectors &, double,
+                            bool, bool>(&frechet_within),
+          "A"_a, "B"_a, "epsilon"_a, py::kw_only(), "is_wgs84"_a = false,
+          "discrete"_a = true, py::call_guard<py::gil_scoped_release>(),
+          "Check if the discrete (or continuous) Frechet distance between "
+          "two polylines is within epsilon (with early exit).");
+    m.def("frechet_within",
+          py::overload_cast<const Nx2Ref &, const Nx2Ref &, double, bool,
+                            bool>(&frechet_within),
+          "A"_a, "B"_a, "epsilon"_a, py::kw_only(), "is_wgs84"_a = false,
+          "discrete"_a = true, py::call_guard<py::gil_scoped_release>(),
+          "Check if the discrete (or continuous) Frechet distance between "
+          "two 2D polylines is within epsilon (with early exit).");
+    m.def("frechet_distances",
+          py::overload_cast<const RowVectors &, const RowVectors &,
+                            const VectorXiRef &, bool, bool,
+                            std::optional<double>, int>(&frechet_distances),
+          "query"_a, "coords"_a, "offsets"_a, py::kw_only(),
+          "is_wgs84"_a = false, "discrete"_a = true,
+          CUBAO_ARGV_DEFAULT_NONE(max_distance), "n_threads"_a = 0,
+          py::call_guard<py::gil_scoped_release>(),
+          "Frechet distances from query to polylines packed in one buffer, "
+          "polyline k is coords[offsets[k]:offsets[k+1]]. Candidates farther "
+          "than max_distance (and empty ones) get inf.");
+    m.def("frechet_distances",
+          py::overload_cast<const Nx2Ref &, const Nx2Ref &,
+                            const VectorXiRef &, bool, bool,
+                            std::optional<double>, int>(&frechet_distances),
+          "query"_a, "coords"_a, "offsets"_a, py::kw_only(),
+          "is_wgs84"_a = false, "discrete"_a = true,
+          CUBAO_ARGV_DEFAULT_NONE(max_distance), "n_threads"_a = 0,
+          py::call_guard<py::gil_scoped_release>(),
+          "Frechet distances from 2D query to 2D polylines packed in one "
+          "buffer, polyline k is coords[offsets[k]:offsets[k+1]]. Candidates "
+          "farther than max_distance (and empty ones) get inf.");
 }
 } // namespace cubao
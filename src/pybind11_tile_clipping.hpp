@@ -0,0 +1,49 @@
+// should sync
+// -
+// https://github.com/cubao/polyline-ruler/blob/master/src/pybind11_tile_clipping.hpp
+
+#pragma once
+
+#include <pybind11/eigen.h>
+#include <pybind11/iostream.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include <pybind11/stl_bind.h>
+
+#include "cubao_inline.hpp"
+#include "tile_clipping.hpp"
+
+namespace cubao
+{
+namespace py = pybind11;
+using namespace pybind11::literals;
+using rvp = py::return_value_policy;
+
+CUBAO_INLINE void bind_tile_clipping(py::module &m)
+{
+    m.def("clip_polylines_to_tiles",
+          py::overload_cast<const RowVectors &,
+                            const Eigen::Ref<const Eigen::VectorXi> &, int,
+                            double, std::optional<double>, int>(
+              &clip_polylines_to_tiles),
+          "coords"_a, "offsets"_a, "zoom"_a, py::kw_only(), "buffer"_a = 0.0,
+          CUBAO_ARGV_DEFAULT_NONE(epsilon), "n_threads"_a = 0,
+          py::call_guard<py::gil_scoped_release>(),
+          "Cut wgs84 polylines packed in one buffer (polyline k is "
+          "coords[offsets[k]:offsets[k+1]]) into tiles of a zoom level, "
+          "returns [coords, offsets, tiles, ids, segs, ts] of the parts.")
+        .def("clip_polylines_to_tiles",
+             py::overload_cast<const Eigen::Ref<const RowVectorsNx2> &,
+                               const Eigen::Ref<const Eigen::VectorXi> &, int,
+                               double, std::optional<double>, int>(
+                 &clip_polylines_to_tiles),
+             "coords"_a, "offsets"_a, "zoom"_a, py::kw_only(),
+             "buffer"_a = 0.0, CUBAO_ARGV_DEFAULT_NONE(epsilon),
+             "n_threads"_a = 0, py::call_guard<py::gil_scoped_release>(),
+             "Cut 2D wgs84 polylines packed in one buffer into tiles of a "
+             "zoom level, returns [coords (Nx3), offsets, tiles, ids, segs, "
+             "ts] of the parts.")
+        //
+        ;
+}
+} // namespace cubao
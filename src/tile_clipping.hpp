@@ -0,0 +1,353 @@
+#ifndef CUBAO_TILE_CLIPPING_HPP
+#define CUBAO_TILE_CLIPPING_HPP
+
+// should sync
+// - https://github.com/cubao/polyline-ruler/blob/master/src/tile_clipping.hpp
+
+// https://github.com/microsoft/vscode-cpptools/issues/9692
+#if __INTELLISENSE__
+#undef __ARM_NEON
+#undef __ARM_NEON__
+#endif
+
+#include <Eigen/Core>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include "cheap_ruler.hpp"
+#include "parallel_for.hpp"
+#include "polyline_ruler.hpp"
+
+namespace cubao
+{
+namespace internal
+{
+// web mercator tile coordinates (fractional, y grows southward) of lon/lat
+inline double lon2tile_x(double lon, double n)
+{
+    return (lon + 180.0) / 360.0 * n;
+}
+inline double lat2tile_y(double lat, double n)
+{
+    lat = std::max(-85.0511287798066, std::min(85.0511287798066, lat));
+    double rad = lat * M_PI / 180.0;
+    return (1.0 - std::asinh(std::tan(rad)) / M_PI) / 2.0 * n;
+}
+inline double tile_x2lon(double x, double n) { return x / n * 360.0 - 180.0; }
+inline double tile_y2lat(double y, double n)
+{
+    return std::atan(std::sinh(M_PI * (1.0 - 2.0 * y / n))) * 180.0 / M_PI;
+}
+
+// parametric range [t0, t1] of segment a -> b (x-y plane) within the box
+// [min, max] (Liang-Barsky), false if it misses the box
+inline bool clip_segment_2d(const Eigen::Vector3d &a, const Eigen::Vector3d &b,
+                            const Eigen::Vector2d &min,
+                            const Eigen::Vector2d &max, double &t0, double &t1)
+{
+    t0 = 0.0;
+    t1 = 1.0;
+    for (int c = 0; c < 2; ++c) {
+        const double d = b[c] - a[c];
+        if (d == 0.0) {
+            if (a[c] < min[c] || a[c] > max[c]) {
+                return false;
+            }
+            continue;
+        }
+        double ta = (min[c] - a[c]) / d;
+        double tb = (max[c] - a[c]) / d;
+        if (ta > tb) {
+            std::swap(ta, tb);
+        }
+        t0 = std::max(t0, ta);
+        t1 = std::min(t1, tb);
+        if (t0 > t1) {
+            return false;
+        }
+    }
+    return true;
+}
+} // namespace internal
+
+// cuts polylines (lon, lat, alt) packed in one buffer (polyline k is
+// coords[offsets[k]:offsets[k+1]]) into the web mercator tiles of `zoom`,
+// each tile extended by `buffer` (a fraction of the tile size) on all
+// sides. tile boundaries are lines of constant lon/lat, so clipping is done
+// on lon/lat, consistent with segment index & t elsewhere (linear in lla).
+// parts beyond the mercator latitude range are cut off, no wrapping across
+// the antimeridian. with `epsilon` (meters), parts are also simplified by
+// douglas_simplify in the frame of CheapRuler::fromTile (ends kept).
+// returns
+//      coords: vertices of all parts, Mx3
+//      offsets: part p is coords[offsets[p]:offsets[p+1]]
+//      tiles: [x, y] of each part, Px2
+//      ids: polyline index of each part
+//      segs, ts: segment index & t of each vertex on its polyline
+// parts are sorted by (tile y, tile x, polyline, position), tiles are
+// clipped in parallel by n_threads threads (0 for all hardware threads)
+inline std::tuple<RowVectors, Eigen::VectorXi, RowVectorsNx2i,
+                  Eigen::VectorXi, Eigen::VectorXi, Eigen::VectorXd>
+clip_polylines_to_tiles(const RowVectors &coords,
+                        const Eigen::Ref<const Eigen::VectorXi> &offsets,
+                        int zoom, double buffer = 0.0,
+                        std::optional<double> epsilon = {},
+                        int n_threads = 0)
+{
+    if (zoom < 0 || zoom > 24) {
+        throw std::invalid_argument("zoom should be within [0, 24]");
+    }
+    if (!(buffer >= 0.0 && buffer < 1.0)) {
+        throw std::invalid_argument("buffer should be within [0, 1)");
+    }
+    internal::check_offsets(offsets, coords.rows());
+    const int M = std::max(0, (int)offsets.size() - 1);
+    const int64_t n = int64_t(1) << zoom;
+    const double N = n;
+    auto tile_range = [&](double lo, double hi, int64_t &first,
+                          int64_t &last) {
+        first = std::max<int64_t>(0, std::floor(lo - buffer));
+        last = std::min<int64_t>(n - 1, std::floor(hi + buffer));
+        return first <= last;
+    };
+
+    // candidate (tile, polyline, segment), tile = y * n + x. per column
+    // crossed by the segment, only rows crossed within that column
+    struct Candidate
+    {
+        int64_t tile;
+        int id;
+        int seg;
+        bool operator<(const Candidate &other) const
+        {
+            return std::tie(tile, id, seg) <
+                   std::tie(other.tile, other.id, other.seg);
+        }
+    };
+    std::vector<std::vector<Candidate>> per_polyline(M);
+    parallel_for(
+        M,
+        [&](int begin, int end) {
+            for (int k = begin; k < end; ++k) {
+                auto &candidates = per_polyline[k];
+                for (int i = offsets[k]; i + 1 < offsets[k + 1]; ++i) {
+                    const double x0 = internal::lon2tile_x(coords(i, 0), N);
+                    const double x1 =
+                        internal::lon2tile_x(coords(i + 1, 0), N);
+                    int64_t cx0, cx1;
+                    if (!tile_range(std::min(x0, x1), std::max(x0, x1), cx0,
+                                    cx1)) {
+                        continue;
+                    }
+                    for (int64_t cx = cx0; cx <= cx1; ++cx) {
+                        double ta = 0.0, tb = 1.0;
+                        if (x0 != x1) {
+                            ta = (cx - buffer - x0) / (x1 - x0);
+                            tb = (cx + 1 + buffer - x0) / (x1 - x0);
+                            if (ta > tb) {
+                                std::swap(ta, tb);
+                            }
+                            ta = std::max(ta, 0.0);
+                            tb = std::min(tb, 1.0);
+                        }
+                        const double lat0 = coords(i, 1),
+                                     lat1 = coords(i + 1, 1);
+                        const double ya = internal::lat2tile_y(
+                            lat0 + (lat1 - lat0) * ta, N);
+                        const double yb = internal::lat2tile_y(
+                            lat0 + (lat1 - lat0) * tb, N);
+                        int64_t cy0, cy1;
+                        if (!tile_range(std::min(ya, yb), std::max(ya, yb),
+                                        cy0, cy1)) {
+                            continue;
+                        }
+                        for (int64_t cy = cy0; cy <= cy1; ++cy) {
+                            candidates.push_back(
+                                {cy * n + cx, k, i - offsets[k]});
+                        }
+                    }
+                }
+            }
+        },
+        n_threads, 16);
+    std::vector<Candidate> candidates;
+    {
+        size_t total = 0;
+        for (auto &c : per_polyline) {
+            total += c.size();
+        }
+        candidates.reserve(total);
+        for (auto &c : per_polyline) {
+            candidates.insert(candidates.end(), c.begin(), c.end());
+            std::vector<Candidate>().swap(c);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    std::vector<size_t> groups; // candidates of tile g: [groups[g], +1)
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (!i || candidates[i].tile != candidates[i - 1].tile) {
+            groups.push_back(i);
+        }
+    }
+    const int G = groups.size();
+    groups.push_back(candidates.size());
+
+    struct Parts
+    {
+        std::vector<Eigen::Vector3d> coords;
+        std::vector<int> offsets{0};
+        std::vector<int> ids;
+        std::vector<int> segs;
+        std::vector<double> ts;
+    };
+    std::vector<Parts> per_tile(G);
+    parallel_for(
+        G,
+        [&](int begin, int end) {
+            std::vector<int> to_keep;
+            std::vector<std::pair<int, int>> stack;
+            RowVectors enus;
+            for (int g = begin; g < end; ++g) {
+                const int64_t tile = candidates[groups[g]].tile;
+                const double tx = tile % n, ty = tile / n;
+                const Eigen::Vector2d min(
+                    internal::tile_x2lon(tx - buffer, N),
+                    internal::tile_y2lat(ty + 1 + buffer, N));
+                const Eigen::Vector2d max(
+                    internal::tile_x2lon(tx + 1 + buffer, N),
+                    internal::tile_y2lat(ty - buffer, N));
+                Parts &parts = per_tile[g];
+                auto close_part = [&](int id) {
+                    const int begin = parts.offsets.back();
+                    const int size = parts.coords.size() - begin;
+                    if (size < 2) {
+                        parts.coords.resize(begin);
+                        parts.segs.resize(begin);
+                        parts.ts.resize(begin);
+                        return;
+                    }
+                    if (epsilon && size > 2) {
+                        const Eigen::Vector3d k =
+                            CheapRuler::fromTile(ty, zoom).k();
+                        const Eigen::Vector3d &anchor = parts.coords[begin];
+                        enus.resize(size, 3);
+                        for (int i = 0; i < size; ++i) {
+                            enus.row(i) = (parts.coords[begin + i] - anchor)
+                                              .cwiseProduct(k);
+                        }
+                        to_keep.assign(size, 0);
+                        internal::douglas_simplify(enus, to_keep.data(),
+                                                   *epsilon, stack);
+                        int m = begin;
+                        for (int i = 0; i < size; ++i) {
+                            if (to_keep[i]) {
+                                parts.coords[m] = parts.coords[begin + i];
+                                parts.segs[m] = parts.segs[begin + i];
+                                parts.ts[m] = parts.ts[begin + i];
+                                ++m;
+                            }
+                        }
+                        parts.coords.resize(m);
+                        parts.segs.resize(m);
+                        parts.ts.resize(m);
+                    }
+                    parts.offsets.push_back(parts.coords.size());
+                    parts.ids.push_back(id);
+                };
+                int part_id = -1, last_seg = -1;
+                double last_t = 0.0;
+                for (size_t c = groups[g]; c < groups[g + 1]; ++c) {
+                    const int id = candidates[c].id;
+                    const int seg = candidates[c].seg;
+                    const int i = offsets[id] + seg;
+                    const Eigen::Vector3d a = coords.row(i);
+                    const Eigen::Vector3d b = coords.row(i + 1);
+                    double t0, t1;
+                    if (!internal::clip_segment_2d(a, b, min, max, t0, t1) ||
+                        (t0 == t1 && a != b)) {
+                        continue;
+                    }
+                    auto at = [&](double t) -> Eigen::Vector3d {
+                        return t == 0.0   ? a
+                               : t == 1.0 ? b
+                                          : PolylineRuler::interpolate(a, b, t);
+                    };
+                    if (part_id == id && last_seg == seg - 1 &&
+                        last_t == 1.0 && t0 == 0.0) {
+                        // continues the open part, its end is this start
+                        parts.segs.back() = seg;
+                        parts.ts.back() = 0.0;
+                    } else {
+                        if (part_id >= 0) {
+                            close_part(part_id);
+                        }
+                        part_id = id;
+                        parts.coords.push_back(at(t0));
+                        parts.segs.push_back(seg);
+                        parts.ts.push_back(t0);
+                    }
+                    parts.coords.push_back(at(t1));
+                    parts.segs.push_back(seg);
+                    parts.ts.push_back(t1);
+                    last_seg = seg;
+                    last_t = t1;
+                }
+                if (part_id >= 0) {
+                    close_part(part_id);
+                }
+            }
+        },
+        n_threads, 1);
+
+    int num_parts = 0, num_points = 0;
+    for (auto &parts : per_tile) {
+        num_parts += parts.ids.size();
+        num_points += parts.coords.size();
+    }
+    RowVectors out_coords(num_points, 3);
+    Eigen::VectorXi out_offsets(num_parts + 1);
+    RowVectorsNx2i tiles(num_parts, 2);
+    Eigen::VectorXi ids(num_parts);
+    Eigen::VectorXi segs(num_points);
+    Eigen::VectorXd ts(num_points);
+    out_offsets[0] = 0;
+    int p = 0, v = 0;
+    for (int g = 0; g < G; ++g) {
+        const int64_t tile = candidates[groups[g]].tile;
+        const Parts &parts = per_tile[g];
+        for (size_t q = 0; q < parts.ids.size(); ++q, ++p) {
+            tiles(p, 0) = tile % n;
+            tiles(p, 1) = tile / n;
+            ids[p] = parts.ids[q];
+            out_offsets[p + 1] = v + parts.offsets[q + 1];
+        }
+        for (size_t i = 0; i < parts.coords.size(); ++i) {
+            out_coords.row(v + i) = parts.coords[i];
+            segs[v + i] = parts.segs[i];
+            ts[v + i] = parts.ts[i];
+        }
+        v += parts.coords.size();
+    }
+    return std::make_tuple(std::move(out_coords), std::move(out_offsets),
+                           std::move(tiles), std::move(ids), std::move(segs),
+                           std::move(ts));
+}
+inline std::tuple<RowVectors, Eigen::VectorXi, RowVectorsNx2i,
+                  Eigen::VectorXi, Eigen::VectorXi, Eigen::VectorXd>
+clip_polylines_to_tiles(const Eigen::Ref<const RowVectorsNx2> &coords,
+                        const Eigen::Ref<const Eigen::VectorXi> &offsets,
+                        int zoom, double buffer = 0.0,
+                        std::optional<double> epsilon = {},
+                        int n_threads = 0)
+{
+    return clip_polylines_to_tiles(to_Nx3(coords), offsets, zoom, buffer,
+                                   epsilon, n_threads);
+}
+} // namespace cubao
+
+#endif
@@ -1,22 +1,68 @@
 from __future__ import annotations
 
 import time
+from concurrent.futures import ThreadPoolExecutor
 
 import numpy as np
+import pytest
 
 from polyline_ruler import (
+    AppendablePolylineRuler,
+    BandedPolylineRuler,
     CheapRuler,
+    EncodedPolyline,
     LineSegment,
+    MapMatcher,
+    PackedRTree,
+    PolylineCollection,
+    PolylineIndex,
     PolylineRuler,
+    PolylineRuler2D,
+    PolylineRuler2DWGS84,
+    PolylineRuler3D,
+    PolylineRuler3DWGS84,
+    StreamingSimplifier,
+    clip_polylines_to_tiles,
+    decode_polyline,
+    decode_polylines,
     douglas_simplify,
     douglas_simplify_indexes,
     douglas_simplify_mask,
+    douglas_simplify_masks,
+    encode_polyline,
+    encode_polylines,
+    frechet_distance,
+    frechet_distances,
+    frechet_within,
+    hausdorff_distance,
+    hausdorff_distances,
+    hausdorff_within,
+    intersect_polylines,
     intersect_segments,
     snap_onto_2d,
     tf,
+    visvalingam_simplify,
+    visvalingam_simplify_indexes,
+    visvalingam_simplify_mask,
 )
 
 
+def random_walk(rng, n, scale=1.0):
+    # 3d gaussian random walk, in meters (ENU)
+    return np.cumsum(rng.normal(size=(n, 3)), axis=0) * scale
+
+
+def to_llas(enus):
+    return tf.enu2lla(np.asarray(enus, dtype=np.float64), anchor_lla=[120, 30, 0])
+
+
+def random_polylines(rng, num, min_size, max_size, scale=10.0):
+    # one random walk, split into `num` polylines of [min_size, max_size) points
+    sizes = rng.integers(min_size, max_size, size=num)
+    offsets = np.cumsum(np.r_[0, sizes]).astype(np.int32)
+    return offsets, random_walk(rng, offsets[-1], scale)
+
+
 def test_segment():
     seg = LineSegment([0, 0, 0], [10, 0, 0])
     assert seg.distance([5.0, 4.0, 0.0]) == 4.0
@@ -53,6 +99,64 @@ def test_transform():
     assert np.abs(ecefs - tf.lla2ecef(llas3)).max() < 1e-6
 
 
+def test_enu2ecef():
+    # at (lon, lat) = (0, 0): east is +y, north is +z, up is +x
+    enus = [[1.0, 2.0, 3.0], [0.0, 0.0, 0.0]]
+    ecefs = tf.enu2ecef(enus, anchor_lla=[0, 0, 0], cheap_ruler=False)
+    np.testing.assert_allclose(
+        ecefs, [[6378140.0, 1.0, 2.0], [6378137.0, 0.0, 0.0]], atol=1e-8
+    )
+    # at (90, 0): east is -x, north is +z, up is +y
+    ecefs = tf.enu2ecef(enus, anchor_lla=[90, 0, 0], cheap_ruler=False)
+    np.testing.assert_allclose(
+        ecefs, [[-1.0, 6378140.0, 2.0], [0.0, 6378137.0, 0.0]], atol=1e-8
+    )
+    anchor = [120.0, 30.0, 10.0]
+    enus = np.array([[100.0, -200.0, 30.0], [-5.0, 7.0, -1.0]])
+    ecefs = tf.enu2ecef(enus, anchor_lla=anchor, cheap_ruler=False)
+    np.testing.assert_allclose(
+        tf.ecef2enu(ecefs, anchor_lla=anchor, cheap_ruler=False), enus, atol=1e-6
+    )
+    expected = tf.enu2ecef(enus, anchor_lla=anchor, cheap_ruler=True)
+    assert np.abs(ecefs - expected).max() < 0.1
+
+
+def test_transform_inplace():
+    rng = np.random.default_rng(7)
+    N = 10007
+    llas = np.column_stack(
+        (
+            rng.uniform(-180, 180, N),
+            rng.uniform(-90, 90, N),
+            rng.uniform(-100, 1e4, N),
+        )
+    )
+    llas[:4, 1] = [90, -90, 45, 0]
+    ecefs = tf.lla2ecef(llas)
+    for n_threads in [1, 0]:
+        coords = llas.copy()
+        tf.lla2ecef_inplace(coords, n_threads=n_threads)
+        assert np.abs(coords - ecefs).max() < 1e-8
+        tf.ecef2lla_inplace(coords, n_threads=n_threads)
+        assert np.abs(coords - tf.ecef2lla(ecefs))[:, :2].max() < 1e-13
+        assert np.abs(coords - tf.ecef2lla(ecefs))[:, 2].max() < 1e-8
+
+    anchor = llas[0]
+    for cheap_ruler in [True, False]:
+        enus = tf.lla2enu(llas, anchor_lla=anchor, cheap_ruler=cheap_ruler)
+        coords = llas.copy()
+        tf.lla2enu_inplace(coords, anchor_lla=anchor, cheap_ruler=cheap_ruler)
+        assert np.abs(coords - enus).max() < 1e-8
+        tf.enu2lla_inplace(coords, anchor_lla=anchor, cheap_ruler=cheap_ruler)
+        assert np.abs(coords - llas)[:, :2].max() < 1e-10
+        coords = enus.copy()
+        tf.enu2ecef_inplace(coords, anchor_lla=anchor, cheap_ruler=cheap_ruler)
+        expected = tf.enu2ecef(enus, anchor_lla=anchor, cheap_ruler=cheap_ruler)
+        assert np.abs(coords - expected).max() < 1e-8
+        tf.ecef2enu_inplace(coords, anchor_lla=anchor, cheap_ruler=cheap_ruler)
+        assert np.abs(coords - enus).max() < 1e-6
+
+
 class Timer:
     def __init__(self, title: str):
         self.title: str = title
@@ -221,6 +325,112 @@ def test_intersections_parallel():
     assert s == 0.5
 
 
+def test_intersect_polylines():
+    coords = [
+        # 0: horizontal
+        [-1, 0, 0],
+        [1, 0, 10],
+        # 1: vertical, crosses 0
+        [0, -1, 0],
+        [0, 1, 0],
+        # 2: self crossing, with a duplicate point
+        [5, 0, 0],
+        [7, 2, 0],
+        [7, 2, 0],
+        [7, 0, 0],
+        [5, 2, 0],
+        # 3: touches the end of 0
+        [1, 0, 0],
+        [2, 0, 0],
+    ]
+    offsets = [0, 2, 4, 9, 11]
+    points, ids, segs, ts = intersect_polylines(coords, offsets)
+    assert np.all(points == [[0, 0, 2.5], [1, 0, 5]])
+    assert np.all(ids == [[0, 1], [0, 3]])
+    assert np.all(segs == [[0, 0], [0, 0]])
+    assert np.all(ts == [[0.5, 0.5], [1.0, 0.0]])
+
+    points, ids, segs, ts = intersect_polylines(coords, offsets, include_self=True)
+    assert np.all(ids == [[0, 1], [0, 3], [2, 2]])
+    assert np.all(segs[2] == [0, 3])
+    assert np.all(points[2] == [6, 1, 0])
+    assert np.all(ts[2] == [0.5, 0.5])
+    for n_threads in [1, 4]:
+        ret = intersect_polylines(
+            np.array(coords)[:, :2], offsets, include_self=True, n_threads=n_threads
+        )
+        assert np.all(ret[0] == points[:, :2])
+        assert np.all(ret[1] == ids)
+
+    # neighboring segments of a closed ring only touch
+    ring = [[0, 0], [1, 0], [1, 1], [0, 1], [0, 0]]
+    points, *_ = intersect_polylines(ring, [0, 5], include_self=True)
+    assert points.shape == (0, 2)
+    # backtracking segments overlap
+    points, ids, segs, _ = intersect_polylines(
+        [[0, 0], [2, 0], [1, 0]], [0, 3], include_self=True
+    )
+    assert np.all(points == [[1.5, 0]]) and np.all(segs == [[0, 1]])
+
+    with pytest.raises(ValueError):
+        intersect_polylines(coords, [0, 20])
+
+
+def test_polyline_distances():
+    #  o-------o-------o  B
+    #
+    #  o---------------o  A
+    A = np.array([[0, 0, 0], [10, 0, 0]], dtype=np.float64)
+    B = np.array([[0, 1, 0], [5, 1, 0], [10, 1, 0]], dtype=np.float64)
+    assert hausdorff_distance(A, B) == 1.0
+    assert frechet_distance(A, B) == np.sqrt(26.0)  # (5, 1) pairs with an end
+    assert abs(frechet_distance(A, B, discrete=False) - 1.0) < 1e-8
+    # going back and forth does not change hausdorff, but frechet
+    C = np.array([[0, 0, 0], [8, 0, 0], [2, 0, 0], [10, 0, 0]], dtype=np.float64)
+    assert hausdorff_distance(A, C) == 0.0
+    assert abs(frechet_distance(A, C, discrete=False) - 3.0) < 1e-8
+    assert hausdorff_distance(A[:, :2], B[:, :2]) == 1.0
+
+    assert hausdorff_within(A, B, 1.0)
+    assert not hausdorff_within(A, B, 0.99)
+    assert frechet_within(A, B, 5.1)
+    assert not frechet_within(A, B, 5.0)
+    assert frechet_within(A, B, 1.01, discrete=False)
+    assert not frechet_within(A, B, 0.99, discrete=False)
+
+    llas = to_llas(A * 100)
+    llas2 = to_llas(B * 100)
+    assert abs(hausdorff_distance(llas, llas2, is_wgs84=True) - 100.0) < 1e-3
+    assert abs(frechet_distance(llas, llas2, is_wgs84=True) - np.sqrt(26) * 100) < 1e-3
+
+    # one query against many candidates
+    rng = np.random.default_rng(14)
+    query = random_walk(rng, 50)
+    candidates = [query + rng.normal(size=(1, 3)) * s for s in range(20)]
+    candidates[5] = candidates[5][:0]
+    coords = np.vstack(candidates)
+    offsets = np.cumsum([0] + [len(c) for c in candidates], dtype=np.int32)
+    for discrete in [True, False]:
+        scores = frechet_distances(query, coords, offsets, discrete=discrete)
+        assert np.isinf(scores[5])
+        for i, c in enumerate(candidates):
+            if len(c):
+                expected = frechet_distance(query, c, discrete=discrete)
+                assert abs(scores[i] - expected) < 1e-6
+        pruned = frechet_distances(
+            query, coords, offsets, discrete=discrete, max_distance=10.0, n_threads=4
+        )
+        np.testing.assert_allclose(pruned[scores <= 10.0], scores[scores <= 10.0])
+        assert np.all(np.isinf(pruned[scores > 10.0]))
+    scores = hausdorff_distances(query, coords, offsets)
+    for i, c in enumerate(candidates):
+        if len(c):
+            assert abs(scores[i] - hausdorff_distance(query, c)) < 1e-9
+    pruned = hausdorff_distances(query, coords, offsets, max_distance=10.0)
+    assert np.all(pruned[scores <= 10.0] == scores[scores <= 10.0])
+    assert np.all(np.isinf(pruned[scores > 10.0]))
+
+
 def test_intersections_duplicates():
     A = [[-5, 0], [5, 0]]
     B = A
@@ -343,6 +553,13 @@ def test_polyline_ruler_duplicates():
     assert np.all(ruler.ranges() == [0, 10, 10, 100])
     assert np.all(ruler.dirs() == [[1, 0, 0], [1, 0, 0], [1, 0, 0]])
 
+    # trailing duplicated points take the dir of the last real segment
+    coords = [[0, 0, 0], [0, 10, 0], [0, 10, 0], [0, 10, 0]]
+    assert np.all(PolylineRuler._dirs(coords) == [[0, 1, 0]] * 3)
+    assert np.all(PolylineRuler(coords).dirs() == [[0, 1, 0]] * 3)
+    with pytest.raises(ValueError):
+        PolylineRuler._dirs([[1, 1, 0], [1, 1, 0], [1, 1, 5]])
+
 
 def test_polyline_ruler_at():
     ruler = PolylineRuler([[0, 0, 0], [10, 0, 0], [10, 0, 0], [100, 0, 0]])
@@ -368,6 +585,602 @@ def test_polyline_ruler_at():
     np.testing.assert_allclose(ruler.segment_index_t(190), [2, 2.0], atol=1e-9)
 
 
+def test_polyline_ruler_rtree():
+    rng = np.random.default_rng(42)
+    coords = random_walk(rng, 1000)
+    ruler = PolylineRuler(coords)
+    indexed = PolylineRuler(coords)
+    assert not indexed.has_rtree()
+    assert indexed.rtree().size() == len(coords) - 1
+    assert indexed.has_rtree()
+    for P in rng.normal(scale=20.0, size=(100, 3)):
+        xyz, idx, t = ruler.pointOnLine(P)
+        xyz2, idx2, t2 = indexed.pointOnLine(P)
+        assert np.all(xyz == xyz2) and idx == idx2 and t == t2
+        points, indexes, ts, dists = indexed.nearest_segments(P, k=3)
+        assert len(indexes) == 3 and indexes[0] == idx
+        assert np.all(np.diff(dists) >= 0)
+        assert np.all(points[0] == xyz)
+    P = coords[10] + [100, 0, 0]
+    assert len(indexed.nearest_segments(P, k=3, max_distance=1.0)[1]) == 0
+    start, stop = coords[100] + 0.1, coords[200] - 0.1
+    assert np.all(ruler.lineSlice(start, stop) == indexed.lineSlice(start, stop))
+
+    tree = PackedRTree([[0, 0, 0, 1, 1, 0], [2, 2, 0, 3, 3, 0], [5, 5, 0, 6, 6, 0]])
+    assert tree.size() == 3
+    assert sorted(tree.search([0.5, 0.5, 0], [2.5, 2.5, 0])) == [0, 1]
+    assert np.all(tree.bounds() == [0, 0, 0, 6, 6, 0])
+
+
+def test_polyline_ruler_points_on_line():
+    rng = np.random.default_rng(7)
+    coords = random_walk(rng, 500)
+    ruler = PolylineRuler(coords)
+    queries = rng.normal(scale=20.0, size=(1000, 3))
+    for n_threads in [1, 4]:
+        xyzs, indexes, ts, dists = ruler.pointsOnLine(queries, n_threads=n_threads)
+        assert xyzs.shape == (1000, 3)
+        for i in range(0, 1000, 97):
+            xyz, idx, t = ruler.pointOnLine(queries[i])
+            assert np.all(xyzs[i] == xyz) and indexes[i] == idx and ts[i] == t
+            assert dists[i] == np.linalg.norm(xyz - queries[i])
+
+    llas = to_llas(coords * 10.0)
+    ruler = PolylineRuler(llas, is_wgs84=True)
+    queries = to_llas(queries * 10.0)
+    xyzs, indexes, ts, dists = ruler.pointsOnLine(queries)
+    for i in range(0, 1000, 97):
+        xyz, idx, t = ruler.pointOnLine(queries[i])
+        np.testing.assert_allclose(xyzs[i], xyz, atol=1e-12)
+        assert indexes[i] == idx
+
+
+def test_polyline_ruler_snap_trajectory():
+    rng = np.random.default_rng(17)
+    steps = np.c_[rng.uniform(5, 15, 2000), rng.normal(scale=3.0, size=(2000, 2))]
+    coords = np.cumsum(steps, axis=0)
+    ruler = PolylineRuler(coords)
+    fixes = coords[::3] + rng.normal(scale=2.0, size=(len(coords[::3]), 3))
+    xyzs, indexes, ts, dists = ruler.snap_trajectory(fixes, window=4, max_distance=20.0)
+    expected = ruler.pointsOnLine(fixes)
+    np.testing.assert_allclose(dists, expected[-1])
+    assert np.all(indexes == expected[1])
+    assert np.all(np.diff(indexes) >= 0)
+
+    xyz, idx, t = ruler.pointOnLine(fixes[100], indexes[100] + 2, window=3)
+    assert idx == indexes[100] and np.all(xyz == xyzs[100])
+    # match on the window border, falls back to the global search
+    xyz, idx, t = ruler.pointOnLine(fixes[100], 0, window=2)
+    assert idx == indexes[100]
+    # too far for the local match, global search
+    xyz, idx, t = ruler.pointOnLine(
+        coords[10] + [0, 5, 0], 12, window=5, max_distance=1.0
+    )
+    assert idx in (9, 10)
+
+    llas = to_llas(coords)
+    ruler = PolylineRuler(llas, is_wgs84=True)
+    fixes = to_llas(fixes)
+    xyzs, indexes2, ts, dists2 = ruler.snap_trajectory(fixes, max_distance=20.0)
+    assert np.all(indexes2 == indexes)
+    np.testing.assert_allclose(dists2, dists, rtol=1e-3)
+
+
+def test_polyline_ruler_line_slice_along():
+    def reference(start, stop, line):
+        total, slice = 0.0, []
+        for p0, p1 in zip(line[:-1], line[1:]):
+            d = np.linalg.norm(p1 - p0)
+            total += d
+            if total > start and not slice:
+                slice.append(p0 + (p1 - p0) * (start - (total - d)) / d)
+            if total >= stop:
+                slice.append(p0 + (p1 - p0) * (stop - (total - d)) / d)
+                return np.array(slice)
+            if total > start:
+                slice.append(p1)
+        return np.array(slice)
+
+    rng = np.random.default_rng(18)
+    coords = random_walk(rng, 200)
+    coords[50] = coords[49]
+    ruler = PolylineRuler(coords)
+    ranges = ruler.ranges()
+    for start, stop in [
+        (10.0, 80.0),
+        (ranges[30], ranges[60]),
+        (-5.0, 20.0),
+        (ranges[-1] - 3.0, ranges[-1] + 10.0),
+        (40.0, 30.0),
+        (0.0, ranges[-1]),
+    ]:
+        expected = reference(start, stop, coords)
+        np.testing.assert_allclose(
+            ruler.lineSliceAlong(start, stop), expected, atol=1e-9
+        )
+        np.testing.assert_allclose(
+            PolylineRuler._lineSliceAlong(start, stop, coords), expected, atol=1e-9
+        )
+        if 0 <= start < stop <= ranges[-1]:
+            head, begin, end, tail = ruler.lineSliceAlongView(start, stop)
+            view = np.vstack([head, coords[begin:end], tail])
+            np.testing.assert_allclose(view, expected, atol=1e-9)
+    assert len(ruler.lineSliceAlong(ranges[-1] + 1.0, ranges[-1] + 2.0)) == 0
+    head, begin, end, tail = ruler.lineSliceAlongView(ranges[-1] + 1.0, 1e9)
+    assert begin == end and np.all(head == coords[-1]) and np.all(tail == coords[-1])
+
+    llas = to_llas(coords * 100.0)
+    ruler = PolylineRuler(llas, is_wgs84=True)
+    expected = CheapRuler(30.0).lineSliceAlong(1000.0, 5000.0, llas)
+    np.testing.assert_allclose(
+        ruler.lineSliceAlong(1000.0, 5000.0), expected, atol=1e-6
+    )
+
+
+def test_polyline_ruler_specialisations():
+    rng = np.random.default_rng(19)
+    enus = random_walk(rng, 300, 10.0)
+    llas = to_llas(enus)
+    queries = enus[::3] + rng.normal(size=(100, 3)) * 10.0
+    lla_queries = to_llas(queries)
+    for cls, coords, points, is_wgs84 in [
+        (PolylineRuler3D, enus, queries, False),
+        (PolylineRuler3DWGS84, llas, lla_queries, True),
+        (PolylineRuler2D, enus[:, :2], queries[:, :2], False),
+        (PolylineRuler2DWGS84, llas[:, :2], lla_queries[:, :2], True),
+    ]:
+        dim = coords.shape[1]
+        coords = np.ascontiguousarray(coords)
+        points = np.ascontiguousarray(points)
+        ruler = cls(coords)
+        assert cls.dim() == dim and cls.is_wgs84() == is_wgs84
+        assert ruler.N() == 300 and ruler.polyline().shape == (300, dim)
+        ref_coords = np.c_[coords, np.zeros((300, 3 - dim))]
+        ref = PolylineRuler(ref_coords, is_wgs84=is_wgs84)
+        np.testing.assert_allclose(ruler.ranges(), ref.ranges(), rtol=1e-12)
+        assert ruler.length() == pytest.approx(ref.length(), rel=1e-12)
+        assert ruler.range(299) == ruler.length()
+        i, t = ruler.segment_index_t(100.0)
+        assert i == ref.segment_index_t(100.0)[0]
+        assert t == pytest.approx(ref.segment_index_t(100.0)[1], abs=1e-9)
+
+        # large batches build the segment rtree first
+        assert not ruler.has_rtree()
+        xyzs, indexes, ts, dists = ruler.pointsOnLine(points, n_threads=2)
+        assert ruler.has_rtree() and ruler.rtree().size() == 299
+        assert xyzs.shape == (100, dim)
+        ref_points = np.c_[points, np.zeros((100, 3 - dim))]
+        expected = ref.pointsOnLine(ref_points)
+        assert np.all(indexes == expected[1])
+        np.testing.assert_allclose(ts, expected[2], atol=1e-9)
+        np.testing.assert_allclose(xyzs, expected[0][:, :dim], atol=1e-9)
+        np.testing.assert_allclose(dists, expected[3], atol=1e-9)
+        xyz, idx, t = ruler.pointOnLine(points[7])
+        assert np.all(xyz == xyzs[7]) and idx == indexes[7] and t == ts[7]
+
+        dists = np.array([-1.0, 0.0, 123.0, ruler.length() + 1.0])
+        np.testing.assert_allclose(
+            ruler.along(dists), ref.along(dists)[:, :dim], atol=1e-9
+        )
+        assert ruler.ruler().length() == pytest.approx(ref.length(), rel=1e-12)
+
+
+def test_banded_polyline_ruler():
+    # ~1,400 km from (100, 30) to (110, 40)
+    rng = np.random.default_rng(21)
+    f = np.linspace(0, 1, 1000)
+    llas = np.c_[100 + 10 * f, 30 + 10 * f, np.zeros(1000)]
+    llas[:, :2] += rng.normal(size=(1000, 2)) * 0.001
+    ecefs = tf.lla2ecef(llas)
+    truth = np.linalg.norm(ecefs[1:] - ecefs[:-1], axis=1).sum()
+    ruler = BandedPolylineRuler(llas)
+    assert ruler.N() == 1000 and ruler.band_height() == 0.1
+    assert abs(ruler.length() / truth - 1) < 1e-5
+    # single ENU frame anchored at the first point
+    assert abs(PolylineRuler(llas, is_wgs84=True).length() / truth - 1) > 1e-2
+
+    offsets = ruler.band_offsets()
+    assert ruler.num_bands() == len(offsets) - 1 > 50
+    assert offsets[0] == 0 and offsets[-1] == 999 and np.all(np.diff(offsets) > 0)
+    for b in [0, ruler.num_bands() // 2, ruler.num_bands() - 1]:
+        lats = llas[offsets[b] : offsets[b + 1] + 1, 1]
+        assert lats.max() - lats.min() <= 0.1
+        assert ruler.band_index(offsets[b]) == b
+        assert ruler.enus(b).shape == (offsets[b + 1] - offsets[b] + 1, 3)
+        np.testing.assert_allclose(
+            ruler.ks()[b], tf.cheap_ruler_k(ruler.anchors()[b, 1])
+        )
+    with pytest.raises(IndexError):
+        ruler.band_index(999)
+
+    # 500 m off the middle of segment i
+    i = 600
+    enu = tf.lla2enu(llas[i : i + 2], anchor_lla=llas[i])
+    normal = np.array([-enu[1, 1], enu[1, 0], 0.0])
+    normal *= 500.0 / np.linalg.norm(normal)
+    lla = tf.enu2lla([enu[1] / 2 + normal], anchor_lla=llas[i])[0]
+    pp, idx, t = ruler.pointOnLine(lla)
+    assert idx == i and 0 < t < 1
+    np.testing.assert_allclose(pp, ruler.at(segment_index=idx, t=t))
+    pts, idxs, ts, dists = ruler.pointsOnLine(np.array([lla, llas[10]]), n_threads=2)
+    assert idxs[0] == i and abs(dists[0] - 500.0) < 1.0 and dists[1] < 1e-6
+    np.testing.assert_allclose(pts[0], pp)
+
+    start, stop = ruler.range(100, t=0.5), ruler.range(900)
+    sliced = ruler.lineSliceAlong(start, stop)
+    assert len(sliced) == 801
+    np.testing.assert_allclose(sliced[0], ruler.along(start), atol=1e-9)
+    np.testing.assert_allclose(sliced[-1], llas[900], atol=1e-9)
+    np.testing.assert_allclose(
+        ruler.lineSlice(sliced[0], sliced[-1]), sliced, atol=1e-9
+    )
+    with pytest.raises(ValueError):
+        BandedPolylineRuler(llas[:1])
+
+
+def test_polyline_ruler_self_intersections():
+    #         o (10, 10)
+    #       / |
+    #  o---x--x---o
+    #     /   |
+    #    o    o (5, -5)
+    coords = [[0, 0, 0], [10, 0, 0], [10, 10, 0], [5, -5, 0], [5, 5, 0]]
+    ruler = PolylineRuler(coords)
+    points, segs, ts = ruler.self_intersections()
+    assert np.all(segs == [[0, 2], [0, 3]])
+    np.testing.assert_allclose(points, [[20 / 3, 0, 0], [5, 0, 0]], atol=1e-12)
+    np.testing.assert_allclose(ts, [[2 / 3, 2 / 3], [0.5, 0.5]], atol=1e-12)
+    assert ruler.has_self_intersections()
+    assert ruler.has_self_intersections(n_threads=4)
+
+    ring = [[0, 0, 0], [1, 0, 0], [1, 1, 0], [1, 1, 0], [0, 1, 0], [0, 0, 0]]
+    assert len(PolylineRuler(ring).self_intersections()[0]) == 0
+    assert not PolylineRuler(ring).has_self_intersections()
+
+    llas = to_llas(coords)
+    ruler = PolylineRuler(llas, is_wgs84=True)
+    points2, segs2, ts2 = ruler.self_intersections()
+    assert np.all(segs2 == segs)
+    np.testing.assert_allclose(ts2, ts, atol=1e-9)
+    np.testing.assert_allclose(points2, to_llas(points), atol=1e-12)
+
+
+def test_appendable_polyline_ruler():
+    rng = np.random.default_rng(13)
+    enus = random_walk(rng, 300, 10.0)
+    enus[100] = enus[99]  # duplicated point
+
+    ruler = AppendablePolylineRuler()
+    assert ruler.N() == 0 and ruler.length() == 0.0
+    ruler.append(enus[0])
+    for i in range(1, 200, 7):
+        ruler.append(enus[i : i + 7])
+    ruler.append(enus[200:])
+    reference = PolylineRuler(enus)
+    assert ruler.N() == reference.N()
+    assert np.all(ruler.polyline() == reference.polyline())
+    assert np.all(ruler.ranges() == reference.ranges())
+    np.testing.assert_allclose(ruler.dirs(), reference.dirs(), atol=1e-12)
+    for r in rng.uniform(-10.0, reference.length() + 10.0, size=20):
+        assert ruler.segment_index_t(r) == reference.segment_index_t(r)
+        np.testing.assert_allclose(ruler.along(r), reference.along(r), atol=1e-9)
+        np.testing.assert_allclose(
+            ruler.dir(range=r), reference.dir(range=r), atol=1e-12
+        )
+        np.testing.assert_allclose(
+            ruler.local_frame(r), reference.local_frame(r), atol=1e-9
+        )
+    P = enus[150] + [3.0, 4.0, 0.0]
+    assert ruler.pointOnLine(P)[1:] == reference.pointOnLine(P)[1:]
+    np.testing.assert_allclose(
+        ruler.lineSliceAlong(100.0, 500.0),
+        reference.lineSliceAlong(100.0, 500.0),
+        atol=1e-9,
+    )
+
+    # sliding window, ranges are relative to the new head
+    ruler.trim_head(120)
+    reference = PolylineRuler(enus[120:])
+    assert ruler.N() == 180
+    np.testing.assert_allclose(ruler.ranges(), reference.ranges(), atol=1e-9)
+    np.testing.assert_allclose(ruler.dirs(), reference.dirs(), atol=1e-12)
+    assert ruler.ruler().N() == 180
+    with pytest.raises(ValueError):
+        ruler.trim_head(181)
+
+    # wgs84, anchored at the head (re-anchored by trim_head)
+    llas = to_llas(enus)
+    ruler = AppendablePolylineRuler(llas[:10], is_wgs84=True)
+    ruler.append(llas[10:])
+    reference = PolylineRuler(llas, is_wgs84=True)
+    np.testing.assert_allclose(ruler.ranges(), reference.ranges(), atol=1e-9)
+    np.testing.assert_allclose(ruler.along(300.0), reference.along(300.0), atol=1e-9)
+    ruler.trim_head(50)
+    reference = PolylineRuler(llas[50:], is_wgs84=True)
+    np.testing.assert_allclose(ruler.ranges(), reference.ranges(), atol=1e-9)
+
+
+def test_appendable_polyline_ruler_wgs84_drift():
+    # latitude drifts from 30 to 34.5, sliding window of ~500 points
+    N = 3000
+    rng = np.random.default_rng(130)
+    llas = np.column_stack(
+        (
+            np.linspace(120.0, 123.0, N),
+            np.linspace(30.0, 34.5, N),
+            rng.normal(size=N),
+        )
+    )
+    llas[:, :2] += rng.normal(size=(N, 2)) * 1e-4
+    ruler = AppendablePolylineRuler(is_wgs84=True)
+    for i in range(0, N, 50):
+        ruler.append(llas[i : i + 50])
+        if ruler.N() > 500:
+            ruler.trim_head(ruler.N() - 500)
+        ruler.dirs()
+    assert ruler.N() == 500
+    reference = PolylineRuler(llas[-500:], is_wgs84=True)
+    np.testing.assert_allclose(ruler.ranges(), reference.ranges(), atol=1e-9)
+    np.testing.assert_allclose(ruler.dirs(), reference.dirs(), atol=1e-12)
+    np.testing.assert_allclose(ruler.k(), reference.k(), rtol=1e-15)
+    P = llas[-100] + [1e-5, 1e-5, 0.0]
+    assert ruler.pointOnLine(P)[1:] == reference.pointOnLine(P)[1:]
+
+
+def test_polyline_ruler_threads():
+    rng = np.random.default_rng(3)
+    enus = random_walk(rng, 2000, 10.0)
+    llas = to_llas(enus)
+    reference = PolylineRuler(llas, is_wgs84=True).freeze(with_rtree=True)
+    assert reference.is_frozen()
+    queries = llas[rng.integers(0, len(llas), size=64)]
+    ranges = rng.uniform(0.0, reference.length(), size=64)
+
+    for _ in range(5):
+        # shared ruler with cold caches, initialized by racing threads
+        ruler = PolylineRuler(llas, is_wgs84=True)
+        assert not ruler.is_frozen()
+
+        def hammer(i, ruler=ruler):
+            ret = []
+            for j in range(64):
+                k = (i + j) % 64
+                ret.append(ruler.along(ranges[k]))
+                ret.append(ruler.dir(range=ranges[k]))
+                ret.append(ruler.pointOnLine(queries[k])[0])
+            return i, ret
+
+        with ThreadPoolExecutor(max_workers=8) as executor:
+            results = list(executor.map(hammer, range(32)))
+        assert ruler.is_frozen()
+        for i, ret in results:
+            for j in range(64):
+                k = (i + j) % 64
+                assert np.all(ret[3 * j] == reference.along(ranges[k]))
+                assert np.all(ret[3 * j + 1] == reference.dir(range=ranges[k]))
+                assert np.all(ret[3 * j + 2] == reference.pointOnLine(queries[k])[0])
+
+
+def test_polyline_ruler_view():
+    coords = np.array(
+        [[0, 0, 0], [10, 0, 0], [10, 10, 0], [100, 10, 0]], dtype=np.float64
+    )
+    owned = PolylineRuler(coords)
+    assert not np.shares_memory(owned.polyline(), coords)
+    ruler = PolylineRuler.view(coords)
+    assert np.shares_memory(ruler.polyline(), coords)
+    assert np.all(ruler.ranges() == owned.ranges())
+    assert np.all(ruler.along(21.0) == owned.along(21.0))
+    del coords  # kept alive by the view
+    assert np.all(ruler.polyline()[-1] == [100, 10, 0])
+    assert ruler.length() == 110.0
+
+    ruler = PolylineRuler.view(np.array([[0, 0], [3, 4]], dtype=np.float64))
+    assert ruler.polyline().shape == (2, 3)
+    assert ruler.length() == 5.0
+
+    for bad in [
+        np.zeros((4, 3), dtype=np.float32),
+        np.zeros((3, 4))[:, :3],
+        np.zeros((4, 4)),
+    ]:
+        with pytest.raises(ValueError):  # noqa: PT011
+            PolylineRuler.view(bad)
+
+
+def test_polyline_collection(tmp_path):
+    rng = np.random.default_rng(15)
+    offsets, enus = random_polylines(rng, 100, 2, 50)
+    llas = to_llas(enus)
+    path = str(tmp_path / "roads.bin")
+    PolylineCollection.write(path, llas, offsets, is_wgs84=True)
+
+    roads = PolylineCollection(path)
+    assert len(roads) == roads.size() == 100
+    assert roads.num_points() == len(llas)
+    assert roads.is_wgs84()
+    assert roads.has_ranges() and roads.has_dirs() and roads.has_rtree()
+    assert np.all(roads.offsets() == offsets)
+    assert np.all(roads.coords() == llas)
+    assert not roads.coords().flags.writeable
+    for k in [0, 42, 99]:
+        polyline = llas[offsets[k] : offsets[k + 1]]
+        assert np.all(roads.polyline(k) == polyline)
+        ruler = roads.ruler(k)
+        expected = PolylineRuler(polyline, is_wgs84=True)
+        assert np.all(ruler.ranges() == expected.ranges())
+        assert np.all(ruler.dirs() == expected.dirs())
+        assert ruler.length() == expected.length()
+    with pytest.raises(IndexError):
+        roads.ruler(100)
+
+    lo, hi = llas[offsets[42]] - 1e-4, llas[offsets[42]] + 1e-4
+    hits = roads.search(lo, hi)
+    assert 42 in hits
+    for k in range(100):
+        polyline = llas[offsets[k] : offsets[k + 1]]
+        overlap = np.all(polyline.min(axis=0) <= hi) and np.all(
+            polyline.max(axis=0) >= lo
+        )
+        assert (k in hits) == overlap
+
+    # rulers keep the file mapped
+    ruler = roads.ruler(7)
+    del roads
+    assert ruler.length() > 0
+
+    path = str(tmp_path / "bare.bin")
+    PolylineCollection.write(
+        path, enus, offsets, with_ranges=False, with_dirs=False, with_rtree=False
+    )
+    roads = PolylineCollection(path)
+    assert not roads.has_ranges() and not roads.has_rtree()
+    assert (
+        roads.ruler(3).length() == PolylineRuler(enus[offsets[3] : offsets[4]]).length()
+    )
+    assert 3 in roads.search(enus[offsets[3]] - 1.0, enus[offsets[3]] + 1.0)
+    with pytest.raises(ValueError):
+        PolylineCollection.write(path, enus[:3], [0, 1, 3])
+    with open(path, "wb") as f:
+        f.write(b"not a polyline collection")
+    with pytest.raises(ValueError):
+        PolylineCollection(path)
+
+    # corrupted headers/rtree indices are rejected when opening
+    path = str(tmp_path / "roads.bin")
+    with open(path, "rb") as f:
+        data = f.read()
+    num_nodes = int(np.frombuffer(data, dtype=np.int32, count=1, offset=32)[0])
+    rtree_indices = int(np.frombuffer(data, dtype=np.uint64, count=1, offset=80)[0])
+    for offset, value in [
+        (32, -1),  # rtree_num_nodes
+        (28, 0),  # rtree_node_size
+        (rtree_indices + 4 * (num_nodes - 1), 1 << 30),  # root's first child
+        (rtree_indices + 4 * (num_nodes - 1), num_nodes - 1),  # cycle
+    ]:
+        corrupted = bytearray(data)
+        corrupted[offset : offset + 4] = np.int32(value).tobytes()
+        with open(path, "wb") as f:
+            f.write(corrupted)
+        with pytest.raises(ValueError):
+            PolylineCollection(path)
+
+
+def test_polyline_index():
+    rng = np.random.default_rng(16)
+    offsets, enus = random_polylines(rng, 200, 1, 30)
+    index = PolylineIndex(enus, offsets, chunk_size=4)
+    assert len(index) == index.size() == 200
+    assert not index.is_wgs84()
+    assert np.all(index.polyline(7) == enus[offsets[7] : offsets[8]])
+
+    def brute(point):
+        dists = []
+        for k in range(200):
+            polyline = enus[offsets[k] : offsets[k + 1]]
+            if len(polyline) == 1:
+                dists.append(np.linalg.norm(polyline[0] - point))
+            else:
+                nearest, *_ = PolylineRuler(polyline).pointOnLine(point)
+                dists.append(np.linalg.norm(nearest - point))
+        return np.array(dists)
+
+    points = enus[rng.integers(0, len(enus), size=20)] + rng.normal(size=(20, 3)) * 30
+    for point in points:
+        dists = brute(point)
+        ids, nearest, segs, ts, ds = index.nearest(point, k=5)
+        assert np.all(ids == np.argsort(dists, kind="stable")[:5])
+        np.testing.assert_allclose(ds, np.sort(dists)[:5])
+        np.testing.assert_allclose(np.linalg.norm(nearest - point, axis=1), ds)
+        ids, *_, ds = index.within(point, dists[ids[2]] + 1e-6)
+        assert len(ids) == 3 and np.all(np.diff(ds) >= 0)
+        ids, *_ = index.nearest(point, k=5, max_distance=dists.min() - 1e-6)
+        assert len(ids) == 0
+
+    offs, ids, _, segs, ts, ds = index.nearest_batch(points, k=3, n_threads=2)
+    assert np.all(np.diff(offs) == 3)
+    for i, point in enumerate(points):
+        expected = index.nearest(point, k=3)
+        assert np.all(ids[offs[i] : offs[i + 1]] == expected[0])
+        assert np.all(ds[offs[i] : offs[i + 1]] == expected[-1])
+    offs, ids, *_ = index.within_batch(points, 50.0)
+    for i, point in enumerate(points):
+        assert np.all(ids[offs[i] : offs[i + 1]] == index.within(point, 50.0)[0])
+
+    # distances in the cheap ruler frame of the query, across the antimeridian
+    llas = np.array([[179.9, 10, 0], [-179.9, 10, 0], [0, 10, 0], [1, 10, 0]])
+    index = PolylineIndex(llas, [0, 2, 4], is_wgs84=True)
+    ids, nearest, segs, ts, ds = index.nearest([-179.95, 10.001, 0], k=2)
+    assert ids[0] == 0 and segs[0] == 0
+    ruler = CheapRuler(10.001)
+    assert ds[0] == pytest.approx(ruler.distance([-179.95, 10.001, 0], nearest[0]))
+    assert ds[0] == pytest.approx(ruler.distance([0, 10, 0], [0, 10.001, 0]))
+    # nearest points are wrapped back to [-180, 180]
+    assert nearest[0] == pytest.approx([-179.95, 10, 0])
+    _, _, nearest, *_ = index.within_batch(
+        [[-179.95, 10.001, 0], [179.95, 9.9, 0]], 2e4
+    )
+    assert np.all(np.abs(nearest[:, 0]) <= 180.0)
+    assert nearest[:, 0] == pytest.approx([-179.95, 179.95])
+    rulers = [
+        PolylineRuler(llas[:2], is_wgs84=True),
+        PolylineRuler(llas[2:], is_wgs84=True),
+    ]
+    assert np.all(PolylineIndex(rulers).nearest([0.5, 10.2, 0], k=2)[0] == [1, 0])
+    with pytest.raises(ValueError):
+        PolylineIndex([PolylineRuler(llas[:2]), rulers[1]])
+
+
+def test_polyline_ruler_ranges_kernels():
+    rng = np.random.default_rng(0)
+    xyzs = np.cumsum(rng.uniform(-10, 10, (1000, 3)), axis=0)
+    diffs = np.linalg.norm(xyzs[1:] - xyzs[:-1], axis=1)
+    ranges = PolylineRuler._ranges(xyzs)
+    assert np.allclose(ranges, [0, *np.cumsum(diffs)])
+    assert np.all(np.diff(ranges) >= 0)
+    assert PolylineRuler._lineDistance(xyzs) == ranges[-1]
+    assert PolylineRuler(xyzs).lineDistance() == ranges[-1]
+
+    ranges32 = PolylineRuler._ranges(xyzs.astype(np.float32))
+    assert ranges32.dtype == np.float64
+    assert np.allclose(ranges32, ranges, atol=0.1)
+    assert PolylineRuler._lineDistance(xyzs.astype(np.float32)) == ranges32[-1]
+
+    llas = np.array([[120.0, 30.0, 0.0]]) + xyzs * 1e-5
+    ranges = PolylineRuler._ranges(llas, is_wgs84=True)
+    ruler = PolylineRuler(llas, is_wgs84=True)
+    assert np.all(ruler.ranges() == ranges)
+    assert ruler.lineDistance() == ruler.length() == ranges[-1]
+    cheap = CheapRuler(30.0)
+    assert np.isclose(cheap.lineDistance(llas), ranges[-1], rtol=1e-3)
+
+
+def test_polyline_ruler_batched():
+    ruler = PolylineRuler([[0, 0, 0], [10, 0, 0], [10, 10, 0], [100, 10, 0]])
+    for ranges in [
+        np.arange(-5.0, 120.0, 0.5),
+        np.array([30.0, 10.0, -1.0, 110.0, 0.0, 200.0, 20.0, 15.0]),
+    ]:
+        indexes, ts = ruler.segment_indexes_t(ranges)
+        assert [ruler.segment_index_t(r) for r in ranges] == list(zip(indexes, ts))
+        assert np.all(ruler.at(ranges=ranges) == [ruler.at(range=r) for r in ranges])
+        assert np.all(ruler.along(ranges) == [ruler.along(r) for r in ranges])
+        for smooth_joint in [True, False]:
+            dirs = ruler.dir(ranges=ranges, smooth_joint=smooth_joint)
+            expected = [ruler.dir(range=r, smooth_joint=smooth_joint) for r in ranges]
+            assert np.all(dirs == expected)
+        _, xyzs, dirs = ruler.arrows(ranges)
+        assert np.all(xyzs == ruler.at(ranges=ranges))
+        assert np.all(dirs == ruler.dir(ranges=ranges))
+        lefts, rights = ruler.scanline(ranges, min=-2.0, max=3.0)
+        for r, left, right in zip(ranges, lefts, rights):
+            expected = ruler.scanline(r, min=-2.0, max=3.0)
+            assert np.all(left == expected[0]) and np.all(right == expected[1])
+        frames = ruler.local_frame(ranges)
+        assert frames.shape == (len(ranges), 4, 4)
+        assert np.all(frames == [ruler.local_frame(r) for r in ranges])
+
+
 def test_douglas():
     # Nx2
     assert douglas_simplify([[1, 1], [2, 2], [3, 3], [4, 4]], epsilon=1e-9).shape == (
@@ -398,6 +1211,269 @@ def test_douglas():
     assert np.all(indexes == [0, 3])
 
 
+def test_douglas_batch():
+    rng = np.random.default_rng(11)
+    sizes = rng.integers(0, 200, size=500)
+    sizes[:3] = [0, 1, 2]
+    offsets = np.r_[0, np.cumsum(sizes)]
+    coords = random_walk(rng, offsets[-1])
+    llas = np.c_[120 + coords[:, :2] * 1e-5, coords[:, 2]]
+    for is_wgs84, xyzs, epsilon in [(False, coords, 2.0), (True, llas, 5.0)]:
+        expected = np.zeros(len(xyzs), dtype=np.int32)
+        for i, j in zip(offsets[:-1], offsets[1:]):
+            if j > i:
+                expected[i:j] = douglas_simplify_mask(
+                    xyzs[i:j], epsilon, is_wgs84=is_wgs84
+                )
+        for n_threads in [1, 4]:
+            masks = douglas_simplify_masks(
+                xyzs, offsets, epsilon, is_wgs84=is_wgs84, n_threads=n_threads
+            )
+            assert np.all(masks == expected)
+    masks = douglas_simplify_masks(coords[:, :2], offsets, 2.0)
+    assert masks.shape == (len(coords),)
+    with pytest.raises(ValueError):
+        douglas_simplify_masks(coords, [0, len(coords) + 1], 2.0)
+
+
+def test_streaming_simplifier():
+    # collinear points are dropped, the corner is kept once a point past it
+    # comes in
+    s = StreamingSimplifier(0.1)
+    assert s.push([0, 0, 0]).tolist() == [[0, 0, 0]]
+    for x in range(1, 5):
+        assert len(s.push([x, 0, 0])) == 0
+    assert s.push([4, 1, 0]).tolist() == [[4, 0, 0]]
+    assert len(s.push([4, 2, 0])) == 0
+    assert s.num_pushed() == 7 and s.num_buffered() == 2
+    assert s.flush().tolist() == [[4, 2, 0]]
+    assert s.num_pushed() == 0 and len(s.flush()) == 0
+
+    rng = np.random.default_rng(22)
+    coords = np.cumsum(random_walk(rng, 5000), axis=0)
+    llas = to_llas(coords)
+    for is_wgs84, xyzs in [(False, coords), (True, llas)]:
+        s = StreamingSimplifier(5.0, is_wgs84=is_wgs84, max_window=64)
+        kept = [s.push(p) for p in xyzs]
+        assert max(map(len, kept)) == 1 and s.num_buffered() <= 64
+        kept = np.vstack([*kept, s.flush()])
+        # same as pushing in batches
+        batches = [s.push_points(xyzs[:1234]), s.push_points(xyzs[1234:]), s.flush()]
+        assert np.all(np.vstack(batches) == kept)
+        assert 2 < len(kept) < len(xyzs) / 2
+        indexes = [i for i, p in enumerate(xyzs) if (kept == p).all(axis=1).any()]
+        assert (
+            len(indexes) == len(kept)
+            and indexes[0] == 0
+            and indexes[-1] == len(xyzs) - 1
+        )
+        # every dropped point is within epsilon of the simplified polyline
+        # (wgs84 windows are measured in their own ENU frames)
+        for i, j in zip(indexes[:-1], indexes[1:]):
+            seg = LineSegment(coords[i], coords[j])
+            assert all(seg.distance(coords[k]) < 5.0 * 1.01 for k in range(i + 1, j))
+    with pytest.raises(ValueError):
+        StreamingSimplifier(1.0, max_window=0)
+
+
+def test_encoded_polyline():
+    # https://developers.google.com/maps/documentation/utilities/polylinealgorithm
+    lonlats = [[-120.2, 38.5], [-120.95, 40.7], [-126.453, 43.252]]
+    assert encode_polyline(lonlats) == "_p~iF~ps|U_ulLnnqC_mqNvxq`@"
+    decoded = decode_polyline("_p~iF~ps|U_ulLnnqC_mqNvxq`@")
+    np.testing.assert_allclose(decoded, np.c_[lonlats, [0, 0, 0]], atol=1e-9)
+    with pytest.raises(ValueError):
+        decode_polyline("_p~iF~ps|U_")
+
+    rng = np.random.default_rng(23)
+    llas = np.cumsum(rng.normal(size=(1000, 3)) * [1e-4, 1e-4, 1.0], axis=0)
+    llas += [120, 30, 100]
+    encoded = encode_polyline(llas, 6, z_precision=2)
+    assert len(encoded) < llas.nbytes / 4
+    decoded = decode_polyline(encoded, 6, z_precision=2)
+    assert np.all(np.abs(decoded - llas).max(axis=0) < [6e-7, 6e-7, 6e-3])
+
+    offsets = np.array([0, 0, 100, 999, 1000], dtype=np.int32)
+    encoded = encode_polylines(llas, offsets, n_threads=2)
+    assert encoded[0] == "" and encoded[1] == encode_polyline(llas[:100])
+    coords, offsets2 = decode_polylines(encoded, n_threads=2)
+    assert np.all(offsets2 == offsets)
+    np.testing.assert_allclose(coords[:, :2], llas[:, :2], atol=5e-6)
+
+    polyline = EncodedPolyline(llas, is_wgs84=True, precision=6, z_precision=2)
+    assert polyline.N() == 1000 and polyline.z_precision() == 2
+    assert not polyline.is_decoded()
+    ruler = polyline.ruler()
+    assert polyline.is_decoded() and ruler.is_wgs84()
+    assert np.all(ruler.polyline() == polyline.decode())
+    copy = EncodedPolyline(
+        polyline.encoded(), is_wgs84=True, precision=6, z_precision=2
+    )
+    assert copy.N() == 1000 and copy.ruler().length() == ruler.length()
+    assert abs(ruler.length() - PolylineRuler(llas, is_wgs84=True).length()) < 5.0
+
+    length = ruler.length()
+    polyline.release()
+    assert not polyline.is_decoded()
+    assert ruler.length() == length  # rulers already returned stay valid
+    assert polyline.ruler().length() == length and polyline.is_decoded()
+
+
+def test_clip_polylines_to_tiles():
+    # zoom 1: tiles split at lon 0 & lat 0
+    coords = np.array([[-10, 10], [10, 10], [10, -10]], dtype=np.float64)
+    parts, offsets, tiles, ids, segs, ts = clip_polylines_to_tiles(coords, [0, 3], 1)
+    assert tiles.tolist() == [[0, 0], [1, 0], [1, 1]]
+    assert offsets.tolist() == [0, 2, 5, 7] and np.all(ids == 0)
+    # the corner is (seg 1, t 0) of the part in tile [1, 0]
+    assert segs.tolist() == [0, 0, 0, 1, 1, 1, 1]
+    assert ts.tolist() == [0.0, 0.5, 0.5, 0.0, 0.5, 0.5, 1.0]
+    np.testing.assert_allclose(
+        parts[:, :2],
+        [[-10, 10], [0, 10], [0, 10], [10, 10], [10, 0], [10, 0], [10, -10]],
+    )
+
+    rng = np.random.default_rng(24)
+    sizes = rng.integers(0, 100, size=50)
+    offsets = np.r_[0, np.cumsum(sizes)].astype(np.int32)
+    llas = np.cumsum(rng.normal(size=(offsets[-1], 3)) * [0.002, 0.002, 1.0], axis=0)
+    llas += [116, 40, 0]
+    zoom = 12
+    parts, part_offsets, tiles, ids, segs, ts = clip_polylines_to_tiles(
+        llas, offsets, zoom, n_threads=2
+    )
+    # parts are on their polylines, and cover them
+    starts = offsets[ids].repeat(np.diff(part_offsets)) + segs
+    expected = llas[starts] + (llas[starts + 1] - llas[starts]) * ts[:, None]
+    np.testing.assert_allclose(parts, expected, atol=1e-9)
+    lengths = np.zeros(len(sizes))
+    for p, k in enumerate(ids):
+        part = parts[part_offsets[p] : part_offsets[p + 1]]
+        lengths[k] += np.linalg.norm(np.diff(part[:, :2], axis=0), axis=1).sum()
+    for k, (i, j) in enumerate(zip(offsets[:-1], offsets[1:])):
+        length = np.linalg.norm(np.diff(llas[i:j, :2], axis=0), axis=1).sum()
+        assert abs(lengths[k] - length) < 1e-9
+    # inside their (buffered) tiles
+    n = 2**zoom
+    lons = parts[:, 0] / 360 * n + n / 2 - tiles[:, 0].repeat(np.diff(part_offsets))
+    assert lons.min() > -1e-9 and lons.max() < 1 + 1e-9
+    buffered = clip_polylines_to_tiles(llas, offsets, zoom, buffer=0.1)
+    assert len(buffered[0]) > len(parts)
+
+    simplified = clip_polylines_to_tiles(llas, offsets, zoom, epsilon=50.0)
+    assert np.all(simplified[1][1:] - simplified[1][:-1] >= 2)
+    assert len(simplified[1]) == len(part_offsets) and len(simplified[0]) < len(parts)
+    assert np.all(simplified[2] == tiles) and np.all(simplified[3] == ids)
+    with pytest.raises(ValueError):
+        clip_polylines_to_tiles(llas, offsets, 25)
+
+
+def test_map_matcher():
+    # grid of roads split at crossings: y=0 & y=100 (x in [0, 200]), x=0, 100, 200
+    ends = [
+        [[0, 0], [100, 0]],
+        [[100, 0], [200, 0]],
+        [[0, 100], [100, 100]],
+        [[100, 100], [200, 100]],
+        [[0, 0], [0, 100]],
+        [[100, 0], [100, 100]],
+        [[200, 0], [200, 100]],
+    ]
+    coords = np.array(
+        [[*a, 0.0] for a, b in ends for a in (a, (np.add(a, b) / 2).tolist(), b)]
+    )
+    offsets = np.arange(0, len(coords) + 1, 3, dtype=np.int32)
+    matcher = MapMatcher(
+        PolylineIndex(coords, offsets), sigma=5.0, beta=10.0, search_radius=30.0
+    )
+    assert matcher.links(0, True).tolist() == [[1, 0], [5, 0]]
+    np.testing.assert_allclose(matcher.ranges(0), [0, 50, 100])
+
+    # along y=0, up x=100, then along y=100 (with noise)
+    truth = np.array(
+        [[x, 0, 0] for x in range(0, 101, 10)]
+        + [[100, y, 0] for y in range(10, 101, 10)]
+        + [[x, 100, 0] for x in range(110, 200, 10)],
+        dtype=np.float64,
+    )
+    expected = np.array([0] * 11 + [5] * 10 + [3] * 9)
+    rng = np.random.default_rng(25)
+    trace = truth + rng.normal(size=truth.shape) * [1.5, 1.5, 0]
+    ids, points, segs, ts, ranges = matcher.match(trace)
+    corners = np.all(truth[:, :2] % 100 == 0, axis=1)
+    assert np.all(ids[~corners] == expected[~corners])
+    for i, k in enumerate(ids):
+        r = matcher.ranges(k)
+        assert (
+            abs(r[segs[i]] + (r[segs[i] + 1] - r[segs[i]]) * ts[i] - ranges[i]) < 1e-9
+        )
+        polyline = coords[offsets[k] : offsets[k + 1]]
+        np.testing.assert_allclose(
+            points[i],
+            polyline[segs[i]] + (polyline[segs[i] + 1] - polyline[segs[i]]) * ts[i],
+        )
+
+    # points without candidates are left unmatched
+    outlier = trace.copy()
+    outlier[5, 1] = 500
+    ids2, points2, *_ = matcher.match(outlier)
+    assert ids2[5] == -1 and np.all(points2[5] == outlier[5])
+    assert np.all(np.delete(ids2, 5) == np.delete(ids, 5))
+
+    batch = np.vstack([trace, outlier, [[1000, 1000, 0]]])
+    batch_offsets = np.array(
+        [0, len(trace), 2 * len(trace), len(batch)], dtype=np.int32
+    )
+    ids3, *_ = matcher.match_batch(batch, batch_offsets, n_threads=2)
+    assert np.all(ids3 == np.r_[ids, ids2, -1])
+
+    rulers = [PolylineRuler(coords[i:j]) for i, j in zip(offsets[:-1], offsets[1:])]
+    assert np.all(MapMatcher(rulers, search_radius=30.0).match(trace)[0] == ids)
+    with pytest.raises(ValueError):
+        MapMatcher(rulers, sigma=0.0)
+    with pytest.raises(ValueError):
+        MapMatcher(rulers, max_route_factor=0.0)
+
+    # consecutive fixes skipping a short polyline in between (1), routed
+    # onto 2 through it, not onto the (nearer, unconnected) parallel 3
+    coords = np.array(
+        [[0, 0], [100, 0], [100, 0], [110, 0], [110, 0], [300, 0], [110, 8], [300, 8]],
+        dtype=np.float64,
+    )
+    index = PolylineIndex(np.c_[coords, np.zeros(8)], [0, 2, 4, 6, 8])
+    trace = [[50, 1, 0], [200, 4.5, 0]]
+    matcher = MapMatcher(index, search_radius=30.0)
+    del index  # shared with (and kept alive by) the matcher, not copied
+    ids, points, segs, ts, ranges = matcher.match(trace)
+    assert ids.tolist() == [0, 2]
+    np.testing.assert_allclose(ranges, [50, 90])
+    assert matcher.max_route_factor() == 4.0
+    # routes longer than the bound are impossible, the chain breaks
+    bounded = MapMatcher(matcher.index(), search_radius=30.0, max_route_factor=0.1)
+    assert bounded.match(trace)[0].tolist() == [0, 3]
+
+
+def test_visvalingam():
+    # collinear points span no area
+    coords = [[1, 1, 0], [2, 2, 0], [3, 3, 0], [4, 4, 0]]
+    assert visvalingam_simplify(coords, 0.0).shape == (2, 3)
+    assert np.all(visvalingam_simplify_mask(coords, 0.0) == [1, 0, 0, 1])
+    assert np.all(visvalingam_simplify_indexes(coords, 0.0) == [0, 3])
+
+    coords = [[0, 0], [5, -2], [10, 0], [10, 5], [5, -1]]
+    assert np.all(visvalingam_simplify_mask(coords, 11.0) == [1, 0, 1, 1, 1])
+    assert visvalingam_simplify(coords, 11.0).shape == (4, 2)
+    # dropping (5, -2) would cross segment (10, 5) -> (5, -1)
+    mask = visvalingam_simplify_mask(coords, 11.0, preserve_topology=True)
+    assert np.all(mask == [1, 1, 1, 1, 1])
+    assert np.all(visvalingam_simplify_indexes(coords, 100.0) == [0, 4])
+
+    # triangle of ~1070 m^2
+    llas = [[120, 30, 0], [120.001, 30.0001, 0], [120.002, 30, 0]]
+    assert np.all(visvalingam_simplify_mask(llas, 1000, is_wgs84=True) == [1, 1, 1])
+    assert np.all(visvalingam_simplify_mask(llas, 1100, is_wgs84=True) == [1, 0, 1])
+
+
 def test_cheap_ruler():
     assert CheapRuler.RE
     assert CheapRuler.FE
@@ -440,6 +1516,64 @@ def test_cheap_ruler():
     assert dist == ruler.k()[1]
 
 
+def test_cheap_ruler_batch():
+    rng = np.random.default_rng(20)
+    ruler = CheapRuler(60.0)
+    a = np.c_[
+        rng.uniform(-200, 200, 1000), rng.uniform(55, 65, 1000), rng.normal(size=1000)
+    ]
+    b = np.c_[
+        rng.uniform(-200, 200, 1000), rng.uniform(55, 65, 1000), rng.normal(size=1000)
+    ]
+    a[0], b[0] = [179.9, 60, 0], [-179.9, 60, 0]  # across the antimeridian
+    for n_threads in [1, 4]:
+        dists = ruler.distances(a, b, n_threads=n_threads)
+        assert np.all(dists == [ruler.distance(p, q) for p, q in zip(a, b)])
+    assert dists[0] == pytest.approx(0.2 * ruler.k()[0], rel=1e-6)
+    assert np.all(ruler.squareDistances(a, b) == dists**2)
+    assert np.all(ruler.bearings(a, b) == [ruler.bearing(p, q) for p, q in zip(a, b)])
+    assert np.all(ruler.deltas(a, b) == [ruler.delta(p, q) for p, q in zip(a, b)])
+    # one-to-many
+    assert np.all(ruler.distances(a[:1], b) == [ruler.distance(a[0], q) for q in b])
+    assert np.all(ruler.distances(a, b[:1]) == [ruler.distance(p, b[0]) for p in a])
+    matrix = ruler.distanceMatrix(a[:30], b[:20])
+    assert matrix.shape == (30, 20)
+    assert matrix[7, 3] == ruler.distance(a[7], b[3])
+    with pytest.raises(ValueError):
+        ruler.distances(a, b[:10])
+
+    lengths = rng.uniform(0, 1000, 1000)
+    angles = rng.uniform(-180, 180, 1000)
+    points = ruler.destinations(a, lengths, angles)
+    assert np.all(points[5] == ruler.destination(a[5], lengths[5], angles[5]))
+    np.testing.assert_allclose(ruler.distances(a, points), lengths, atol=1e-6)
+    # many origins, one distance & bearing (and one origin, many of them)
+    points = ruler.destinations(a, [100.0], [45.0])
+    assert points.shape == a.shape
+    assert np.all(points[7] == ruler.destination(a[7], 100.0, 45.0))
+    points = ruler.destinations(a[:1], lengths, angles)
+    assert np.all(points[9] == ruler.destination(a[0], lengths[9], angles[9]))
+    points = ruler.offsets(a[:1], np.c_[lengths, lengths, lengths])
+    np.testing.assert_allclose(points[9], ruler.offset(a[0], *[lengths[9]] * 3))
+
+    mins, maxs = ruler.bufferPoints(a, 100.0)
+    assert np.all(mins[3] == ruler.bufferPoint(a[3], 100.0)[0])
+    assert np.all(maxs[3] == ruler.bufferPoint(a[3], 100.0)[1])
+    bbox = ([-10, 56, -1], [120, 60, 1])
+    mask = CheapRuler._insideBBox(a, bbox, check_z=True)
+    assert np.all(mask == [CheapRuler._insideBBox(p, bbox, check_z=True) for p in a])
+    # old keyword spelling still works
+    assert CheapRuler._insideBBox(a[0], bbox, cheak_z=True) == mask[0]
+    # batches wrap longitude differences like the scalar methods
+    c = np.array([[179.9, 10, 0], [-179.9, 10, 0], [180, 10, 0]])
+    d = np.array([[-179.9, 10, 0], [179.9, 10, 0], [-179.99, 11, 0]])
+    assert np.all(ruler.distances(c, d) == [ruler.distance(p, q) for p, q in zip(c, d)])
+    assert np.all(ruler.bearings(c, d) == [ruler.bearing(p, q) for p, q in zip(c, d)])
+    assert np.all(ruler.deltas(c, d) == [ruler.delta(p, q) for p, q in zip(c, d)])
+    bbox = ([170, 0, -1], [-170, 20, 1])
+    assert np.all(CheapRuler._insideBBox(c, bbox) == 1)
+
+
 def test_snap_onto():
     P, dist, t = snap_onto_2d([13, 4], [0, 0], [10, 0])
     assert P.tolist() == [10, 0]